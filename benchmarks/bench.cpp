@@ -0,0 +1,217 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "bench.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> bytes{0};
+
+void *counted_malloc(size_t const size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(size, std::memory_order_relaxed);
+  void *const p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc{};
+  }
+  return p;
+}
+
+struct Benchmark {
+  std::string name;
+  Bench_function function;
+};
+
+std::vector<Benchmark> &registry() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct Result {
+  std::string name;
+  size_t iterations;
+  double ns_per_op;
+  double allocations_per_op;
+  double bytes_per_op;
+};
+
+Result run(Benchmark const &benchmark, std::chrono::nanoseconds const min) {
+  static auto const max_iterations = size_t{1} << 30U;
+  auto n = size_t{1};
+  while (true) {
+    Bench_state state{n};
+    benchmark.function(state);
+    auto const elapsed = std::chrono::steady_clock::now() - state.start_time;
+    auto const allocs = allocation_count() - state.start_allocations;
+    auto const size = allocated_bytes() - state.start_bytes;
+    if (elapsed >= min || n >= max_iterations) {
+      auto const ns = std::chrono::duration<double, std::nano>(elapsed);
+      return {benchmark.name, n, ns.count() / n,
+              static_cast<double>(allocs) / n, static_cast<double>(size) / n};
+    }
+    // aim a bit above the minimum time, but grow at most 100 times per run
+    auto const elapsed_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    auto const ratio = static_cast<double>(min.count()) /
+                       static_cast<double>(std::max(elapsed_ns, int64_t{1}));
+    auto const next = static_cast<size_t>(n * std::min(ratio * 1.2, 100.0));
+    n = std::min(std::max(next, n + 1), max_iterations);
+  }
+}
+
+void write_json(std::ostream &out, std::vector<Result> const &results) {
+  out << "{\"benchmarks\": [";
+  char const *sep = "\n";
+  for (auto const &r : results) {
+    out << sep << "  {\"name\": \"" << r.name
+        << "\", \"iterations\": " << r.iterations
+        << ", \"ns_per_op\": " << r.ns_per_op
+        << ", \"allocations_per_op\": " << r.allocations_per_op
+        << ", \"bytes_per_op\": " << r.bytes_per_op << "}";
+    sep = ",\n";
+  }
+  out << "\n]}\n";
+}
+
+void print_help() {
+  std::cout << "usage: sleep-proxy-bench [-f FILTER] [-j FILE] [-t MS]\n"
+               "  -f, --filter FILTER  run benchmarks containing FILTER\n"
+               "  -j, --json FILE      write the results as JSON to FILE\n"
+               "  -t, --min-time MS    run each benchmark at least MS ms\n";
+}
+} // namespace
+
+void *operator new(size_t const size) { return counted_malloc(size); }
+void *operator new[](size_t const size) { return counted_malloc(size); }
+void operator delete(void *const p) noexcept { std::free(p); }
+void operator delete[](void *const p) noexcept { std::free(p); }
+void operator delete(void *const p, size_t /*unused*/) noexcept {
+  std::free(p);
+}
+void operator delete[](void *const p, size_t /*unused*/) noexcept {
+  std::free(p);
+}
+
+uint64_t allocation_count() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t allocated_bytes() { return bytes.load(std::memory_order_relaxed); }
+
+Bench_state::Bench_state(size_t const iterations)
+    : n{iterations}, start_time{}, start_allocations{0}, start_bytes{0} {
+  start();
+}
+
+void Bench_state::start() {
+  start_allocations = allocation_count();
+  start_bytes = allocated_bytes();
+  start_time = std::chrono::steady_clock::now();
+}
+
+Bench_registration::Bench_registration(char const *name,
+                                       Bench_function function) {
+  registry().push_back({name, function});
+}
+
+std::vector<uint8_t> from_hex(std::string const &hex) {
+  if (hex.size() % 2 != 0) {
+    throw std::invalid_argument("odd number of hex digits: " + hex);
+  }
+  std::vector<uint8_t> result;
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    result.push_back(
+        static_cast<uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+  }
+  return result;
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+int main(int argc, char *argv[]) {
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+  static const option long_options[] = {
+      {"help", no_argument, nullptr, 'h'},
+      {"filter", required_argument, nullptr, 'f'},
+      {"json", required_argument, nullptr, 'j'},
+      {"min-time", required_argument, nullptr, 't'},
+      {nullptr, 0, nullptr, 0}};
+  std::string filter;
+  std::string json_path;
+  auto min_time = std::chrono::milliseconds{200};
+  int c = -1;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  while ((c = getopt_long(argc, argv, "hf:j:t:", long_options, nullptr)) !=
+         -1) {
+    switch (c) {
+    case 'f':
+      filter = optarg;
+      break;
+    case 'j':
+      json_path = optarg;
+      break;
+    case 't':
+      min_time = std::chrono::milliseconds{std::stoul(optarg)};
+      break;
+    case 'h':
+      print_help();
+      return 0;
+    default:
+      print_help();
+      return 1;
+    }
+  }
+
+  // the info messages of the parsers would be measured as well
+  set_log_level(LOG_WARNING);
+  std::vector<Result> results;
+  std::cout << std::left << std::setw(40) << "benchmark" << std::right
+            << std::setw(12) << "iterations" << std::setw(12) << "ns/op"
+            << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op\n";
+  for (auto const &benchmark : registry()) {
+    if (benchmark.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    results.push_back(run(benchmark, min_time));
+    auto const &r = results.back();
+    std::cout << std::left << std::setw(40) << r.name << std::right
+              << std::setw(12) << r.iterations << std::fixed
+              << std::setprecision(1) << std::setw(12) << r.ns_per_op
+              << std::setprecision(2) << std::setw(12) << r.allocations_per_op
+              << std::setprecision(1) << std::setw(12) << r.bytes_per_op
+              << '\n';
+  }
+  if (!json_path.empty()) {
+    std::ofstream out{json_path};
+    write_json(out, results);
+    if (!out) {
+      std::cerr << "can't write " << json_path << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
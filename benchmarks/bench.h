@@ -0,0 +1,67 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Passed to every benchmark: the function has to repeat the measured
+ * operation iterations() times. Setup before start() is not measured.
+ */
+class Bench_state {
+  size_t const n;
+
+public:
+  std::chrono::steady_clock::time_point start_time;
+  uint64_t start_allocations;
+  uint64_t start_bytes;
+
+  explicit Bench_state(size_t const iterations);
+
+  size_t iterations() const { return n; }
+
+  /** resets the clock and the allocation counters */
+  void start();
+};
+
+using Bench_function = void (*)(Bench_state &);
+
+/** adds a benchmark to the suite, use BENCHMARK() */
+struct Bench_registration {
+  Bench_registration(char const *name, Bench_function function);
+};
+
+/** the number and size of allocations since the program started */
+uint64_t allocation_count();
+uint64_t allocated_bytes();
+
+/** keeps the compiler from optimizing away a result */
+template <typename T> void do_not_optimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** "0800" -> {0x08, 0x00}, for frames copied from wireshark */
+std::vector<uint8_t> from_hex(std::string const &hex);
+
+#define BENCHMARK(name)                                                        \
+  void name(Bench_state &state);                                               \
+  Bench_registration const name##_registration{#name, name};                   \
+  void name(Bench_state &state)
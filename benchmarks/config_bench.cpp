@@ -0,0 +1,136 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "bench.h"
+
+#include "address_index.h"
+#include "args.h"
+#include "config_snapshot.h"
+#include "host_table.h"
+#include "to_string.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <random>
+#include <unistd.h>
+
+namespace {
+/** a configuration of count hosts on a few interfaces */
+std::string many_hosts(size_t const count) {
+  std::string config;
+  for (size_t i = 0; i < count; ++i) {
+    auto const low = to_string(i % 250 + 1);
+    auto const high = to_string(i / 250 % 250);
+    config += "host\n"
+              "name host-" +
+              to_string(i) +
+              "\n"
+              "address 10.1." +
+              high + "." + low +
+              "/16\n"
+              "address 2001:db8::" +
+              high + ":" + low +
+              "/64\n"
+              "port 22\n"
+              "port 445\n"
+              "mac 02:00:00:00:" +
+              high + ":" + low +
+              "\n"
+              "interface br-lan" +
+              to_string(i % 4) +
+              "\n"
+              "ping_tries 5\n"
+              "wol_method ethernet\n\n";
+  }
+  return config;
+}
+
+BENCHMARK(parse_host_table_10000_hosts) {
+  auto const config = many_hosts(10000);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(parse_host_table(config).size());
+  }
+}
+
+BENCHMARK(read_snapshot_10000_hosts) {
+  std::array<char, 32> path{{"/tmp/config_benchXXXXXX"}};
+  close(mkstemp(path.data()));
+  write_snapshot(parse_host_table(many_hosts(10000)), path.data());
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(read_snapshot(path.data()).size());
+  }
+  unlink(path.data());
+}
+
+BENCHMARK(args_of_10000_table_rows) {
+  auto const table = parse_host_table(many_hosts(10000));
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    std::vector<Args> args;
+    args.reserve(table.size());
+    for (size_t host = 0; host < table.size(); ++host) {
+      args.emplace_back(table, host);
+    }
+    do_not_optimize(args.size());
+  }
+}
+/** the addresses of all hosts in random order */
+std::vector<IP_address> destinations_of(Host_table const &table) {
+  std::vector<IP_address> destinations;
+  for (size_t host = 0; host < table.size(); ++host) {
+    for (auto const &address : table.addresses_of(host)) {
+      destinations.push_back(address);
+    }
+  }
+  std::shuffle(std::begin(destinations), std::end(destinations),
+               std::mt19937{42});
+  return destinations;
+}
+
+BENCHMARK(address_index_lookup_10000_hosts) {
+  auto const table = parse_host_table(many_hosts(10000));
+  auto const index = index_host_addresses(table);
+  auto const destinations = destinations_of(table);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(index.lookup(destinations[i % destinations.size()]));
+  }
+}
+
+/** what a lookup costs without an index */
+BENCHMARK(linear_scan_lookup_10000_hosts) {
+  auto const table = parse_host_table(many_hosts(10000));
+  std::vector<Args> args;
+  for (size_t host = 0; host < table.size(); ++host) {
+    args.emplace_back(table, host);
+  }
+  auto const destinations = destinations_of(table);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    auto const &destination = destinations[i % destinations.size()];
+    do_not_optimize(std::find_if(std::begin(args), std::end(args),
+                                 [&destination](Args const &host) {
+                                   return std::find(std::begin(host.address),
+                                                    std::end(host.address),
+                                                    destination) !=
+                                          std::end(host.address);
+                                 }) -
+                    std::begin(args));
+  }
+}
+} // namespace
@@ -0,0 +1,165 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/**
+ * Stand-in for a sleeping host in the netns benchmark. It reads lines of
+ * "DEVICE MAC IP/PREFIX" and brings IP up on DEVICE some time after a magic
+ * packet for MAC arrived on the capture interface. It accepts and closes TCP
+ * connections on the given port for all of them.
+ */
+
+#include "argv_arena.h"
+#include "ethernet.h"
+#include "file_descriptor.h"
+#include "log.h"
+#include "pcap_wrapper.h"
+#include "spawn_process.h"
+#include "wol_watcher.h"
+
+#include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+struct Fake_host {
+  std::string device;
+  ether_addr mac;
+  std::string address;
+};
+
+std::vector<Fake_host> read_hosts(std::string const &path) {
+  std::ifstream file{path};
+  if (!file) {
+    throw std::runtime_error("can't open " + path);
+  }
+  std::vector<Fake_host> hosts;
+  std::string device;
+  std::string mac;
+  std::string address;
+  while (file >> device >> mac >> address) {
+    hosts.push_back({device, mac_to_binary(mac), address});
+  }
+  return hosts;
+}
+
+void wake_up(Fake_host const &host, std::chrono::milliseconds const delay) {
+  std::this_thread::sleep_for(delay);
+  Argv_arena cmd;
+  // replace does not fail if a second magic packet came in
+  cmd << "ip"
+      << "addr"
+      << "replace" << host.address << "dev" << host.device;
+  if (spawn(cmd) != 0) {
+    LOG(LOG_ERR, "failed to wake up %s", host.address.c_str());
+  }
+}
+
+/** completes the handshake of connections to any of the hosts */
+void accept_connections(uint16_t const port) {
+  File_descriptor const listener{socket(AF_INET, SOCK_STREAM, 0)};
+  int const on = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in any{};
+  any.sin_family = AF_INET;
+  any.sin_port = htons(port);
+  any.sin_addr.s_addr = htonl(INADDR_ANY);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (bind(listener, reinterpret_cast<sockaddr const *>(&any), sizeof(any)) !=
+          0 ||
+      listen(listener, SOMAXCONN) != 0) {
+    throw std::runtime_error(std::string("can't listen: ") + strerror(errno));
+  }
+  while (true) {
+    auto const fd = accept(listener, nullptr, nullptr);
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void print_usage() {
+  std::cout << "usage: fake_host -i IFACE [-d MS] [-p PORT] HOSTS\n"
+               "  -i, --interface IFACE  where magic packets arrive\n"
+               "  -d, --delay MS         time from magic packet to ip up\n"
+               "  -p, --port PORT        TCP port to accept connections on\n"
+               "HOSTS has lines of DEVICE MAC IP/PREFIX\n";
+}
+} // namespace
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+int main(int argc, char *argv[]) {
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+  static const option long_options[] = {
+      {"help", no_argument, nullptr, 'h'},
+      {"interface", required_argument, nullptr, 'i'},
+      {"delay", required_argument, nullptr, 'd'},
+      {"port", required_argument, nullptr, 'p'},
+      {nullptr, 0, nullptr, 0}};
+  std::string iface;
+  auto delay = std::chrono::milliseconds{1000};
+  auto port = uint16_t{80};
+  int c = -1;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  while ((c = getopt_long(argc, argv, "hi:d:p:", long_options, nullptr)) !=
+         -1) {
+    switch (c) {
+    case 'i':
+      iface = optarg;
+      break;
+    case 'd':
+      delay = std::chrono::milliseconds{std::stoul(optarg)};
+      break;
+    case 'p':
+      port = static_cast<uint16_t>(std::stoul(optarg));
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+  if (iface.empty() || optind + 1 != argc) {
+    print_usage();
+    return 1;
+  }
+  try {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto const hosts = read_hosts(argv[optind]);
+    std::thread{accept_connections, port}.detach();
+    Pcap_wrapper capture{iface};
+    capture.set_filter("udp port 9 or ether proto 0x0842");
+    capture.loop(0, [&](pcap_pkthdr const *header, u_char const *packet) {
+      std::vector<uint8_t> const data{packet, packet + header->caplen};
+      for (auto const &host : hosts) {
+        if (is_magic_packet(data, host.mac)) {
+          std::thread{wake_up, host, delay}.detach();
+        }
+      }
+    });
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "fake_host: %s", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "bench.h"
+
+#include "ip_address.h"
+#include "libsleep_proxy.h"
+#include "to_string.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+std::vector<IP_address> many_ips(size_t const count) {
+  std::vector<IP_address> ips;
+  for (size_t i = 0; i < count; ++i) {
+    auto const s = to_string(i);
+    ips.push_back(i % 2 == 0 ? parse_ip("10.0." + to_string(i / 256 % 256) +
+                                        "." + to_string(i % 256))
+                             : parse_ip("2001:db8::" + s));
+  }
+  return ips;
+}
+
+void compare(Bench_state &state, std::string const &lhs,
+             std::string const &rhs) {
+  auto const a = parse_ip(lhs);
+  auto const b = parse_ip(rhs);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(a == b);
+  }
+}
+
+BENCHMARK(ip_address_equal_ipv4) {
+  compare(state, "192.168.1.1/24", "192.168.1.1/24");
+}
+
+BENCHMARK(ip_address_equal_ipv6) {
+  compare(state, "2001:db8::1/64", "2001:db8::1/64");
+}
+
+BENCHMARK(ip_address_equal_mixed) {
+  compare(state, "192.168.1.1/24", "2001:db8::1/64");
+}
+
+BENCHMARK(ip_address_less_ipv6) {
+  auto const a = parse_ip("2001:db8::1/64");
+  auto const b = parse_ip("2001:db8::2/64");
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(a < b);
+  }
+}
+
+void hash(Bench_state &state, std::string const &ip) {
+  auto const a = parse_ip(ip);
+  std::hash<IP_address> const hasher{};
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(hasher(a));
+  }
+}
+
+BENCHMARK(ip_address_hash_ipv4) { hash(state, "192.168.1.1/24"); }
+
+BENCHMARK(ip_address_hash_ipv6) { hash(state, "2001:db8::1/64"); }
+
+/** looks up every one of 1000 addresses */
+BENCHMARK(ip_address_lookup_1000_unordered_set) {
+  auto const ips = many_ips(1000);
+  std::unordered_set<IP_address> const set(std::begin(ips), std::end(ips));
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(set.count(ips[i % ips.size()]));
+  }
+}
+
+BENCHMARK(ip_address_lookup_1000_sorted_vector) {
+  auto ips = many_ips(1000);
+  auto const lookups = ips;
+  std::sort(std::begin(ips), std::end(ips));
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(std::binary_search(std::begin(ips), std::end(ips),
+                                       lookups[i % lookups.size()]));
+  }
+}
+
+BENCHMARK(parse_ip_string_ipv4) {
+  std::string const ip{"192.168.1.1/24"};
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(parse_ip(ip));
+  }
+}
+
+BENCHMARK(parse_ip_string_ipv6) {
+  std::string const ip{"2001:db8::1/64"};
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(parse_ip(ip));
+  }
+}
+
+void rule_of(Bench_state &state, size_t const ip_count,
+             size_t const port_count) {
+  auto const ips = many_ips(ip_count);
+  std::vector<uint16_t> ports;
+  for (size_t i = 0; i < port_count; ++i) {
+    ports.push_back(static_cast<uint16_t>(1000 + i));
+  }
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(rule_to_listen_on_ips_and_ports(ips, ports));
+  }
+}
+
+BENCHMARK(rule_to_listen_on_ips_and_ports_2x2) { rule_of(state, 2, 2); }
+
+BENCHMARK(rule_to_listen_on_ips_and_ports_1000x100) {
+  rule_of(state, 1000, 100);
+}
+} // namespace
@@ -0,0 +1,210 @@
+#!/bin/bash
+#
+# Copyright (C) 2026  Lutz Reinhardt
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+# End to end benchmark of watchHost in network namespaces. Needs root,
+# iproute2, iptables and ping, but no network.
+#
+#   client --- switch (bridge) --- proxy (watchHost)
+#                 |
+#              sleeper (fake_host, one macvlan per host)
+#
+# For every host count it lets all hosts fall asleep, waits until watchHost
+# emulates them, connects to all of them from the client and waits until
+# fake_host has brought them up again. Per round it prints how long arming
+# took, the SYN to established latencies and the CPU time of watchHost.
+#
+# usage: netns_wake.sh BUILD_DIR [HOST_COUNT...]
+# environment: ROUNDS (3), WAKE_DELAY_MS (1000), PORT (80)
+
+set -euo pipefail
+
+build=${1:?usage: $0 BUILD_DIR [HOST_COUNT...]}
+shift
+counts=("$@")
+if [ ${#counts[@]} -eq 0 ]; then
+	counts=(1 10 100 1000)
+fi
+rounds=${ROUNDS:-3}
+wake_delay_ms=${WAKE_DELAY_MS:-1000}
+port=${PORT:-80}
+
+watch_host=$build/src/watchHost
+fake_host=$build/benchmarks/fake_host
+work=$(mktemp -d)
+ticks=$(getconf CLK_TCK)
+
+now_ms() {
+	echo $(($(date +%s%N) / 1000000))
+}
+
+host_ip() {
+	echo "10.200.$((1 + $1 / 250)).$((1 + $1 % 250))"
+}
+
+host_mac() {
+	printf '02:00:00:00:%02x:%02x' $(($1 / 256)) $(($1 % 256))
+}
+
+cleanup() {
+	# killing the namespaces' processes before deleting them
+	for ns in sp-client sp-proxy sp-sleeper sp-switch; do
+		ip netns pids $ns 2>/dev/null | xargs -r kill 2>/dev/null || true
+		ip netns del $ns 2>/dev/null || true
+	done
+	rm -rf "$work"
+}
+trap cleanup EXIT
+
+setup_network() {
+	for ns in sp-client sp-proxy sp-sleeper sp-switch; do
+		ip netns add $ns
+		ip -n $ns link set lo up
+	done
+	ip -n sp-switch link add br0 type bridge
+	ip -n sp-switch link set br0 up
+	for end in client:c0 proxy:p0 sleeper:s0; do
+		local ns=sp-${end%%:*}
+		local dev=${end##*:}
+		ip -n sp-switch link add sw-$dev type veth peer name $dev netns $ns
+		ip -n sp-switch link set sw-$dev master br0 up
+		ip -n $ns link set $dev up
+	done
+	ip -n sp-client addr add 10.200.0.1/16 dev c0
+	ip -n sp-proxy addr add 10.200.0.2/16 dev p0
+}
+
+# one macvlan per host, the ip is added by fake_host upon WOL
+setup_hosts() {
+	local count=$1
+	: >"$work/hosts"
+	: >"$work/watchhosts"
+	: >"$work/sleep"
+	for ((i = 0; i < count; i++)); do
+		echo "link add h$i link s0 address $(host_mac $i) type macvlan mode bridge"
+		echo "link set h$i up"
+	done | ip -n sp-sleeper -batch -
+	for ((i = 0; i < count; i++)); do
+		echo "h$i $(host_mac $i) $(host_ip $i)/16" >>"$work/hosts"
+		echo "addr flush dev h$i" >>"$work/sleep"
+		cat >>"$work/watchhosts" <<-EOF
+			host
+			name h$i
+			address $(host_ip $i)/16
+			port $port
+			mac $(host_mac $i)
+			interface p0
+			ping_tries 20
+			wol_method ethernet
+
+		EOF
+	done
+}
+
+remove_hosts() {
+	local count=$1
+	for ((i = 0; i < count; i++)); do
+		echo "link del h$i"
+	done | ip -n sp-sleeper -batch -
+}
+
+armed_hosts() {
+	ip -n sp-proxy -o -4 addr show dev p0 | grep -vc " 10.200.0.2/" || true
+}
+
+cpu_ticks() {
+	awk '{ print $14 + $15 }' "/proc/$1/stat"
+}
+
+# prints the latency of a connect() to $1 in ms
+connect_ms() {
+	local start
+	start=$(now_ms)
+	if ip netns exec sp-client timeout 60 \
+		bash -c "exec 3<>/dev/tcp/$1/$port" 2>/dev/null; then
+		echo $(($(now_ms) - start))
+	else
+		echo "failed"
+	fi
+}
+
+percentiles() {
+	sort -n | awk '{ v[NR] = $1 }
+		END {
+			if (NR == 0) { print "no connections"; exit }
+			printf "p50 %d ms, p90 %d ms, p99 %d ms, max %d ms\n",
+				v[int(NR * 0.5) + 1 > NR ? NR : int(NR * 0.5) + 1],
+				v[int(NR * 0.9) + 1 > NR ? NR : int(NR * 0.9) + 1],
+				v[int(NR * 0.99) + 1 > NR ? NR : int(NR * 0.99) + 1],
+				v[NR]
+		}'
+}
+
+run_count() {
+	local count=$1
+	setup_hosts "$count"
+	ip netns exec sp-sleeper "$fake_host" -i s0 -d "$wake_delay_ms" \
+		-p "$port" "$work/hosts" &
+	ip netns exec sp-proxy "$watch_host" -c "$work/watchhosts" &
+	# ip netns exec execs the program, so this is watchHost itself
+	local proxy=$!
+
+	for ((round = 1; round <= rounds; round++)); do
+		# all hosts fall asleep
+		ip -n sp-sleeper -batch "$work/sleep"
+		local slept cpu_before
+		slept=$(now_ms)
+		cpu_before=$(cpu_ticks "$proxy")
+		until [ "$(armed_hosts)" -ge "$count" ]; do
+			sleep 0.1
+		done
+		local armed=$(($(now_ms) - slept))
+
+		: >"$work/latencies"
+		local connections=()
+		for ((i = 0; i < count; i++)); do
+			connect_ms "$(host_ip $i)" >>"$work/latencies" &
+			connections+=($!)
+		done
+		wait "${connections[@]}"
+		local cycle=$(($(now_ms) - slept))
+		local cpu=$((($(cpu_ticks "$proxy") - cpu_before) * 1000 / ticks))
+
+		echo "hosts $count round $round: armed after $armed ms," \
+			"cycle $cycle ms, watchHost cpu $((cpu / count)) ms per host"
+		echo "  failed connections: $(grep -c failed "$work/latencies" || true)"
+		echo "  SYN to established: $(grep -v failed "$work/latencies" |
+			percentiles)"
+	done
+
+	ip netns pids sp-proxy | xargs -r kill
+	ip netns pids sp-sleeper | xargs -r kill
+	wait 2>/dev/null || true
+	remove_hosts "$count"
+}
+
+for program in "$watch_host" "$fake_host"; do
+	if [ ! -x "$program" ]; then
+		echo "$program is missing, build with ninja -C $build" >&2
+		exit 1
+	fi
+done
+
+setup_network
+for count in "${counts[@]}"; do
+	run_count "$count"
+done
@@ -0,0 +1,113 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "bench.h"
+
+#include "ethernet.h"
+#include "ip.h"
+#include "packet_parser.h"
+#include "wol.h"
+#include "wol_watcher.h"
+
+namespace {
+// the frames of tests/packet_parser_test.cpp
+std::string const ipv4_tcp = "4500003c88d040004006b3e97f0000017f000001";
+std::string const ipv6_tcp = "6000000000280640000000000000000000000000000000"
+                             "0100000000000000000000000000000001";
+std::string const ethernet = "000000000000000000000000";
+std::string const sll = "000000010006000000000000";
+std::string const vlan = "810000010800";
+
+void get_headers_of(Bench_state &state, int const type,
+                    std::string const &hex) {
+  auto const frame = from_hex(hex);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(get_headers(type, frame));
+  }
+}
+
+BENCHMARK(get_headers_ethernet_ipv4) {
+  get_headers_of(state, DLT_EN10MB, ethernet + "0800" + ipv4_tcp);
+}
+
+BENCHMARK(get_headers_ethernet_ipv6) {
+  get_headers_of(state, DLT_EN10MB, ethernet + "86dd" + ipv6_tcp);
+}
+
+BENCHMARK(get_headers_ethernet_vlan_ipv4) {
+  get_headers_of(state, DLT_EN10MB, ethernet + vlan + ipv4_tcp);
+}
+
+BENCHMARK(get_headers_sll_ipv4) {
+  get_headers_of(state, DLT_LINUX_SLL, sll + "00000800" + ipv4_tcp);
+}
+
+BENCHMARK(get_headers_sll_ipv6) {
+  get_headers_of(state, DLT_LINUX_SLL, sll + "000086dd" + ipv6_tcp);
+}
+
+BENCHMARK(get_headers_sll_vlan_ipv4) {
+  get_headers_of(state, DLT_LINUX_SLL, sll + "0000" + vlan + ipv4_tcp);
+}
+
+void parse_ip_of(Bench_state &state, uint16_t const type,
+                 std::string const &hex) {
+  auto const header = from_hex(hex);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(parse_ip(type, std::begin(header), std::end(header)));
+  }
+}
+
+BENCHMARK(parse_ip_ipv4) { parse_ip_of(state, ETHERTYPE_IP, ipv4_tcp); }
+
+BENCHMARK(parse_ip_ipv6) { parse_ip_of(state, ETHERTYPE_IPV6, ipv6_tcp); }
+
+ether_addr const mac = mac_to_binary("01:23:45:67:89:ab");
+
+/** frames without a magic packet, the whole frame has to be searched */
+void is_magic_packet_of(Bench_state &state, size_t const size) {
+  std::vector<uint8_t> const frame(size, 0xff);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(is_magic_packet(frame, mac));
+  }
+}
+
+BENCHMARK(is_magic_packet_64) { is_magic_packet_of(state, 64); }
+
+BENCHMARK(is_magic_packet_512) { is_magic_packet_of(state, 512); }
+
+BENCHMARK(is_magic_packet_1500) { is_magic_packet_of(state, 1500); }
+
+BENCHMARK(is_magic_packet_9000) { is_magic_packet_of(state, 9000); }
+
+BENCHMARK(is_magic_packet_match) {
+  auto const frame =
+      from_hex(ethernet + "0842") + create_wol_payload(mac);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(is_magic_packet(frame, mac));
+  }
+}
+
+BENCHMARK(create_wol_payload) {
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(create_wol_payload(mac));
+  }
+}
+} // namespace
@@ -0,0 +1,129 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+/**
+ * Runs recorded captures through the packet pipeline of the proxy:
+ * Catch_incoming_connection, and with that get_headers, and the magic packet
+ * search of Wol_watcher. Prints what was found and the packets per second.
+ */
+
+#include "ethernet.h"
+#include "log.h"
+#include "packet_parser.h"
+#include "pcap_wrapper.h"
+#include "wol_watcher.h"
+
+#include <cinttypes>
+#include <getopt.h>
+#include <iostream>
+
+namespace {
+struct Totals {
+  uint64_t packets{0};
+  uint64_t bytes{0};
+  uint64_t ipv4{0};
+  uint64_t ipv6{0};
+  uint64_t unparsed{0};
+  uint64_t magic_packets{0};
+};
+
+void replay(std::string const &path, bool const realtime,
+            std::vector<ether_addr> const &macs, Totals &totals) {
+  Pcap_wrapper pc{Pcap_wrapper::Offline{path, realtime}};
+  Catch_incoming_connection cic{pc.get_datalink()};
+  pc.loop(0, [&](pcap_pkthdr const *header, u_char const *packet) {
+    ++totals.packets;
+    totals.bytes += header->caplen;
+    cic(header, packet);
+    auto const &ip_header = std::get<1>(cic.headers);
+    if (ip_header == nullptr) {
+      ++totals.unparsed;
+    } else if (ip_header->version() == ip::ipv4) {
+      ++totals.ipv4;
+    } else {
+      ++totals.ipv6;
+    }
+    for (auto const &mac : macs) {
+      if (is_magic_packet(cic.data, mac)) {
+        ++totals.magic_packets;
+      }
+    }
+  });
+}
+
+void print_usage() {
+  std::cout << "usage: pcap_replay [-r] [-m MAC]... FILE...\n"
+               "  -r, --realtime  keep the recorded gaps between packets\n"
+               "  -m, --mac MAC   count magic packets for MAC\n";
+}
+} // namespace
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+int main(int argc, char *argv[]) {
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+  static const option long_options[] = {
+      {"help", no_argument, nullptr, 'h'},
+      {"realtime", no_argument, nullptr, 'r'},
+      {"mac", required_argument, nullptr, 'm'},
+      {nullptr, 0, nullptr, 0}};
+  bool realtime = false;
+  std::vector<ether_addr> macs;
+  int c = -1;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  while ((c = getopt_long(argc, argv, "hrm:", long_options, nullptr)) != -1) {
+    switch (c) {
+    case 'r':
+      realtime = true;
+      break;
+    case 'm':
+      macs.push_back(mac_to_binary(optarg));
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    print_usage();
+    return 1;
+  }
+  // per packet messages would be measured as well
+  set_log_level(LOG_WARNING);
+  Totals totals;
+  auto const start = std::chrono::steady_clock::now();
+  try {
+    for (int i = optind; i < argc; ++i) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      replay(argv[i], realtime, macs, totals);
+    }
+  } catch (std::exception const &e) {
+    std::cerr << "pcap_replay: " << e.what() << '\n';
+    return 1;
+  }
+  auto const seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  std::cout << totals.packets << " packets (" << totals.ipv4 << " IPv4, "
+            << totals.ipv6 << " IPv6, " << totals.unparsed << " unparsed), "
+            << totals.magic_packets << " magic packets\n"
+            << seconds << " s, " << totals.packets / seconds
+            << " packets/s, " << totals.bytes * 8 / seconds / 1e6
+            << " Mbit/s\n";
+  return 0;
+}
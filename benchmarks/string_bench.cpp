@@ -0,0 +1,130 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "bench.h"
+
+#include "args.h"
+#include "argv_arena.h"
+#include "container_utils.h"
+#include "ip_address.h"
+#include "scope_guard.h"
+#include "text_writer.h"
+#include "to_string.h"
+
+namespace {
+/** like a line of ip neigh */
+std::string const neigh_line{
+    "fe80::1 dev eth0 lladdr 11:22:33:44:55:66 router REACHABLE"};
+
+BENCHMARK(split_line) {
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(split(neigh_line, ' '));
+  }
+}
+
+BENCHMARK(split_1000_fields) {
+  std::string line;
+  for (int i = 0; i < 1000; ++i) {
+    line += to_string(i) + ',';
+  }
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(split(line, ','));
+  }
+}
+
+BENCHMARK(join_1000_integers) {
+  std::vector<uint16_t> const ports(1000, 8080);
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(join(ports, identity<uint16_t>, " or "));
+  }
+}
+
+BENCHMARK(to_string_integer) {
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(to_string(i));
+  }
+}
+
+BENCHMARK(to_string_ip_address) {
+  auto const ip = parse_ip("2001:db8::1/64");
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(to_string(ip));
+  }
+}
+BENCHMARK(ip_address_with_subnet) {
+  auto const ip = parse_ip("2001:db8::1/64");
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(ip.with_subnet());
+  }
+}
+
+BENCHMARK(ip_address_with_subnet_text) {
+  auto const ip = parse_ip("2001:db8::1/64");
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(ip.with_subnet_text());
+  }
+}
+
+BENCHMARK(text_writer_log_line) {
+  auto const ip = parse_ip("2001:db8::1/64");
+  std::array<char, 128> text{};
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    Text_writer out{text};
+    out << "ping " << ip << " attempt " << i;
+    do_not_optimize(out.size());
+  }
+}
+
+BENCHMARK(to_string_args) {
+  Args const args{"eth0",       {"10.0.0.1/16", "fe80::123"},
+                  {"22", "80"}, "00:11:aa:cd:65:43",
+                  "host",       "5",
+                  "ethernet"};
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    do_not_optimize(to_string(args));
+  }
+}
+
+/** the commands run when a host is emulated, added and deleted */
+BENCHMARK(render_arm_commands) {
+  auto const ip = parse_ip("2001:db8::1/64");
+  Temp_ip const temp_ip{"eth0", ip};
+  Drop_port const drop_port{ip, 22};
+  Reject_tp const reject_tp{ip, Reject_tp::TP::UDP};
+  Block_icmp const block_icmp{ip};
+  Block_ipv6_neighbor_solicitation const block_ns{ip};
+  Argv_arena argv;
+  state.start();
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    for (auto const action : {Action::add, Action::del}) {
+      argv.clear();
+      temp_ip(action, argv);
+      drop_port(action, argv);
+      reject_tp(action, argv);
+      block_icmp(action, argv);
+      block_ns(action, argv);
+      do_not_optimize(argv.size());
+    }
+  }
+}
+} // namespace
@@ -0,0 +1,97 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "ip_address.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class Host_table;
+
+/** an IPv6 or IPv4-mapped address as a 128 bit number */
+struct Address_key {
+  uint64_t high;
+  uint64_t low;
+};
+
+/**
+ * Longest prefix match over IPv4 and IPv6 prefixes. IPv4 addresses are kept
+ * as IPv4-mapped IPv6 addresses, so both families share the structures.
+ *
+ * Full addresses, the usual case of a host, always are the longest match
+ * and lie in an open addressing hash table: finding them touches one or two
+ * cache lines. Shorter prefixes lie in a path compressed binary radix trie,
+ * which is only walked if the table does not contain the address.
+ */
+class Address_index {
+  struct Slot {
+    Address_key key;
+    uint32_t value;
+  };
+
+  struct Node {
+    Address_key key;
+    std::array<uint32_t, 2> children;
+    uint32_t value;
+    uint8_t length;
+  };
+
+  /** linear probing, a power of two and at most half full */
+  std::vector<Slot> slots{};
+  size_t addresses{0};
+  std::vector<Node> nodes{};
+  uint32_t root;
+  size_t prefixes{0};
+
+  bool add_address(Address_key const &key, uint32_t value);
+
+  bool add_prefix(Address_key const &key, uint8_t length, uint32_t value);
+
+  uint32_t new_node(Address_key const &key, uint8_t length, uint32_t value);
+
+  void link(uint32_t parent, size_t side, uint32_t child);
+
+public:
+  /** returned by lookup() if no prefix contains the address */
+  static uint32_t const no_value;
+
+  Address_index();
+
+  /**
+   * Maps the first prefix_length bits of address to value. Keeps the value
+   * of a prefix added before and returns false then.
+   */
+  bool add(IP_address const &address, uint8_t prefix_length, uint32_t value);
+
+  /** the value of the longest prefix containing address or no_value */
+  uint32_t lookup(IP_address const &address) const;
+
+  /** the number of addresses and prefixes */
+  size_t size() const;
+
+  bool empty() const;
+
+  /** the bytes used by the table and the trie */
+  size_t memory_usage() const;
+};
+
+/**
+ * Indexes every address of every host with its full length, the value is
+ * the row of the host. An address shared by hosts belongs to the first.
+ */
+Address_index index_host_addresses(Host_table const &table);
@@ -21,8 +21,11 @@
 #include <netinet/ether.h>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
+class Host_table;
+
 void reset();
 void print_help();
 
@@ -42,6 +45,14 @@ struct Args {
   const unsigned int ping_tries;
   const Wol_method wol_method;
   const bool &syslog;
+  /** number of PACKET_FANOUT capture workers, 0 uses a single pcap handle */
+  const unsigned int &capture_workers;
+  /** Unix socket to serve metrics on, empty if none */
+  const std::string &metrics_socket;
+  /** the configuration file the hosts were read from, empty if none */
+  const std::string &config_file;
+  /** only write the snapshot of the configuration file and exit */
+  const bool &compile_config;
 
   Args();
 
@@ -49,12 +60,43 @@ struct Args {
        const std::vector<std::string> &ports_, const std::string &mac_,
        const std::string &hostname_, const std::string &ping_tries_,
        const std::string &wol_method_);
+
+  /** copies a row of an already validated table */
+  Args(const Host_table &table, size_t host);
 };
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
 std::vector<Args> read_commandline(int argc, char *const argv[]);
 
+/** reads the hosts of a configuration file, throws if it can't be opened */
+std::vector<Args> read_config(const std::string &filename);
+
+/** compares the options of the hosts, not the global ones */
+bool operator==(const Args &lhs, const Args &rhs);
+
+bool operator!=(const Args &lhs, const Args &rhs);
+
+/** what identifies a host across reloads: its name, its mac if unnamed */
+std::string host_identity(const Args &args);
+
+/** how the hosts of a reloaded configuration relate to the running ones */
+struct Config_diff {
+  /** indices of old hosts which are gone or changed */
+  std::vector<size_t> stopped{};
+  /** indices of new hosts which are new or changed */
+  std::vector<size_t> started{};
+  /** old and new index of every host which did not change */
+  std::vector<std::pair<size_t, size_t>> kept{};
+};
+
+/** matches the hosts of both configurations by host_identity() */
+Config_diff diff_config(const std::vector<Args> &old_config,
+                        const std::vector<Args> &new_config);
+
 /**
  * write args into out
  */
 std::ostream &operator<<(std::ostream &out, const Args &args);
+
+/** like the std::ostream version, cut off where out is full */
+Text_writer &operator<<(Text_writer &out, const Args &args);
@@ -0,0 +1,66 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Command line arguments stored back to back, each terminated by '\0', in a
+ * single buffer. clear() keeps the capacity, so an arena which is reused for
+ * every command stops allocating once it has seen the longest one.
+ */
+class Argv_arena {
+  std::vector<char> buffer;
+  /** start of each argument in buffer */
+  std::vector<size_t> offsets;
+  /** argv handed out by argv(), rebuilt on each call */
+  std::vector<char *> pointers;
+
+  void append(char const *arg, size_t length);
+
+public:
+  Argv_arena();
+
+  void clear();
+
+  bool empty() const;
+
+  size_t size() const;
+
+  /** the i-th argument, valid until the arena is modified */
+  char const *at(size_t i) const;
+
+  /** appends one argument */
+  Argv_arena &operator<<(std::string const &arg);
+
+  Argv_arena &operator<<(char const *arg);
+
+  Argv_arena &operator<<(unsigned long number);
+
+  /**
+   * appends the parts of cmd between delimiters as arguments, the same way
+   * split(cmd, delimiter) does
+   */
+  Argv_arena &split(std::string const &cmd, char delimiter = ' ');
+
+  /** nullptr terminated argv, valid until the arena is modified */
+  char *const *argv();
+
+  /** the arguments joined by spaces */
+  std::string to_string() const;
+};
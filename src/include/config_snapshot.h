@@ -0,0 +1,50 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "host_table.h"
+#include <string>
+
+/** where watchHost --compile-config puts the snapshot of config_file */
+std::string snapshot_path(std::string const &config_file);
+
+/**
+ * Writes the validated table in a versioned and checksummed binary format,
+ * along with the size and checksum of the config text it was parsed from.
+ * The snapshot is written to a temporary file first and renamed into place.
+ */
+void write_snapshot(Host_table const &table, std::string const &path,
+                    std::string const &config = "");
+
+/**
+ * Maps the snapshot at path and copies its arrays into a table. Throws a
+ * std::runtime_error if it is damaged or from another version.
+ */
+Host_table read_snapshot(std::string const &path);
+
+/** read_snapshot(), which also throws if it wasn't compiled from config */
+Host_table read_snapshot(std::string const &path, std::string const &config);
+
+/** parses config_file and writes its snapshot, returns the number of hosts */
+size_t compile_config(std::string const &config_file);
+
+/**
+ * Reads the snapshot of config_file if it was compiled from the current text
+ * of config_file, parses config_file otherwise or if the snapshot can't be
+ * read.
+ */
+Host_table load_host_table(std::string const &config_file);
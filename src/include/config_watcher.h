@@ -0,0 +1,39 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "file_descriptor.h"
+#include <string>
+
+/**
+ * Notices when a file has been written or replaced, e.g. by an editor moving
+ * a temporary file over it. Watches the directory with inotify, as the file
+ * itself may be replaced.
+ */
+class Config_watcher {
+  std::string const name;
+  File_descriptor inotify;
+
+public:
+  explicit Config_watcher(std::string const &path);
+
+  /** becomes readable when the file might have changed */
+  int fd() const;
+
+  /** consumes all pending events, true if one of them concerns the file */
+  bool changed();
+};
@@ -20,25 +20,37 @@
 #include "ip_address.h"
 #include "pcap_wrapper.h"
 #include "scope_guard.h"
-#include <atomic>
+#include "stream_reader.h"
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
-#include <thread>
 
 std::string get_mac(std::string const &iface);
 
 using Is_ip_occupied =
     std::function<bool(std::string const &, IP_address const &)>;
 
+/** gets whether another node uses the ip, get() throws if the check failed */
+using Ip_check_done = std::function<void(std::future<bool>)>;
+
+/** starts a check which calls done once it finished, without waiting */
+using Start_ip_check = std::function<void(
+    std::string const &, IP_address const &, Ip_check_done)>;
+
 bool contains_mac_different_from_given(std::string mac,
                                        std::vector<std::string> const &lines);
 
-void daw_thread_main_ipv6(const std::string &iface, const IP_address &ip,
-                          Is_ip_occupied const &is_ip_occupied,
-                          std::atomic_bool &loop, Pcap_wrapper &pc);
+bool contains_mac_different_from_given(std::string const &mac,
+                                       std::vector<Line_view> const &lines);
 
-void daw_thread_main_non_root(const std::string &iface, const IP_address &ip,
-                              Is_ip_occupied const &is_ip_occupied,
-                              std::atomic_bool &loop, Pcap_wrapper &pc);
+/**
+ * checks once whether another node uses ip: duplicate_address if so, signal
+ * if the check failed and unset otherwise
+ */
+Pcap_wrapper::Loop_end_reason
+check_duplicate_address(std::string const &iface, IP_address const &ip,
+                        Is_ip_occupied const &is_ip_occupied);
 
 struct Ip_neigh_checker {
   std::string const this_nodes_mac;
@@ -50,6 +62,10 @@ struct Ip_neigh_checker {
   bool is_ipv6_present(std::string const &iface, IP_address const &ip) const;
 
   bool operator()(std::string const &iface, IP_address const &ip) const;
+
+  /** operator() on process_runner(), which also calls done */
+  void start(std::string const &iface, IP_address const &ip,
+             Ip_check_done done) const;
 };
 
 struct Duplicate_address_watcher {
@@ -57,8 +73,11 @@ struct Duplicate_address_watcher {
   const IP_address ip;
   Pcap_wrapper &pcap;
   const Is_ip_occupied is_ip_occupied;
-  std::thread watcher;
-  std::atomic<bool> loop;
+  /** runs is_ip_occupied, without holding a thread while a command runs */
+  const Start_ip_check start_check;
+  /** shared with the checks running or queued on thread_pool() */
+  struct Watch;
+  std::shared_ptr<Watch> watch;
 
   Duplicate_address_watcher(std::string ifacee, IP_address ipp,
                             Pcap_wrapper &pc);
@@ -66,6 +85,9 @@ struct Duplicate_address_watcher {
   Duplicate_address_watcher(std::string ifacee, IP_address ipp,
                             Pcap_wrapper &pc, Is_ip_occupied is_ip_occupiedd);
 
+  Duplicate_address_watcher(std::string ifacee, IP_address ipp,
+                            Pcap_wrapper &pc, Start_ip_check start_checkk);
+
   ~Duplicate_address_watcher();
 
   Duplicate_address_watcher(Duplicate_address_watcher const &) = delete;
@@ -77,5 +99,8 @@ struct Duplicate_address_watcher {
 
   std::string operator()(Action action);
 
+  /** whether the checks still run, i.e. no duplicate address was found */
+  bool watching() const;
+
   void stop_watcher();
 };
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "container_utils.h"
+#include "text_writer.h"
 #include "to_string.h"
 #include <arpa/inet.h>
 #include <array>
@@ -52,6 +53,13 @@ struct Link_layer {
 
 std::ostream &operator<<(std::ostream &out, const Link_layer &ll);
 
+Text_writer &operator<<(Text_writer &out, const Link_layer &ll);
+
+/** writes mac like binary_to_mac() */
+Text_writer &operator<<(Text_writer &out, const ether_addr &mac);
+
+std::ostream &operator<<(std::ostream &out, const ether_addr &mac);
+
 std::vector<uint8_t> create_ethernet_header(const ether_addr &dmac,
                                             const ether_addr &smac,
                                             uint16_t type);
@@ -91,10 +99,11 @@ std::unique_ptr<Link_layer> parse_linux_cooked_capture(iterator data,
   uint16_t const payload_type =
       // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
       ntohs(*reinterpret_cast<uint16_t const *>(&(*data)));
-  std::string const info =
-      "Linux cooked capture: src: " + binary_to_mac(ether_shost);
+  std::array<char, 64> info{};
+  Text_writer out{info};
+  out << "Linux cooked capture: src: " << ether_shost;
   return std::make_unique<Link_layer>(Link_layer::lcc_header_size, ether_shost,
-                                      payload_type, info);
+                                      payload_type, out.str());
 }
 
 template <typename iterator>
@@ -112,10 +121,11 @@ std::unique_ptr<Link_layer> parse_ethernet(iterator data, iterator end) {
   uint16_t const ether_type =
       // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
       ntohs(*reinterpret_cast<uint16_t const *>(&(*data)));
-  std::string const info = "Ethernet: dst = " + binary_to_mac(ether_dhost) +
-                           ", src = " + binary_to_mac(ether_shost);
+  std::array<char, 64> info{};
+  Text_writer out{info};
+  out << "Ethernet: dst = " << ether_dhost << ", src = " << ether_shost;
   return std::make_unique<Link_layer>(header_size, ether_shost, ether_type,
-                                      info);
+                                      out.str());
 }
 
 template <typename iterator>
@@ -0,0 +1,126 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "file_descriptor.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/** the kernel interface used by Event_loop to wait for file descriptors */
+struct Event_backend {
+  Event_backend() = default;
+  Event_backend(Event_backend const &) = delete;
+  Event_backend(Event_backend &&) = delete;
+  virtual ~Event_backend() = default;
+  Event_backend &operator=(Event_backend const &) = delete;
+  Event_backend &operator=(Event_backend &&) = delete;
+
+  /** start watching fd for readability */
+  virtual void add(int fd) = 0;
+
+  /** stop watching fd */
+  virtual void remove(int fd) = 0;
+
+  /**
+   * wait up to timeout_ms milliseconds, -1 waits forever, and append the
+   * readable file descriptors to ready
+   */
+  virtual void wait(int timeout_ms, std::vector<int> &ready) = 0;
+};
+
+/**
+ * Single threaded reactor: calls callbacks when file descriptors become
+ * readable or timers expire. Only post() and stop() may be called from other
+ * threads, everything else belongs to the thread calling run().
+ */
+class Event_loop {
+public:
+  enum class Backend { epoll, io_uring };
+  using Callback = std::function<void()>;
+  using Timer_id = uint64_t;
+  using Clock = std::chrono::steady_clock;
+
+private:
+  std::unique_ptr<Event_backend> backend;
+  Backend const backend_type;
+  std::map<int, Callback> fds;
+  std::map<std::pair<Clock::time_point, Timer_id>, Callback> timers;
+  std::map<Timer_id, Clock::time_point> timer_deadlines;
+  Timer_id next_timer_id;
+  /** wakes the loop up from other threads */
+  File_descriptor wakeup;
+  std::mutex posted_mutex;
+  std::vector<Callback> posted;
+  std::atomic_bool stopped;
+
+  int next_timeout_ms(std::chrono::milliseconds max_timeout);
+
+  size_t run_timers();
+
+  size_t run_posted();
+
+public:
+  /** io_uring if compiled in and allowed by the kernel, epoll otherwise */
+  static Backend default_backend();
+
+  explicit Event_loop(Backend backendd = default_backend());
+
+  Event_loop(Event_loop const &) = delete;
+  Event_loop(Event_loop &&) = delete;
+
+  ~Event_loop();
+
+  Event_loop &operator=(Event_loop const &) = delete;
+  Event_loop &operator=(Event_loop &&) = delete;
+
+  Backend get_backend() const;
+
+  /** calls on_readable each time fd is readable until remove_fd() */
+  void add_fd(int fd, Callback on_readable);
+
+  void remove_fd(int fd);
+
+  /** calls cb once after timeout */
+  Timer_id add_timer(std::chrono::milliseconds timeout, Callback cb);
+
+  /** returns false if the timer already expired or does not exist */
+  bool cancel_timer(Timer_id id);
+
+  /** runs cb inside the loop, may be called from any thread */
+  void post(Callback cb);
+
+  /**
+   * waits at most timeout, a negative one waits forever, for events and
+   * returns the number of callbacks run
+   */
+  size_t run_once(std::chrono::milliseconds timeout);
+
+  /** runs until stop() is called */
+  void run();
+
+  /** may be called from any thread */
+  void stop();
+
+  bool is_stopped() const;
+};
+
+std::ostream &operator<<(std::ostream &out, Event_loop::Backend backend);
@@ -0,0 +1,191 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "ethernet.h"
+#include "file_descriptor.h"
+#include "mpsc_queue.h"
+#include "pcap_wrapper.h"
+#include <array>
+#include <atomic>
+#include <linux/if_packet.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Builds the Linux cooked capture header libpcap puts in front of packets
+ * captured on the "any" device
+ */
+std::array<uint8_t, Link_layer::lcc_header_size>
+linux_cooked_header(sockaddr_ll const &sll);
+
+/** a packet handed from a fanout worker to a capture */
+struct Captured_packet {
+  pcap_pkthdr header;
+  std::vector<uint8_t> data;
+};
+
+struct Fanout_capture;
+
+/**
+ * Several AF_PACKET sockets in one PACKET_FANOUT_HASH group on an interface,
+ * each read by its own worker thread pinned to a core. All Fanout_captures
+ * on the interface share one group: the workers run the filter of every
+ * subscribed capture on their packets and queue the matching ones for it.
+ * The kernel filter of the sockets is the union of the subscribed filters.
+ */
+class Fanout_group {
+  std::string const iface;
+  int const snaplen;
+  Counter &packets_seen;
+  Counter &kernel_drops;
+  std::vector<File_descriptor> sockets;
+  std::vector<std::thread> workers;
+  std::atomic_bool stop_workers;
+  /** guards subscribers and the kernel filter */
+  std::mutex mutex;
+  std::vector<Fanout_capture *> subscribers;
+  bool broken;
+  std::mutex drops_mutex;
+  uint64_t dropped;
+
+  void join_fanout_group();
+
+  void worker_main(int sock);
+
+  /** attaches the union of the subscribed filters to every socket */
+  void update_kernel_filter();
+
+public:
+  /** the running group on iface, started with workers if there is none */
+  static std::shared_ptr<Fanout_group> get(std::string const &iface,
+                                           unsigned int workers, int snaplen,
+                                           Counter &packets_seen,
+                                           Counter &kernel_drops);
+
+  Fanout_group(std::string ifacee, unsigned int workers, int snaplenn,
+               Counter &packets_seenn, Counter &kernel_dropss);
+
+  Fanout_group(Fanout_group const &) = delete;
+  Fanout_group(Fanout_group &&) = delete;
+
+  ~Fanout_group();
+
+  Fanout_group &operator=(Fanout_group const &) = delete;
+  Fanout_group &operator=(Fanout_group &&) = delete;
+
+  /** capture receives its packets until unsubscribe() */
+  void subscribe(Fanout_capture &capture);
+
+  void unsubscribe(Fanout_capture &capture);
+
+  /** replaces the filter of a subscribed capture */
+  void set_filter(Fanout_capture &capture, std::unique_ptr<BPF> filter,
+                  std::string const &text);
+
+  /** whether a worker failed, the group then captures nothing anymore */
+  bool is_broken();
+
+  size_t worker_count() const;
+
+  /** reads the kernel drops of all sockets, returns them since the start */
+  uint64_t collect_drops();
+};
+
+/**
+ * Captures from the Fanout_group of an interface, the packets are handed
+ * over from its workers to the thread calling loop() via a lock-free queue.
+ *
+ * Packets are delivered with a Linux cooked capture header, exactly as
+ * libpcap does on the "any" device, so existing callbacks keep working.
+ */
+struct Fanout_capture : public Pcap_wrapper {
+  struct Stats {
+    /** packets handed to the callback */
+    uint64_t captured;
+    /** packets dropped by the kernel because a socket buffer was full */
+    uint64_t kernel_drops;
+  };
+
+private:
+  friend class Fanout_group;
+
+  std::string const iface;
+  int const snaplen;
+  std::shared_ptr<Fanout_group> group;
+  /** the filter and its text, both only changed by the group */
+  std::unique_ptr<BPF> filter;
+  std::string filter_text;
+  bool subscribed;
+  Mpsc_queue<Captured_packet> queue;
+  /** eventfd to wake the consumer in loop() */
+  File_descriptor wakeup;
+  uint64_t captured;
+
+  /** called by the workers: queues the raw packet if it passes the filter */
+  void offer(sockaddr_ll const &sll, std::vector<uint8_t> const &raw,
+             size_t caplen, size_t len);
+
+  /** called by the workers once one of them failed */
+  void fail();
+
+  void wait_for_packets() const;
+
+public:
+  /** default size of the receive buffer of each socket */
+  static auto const default_buffer_size = int{4 * 1024 * 1024};
+
+  /**
+   * captures on iface, "any" listens on all interfaces. If no group runs on
+   * iface yet, one with workers sockets is started, 0 uses one per core
+   */
+  explicit Fanout_capture(std::string ifacee, unsigned int workers = 0,
+                          int snaplenn = default_snaplen);
+
+  Fanout_capture(Fanout_capture const &) = delete;
+  Fanout_capture(Fanout_capture &&) = delete;
+
+  ~Fanout_capture() override;
+
+  Fanout_capture &operator=(Fanout_capture const &) = delete;
+  Fanout_capture &operator=(Fanout_capture &&) = delete;
+
+  /** always DLT_LINUX_SLL */
+  int get_datalink() const override;
+
+  /** compiles filter for raw IP packets and subscribes with it */
+  void set_filter(const std::string &filter) override;
+
+  Pcap_wrapper::Loop_end_reason loop(int count, Callback_t cb) override;
+
+  void break_loop(const Loop_end_reason &ler) override;
+
+  /** number of sockets and worker threads of the shared group */
+  size_t worker_count() const;
+
+  Stats get_stats();
+};
+
+/**
+ * Opens a capture on iface. With workers set to 0 a plain libpcap capture is
+ * used, otherwise a Fanout_capture with that many workers
+ */
+std::unique_ptr<Pcap_wrapper> open_capture(std::string const &iface,
+                                           unsigned int workers);
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -52,3 +54,12 @@ get_self_pipes(bool close_on_exec = true);
 int get_fd_from_stream(FILE *stream);
 
 void flush_file(FILE *stream);
+
+/** the error to throw after what failed and set errno */
+std::runtime_error errno_error(std::string const &what);
+
+/**
+ * writes size bytes of data to fd, going on after short writes and EINTR.
+ * A socket whose peer is gone throws instead of raising SIGPIPE.
+ */
+void write_all(int fd, void const *data, size_t size);
@@ -0,0 +1,127 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+/** what we think a host is doing, see next_state() for the transitions */
+enum class Host_state {
+  /** the host answers pings, nothing is emulated */
+  awake,
+  /** the host is silent, its firewall rules and IPs are being set up */
+  arming,
+  /** the host is emulated, waiting for a SYN */
+  armed,
+  /** a SYN arrived, the host is woken and pinged */
+  waking,
+  /** the woken host answered, the SYN is replayed */
+  replaying,
+  /** emulation ended without a SYN, the rules and IPs are removed */
+  disarming,
+  /** waking the host or emulating it failed */
+  failed
+};
+
+static auto const host_state_count =
+    static_cast<size_t>(Host_state::failed) + 1;
+
+std::ostream &operator<<(std::ostream &out, Host_state state);
+
+/** what moves a host from one state to the next and who reports it */
+enum class Host_event {
+  /** prober: the host stopped answering pings */
+  silent,
+  /** the firewall rules and IPs are in place */
+  armed,
+  /** capture: a SYN to the host arrived */
+  syn,
+  /** duplicate address detection: another machine uses one of the IPs */
+  duplicate_address,
+  /** prober: the woken host answers */
+  answered,
+  /** timer: the woken host did not answer in time */
+  timeout,
+  /** the SYN has been replayed */
+  replayed,
+  /** the firewall rules and IPs have been removed */
+  disarmed,
+  /** the host is not watched anymore or a signal arrived */
+  stop,
+  /** anything unexpected, e.g. an exception */
+  error
+};
+
+std::ostream &operator<<(std::ostream &out, Host_event event);
+
+/** the state after event in state, state itself if event does not apply */
+Host_state next_state(Host_state state, Host_event event);
+
+/**
+ * The lifecycle of one host as plain data: its state, since when and how
+ * long it spent in every state. Events which do not apply to the current
+ * state are ignored, so every source may report whatever it sees. Not
+ * thread safe, one thread or reactor drives it.
+ */
+class Host_lifecycle {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** a change of the state, passed to the observer */
+  struct Transition {
+    Host_state from;
+    Host_state to;
+    Host_event event;
+    Clock::time_point at;
+    /** how long the host has been in from */
+    Clock::duration duration;
+  };
+
+  using Observer = std::function<void(Transition const &)>;
+
+  /** starts awake at now */
+  explicit Host_lifecycle(Observer observer = {},
+                          Clock::time_point now = Clock::now());
+
+  /** returns whether the state changed */
+  bool handle(Host_event event, Clock::time_point now = Clock::now());
+
+  Host_state state() const;
+
+  /** when the current state has been entered */
+  Clock::time_point since() const;
+
+  /** the time spent in state until now, including the current stay */
+  Clock::duration time_in(Host_state state,
+                          Clock::time_point now = Clock::now()) const;
+
+private:
+  Host_state current;
+  Clock::time_point entered;
+  std::array<Clock::duration, host_state_count> durations;
+  Observer observer;
+};
+
+/**
+ * an observer which exports the state of hostname and the time spent in
+ * each state in the metrics, it marks hostname awake like a new lifecycle
+ */
+Host_lifecycle::Observer host_state_metrics(std::string const &hostname);
@@ -0,0 +1,104 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "ip_address.h"
+#include "wol.h"
+#include <cstdint>
+#include <netinet/ether.h>
+#include <string>
+#include <vector>
+
+/** a contiguous part of one of the arrays of Host_table */
+template <typename T> struct Table_range {
+  T const *first;
+  T const *last;
+
+  T const *begin() const { return first; }
+  T const *end() const { return last; }
+  size_t size() const { return static_cast<size_t>(last - first); }
+};
+
+/**
+ * The hosts of a configuration as a structure of arrays: interface names are
+ * interned, the addresses, ports and names of all hosts lie in one array each
+ * and are found by offsets. Args is built from a row when a host is watched.
+ */
+class Host_table {
+  std::vector<std::string> interface_names{};
+  std::vector<uint16_t> interface_ids{};
+  std::string names{};
+  std::vector<uint32_t> name_offsets{0};
+  std::vector<IP_address> addresses{};
+  std::vector<uint32_t> address_offsets{0};
+  std::vector<uint16_t> ports{};
+  std::vector<uint32_t> port_offsets{0};
+  std::vector<ether_addr> macs{};
+  std::vector<unsigned int> ping_tries_{};
+  std::vector<Wol_method> wol_methods{};
+
+  friend void write_snapshot(Host_table const &table, std::string const &path,
+                             std::string const &config);
+  friend Host_table read_snapshot(std::string const &path);
+
+public:
+  size_t size() const;
+
+  bool empty() const;
+
+  /** every interface once, in the order of their first use */
+  std::vector<std::string> const &interfaces() const;
+
+  uint16_t interface_id(size_t host) const;
+
+  std::string const &interface(size_t host) const;
+
+  std::string hostname(size_t host) const;
+
+  Table_range<IP_address> addresses_of(size_t host) const;
+
+  Table_range<uint16_t> ports_of(size_t host) const;
+
+  ether_addr const &mac(size_t host) const;
+
+  unsigned int ping_tries(size_t host) const;
+
+  Wol_method wol_method(size_t host) const;
+
+  /** belongs to the host added next */
+  void add_address(IP_address const &address);
+
+  /** belongs to the host added next */
+  void add_port(uint16_t port);
+
+  /** the addresses and ports added since the last host are its own */
+  void add_host(std::string const &interface, std::string const &hostname,
+                ether_addr const &mac, unsigned int ping_tries,
+                Wol_method wol_method);
+
+  /** whether addresses or ports have been added for the next host */
+  bool has_pending_addresses() const;
+
+  bool has_pending_ports() const;
+};
+
+/**
+ * Parses the hosts of a configuration in one pass over config. Lines before
+ * the first host and invalid lines are skipped, invalid values throw a
+ * std::runtime_error naming the line.
+ */
+Host_table parse_host_table(std::string const &config);
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "to_string.h"
+#include <cstdint>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -67,3 +68,15 @@ template <typename T> T str_to_integral(const std::string &string) {
 }
 
 std::string uint32_t_to_eight_hex_chars(uint32_t i) noexcept;
+
+/** the finalizer of splitmix64, every input bit changes half the output */
+inline uint64_t mix64(uint64_t x) noexcept {
+  x = (x ^ (x >> 30U)) * uint64_t{0xbf58476d1ce4e5b9U};
+  x = (x ^ (x >> 27U)) * uint64_t{0x94d049bb133111ebU};
+  return x ^ (x >> 31U);
+}
+
+/** hash of two words for hash tables, e.g. of an IPv6 address */
+inline uint64_t hash_words(uint64_t const high, uint64_t const low) noexcept {
+  return mix64(high ^ mix64(low));
+}
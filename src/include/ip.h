@@ -62,6 +62,8 @@ struct ip {
 /** writes ip into out which every information available to the base class */
 std::ostream &operator<<(std::ostream &out, const ip &ip);
 
+Text_writer &operator<<(Text_writer &out, const ip &ip);
+
 template <typename iterator>
 bool ethernet_payload_and_ip_version_dont_match(uint16_t const type,
                                                 iterator data) {
@@ -72,7 +74,7 @@ bool ethernet_payload_and_ip_version_dont_match(uint16_t const type,
   bool const result = (type == ip::Version::ipv4 && version != 4) ||
                       (type == ip::Version::ipv6 && version != 6);
   if (result) {
-    log_string(LOG_ERR, "ethernet type and ip version do not match");
+    LOG_RATE_LIMITED(LOG_ERR, "ethernet type and ip version do not match");
   }
   return result;
 }
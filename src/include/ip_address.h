@@ -16,10 +16,22 @@
 
 #pragma once
 
+#include "text_writer.h"
 #include <arpa/inet.h>
+#include <array>
+#include <cstddef>
+#include <functional>
 #include <ostream>
 #include <string>
 
+/** the text of an address in a buffer of its own, nothing is allocated */
+struct IP_text {
+  /** an IPv6 address, "/128" and the nul termination */
+  std::array<char, INET6_ADDRSTRLEN + 4> text;
+
+  char const *c_str() const { return text.data(); }
+};
+
 struct IP_address {
   int family;
   union {
@@ -32,11 +44,34 @@ struct IP_address {
 
   std::string with_subnet() const;
 
+  /** like pure() and with_subnet(), but without allocating */
+  IP_text pure_text() const;
+
+  IP_text with_subnet_text() const;
+
+  /** compares family, subnet and the bytes of the address, not allocating */
   bool operator==(const IP_address &rhs) const;
+
+  bool operator!=(const IP_address &rhs) const;
+
+  /** orders by family, then numerically by address, then by subnet */
+  bool operator<(const IP_address &rhs) const;
+};
+
+namespace std {
+template <> struct hash<IP_address> {
+  size_t operator()(const IP_address &ip) const noexcept;
 };
+} // namespace std
 
 IP_address parse_ip(const std::string &ip);
 
+/** parses the characters from begin to end without allocating */
+IP_address parse_ip_range(char const *begin, char const *end);
+
 std::string get_pure_ip(const IP_address &ip);
 
 std::ostream &operator<<(std::ostream &out, const IP_address &ipa);
+
+/** writes the address with its subnet like with_subnet() */
+Text_writer &operator<<(Text_writer &out, const IP_address &ipa);
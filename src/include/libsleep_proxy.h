@@ -17,8 +17,12 @@
 #pragma once
 
 #include "args.h"
+#include "host_lifecycle.h"
 #include "ip_address.h"
+#include "wake_latency.h"
 #include <exception>
+#include <future>
+#include <ostream>
 #include <string>
 
 void setup_signals();
@@ -32,8 +36,15 @@ std::string get_bindable_ip(const std::string &iface, const std::string &ip);
 std::string rule_to_listen_on_ips_and_ports(const std::vector<IP_address> &ips,
                                             const std::vector<uint16_t> &ports);
 
+/** pings ip once on the process runner, the future holds ping's exit status */
+std::future<uint8_t> ping_async(const std::string &iface, const IP_address &ip);
+
+/** waits for ping and returns whether it got an answer in time */
+bool ping_succeeded(std::future<uint8_t> &ping);
+
+/** pings up to tries times, the duration of each attempt goes to attempts */
 bool ping_and_wait(const std::string &iface, const IP_address &ip,
-                   unsigned int tries);
+                   unsigned int tries, Latency_histogram *attempts = nullptr);
 
 enum class Emulate_host_status {
   success,
@@ -43,4 +54,22 @@ enum class Emulate_host_status {
   undefined_error
 };
 
+std::ostream &operator<<(std::ostream &out, Emulate_host_status status);
+
+/**
+ * Emulates the silent host until a connection arrives, wakes it and counts
+ * the result in the metrics. Reports every step to lifecycle.
+ */
+Emulate_host_status emulate_host(const Args &args, Host_lifecycle &lifecycle);
+
+/** emulate_host() with a lifecycle exported in the metrics */
 Emulate_host_status emulate_host(const Args &args);
+
+/**
+ * Makes emulate_host(args) return signal_received as soon as it listens,
+ * until resume_emulation(args). Stops a single host, args is identified by
+ * its address.
+ */
+void cancel_emulation(const Args &args);
+
+void resume_emulation(const Args &args);
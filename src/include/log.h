@@ -17,11 +17,53 @@
 #pragma once
 
 #include "to_string.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <syslog.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Messages less important than this are compiled out of LOG() and
+ * LOG_STRING(), set with the meson option log_level
+ */
+#ifndef SLEEP_PROXY_LOG_LEVEL
+#define SLEEP_PROXY_LOG_LEVEL LOG_DEBUG
+#endif
 
 void setup_log(const std::string &ident, int option, int facility);
 
+/**
+ * From now on log() only formats the message into a ring of the calling
+ * thread, a writer thread hands it to syslog or stdout. If a ring is full the
+ * message is dropped and counted. Messages of different threads may be
+ * written out of order.
+ */
+void start_async_log(size_t ring_slots = 64);
+
+/** writes all queued messages and goes back to synchronous logging */
+void stop_async_log();
+
+/** waits until all queued messages have been written */
+void flush_log();
+
+/** messages dropped because a ring was full */
+uint64_t dropped_log_messages();
+
+/** drops messages less important than level (LOG_EMERG ... LOG_DEBUG) */
+void set_log_level(int level);
+
+int get_log_level();
+
+/** parses a level name like "info" or "warning" or its number */
+int parse_log_level(std::string const &level);
+
 void log(int priority, const char *format, ...)
     __attribute__((format(printf, 2, 3)));
 
@@ -34,3 +76,271 @@ template <> void log_string<std::string>(int priority, std::string &&t);
 template <typename T> void log_string(const int priority, T &&t) {
   log_string(priority, to_string(std::forward<T>(t)));
 }
+
+namespace log_detail {
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+extern std::atomic<int> level;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+extern std::atomic_bool async_enabled;
+
+/** formats the arguments stored in payload */
+using Formatter = void (*)(char *out, size_t size, char const *format,
+                           char const *payload);
+
+/** log() without the format check, for formats passed through LOG() */
+void log_unchecked(int priority, char const *format, ...);
+
+/** snprintf() without the format check */
+int format_unchecked(char *out, size_t size, char const *format, ...);
+
+/**
+ * the payload of a free record in the ring of the calling thread, false if
+ * the ring is full
+ */
+bool claim_record(char *&payload, char *&end);
+
+/** queues the claimed record, a formatter of nullptr takes payload as text */
+void publish_record(int priority, char const *format, Formatter formatter);
+
+/** queues the claimed record with text, which did not fit into its payload */
+void publish_overflow(int priority, std::unique_ptr<char[]> text);
+
+/** test only: while held the writer thread leaves the rings alone */
+void hold_writer(bool held);
+
+/** how LOG() stores an argument: numbers and pointers as they are */
+template <typename T, typename Enable = void> struct Log_arg {
+  static_assert(std::is_arithmetic<T>::value || std::is_pointer<T>::value,
+                "LOG() takes numbers, pointers and C strings");
+
+  using decoded = T;
+
+  static size_t size(T const /*value*/) { return sizeof(T); }
+
+  static bool encode(char *&out, char const *const end, T const value) {
+    if (static_cast<size_t>(end - out) < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(out, &value, sizeof(T));
+    out += sizeof(T);
+    return true;
+  }
+
+  static T decode(char const *&in) {
+    T value{};
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+  }
+};
+
+template <typename T>
+using Enable_if_c_string =
+    typename std::enable_if<std::is_same<T, char *>::value ||
+                            std::is_same<T, char const *>::value>::type;
+
+/** C strings are copied including '\0' and truncated if they do not fit */
+template <typename T> struct Log_arg<T, Enable_if_c_string<T>> {
+  using decoded = char const *;
+
+  static size_t size(char const *value) {
+    return value == nullptr ? sizeof("(null)") : std::strlen(value) + 1;
+  }
+
+  static bool encode(char *&out, char const *const end, char const *value) {
+    if (out == end) {
+      return false;
+    }
+    if (value == nullptr) {
+      value = "(null)";
+    }
+    auto const length =
+        std::min(std::strlen(value), static_cast<size_t>(end - out) - 1);
+    std::memcpy(out, value, length);
+    out[length] = '\0';
+    out += length + 1;
+    return true;
+  }
+
+  static char const *decode(char const *&in) {
+    auto const *const value = in;
+    in += std::strlen(in) + 1;
+    return value;
+  }
+};
+
+inline size_t encoded_size() { return 0; }
+
+template <typename T, typename... Args>
+size_t encoded_size(T const &arg, Args const &... args) {
+  return Log_arg<typename std::decay<T>::type>::size(arg) +
+         encoded_size(args...);
+}
+
+inline bool encode_all(char *& /*out*/, char const * /*end*/) { return true; }
+
+template <typename T, typename... Args>
+bool encode_all(char *&out, char const *const end, T const &arg,
+                Args const &... args) {
+  return Log_arg<typename std::decay<T>::type>::encode(out, end, arg) &&
+         encode_all(out, end, args...);
+}
+
+template <typename Tuple, size_t... I>
+void format_tuple(char *out, size_t const size, char const *const format,
+                  Tuple const &args,
+                  std::index_sequence<I...> /*unused*/) {
+  format_unchecked(out, size, format, std::get<I>(args)...);
+}
+
+template <typename... Args>
+void format_payload(char *out, size_t const size, char const *const format,
+                    char const *payload) {
+  // a braced init list decodes the arguments from left to right
+  std::tuple<typename Log_arg<Args>::decoded...> const args{
+      Log_arg<Args>::decode(payload)...};
+  static_cast<void>(payload);
+  format_tuple(out, size, format, args, std::index_sequence_for<Args...>{});
+}
+
+template <typename... Args>
+void log_deferred(int const priority, char const *const format,
+                  Args const &... args) {
+  if (!async_enabled.load(std::memory_order_relaxed)) {
+    log_unchecked(priority, format, args...);
+    return;
+  }
+  char *payload = nullptr;
+  char *end = nullptr;
+  if (!claim_record(payload, end)) {
+    return;
+  }
+  auto *out = payload;
+  if (encoded_size(args...) <= static_cast<size_t>(end - payload) &&
+      encode_all(out, end, args...)) {
+    publish_record(priority, format,
+                   &format_payload<typename std::decay<Args>::type...>);
+    return;
+  }
+  // rare long messages are formatted right away into the heap
+  auto const length = format_unchecked(nullptr, 0, format, args...);
+  if (length < 0) {
+    return;
+  }
+  auto const size = static_cast<size_t>(length) + 1;
+  std::unique_ptr<char[]> text{new char[size]};
+  format_unchecked(text.get(), size, format, args...);
+  publish_overflow(priority, std::move(text));
+}
+} // namespace log_detail
+
+/** false if messages of this priority are dropped anyway */
+inline bool log_enabled(int const priority) {
+  return priority <= SLEEP_PROXY_LOG_LEVEL &&
+         priority <= log_detail::level.load(std::memory_order_relaxed);
+}
+
+/**
+ * LOG(priority, format, ...) is log() for numbers and C strings, which
+ * evaluates its arguments only if the priority is enabled. With async
+ * logging the arguments are stored as they are and formatted by the writer
+ * thread; the format has to be a string literal.
+ */
+#define LOG(priority, ...)                                                     \
+  do {                                                                         \
+    if (log_enabled(priority)) {                                               \
+      if (false) {                                                             \
+        /* only checks the format */                                           \
+        log(priority, __VA_ARGS__);                                            \
+      }                                                                        \
+      log_detail::log_deferred(priority, __VA_ARGS__);                         \
+    }                                                                          \
+  } while (false)
+
+/**
+ * Token bucket of one LOG_RATE_LIMITED() call site: burst messages pass at
+ * once, afterwards per_second. Lock free, so it can be shared by the
+ * capture threads.
+ */
+class Log_rate_limit {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** format describes the messages when their suppressed count is logged */
+  Log_rate_limit(unsigned int burst, unsigned int per_second,
+                 int priority = LOG_INFO, char const *format = "");
+
+  Log_rate_limit(Log_rate_limit const &) = delete;
+  Log_rate_limit(Log_rate_limit &&) = delete;
+
+  ~Log_rate_limit();
+
+  Log_rate_limit &operator=(Log_rate_limit const &) = delete;
+  Log_rate_limit &operator=(Log_rate_limit &&) = delete;
+
+  /**
+   * false if the message has to be dropped. Otherwise suppressed is set to
+   * the number of messages dropped since the last one which passed
+   */
+  bool allow(uint64_t &suppressed, Clock::time_point now = Clock::now());
+
+  /**
+   * takes the messages dropped since the last one which passed. With
+   * only_idle nothing is taken while the bucket is still empty, the next
+   * message which passes reports them
+   */
+  uint64_t take_suppressed(bool only_idle,
+                           Clock::time_point now = Clock::now());
+
+  int const priority;
+  char const *const format;
+
+private:
+  int64_t const interval_ns;
+  int64_t const burst_ns;
+  /** when the bucket will be full again, in ns of Clock */
+  std::atomic<int64_t> full_at;
+  std::atomic<uint64_t> dropped;
+
+  static int64_t to_ns(Clock::time_point time);
+};
+
+/**
+ * logs the count of messages each LOG_RATE_LIMITED() call site dropped since
+ * its last message, with only_idle only of those whose burst refilled.
+ * The async writer does so every second, stop_async_log() for all.
+ */
+void log_suppressed(bool only_idle = false);
+
+/** the format of LOG() arguments, without evaluating the others */
+#define LOG_FORMAT_OF_(format, ...) format
+
+/**
+ * LOG() for messages caused by network traffic: each call site logs at most
+ * 10 messages at once and then one per second. The next message which
+ * passes is preceded by "suppressed N similar messages", if none follows
+ * log_suppressed() reports them.
+ */
+#define LOG_RATE_LIMITED(priority, ...)                                        \
+  do {                                                                         \
+    if (log_enabled(priority)) {                                               \
+      static Log_rate_limit log_limit_{                                        \
+          10, 1, priority, LOG_FORMAT_OF_(__VA_ARGS__, )};                     \
+      uint64_t log_suppressed_ = 0;                                            \
+      if (log_limit_.allow(log_suppressed_)) {                                 \
+        if (log_suppressed_ > 0) {                                             \
+          LOG(priority, "suppressed %" PRIu64 " similar messages",             \
+              log_suppressed_);                                                \
+        }                                                                      \
+        LOG(priority, __VA_ARGS__);                                            \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
+/** log_string(), which evaluates t only if the priority is enabled */
+#define LOG_STRING(priority, t)                                                \
+  do {                                                                         \
+    if (log_enabled(priority)) {                                               \
+      log_string(priority, t);                                                 \
+    }                                                                          \
+  } while (false)
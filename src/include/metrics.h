@@ -0,0 +1,202 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "event_loop.h"
+#include "file_descriptor.h"
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace metrics_detail {
+static auto const shard_count = size_t{16};
+
+/** the counter shard of the calling thread, threads are spread round robin */
+inline size_t thread_shard() {
+  static std::atomic<size_t> next{0};
+  thread_local size_t const shard =
+      next.fetch_add(1, std::memory_order_relaxed) % shard_count;
+  return shard;
+}
+} // namespace metrics_detail
+
+/**
+ * Monotonic counter. Each thread increments its own shard on a separate
+ * cache line, the shards are only summed up when the value is read.
+ */
+class Counter {
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value;
+  };
+  std::array<Shard, metrics_detail::shard_count> shards;
+
+public:
+  Counter();
+
+  /** C++14 new ignores the alignment of the shards */
+  static void *operator new(size_t size);
+
+  static void operator delete(void *counter);
+
+  void inc(uint64_t const n = 1) {
+    shards[metrics_detail::thread_shard()].value.fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const;
+};
+
+/**
+ * Monotonic counter in a single word, for series like the ones of one host
+ * which only one thread increments, so shards would only cost memory.
+ */
+class Unsharded_counter {
+  std::atomic<uint64_t> total;
+
+public:
+  Unsharded_counter();
+
+  void inc(uint64_t const n = 1) {
+    total.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const { return total.load(std::memory_order_relaxed); }
+};
+
+/** a value which can go up and down */
+class Gauge {
+  std::atomic<int64_t> current;
+
+public:
+  Gauge();
+
+  void set(int64_t const value) {
+    current.store(value, std::memory_order_relaxed);
+  }
+
+  void add(int64_t const n) { current.fetch_add(n, std::memory_order_relaxed); }
+
+  int64_t value() const { return current.load(std::memory_order_relaxed); }
+};
+
+/** label names and values of one time series */
+using Metric_labels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * All metrics of the process. Looking a metric up takes a lock, so hot paths
+ * keep the returned reference, which stays valid forever.
+ */
+class Metrics {
+public:
+  enum class Type { counter, gauge, stateset };
+
+private:
+  struct Family {
+    Type type;
+    std::string help;
+    /** counters are written divided by it, e.g. ns_per_s for ns as s */
+    uint64_t divisor;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Unsharded_counter>>
+        unsharded_counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+  };
+
+  mutable std::mutex mutex;
+  std::map<std::string, Family> families;
+
+  Family &family(std::string const &name, Type type, std::string const &help,
+                 uint64_t divisor);
+
+public:
+  /** the divisor of counters of nanoseconds which are written as seconds */
+  static auto const ns_per_s = uint64_t{1000000000};
+
+  Metrics();
+
+  /** name without _total, throws if name is registered as another type */
+  Counter &counter(std::string const &name, std::string const &help,
+                   Metric_labels const &labels = {}, uint64_t divisor = 1);
+
+  /** like counter() for a series with a single writer */
+  Unsharded_counter &unsharded_counter(std::string const &name,
+                                       std::string const &help,
+                                       Metric_labels const &labels = {},
+                                       uint64_t divisor = 1);
+
+  Gauge &gauge(std::string const &name, std::string const &help,
+               Metric_labels const &labels = {});
+
+  /**
+   * the gauge of one state of a stateset, the label named like the metric
+   * holds the state and is added to labels
+   */
+  Gauge &state(std::string const &name, std::string const &help,
+               Metric_labels const &labels, std::string const &state);
+
+  /** writes everything in the OpenMetrics text format, ending with # EOF */
+  void write(std::ostream &out) const;
+};
+
+/** the metrics of the process */
+Metrics &metrics();
+
+/**
+ * Serves metrics() on a Unix socket from its own thread. Clients sending an
+ * HTTP GET (curl --unix-socket) get an HTTP response, all others, e.g.
+ * socat, get the plain text once they sent anything or after a second.
+ */
+class Metrics_server {
+  struct Client {
+    File_descriptor fd;
+    Event_loop::Timer_id timeout;
+  };
+
+  std::string const path;
+  File_descriptor listener;
+  Event_loop loop;
+  /** only accessed from the loop thread */
+  std::map<int, Client> clients;
+  std::thread thread;
+
+  void accept_clients();
+
+  void read_request(int fd);
+
+  /** writes the metrics to the client and closes its connection */
+  void respond(int fd, bool http);
+
+public:
+  /** replaces a stale socket at path */
+  explicit Metrics_server(std::string socket_path);
+
+  Metrics_server(Metrics_server const &) = delete;
+  Metrics_server(Metrics_server &&) = delete;
+
+  /** stops serving and removes the socket */
+  ~Metrics_server();
+
+  Metrics_server &operator=(Metrics_server const &) = delete;
+  Metrics_server &operator=(Metrics_server &&) = delete;
+};
@@ -0,0 +1,85 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/**
+ * Unbounded lock-free queue for many producers and one consumer (Dmitry
+ * Vyukov's intrusive MPSC design). push() is wait-free and never drops an
+ * element, pop() may only be called from a single thread.
+ *
+ * pop() can return false while a producer is between its two steps of push().
+ * The element becomes visible as soon as that producer finishes, so a
+ * consumer which is woken after push() returned will always see it.
+ */
+template <typename T> class Mpsc_queue {
+  struct Node {
+    std::atomic<Node *> next;
+    T value;
+
+    Node() : next{nullptr}, value{} {}
+    explicit Node(T &&v) : next{nullptr}, value{std::move(v)} {}
+  };
+
+  /** producers append here */
+  std::atomic<Node *> head;
+  /** consumed stub node, its successor is the next element to pop */
+  Node *tail;
+
+public:
+  Mpsc_queue() : head{new Node{}}, tail{head.load()} {}
+
+  Mpsc_queue(Mpsc_queue const &) = delete;
+  Mpsc_queue(Mpsc_queue &&) = delete;
+
+  ~Mpsc_queue() {
+    while (tail != nullptr) {
+      Node *const next = tail->next.load(std::memory_order_relaxed);
+      delete tail;
+      tail = next;
+    }
+  }
+
+  Mpsc_queue &operator=(Mpsc_queue const &) = delete;
+  Mpsc_queue &operator=(Mpsc_queue &&) = delete;
+
+  /** may be called from any thread */
+  void push(T value) {
+    auto *const node = new Node{std::move(value)};
+    Node *const prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /** only to be called by the consumer, returns false if nothing is queued */
+  bool pop(T &value) {
+    Node *const next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+    value = std::move(next->value);
+    delete tail;
+    tail = next;
+    return true;
+  }
+
+  /** only to be called by the consumer */
+  bool empty() const {
+    return tail->next.load(std::memory_order_acquire) == nullptr;
+  }
+};
@@ -18,6 +18,7 @@
 
 #include "ethernet.h"
 #include "ip.h"
+#include <chrono>
 #include <memory>
 #include <pcap/pcap.h>
 #include <tuple>
@@ -47,6 +48,8 @@ struct Catch_incoming_connection {
   const int link_layer_type;
   basic_headers headers;
   std::vector<uint8_t> data;
+  /** when the packet has been handed to us */
+  std::chrono::steady_clock::time_point received;
 
   explicit Catch_incoming_connection(int link_layer_typee);
 
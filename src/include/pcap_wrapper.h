@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "metrics.h"
 #include <array>
 #include <functional>
 #include <memory>
@@ -25,6 +26,18 @@
 #include <thread>
 #include <vector>
 
+/** provides a bpf_programm instance in an exception safe way */
+struct BPF {
+  bpf_program bpf;
+  BPF(std::unique_ptr<pcap_t, void (*)(pcap_t *)> &pc,
+      const std::string &filter);
+  BPF(BPF const &) = delete;
+  BPF(BPF &&) = delete;
+  ~BPF();
+  BPF &operator=(BPF const &) = delete;
+  BPF &operator=(BPF &&) = delete;
+};
+
 /** Provide a nice interface to pcap and close the handle upon an exception */
 struct Pcap_wrapper {
   enum class Loop_end_reason {
@@ -44,19 +57,50 @@ private:
   std::unique_ptr<std::mutex> loop_end_reson_mutex;
   Loop_end_reason loop_end_reason = Loop_end_reason::unset;
 
+  /** kernel drops already added to kernel_drops */
+  unsigned int reported_drops = 0;
+
+  /** offline only: replay packets with their recorded gaps */
+  bool realtime = false;
+
 protected:
-  /** this is only present to run tests as non-root, do not use */
+  /** packets handed to the callback of loop() */
+  Counter *packets_seen = nullptr;
+  /** packets dropped by the kernel before we could read them */
+  Counter *kernel_drops = nullptr;
+
+  /**
+   * this is only present to run tests as non-root and for captures not backed
+   * by libpcap, do not use otherwise
+   */
   Pcap_wrapper();
 
+  /** counts packets and drops in the metrics of iface */
+  void count_in_metrics_of(std::string const &iface);
+
   Loop_end_reason get_end_reason() const;
 
 public:
   static auto const default_snaplen = int{65000};
   static auto const default_timeout = int{1000};
 
-  /** open a pcap instance on iface */
+  /**
+   * open a pcap instance on iface, buffer_size is the kernel buffer in bytes,
+   * 0 keeps the default of libpcap
+   */
   explicit Pcap_wrapper(std::string const &iface, int snaplen = default_snaplen,
-                        bool promisc = false, int timeout = default_timeout);
+                        bool promisc = false, int timeout = default_timeout,
+                        int buffer_size = 0);
+
+  /** a pcap or pcapng file to read packets from */
+  struct Offline {
+    std::string path;
+    /** keep the gaps between packets, else read as fast as possible */
+    bool realtime;
+  };
+
+  /** open a capture file instead of an interface, loop() ends at its end */
+  explicit Pcap_wrapper(Offline const &file);
 
   Pcap_wrapper(Pcap_wrapper const &) = delete;
   Pcap_wrapper(Pcap_wrapper &&) = default;
@@ -67,19 +111,28 @@ public:
   Pcap_wrapper &operator=(Pcap_wrapper &&) = default;
 
   /** tell if the first header is ethernet, unix socket, ... */
-  int get_datalink() const;
+  virtual int get_datalink() const;
 
   std::string get_verbose_datalink() const;
 
   /** sets a BPF (berkeley packet filter) filter the pcap instance */
-  void set_filter(const std::string &filter);
+  virtual void set_filter(const std::string &filter);
 
   /** sniff count packets calling cb each time */
   using Callback_t =
       std::function<void(const struct pcap_pkthdr *, const u_char *)>;
   virtual Pcap_wrapper::Loop_end_reason loop(int count, Callback_t cb);
 
-  void break_loop(const Loop_end_reason &ler);
+  virtual void break_loop(const Loop_end_reason &ler);
+
+  /**
+   * handles the packets of at most one buffer, up to count of them, in the
+   * calling thread. Returns the number of packets, 0 after the timeout
+   */
+  int dispatch(int count, Callback_t cb);
+
+  /** received and dropped packets since the handle has been opened */
+  pcap_stat stats() const;
 
   int inject(const std::vector<uint8_t> &data);
 };
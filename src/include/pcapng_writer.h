@@ -0,0 +1,58 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <pcap/pcap.h>
+#include <string>
+
+/**
+ * Writes packets into pcapng files of one section with one interface. Once
+ * a file reaches max_bytes the next one is started: path.0, path.1, ... and
+ * with max_files set, the oldest is overwritten, like tcpdump -C -W.
+ */
+class Pcapng_writer {
+  std::string const path;
+  int const link_type;
+  uint32_t const snaplen;
+  uint64_t const max_bytes;
+  unsigned int const max_files;
+
+  std::unique_ptr<FILE, int (*)(FILE *)> file;
+  /** bytes written into file */
+  uint64_t written;
+  /** number of the current file */
+  unsigned int file_number;
+
+  void open_next();
+  void write_bytes(void const *data, size_t size);
+
+public:
+  /** max_bytes of 0 never rotates, max_files of 0 keeps all files */
+  Pcapng_writer(std::string pathh, int link_typee, uint32_t snaplenn,
+                uint64_t max_bytess = 0, unsigned int max_filess = 0);
+
+  /** the name of the n-th file, just path without rotation */
+  std::string file_name(unsigned int n) const;
+
+  /** appends an enhanced packet block, rotates before if needed */
+  void write(pcap_pkthdr const &header, uint8_t const *data);
+
+  void flush();
+};
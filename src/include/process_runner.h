@@ -0,0 +1,169 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "argv_arena.h"
+#include "event_loop.h"
+#include "stream_reader.h"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/** set on the future of a command which had to be killed */
+struct Process_timeout : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Runs commands on its own Event_loop thread without blocking the caller.
+ * Children are waited for via pidfds, or by polling waitpid() on kernels
+ * without pidfd_open(). A command running longer than its timeout gets
+ * SIGTERM and, if it still lives after kill_grace, SIGKILL. At most
+ * max_children commands run at once, further ones are queued.
+ */
+class Process_runner {
+public:
+  using Duration = std::chrono::milliseconds;
+
+  static constexpr Duration default_timeout{30000};
+  static constexpr Duration kill_grace{2000};
+  static auto const default_max_children = size_t{16};
+
+  /**
+   * called on the runner thread with the ready result and the standard
+   * output of the command, must not block
+   */
+  using Completion =
+      std::function<void(std::future<uint8_t> result, Stream_reader &out)>;
+
+private:
+  struct Job {
+    /** not touched once the result is set, run_and_wait() takes it back */
+    Argv_arena cmd;
+    Duration const timeout;
+    std::promise<uint8_t> result;
+    /** empty unless the output is captured for a Completion */
+    Completion done;
+    Stream_reader out;
+
+    Job(Argv_arena cmdd, Duration timeoutt, Completion donee)
+        : cmd{std::move(cmdd)}, timeout{timeoutt}, result{},
+          done{std::move(donee)}, out{} {}
+
+    void set_value(uint8_t status);
+
+    void set_exception(std::exception_ptr const &e);
+
+  private:
+    void complete();
+  };
+
+  struct Child {
+    std::shared_ptr<Job> job;
+    /** invalid if pidfd_open() is not supported */
+    File_descriptor pidfd;
+    /** the read end of the pipe on stdout, invalid if it isn't captured */
+    File_descriptor output;
+    Event_loop::Timer_id deadline;
+    bool timed_out;
+    Event_loop::Clock::time_point started;
+
+    Child(std::shared_ptr<Job> jobb, File_descriptor pidfdd,
+          File_descriptor outputt, Event_loop::Timer_id deadlinee)
+        : job{std::move(jobb)}, pidfd{std::move(pidfdd)},
+          output{std::move(outputt)}, deadline{deadlinee}, timed_out{false},
+          started{Event_loop::Clock::now()} {}
+  };
+
+  size_t const max_children;
+  Event_loop loop;
+  /** only accessed from the loop thread */
+  std::map<pid_t, Child> children;
+  std::deque<std::shared_ptr<Job>> pending;
+  std::thread thread;
+
+  /** starts job on the loop thread or queues it if too many children run */
+  void queue(std::shared_ptr<Job> const &job);
+
+  void start(std::shared_ptr<Job> const &job);
+
+  void start_pending();
+
+  void poll_child(pid_t pid);
+
+  void read_output(pid_t pid);
+
+  void reap(pid_t pid);
+
+  void on_deadline(pid_t pid);
+
+  void shutdown();
+
+public:
+  explicit Process_runner(size_t max_childrenn = default_max_children);
+
+  Process_runner(Process_runner const &) = delete;
+  Process_runner(Process_runner &&) = delete;
+
+  /** kills all children still running */
+  ~Process_runner();
+
+  Process_runner &operator=(Process_runner const &) = delete;
+  Process_runner &operator=(Process_runner &&) = delete;
+
+  /**
+   * queues cmd and returns its exit status. The future throws Process_timeout
+   * if cmd had to be killed and std::runtime_error if it could not be started
+   */
+  std::future<uint8_t> run(Argv_arena cmd, Duration timeout = default_timeout);
+
+  /**
+   * queues cmd like run() and captures its standard output. Instead of a
+   * future nobody waits on, done gets the result once cmd exited.
+   */
+  void run(Argv_arena cmd, Duration timeout, Completion done);
+
+  /**
+   * runs cmd like run() and waits for its exit status. cmd is handed back
+   * afterwards, even if it failed, so a reused arena keeps its buffers
+   */
+  uint8_t run_and_wait(Argv_arena &cmd, Duration timeout = default_timeout);
+
+  template <typename Container>
+  std::future<uint8_t> run(Container const &cmd,
+                           Duration const timeout = default_timeout) {
+    static_assert(std::is_same<typename Container::value_type,
+                               std::string>::value,
+                  "container has to carry std::string");
+    Argv_arena argv;
+    for (auto const &arg : cmd) {
+      argv << arg;
+    }
+    return run(std::move(argv), timeout);
+  }
+};
+
+/** the runner shared by all threads of the process */
+Process_runner &process_runner();
@@ -16,12 +16,14 @@
 
 #pragma once
 
+#include "argv_arena.h"
 #include "ip_address.h"
 #include "pcap_wrapper.h"
 #include <algorithm>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <type_traits>
 
 /** perform or reverse the modification */
 enum struct Action { add, del };
@@ -31,7 +33,8 @@ enum struct Action { add, del };
  * reverse this modification.
  */
 struct Scope_guard {
-  using Aquire_release = std::function<std::string(const Action)>;
+  /** renders the command to run into the arena, leaves it empty for none */
+  using Aquire_release = std::function<void(const Action, Argv_arena &)>;
 
 private:
   /** if the consumed resource or modification is freed */
@@ -44,6 +47,21 @@ private:
    */
   void take_action(Action a) const;
 
+  template <typename Functor>
+  static auto to_aquire_release(Functor f, int)
+      -> decltype(f(Action::add, std::declval<Argv_arena &>()),
+                  Aquire_release{}) {
+    return Aquire_release{std::move(f)};
+  }
+
+  /** adapts functors returning the command as a single string */
+  template <typename Functor>
+  static Aquire_release to_aquire_release(Functor f, long) {
+    return [f](const Action a, Argv_arena &argv) mutable {
+      argv.split(f(a), ' ');
+    };
+  }
+
 public:
   /**
    * Default constructor initializes anything with default values
@@ -56,6 +74,19 @@ public:
    */
   explicit Scope_guard(Aquire_release aquire_release_arg);
 
+  /**
+   * consume the resource or perform modification using a functor which
+   * either renders into an Argv_arena or returns the command as a string
+   */
+  template <typename Functor,
+            typename = typename std::enable_if<
+                !std::is_same<typename std::decay<Functor>::type,
+                              Scope_guard>::value &&
+                !std::is_same<typename std::decay<Functor>::type,
+                              Aquire_release>::value>::type>
+  explicit Scope_guard(Functor f)
+      : Scope_guard{to_aquire_release(std::move(f), 0)} {}
+
   /**
    * Move constructor
    */
@@ -86,6 +117,8 @@ struct Temp_ip {
   const std::string iface;
   const IP_address ip;
 
+  void operator()(Action action, Argv_arena &argv) const;
+
   std::string operator()(Action action) const;
 };
 
@@ -94,6 +127,8 @@ struct Drop_port {
   const IP_address ip;
   const uint16_t port;
 
+  void operator()(Action action, Argv_arena &argv) const;
+
   std::string operator()(Action action) const;
 };
 
@@ -103,6 +138,8 @@ struct Reject_tp {
   const IP_address ip;
   const TP tcp_udp;
 
+  void operator()(Action action, Argv_arena &argv) const;
+
   std::string operator()(Action action) const;
 };
 
@@ -110,12 +147,16 @@ struct Reject_tp {
 struct Block_icmp {
   const IP_address ip;
 
+  void operator()(Action action, Argv_arena &argv) const;
+
   std::string operator()(Action action) const;
 };
 
 struct Block_ipv6_neighbor_solicitation {
   const IP_address ip;
 
+  void operator()(Action action, Argv_arena &argv) const;
+
   std::string operator()(Action action) const;
 };
 
@@ -17,11 +17,14 @@
 #pragma once
 
 #include <cerrno>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <linux/if.h>
 #include <netinet/ether.h>
 #include <stdexcept>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <vector>
 
 /** C++ wrapper to socket functions */
@@ -82,9 +85,53 @@ public:
     return sent_bytes;
   }
 
+  /**
+   * send the first count messages with sendmmsg(), returns the number sent,
+   * 0 if the send queue is full
+   */
+  unsigned int send_batch(std::vector<mmsghdr> &messages, unsigned int count);
+
   void ioctl(unsigned long req_number, ifreq &ifr) const;
 
   int get_ifindex(const std::string &iface) const;
 
   ether_addr get_hwaddr(const std::string &iface) const;
 };
+
+/**
+ * Sends prebuilt frames through a Socket with sendmmsg(), up to batch frames
+ * per call and at most rate frames per second since the last restart(), 0
+ * for no limit.
+ */
+class Paced_sender {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Frames = std::vector<std::vector<uint8_t>>;
+
+private:
+  std::vector<iovec> iovecs;
+  std::vector<mmsghdr> messages;
+  uint64_t const rate;
+  Clock::time_point start;
+  uint64_t sent;
+  uint64_t full_queue;
+
+public:
+  Paced_sender(unsigned int batch, uint64_t ratee);
+
+  /** paces the following frames as if none had been sent before */
+  void restart();
+
+  /**
+   * sends up to count frames starting at frames[first], wrapping around at
+   * the end of frames, to destination if it isn't nullptr. Sleeps and
+   * returns 0 if no frame is due yet or the send queue is full, otherwise
+   * the number of frames sent.
+   */
+  unsigned int send(Socket &socket, Frames const &frames, size_t first,
+                    size_t count, sockaddr const *destination = nullptr,
+                    socklen_t destination_size = 0);
+
+  /** how often the send queue could not take a whole batch */
+  uint64_t full_queues() const;
+};
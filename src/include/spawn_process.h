@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include "argv_arena.h"
 #include "file_descriptor.h"
+#include "stream_reader.h"
 #include "to_string.h"
 #include <functional>
 #include <string>
@@ -24,9 +26,22 @@
 
 uint8_t wait_until_pid_exits(const pid_t &pid);
 
+/** starts argv without waiting for it, argv has to end with nullptr */
+pid_t spawn_child(char *const *argv, File_descriptor const &in,
+                  File_descriptor const &out);
+
 uint8_t spawn_wrapper(std::vector<char *> params, File_descriptor const &in,
                       File_descriptor const &out);
 
+uint8_t spawn(Argv_arena &cmd, File_descriptor const &in = File_descriptor(),
+              File_descriptor const &out = File_descriptor());
+
+/**
+ * runs cmd and reads its stdout into out until EOF before waiting for it, so
+ * no output is lost and a full pipe cannot block the child
+ */
+uint8_t spawn(Argv_arena &cmd, Stream_reader &out);
+
 template <typename Container>
 uint8_t spawn(Container &&cmd, File_descriptor const &in = File_descriptor(),
               File_descriptor const &out = File_descriptor()) {
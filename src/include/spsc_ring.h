@@ -0,0 +1,96 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Bounded lock-free ring for one producer and one consumer. Elements are
+ * written and read in place: the producer fills the slot returned by claim()
+ * and makes it visible with publish(), the consumer reads front() and
+ * releases it with pop(). Nothing is allocated after construction.
+ */
+template <typename T> class Spsc_ring {
+  std::vector<T> slots;
+  size_t const mask;
+  /** next slot to read, written by the consumer */
+  std::atomic<size_t> head;
+  /** keeps head and tail on different cache lines */
+  std::array<char, 64> padding;
+  /** next slot to write, written by the producer */
+  std::atomic<size_t> tail;
+
+  static size_t round_up_to_power_of_two(size_t const n) {
+    auto result = size_t{1};
+    while (result < n) {
+      result <<= 1U;
+    }
+    return result;
+  }
+
+public:
+  /** capacity is rounded up to the next power of two */
+  explicit Spsc_ring(size_t const capacity)
+      : slots(round_up_to_power_of_two(capacity)), mask{slots.size() - 1},
+        head{0}, padding{}, tail{0} {}
+
+  Spsc_ring(Spsc_ring const &) = delete;
+  Spsc_ring(Spsc_ring &&) = delete;
+  ~Spsc_ring() = default;
+  Spsc_ring &operator=(Spsc_ring const &) = delete;
+  Spsc_ring &operator=(Spsc_ring &&) = delete;
+
+  size_t capacity() const { return slots.size(); }
+
+  /** producer only: the slot to fill next, nullptr if the ring is full */
+  T *claim() {
+    auto const t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size()) {
+      return nullptr;
+    }
+    return &slots[t & mask];
+  }
+
+  /** producer only: makes the slot returned by claim() readable */
+  void publish() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+  /** consumer only: the oldest element, nullptr if the ring is empty */
+  T *front() {
+    auto const h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots[h & mask];
+  }
+
+  /** consumer only: releases the element returned by front() */
+  void pop() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+};
@@ -0,0 +1,82 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** characters inside the buffer of a Stream_reader, not owned */
+struct Line_view {
+  char const *data;
+  size_t size;
+
+  std::string str() const;
+
+  /** the index-th part between delimiters, like split(str(), delimiter) */
+  Line_view field(size_t index, char delimiter = ' ') const;
+
+  bool equals_ignore_case(std::string const &rhs) const;
+};
+
+bool operator==(Line_view const &lhs, std::string const &rhs);
+
+std::ostream &operator<<(std::ostream &out, Line_view const &line);
+
+/**
+ * Collects the output of a file descriptor in one growing buffer and hands
+ * out its lines as views into it. Views stay valid until the reader is read
+ * into or cleared again.
+ *
+ * read_all() blocks until EOF. In an Event_loop call read_some() whenever
+ * the (non blocking) descriptor is readable and next_line() afterwards.
+ */
+class Stream_reader {
+  std::vector<char> buffer;
+  /** bytes of buffer holding data */
+  size_t filled;
+  /** bytes already handed out by next_line() */
+  size_t consumed;
+  bool eof;
+
+public:
+  Stream_reader();
+
+  /**
+   * calls read() once, so it blocks only if fd is blocking and empty. Returns
+   * false once EOF has been reached
+   */
+  bool read_some(int fd);
+
+  /** reads until EOF */
+  void read_all(int fd);
+
+  bool at_eof() const;
+
+  /**
+   * the next complete line without '\n'. After EOF the last line is returned
+   * even without a trailing '\n'. Returns false if there is none
+   */
+  bool next_line(Line_view &line);
+
+  /** all lines of the data read so far, split like split(data, '\n') */
+  std::vector<Line_view> lines() const;
+
+  size_t size() const;
+
+  void clear();
+};
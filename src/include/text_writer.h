@@ -0,0 +1,86 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Formats text into a buffer provided by the caller, usually on the stack,
+ * without allocating. The text is always nul terminated, whatever does not
+ * fit is cut off and truncated() tells about it.
+ */
+class Text_writer {
+  char *const first;
+  /** the last char of the buffer, kept for the nul termination */
+  char *const last;
+  char *position;
+  bool overflow;
+
+  Text_writer &write_unsigned(unsigned long long number, bool negative);
+
+public:
+  /** size includes the nul termination and has to be at least 1 */
+  Text_writer(char *buffer, size_t size);
+
+  template <size_t N>
+  explicit Text_writer(std::array<char, N> &buffer)
+      : Text_writer(buffer.data(), N) {}
+
+  Text_writer(Text_writer const &) = delete;
+  Text_writer(Text_writer &&) = delete;
+  ~Text_writer() = default;
+  Text_writer &operator=(Text_writer const &) = delete;
+  Text_writer &operator=(Text_writer &&) = delete;
+
+  char const *c_str() const;
+
+  size_t size() const;
+
+  /** whether some of the written text did not fit */
+  bool truncated() const;
+
+  std::string str() const;
+
+  /** starts over at the beginning of the buffer */
+  void clear();
+
+  Text_writer &write(char const *text, size_t length);
+
+  Text_writer &operator<<(char const *text);
+
+  Text_writer &operator<<(std::string const &text);
+
+  Text_writer &operator<<(char c);
+
+  Text_writer &operator<<(int number);
+
+  Text_writer &operator<<(long number);
+
+  Text_writer &operator<<(long long number);
+
+  Text_writer &operator<<(unsigned int number);
+
+  Text_writer &operator<<(unsigned long number);
+
+  Text_writer &operator<<(unsigned long long number);
+
+  /** the lower width hex digits of number, with leading zeros */
+  Text_writer &hex(uint64_t number, size_t width);
+};
@@ -0,0 +1,103 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include "event_loop.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed number of workers for blocking work, each with its own deque of
+ * tasks. A worker runs its newest task first and steals the oldest task of
+ * another worker once its own deque is empty. Tasks posted from outside the
+ * pool are spread round robin. Delayed tasks wait on an Event_loop thread
+ * until they are due.
+ */
+class Thread_pool {
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct Worker_queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+
+    Worker_queue() : mutex{}, tasks{} {}
+  };
+
+  std::vector<std::unique_ptr<Worker_queue>> queues;
+  /** tasks queued but not taken by a worker yet */
+  std::atomic<size_t> queued;
+  std::atomic<size_t> next_queue;
+  std::atomic_bool stopping;
+  std::mutex idle_mutex;
+  std::condition_variable idle;
+  Event_loop timers;
+  std::thread timer_thread;
+  std::vector<std::thread> workers;
+
+  void push(Task task);
+
+  /** takes the newest task of queue index or steals the oldest of another */
+  bool pop(size_t index, Task &task);
+
+  void work(size_t index);
+
+public:
+  /** the number of hardware threads, at least one */
+  static size_t default_size();
+
+  explicit Thread_pool(size_t size = default_size());
+
+  Thread_pool(Thread_pool const &) = delete;
+  Thread_pool(Thread_pool &&) = delete;
+
+  /** runs the queued tasks, drops delayed ones which are not due yet */
+  ~Thread_pool();
+
+  Thread_pool &operator=(Thread_pool const &) = delete;
+  Thread_pool &operator=(Thread_pool &&) = delete;
+
+  size_t size() const;
+
+  /** runs task on a worker, exceptions are logged */
+  void post(Task task);
+
+  /** posts task once delay passed */
+  void post_after(std::chrono::milliseconds delay, Task task);
+
+  /** runs f on a worker, the future carries its result or exception */
+  template <typename F> auto submit(F f) -> std::future<decltype(f())> {
+    using Result = decltype(f());
+    auto const task =
+        std::make_shared<std::packaged_task<Result()>>(std::move(f));
+    auto result = task->get_future();
+    post([task]() { (*task)(); });
+    return result;
+  }
+};
+
+/** the pool shared by all threads of the process */
+Thread_pool &thread_pool();
@@ -16,11 +16,15 @@
 
 #pragma once
 
+#include "text_writer.h"
 #include <algorithm>
+#include <array>
 #include <iterator>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 /**
@@ -38,12 +42,61 @@ std::ostream &operator<<(std::ostream &out, std::vector<T, Alloc> v) {
 
 std::string to_string(char const *t);
 
-template <typename T> std::string to_string(T &&t) {
+namespace to_string_detail {
+/** integers except bool and the char types, which streams print as text */
+template <typename T>
+using Is_number = std::integral_constant<
+    bool, std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+              !std::is_same<T, char>::value &&
+              !std::is_same<T, signed char>::value &&
+              !std::is_same<T, unsigned char>::value>;
+
+/** class types with a Text_writer overload */
+template <typename T, typename = void> struct Has_writer : std::false_type {};
+
+template <typename T>
+struct Has_writer<T, decltype(void(std::declval<Text_writer &>()
+                                   << std::declval<T const &>()))>
+    : std::integral_constant<bool, std::is_class<T>::value> {};
+
+template <typename T> std::string via_stream(T const &t) {
   std::stringstream ss;
   ss << t;
   return ss.str();
 }
 
+template <typename T>
+std::string via(T const &t, std::true_type /*number*/,
+                std::false_type /*writer*/) {
+  return std::to_string(t);
+}
+
+template <typename T>
+std::string via(T const &t, std::false_type /*number*/,
+                std::true_type /*writer*/) {
+  std::array<char, 256> text{};
+  Text_writer out{text};
+  out << t;
+  return out.truncated() ? via_stream(t) : out.str();
+}
+
+template <typename T>
+std::string via(T const &t, std::false_type /*number*/,
+                std::false_type /*writer*/) {
+  return via_stream(t);
+}
+} // namespace to_string_detail
+
+/**
+ * integers and types which can be written to a Text_writer are formatted
+ * without std::stringstream, anything else is streamed
+ */
+template <typename T> std::string to_string(T &&t) {
+  using Plain = typename std::decay<T>::type;
+  return to_string_detail::via(t, to_string_detail::Is_number<Plain>{},
+                               to_string_detail::Has_writer<Plain>{});
+}
+
 bool contains_only_valid_characters(const std::string &input,
                                     const std::string &valid_chars);
 
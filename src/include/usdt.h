@@ -0,0 +1,65 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+/**
+ * Static tracepoints of the provider sleep_proxy, compiled in with the meson
+ * option usdt. Each probe is a single nop until a tracer attaches, e.g.
+ *
+ *   bpftrace -e 'usdt:./libsleep-proxy.so:sleep_proxy:ping_attempt
+ *                { printf("%s %d ms\n", str(arg1), arg3 / 1000000); }'
+ *
+ * Strings are passed as char const *, durations as int64_t nanoseconds.
+ * Without the option the arguments are not even evaluated.
+ */
+#ifdef SLEEP_PROXY_USDT
+
+#include <sys/sdt.h>
+
+#define SLEEP_PROXY_PROBE1(name, a) DTRACE_PROBE1(sleep_proxy, name, a)
+#define SLEEP_PROXY_PROBE2(name, a, b) DTRACE_PROBE2(sleep_proxy, name, a, b)
+#define SLEEP_PROXY_PROBE3(name, a, b, c)                                      \
+  DTRACE_PROBE3(sleep_proxy, name, a, b, c)
+#define SLEEP_PROXY_PROBE4(name, a, b, c, d)                                   \
+  DTRACE_PROBE4(sleep_proxy, name, a, b, c, d)
+#define SLEEP_PROXY_PROBE5(name, a, b, c, d, e)                                \
+  DTRACE_PROBE5(sleep_proxy, name, a, b, c, d, e)
+
+#else
+
+// sizeof() keeps variables only used by probes from being unused
+#define SLEEP_PROXY_PROBE1(name, a) static_cast<void>(sizeof(a))
+#define SLEEP_PROXY_PROBE2(name, a, b)                                         \
+  static_cast<void>(sizeof(a) + sizeof(b))
+#define SLEEP_PROXY_PROBE3(name, a, b, c)                                      \
+  static_cast<void>(sizeof(a) + sizeof(b) + sizeof(c))
+#define SLEEP_PROXY_PROBE4(name, a, b, c, d)                                   \
+  static_cast<void>(sizeof(a) + sizeof(b) + sizeof(c) + sizeof(d))
+#define SLEEP_PROXY_PROBE5(name, a, b, c, d, e)                                \
+  static_cast<void>(sizeof(a) + sizeof(b) + sizeof(c) + sizeof(d) + sizeof(e))
+
+#endif
+
+#include <chrono>
+#include <cstdint>
+
+/** nanoseconds since start for the timing arguments of probes */
+inline int64_t probe_ns_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
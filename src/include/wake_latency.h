@@ -0,0 +1,121 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+/**
+ * Histogram of durations with buckets growing like the values (HDR style):
+ * each power of two is split into sub_buckets linear buckets, so every
+ * value is kept with a relative error below 1/sub_buckets. Recording is
+ * lock free and may happen while another thread reads.
+ */
+class Latency_histogram {
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  static auto const sub_bucket_bits = 4U;
+  static auto const sub_buckets = 1U << sub_bucket_bits;
+  /**
+   * durations up to 2^max_bits ns (about a minute) are told apart, longer
+   * ones share the last bucket
+   */
+  static auto const max_bits = 36U;
+  static auto const bucket_count =
+      sub_buckets * (max_bits - sub_bucket_bits + 2);
+
+  Latency_histogram();
+
+  Latency_histogram(Latency_histogram const &) = delete;
+  Latency_histogram(Latency_histogram &&) = delete;
+  ~Latency_histogram() = default;
+  Latency_histogram &operator=(Latency_histogram const &) = delete;
+  Latency_histogram &operator=(Latency_histogram &&) = delete;
+
+  void record(Duration value);
+
+  uint64_t count() const;
+
+  Duration max() const;
+
+  Duration mean() const;
+
+  /**
+   * the largest value in the bucket holding the given percentile (0 to 100)
+   * of all values, never more than max()
+   */
+  Duration percentile(double percent) const;
+
+  static size_t bucket_index(uint64_t ns);
+
+  /** the largest value counted in bucket */
+  static uint64_t bucket_upper_bound(size_t bucket);
+
+private:
+  /** 32 bits are plenty for the wakes of one host and halve the size */
+  std::array<std::atomic<uint32_t>, bucket_count> buckets;
+  std::atomic<uint64_t> total;
+  std::atomic<uint64_t> sum_ns;
+  std::atomic<uint64_t> max_ns;
+};
+
+/** the stages of waking a host, in the order emulate_host() runs them */
+enum class Wake_stage {
+  /** from the SYN packet until capturing has stopped */
+  capture,
+  icmp_block,
+  /** removing the firewall rules and IPs (locks.clear()) */
+  firewall_teardown,
+  wol,
+  /** every single ping_and_wait() attempt */
+  ping_attempt,
+  /** all ping attempts together */
+  ping,
+  replay,
+  /** from the SYN packet until it has been replayed */
+  total
+};
+
+std::ostream &operator<<(std::ostream &out, Wake_stage stage);
+
+/** histograms of all wake stages of one host */
+class Wake_latency {
+public:
+  static auto const stage_count = static_cast<size_t>(Wake_stage::total) + 1;
+
+  Wake_latency();
+
+  Latency_histogram &operator[](Wake_stage stage);
+
+  Latency_histogram const &operator[](Wake_stage stage) const;
+
+private:
+  std::array<Latency_histogram, stage_count> stages;
+};
+
+/** the histograms of hostname, created on first use and never removed */
+Wake_latency &wake_latency(std::string const &hostname);
+
+/** writes count, percentiles and max in ms of every stage of every host */
+void write_wake_latency(std::ostream &out);
+
+/** logs write_wake_latency(), watchHost does so on SIGUSR1 */
+void log_wake_latency();
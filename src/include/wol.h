@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "text_writer.h"
 #include <netinet/ether.h>
 #include <string>
 #include <vector>
@@ -34,6 +35,8 @@ std::vector<uint8_t> create_wol_payload(const ether_addr &mac);
 Wol_method parse_wol_method(const std::string &wol_method);
 std::ostream &operator<<(std::ostream &out, const Wol_method &wol_method);
 
+Text_writer &operator<<(Text_writer &out, const Wol_method &wol_method);
+
 /**
  * Send a WOL UDP packet to the given mac
  */
@@ -0,0 +1,249 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "address_index.h"
+
+#include "host_table.h"
+#include "int_utils.h"
+#include "log.h"
+#include <algorithm>
+#include <cstring>
+#include <endian.h>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+auto const no_node = std::numeric_limits<uint32_t>::max();
+auto const key_bits = uint8_t{128};
+/** where IPv4 addresses start in the IPv4-mapped IPv6 range */
+auto const ipv4_offset = uint8_t{96};
+
+Address_key key_of(IP_address const &address) {
+  std::array<uint8_t, 16> bytes{{0}};
+  if (address.family == AF_INET) {
+    bytes.at(10) = 0xff;
+    bytes.at(11) = 0xff;
+    std::memcpy(&bytes.at(12), &address.address.ipv4, sizeof(in_addr));
+  } else {
+    std::memcpy(bytes.data(), &address.address.ipv6, sizeof(in6_addr));
+  }
+  Address_key key{0, 0};
+  std::memcpy(&key.high, bytes.data(), sizeof(key.high));
+  std::memcpy(&key.low, &bytes.at(8), sizeof(key.low));
+  key.high = be64toh(key.high);
+  key.low = be64toh(key.low);
+  return key;
+}
+
+/** the first length bits of a 64 bit half */
+uint64_t prefix_mask(unsigned int const length) {
+  return length == 0    ? 0
+         : length >= 64 ? ~uint64_t{0}
+                        : ~uint64_t{0} << (64U - length);
+}
+
+Address_key masked(Address_key const &key, uint8_t const length) {
+  return {key.high & prefix_mask(length),
+          key.low & prefix_mask(length > 64 ? length - 64U : 0U)};
+}
+
+/** the bit after the first position bits */
+size_t bit(Address_key const &key, uint8_t const position) {
+  return position < 64 ? key.high >> (63U - position) & 1U
+                       : key.low >> (127U - position) & 1U;
+}
+
+size_t hash(Address_key const &key) { return hash_words(key.high, key.low); }
+
+bool operator==(Address_key const &lhs, Address_key const &rhs) {
+  return lhs.high == rhs.high && lhs.low == rhs.low;
+}
+
+/** the number of leading bits both keys share */
+uint8_t common_length(Address_key const &lhs, Address_key const &rhs) {
+  if (lhs.high != rhs.high) {
+    return static_cast<uint8_t>(__builtin_clzll(lhs.high ^ rhs.high));
+  }
+  if (lhs.low != rhs.low) {
+    return static_cast<uint8_t>(64 + __builtin_clzll(lhs.low ^ rhs.low));
+  }
+  return key_bits;
+}
+} // namespace
+
+uint32_t const Address_index::no_value = std::numeric_limits<uint32_t>::max();
+
+Address_index::Address_index() : root{no_node} {}
+
+uint32_t Address_index::new_node(Address_key const &key, uint8_t const length,
+                                 uint32_t const value) {
+  if (nodes.size() >= no_node) {
+    throw std::length_error("too many prefixes in Address_index");
+  }
+  nodes.push_back({key, {{no_node, no_node}}, value, length});
+  return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void Address_index::link(uint32_t const parent, size_t const side,
+                         uint32_t const child) {
+  if (parent == no_node) {
+    root = child;
+  } else {
+    nodes.at(parent).children.at(side) = child;
+  }
+}
+
+bool Address_index::add(IP_address const &address,
+                        uint8_t const prefix_length, uint32_t const value) {
+  if (address.family != AF_INET && address.family != AF_INET6) {
+    throw std::invalid_argument("Address_index: unknown address family");
+  }
+  auto const is_ipv4 = address.family == AF_INET;
+  if (prefix_length > (is_ipv4 ? key_bits - ipv4_offset : key_bits)) {
+    throw std::invalid_argument("Address_index: prefix length too long");
+  }
+  if (value == no_value) {
+    throw std::invalid_argument("Address_index: value reserved");
+  }
+  auto const length = static_cast<uint8_t>(
+      is_ipv4 ? prefix_length + ipv4_offset : prefix_length);
+  auto const key = masked(key_of(address), length);
+  return length == key_bits ? add_address(key, value)
+                            : add_prefix(key, length, value);
+}
+
+bool Address_index::add_address(Address_key const &key, uint32_t const value) {
+  if ((addresses + 1) * 2 > slots.size()) {
+    auto const previous = std::move(slots);
+    slots.assign(std::max(previous.size() * 2, size_t{16}),
+                 Slot{{0, 0}, no_value});
+    addresses = 0;
+    for (auto const &slot : previous) {
+      if (slot.value != no_value) {
+        add_address(slot.key, slot.value);
+      }
+    }
+  }
+  auto const mask = slots.size() - 1;
+  for (auto i = hash(key) & mask;; i = (i + 1) & mask) {
+    auto &slot = slots[i];
+    if (slot.value == no_value) {
+      slot = Slot{key, value};
+      ++addresses;
+      return true;
+    }
+    if (slot.key == key) {
+      return false;
+    }
+  }
+}
+
+bool Address_index::add_prefix(Address_key const &key, uint8_t const length,
+                               uint32_t const value) {
+  auto parent = no_node;
+  auto side = size_t{0};
+  auto current = root;
+  while (current != no_node) {
+    auto &node = nodes.at(current);
+    auto const common =
+        std::min({common_length(key, node.key), length, node.length});
+    if (common == node.length) {
+      if (node.length == length) {
+        if (node.value != no_value) {
+          return false;
+        }
+        node.value = value;
+        ++prefixes;
+        return true;
+      }
+      parent = current;
+      side = bit(key, node.length);
+      current = node.children.at(side);
+      continue;
+    }
+    // the new prefix contains node or both diverge: node moves down
+    auto const node_key = node.key;
+    auto replacement = no_node;
+    if (common == length) {
+      replacement = new_node(key, length, value);
+    } else {
+      replacement = new_node(masked(key, common), common, no_value);
+      auto const leaf = new_node(key, length, value);
+      nodes.at(replacement).children.at(bit(key, common)) = leaf;
+    }
+    nodes.at(replacement).children.at(bit(node_key, common)) = current;
+    link(parent, side, replacement);
+    ++prefixes;
+    return true;
+  }
+  link(parent, side, new_node(key, length, value));
+  ++prefixes;
+  return true;
+}
+
+uint32_t Address_index::lookup(IP_address const &address) const {
+  if (address.family != AF_INET && address.family != AF_INET6) {
+    return no_value;
+  }
+  auto const key = key_of(address);
+  if (addresses != 0) {
+    auto const mask = slots.size() - 1;
+    for (auto i = hash(key) & mask; slots[i].value != no_value;
+         i = (i + 1) & mask) {
+      if (slots[i].key == key) {
+        return slots[i].value;
+      }
+    }
+  }
+  auto best = no_value;
+  for (auto current = root; current != no_node;) {
+    auto const &node = nodes[current];
+    if (common_length(key, node.key) < node.length) {
+      break;
+    }
+    if (node.value != no_value) {
+      best = node.value;
+    }
+    if (node.length == key_bits) {
+      break;
+    }
+    current = node.children[bit(key, node.length)];
+  }
+  return best;
+}
+
+size_t Address_index::size() const { return addresses + prefixes; }
+
+bool Address_index::empty() const { return size() == 0; }
+
+size_t Address_index::memory_usage() const {
+  return slots.capacity() * sizeof(Slot) + nodes.capacity() * sizeof(Node);
+}
+
+Address_index index_host_addresses(Host_table const &table) {
+  Address_index index;
+  for (size_t host = 0; host < table.size(); ++host) {
+    for (auto const &address : table.addresses_of(host)) {
+      auto const full_length = address.family == AF_INET ? 32 : 128;
+      if (!index.add(address, full_length, static_cast<uint32_t>(host))) {
+        LOG(LOG_INFO, "%s of %s already belongs to %s",
+            address.pure_text().c_str(), table.hostname(host).c_str(),
+            table.hostname(index.lookup(address)).c_str());
+      }
+    }
+  }
+  return index;
+}
@@ -15,97 +15,58 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "args.h"
+#include "config_snapshot.h"
 #include "ethernet.h"
+#include "host_table.h"
 #include "int_utils.h"
 #include "ip_utils.h"
 #include "log.h"
 #include "wol.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <getopt.h>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace {
-const std::string def_iface = "lo";
-const std::string def_address_ipv4 = "10.0.0.1/16";
-const std::string def_address_ipv6 = "fe80::123/64";
-const std::string def_ports0 = "12345";
-const std::string def_ports1 = "23456";
-const std::string def_mac = "01:12:34:45:67:89";
-const std::string def_hostname;
-const std::string def_ping_tries = "5";
-const std::string def_wol_method = "ethernet";
-
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 bool to_syslog = false;
-
-Args read_args(std::ifstream &file) {
-  std::string interface = def_iface;
-  std::vector<std::string> address;
-  std::vector<std::string> ports;
-  std::string mac = def_mac;
-  std::string hostname = def_hostname;
-  std::string ping_tries = def_ping_tries;
-  std::string wol_method = def_wol_method;
-  std::string line;
-  while (std::getline(file, line) && line.substr(0, 4) != "host") {
-    if (line.empty()) {
-      continue;
-    }
-    const auto token = split(line, ' ');
-    if (token.size() != 2) {
-      log_string(LOG_INFO, "skipping line \"" + line + "\"");
-      log_string(LOG_INFO,
-                 "needs to be a pair of name and value separated by space");
-      continue;
-    }
-    if (token.at(0) == "interface") {
-      interface = token.at(1);
-    } else if (token.at(0) == "address") {
-      address.push_back(token.at(1));
-    } else if (token.at(0) == "port") {
-      ports.push_back(token.at(1));
-    } else if (token.at(0) == "mac") {
-      mac = token.at(1);
-    } else if (token.at(0) == "name") {
-      hostname = token.at(1);
-    } else if (token.at(0) == "ping_tries") {
-      ping_tries = token.at(1);
-    } else if (token.at(0) == "wol_method") {
-      wol_method = token.at(1);
-    } else {
-      log_string(LOG_INFO, "unknown name \"" + token.at(0) + "\": skipping");
-    }
-  }
-  if (address.empty()) {
-    address.push_back(def_address_ipv4);
-    address.push_back(def_address_ipv6);
-  }
-  if (ports.empty()) {
-    ports.push_back(def_ports0);
-    ports.push_back(def_ports1);
-  }
-
-  return {interface, address, ports, mac, hostname, ping_tries, wol_method};
-}
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+unsigned int num_capture_workers = 0;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::string metrics_socket_path;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::string config_file_path;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+bool compile_config_only = false;
 
 std::vector<Args> read_file(const std::string &filename) {
-  std::ifstream file(filename);
+  auto const table = load_host_table(filename);
   std::vector<Args> ret_val;
-  std::string line;
-  while (std::getline(file, line) && line.substr(0, 4) != "host") {
-  }
-  while (file) {
-    ret_val.emplace_back(read_args(file));
+  ret_val.reserve(table.size());
+  for (size_t host = 0; host < table.size(); ++host) {
+    ret_val.emplace_back(table, host);
   }
   return ret_val;
 }
 } // namespace
 
-void reset() { to_syslog = false; }
+void reset() {
+  to_syslog = false;
+  num_capture_workers = 0;
+  metrics_socket_path.clear();
+  config_file_path.clear();
+  compile_config_only = false;
+  set_log_level(LOG_DEBUG);
+}
 
 Args::Args() : interface {
 }, address{}, ports{}, mac{{0}}, hostname{}, ping_tries{0}, wol_method{},
-    syslog(to_syslog) {
+    syslog(to_syslog), capture_workers(num_capture_workers),
+    metrics_socket(metrics_socket_path), config_file(config_file_path),
+    compile_config(compile_config_only) {
 }
 
 Args::Args(const std::string &interface_,
@@ -120,7 +81,10 @@ Args::Args(const std::string &interface_,
       hostname(test_characters(hostname_, iface_chars + "-",
                                "invalid token in hostname: " + hostname_)),
       ping_tries(str_to_integral<unsigned int>(ping_tries_)),
-      wol_method(parse_wol_method(wol_method_)), syslog(to_syslog) {
+      wol_method(parse_wol_method(wol_method_)), syslog(to_syslog),
+      capture_workers(num_capture_workers),
+      metrics_socket(metrics_socket_path), config_file(config_file_path),
+      compile_config(compile_config_only) {
   if (address.empty()) {
     throw std::runtime_error("no ip address given");
   }
@@ -129,6 +93,17 @@ Args::Args(const std::string &interface_,
   }
 }
 
+Args::Args(const Host_table &table, size_t const host)
+    : interface(table.interface(host)),
+      address(std::begin(table.addresses_of(host)),
+              std::end(table.addresses_of(host))),
+      ports(std::begin(table.ports_of(host)), std::end(table.ports_of(host))),
+      mac(table.mac(host)), hostname(table.hostname(host)),
+      ping_tries(table.ping_tries(host)), wol_method(table.wol_method(host)),
+      syslog(to_syslog), capture_workers(num_capture_workers),
+      metrics_socket(metrics_socket_path), config_file(config_file_path),
+      compile_config(compile_config_only) {}
+
 void print_help() {
   log_string(LOG_INFO, "usage: emulateHost [-h] [-s] [-c CONFIG]");
   log_string(LOG_INFO, "emulates a host, which went standby and wakes it upon "
@@ -142,6 +117,18 @@ void print_help() {
       "                        read config file, should be the last argument");
   log_string(LOG_INFO, "  -s, --syslog");
   log_string(LOG_INFO, "                        print messages to syslog");
+  log_string(LOG_INFO, "  -w WORKERS, --capture-workers WORKERS");
+  log_string(LOG_INFO, "                        capture with WORKERS threads "
+                       "using PACKET_FANOUT");
+  log_string(LOG_INFO, "  -l LEVEL, --log-level LEVEL");
+  log_string(LOG_INFO, "                        drop messages less important "
+                       "than LEVEL (err, warning, notice, info, debug)");
+  log_string(LOG_INFO, "  -m PATH, --metrics-socket PATH");
+  log_string(LOG_INFO, "                        serve OpenMetrics on the Unix "
+                       "socket PATH");
+  log_string(LOG_INFO, "  --compile-config");
+  log_string(LOG_INFO, "                        write a binary snapshot of "
+                       "CONFIG next to it and exit");
 }
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
@@ -151,24 +138,41 @@ std::vector<Args> read_commandline(const int argc, char *const argv[]) {
       {"help", no_argument, nullptr, 'h'},
       {"config", required_argument, nullptr, 'c'},
       {"syslog", no_argument, nullptr, 's'},
+      {"capture-workers", required_argument, nullptr, 'w'},
+      {"log-level", required_argument, nullptr, 'l'},
+      {"metrics-socket", required_argument, nullptr, 'm'},
+      {"compile-config", no_argument, nullptr, 'C'},
       {nullptr, 0, nullptr, 0}};
   int option_index = 0;
   int c = -1;
   std::vector<Args> ret_val;
   // read cmd line arguments and checks them
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
-  while ((c = getopt_long(argc, argv, "hc:s", long_options, &option_index)) !=
-         -1) {
+  while ((c = getopt_long(argc, argv, "hc:sw:l:m:C", long_options,
+                          &option_index)) != -1) {
     switch (c) {
     case 'h':
       print_help();
       exit(0);
     case 'c':
+      config_file_path = optarg;
       ret_val = read_file(optarg);
       break;
     case 's':
       to_syslog = true;
       break;
+    case 'w':
+      num_capture_workers = str_to_integral<unsigned int>(optarg);
+      break;
+    case 'l':
+      set_log_level(parse_log_level(optarg));
+      break;
+    case 'm':
+      metrics_socket_path = optarg;
+      break;
+    case 'C':
+      compile_config_only = true;
+      break;
     case '?':
       log_string(LOG_ERR, std::string("got unknown option: ") +
                               static_cast<char>(optopt));
@@ -181,12 +185,90 @@ std::vector<Args> read_commandline(const int argc, char *const argv[]) {
   return ret_val;
 }
 
+std::vector<Args> read_config(const std::string &filename) {
+  if (!std::ifstream{filename}) {
+    throw std::runtime_error("can't open " + filename + ": " +
+                             strerror(errno));
+  }
+  return read_file(filename);
+}
+
+bool operator==(const Args &lhs, const Args &rhs) {
+  return lhs.interface == rhs.interface && lhs.address == rhs.address &&
+         lhs.ports == rhs.ports &&
+         std::equal(std::begin(lhs.mac.ether_addr_octet),
+                    std::end(lhs.mac.ether_addr_octet),
+                    std::begin(rhs.mac.ether_addr_octet)) &&
+         lhs.hostname == rhs.hostname && lhs.ping_tries == rhs.ping_tries &&
+         lhs.wol_method == rhs.wol_method;
+}
+
+bool operator!=(const Args &lhs, const Args &rhs) { return !(lhs == rhs); }
+
+std::string host_identity(const Args &args) {
+  return args.hostname.empty() ? binary_to_mac(args.mac) : args.hostname;
+}
+
+Config_diff diff_config(const std::vector<Args> &old_config,
+                        const std::vector<Args> &new_config) {
+  // hosts sharing an identity are matched in the order they appear
+  std::unordered_multimap<std::string, size_t> unmatched;
+  for (size_t i = 0; i < old_config.size(); ++i) {
+    unmatched.emplace(host_identity(old_config.at(i)), i);
+  }
+  Config_diff diff;
+  for (size_t i = 0; i < new_config.size(); ++i) {
+    auto const range = unmatched.equal_range(host_identity(new_config.at(i)));
+    if (range.first == range.second) {
+      diff.started.push_back(i);
+      continue;
+    }
+    auto old = std::min_element(
+        range.first, range.second,
+        [](std::pair<const std::string, size_t> const &lhs,
+           std::pair<const std::string, size_t> const &rhs) {
+          return lhs.second < rhs.second;
+        });
+    if (old_config.at(old->second) == new_config.at(i)) {
+      diff.kept.emplace_back(old->second, i);
+    } else {
+      diff.stopped.push_back(old->second);
+      diff.started.push_back(i);
+    }
+    unmatched.erase(old);
+  }
+  for (auto const &identity_index : unmatched) {
+    diff.stopped.push_back(identity_index.second);
+  }
+  std::sort(std::begin(diff.stopped), std::end(diff.stopped));
+  return diff;
+}
+
 std::ostream &operator<<(std::ostream &out, const Args &args) {
   out << "Args(interface = " << args.interface << ", address = " << args.address
       << ", ports = " << args.ports << ", mac = " << binary_to_mac(args.mac)
       << ", hostname = " << args.hostname
       << ", print_tries = " << args.ping_tries
       << ", wol_method = " << args.wol_method << ", syslog = " << args.syslog
-      << ")";
+      << ", capture_workers = " << args.capture_workers << ")";
   return out;
 }
+
+Text_writer &operator<<(Text_writer &out, const Args &args) {
+  auto const write_all = [&out](auto const &items) {
+    auto separator = "";
+    for (auto const &item : items) {
+      out << separator << item;
+      separator = ", ";
+    }
+  };
+  out << "Args(interface = " << args.interface << ", address = ";
+  write_all(args.address);
+  out << ", ports = ";
+  write_all(args.ports);
+  return out << ", mac = " << args.mac << ", hostname = " << args.hostname
+             << ", print_tries = " << args.ping_tries
+             << ", wol_method = " << args.wol_method
+             << ", syslog = " << static_cast<int>(args.syslog)
+             << ", capture_workers = " << args.capture_workers << ")";
+}
@@ -0,0 +1,92 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "argv_arena.h"
+#include "text_writer.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+Argv_arena::Argv_arena() : buffer{}, offsets{}, pointers{} {}
+
+void Argv_arena::clear() {
+  buffer.clear();
+  offsets.clear();
+}
+
+bool Argv_arena::empty() const { return offsets.empty(); }
+
+size_t Argv_arena::size() const { return offsets.size(); }
+
+char const *Argv_arena::at(size_t const i) const {
+  return &buffer.at(offsets.at(i));
+}
+
+void Argv_arena::append(char const *const arg, size_t const length) {
+  offsets.push_back(buffer.size());
+  buffer.insert(std::end(buffer), arg, arg + length);
+  buffer.push_back('\0');
+}
+
+Argv_arena &Argv_arena::operator<<(std::string const &arg) {
+  append(arg.data(), arg.size());
+  return *this;
+}
+
+Argv_arena &Argv_arena::operator<<(char const *const arg) {
+  append(arg, strlen(arg));
+  return *this;
+}
+
+Argv_arena &Argv_arena::operator<<(unsigned long const number) {
+  std::array<char, 24> digits{};
+  Text_writer out{digits};
+  out << number;
+  append(out.c_str(), out.size());
+  return *this;
+}
+
+Argv_arena &Argv_arena::split(std::string const &cmd, char const delimiter) {
+  auto iter = std::begin(cmd);
+  while (iter != std::end(cmd)) {
+    auto const delim = std::find(iter, std::end(cmd), delimiter);
+    append(&*iter, static_cast<size_t>(std::distance(iter, delim)));
+    iter = delim;
+    if (iter != std::end(cmd)) {
+      ++iter;
+    }
+  }
+  return *this;
+}
+
+char *const *Argv_arena::argv() {
+  pointers.clear();
+  for (auto const offset : offsets) {
+    pointers.push_back(&buffer[offset]);
+  }
+  pointers.push_back(nullptr);
+  return pointers.data();
+}
+
+std::string Argv_arena::to_string() const {
+  // the separators are where the '\0' are
+  std::string result(std::begin(buffer), std::end(buffer));
+  std::replace(std::begin(result), std::end(result), '\0', ' ');
+  if (!result.empty()) {
+    result.pop_back();
+  }
+  return result;
+}
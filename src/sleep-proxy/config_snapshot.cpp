@@ -0,0 +1,432 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "config_snapshot.h"
+
+#include "file_descriptor.h"
+#include "log.h"
+#include "to_string.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+std::array<char, 8> const snapshot_magic{
+    {'S', 'P', 'H', 'O', 'S', 'T', 'S', '\0'}};
+/** changes whenever the layout of the payload changes */
+auto const snapshot_version = uint32_t{2};
+/** reads differently on a machine of the other byte order */
+auto const byte_order_mark = uint32_t{0x01020304};
+
+struct Header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t payload_size;
+  uint64_t checksum;
+  /** the configuration text the table was parsed from */
+  uint64_t config_size;
+  uint64_t config_checksum;
+};
+
+/** an IP_address without the padding and the int of the struct */
+struct Stored_address {
+  uint8_t family;
+  uint8_t subnet;
+  std::array<uint8_t, 16> bytes;
+};
+
+/** FNV-1a, enough to notice truncated or damaged files */
+uint64_t checksum(uint8_t const *const data, size_t const size) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return std::accumulate(data, data + size, uint64_t{14695981039346656037U},
+                         [](uint64_t const hash, uint8_t const byte) {
+                           return (hash ^ byte) * uint64_t{1099511628211U};
+                         });
+}
+
+Stored_address store(IP_address const &ip) {
+  Stored_address stored{4, ip.subnet, {{0}}};
+  if (ip.family == AF_INET) {
+    std::memcpy(stored.bytes.data(), &ip.address.ipv4, sizeof(in_addr));
+  } else {
+    stored.family = 6;
+    std::memcpy(stored.bytes.data(), &ip.address.ipv6, sizeof(in6_addr));
+  }
+  return stored;
+}
+
+IP_address restore(Stored_address const &stored) {
+  IP_address ip{};
+  ip.subnet = stored.subnet;
+  switch (stored.family) {
+  case 4:
+    ip.family = AF_INET;
+    std::memcpy(&ip.address.ipv4, stored.bytes.data(), sizeof(in_addr));
+    break;
+  case 6:
+    ip.family = AF_INET6;
+    std::memcpy(&ip.address.ipv6, stored.bytes.data(), sizeof(in6_addr));
+    break;
+  default:
+    throw std::runtime_error("invalid address family " +
+                             to_string(int{stored.family}));
+  }
+  if (ip.subnet > (ip.family == AF_INET ? 32 : 128)) {
+    throw std::runtime_error("invalid subnet " + to_string(int{ip.subnet}));
+  }
+  return ip;
+}
+
+/**
+ * Appends the element count and the bytes of values. Padding keeps every
+ * array 8 byte aligned within the file.
+ */
+template <typename Container>
+void append_array(std::vector<uint8_t> &payload, Container const &values) {
+  using T = typename Container::value_type;
+  static_assert(std::is_trivially_copyable<T>::value, "copied bytewise");
+  auto const count = uint64_t{values.size()};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto const *const count_bytes = reinterpret_cast<uint8_t const *>(&count);
+  payload.insert(std::end(payload), count_bytes, count_bytes + sizeof(count));
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto const *const bytes = reinterpret_cast<uint8_t const *>(values.data());
+  payload.insert(std::end(payload), bytes, bytes + values.size() * sizeof(T));
+  payload.resize((payload.size() + 7) / 8 * 8);
+}
+
+/** the arrays of a payload in the order append_array() wrote them */
+class Payload_reader {
+  uint8_t const *position;
+  uint8_t const *const end;
+
+  size_t remaining() const { return static_cast<size_t>(end - position); }
+
+  void take(void *const destination, size_t const size) {
+    if (size > remaining()) {
+      throw std::runtime_error("truncated payload");
+    }
+    std::memcpy(destination, position, size);
+    position += size;
+  }
+
+public:
+  Payload_reader(uint8_t const *const data, size_t const size)
+      : position{data}, end{data + size} {}
+
+  template <typename T> std::vector<T> array() {
+    auto count = uint64_t{0};
+    take(&count, sizeof(count));
+    if (count > remaining() / sizeof(T)) {
+      throw std::runtime_error("truncated payload");
+    }
+    std::vector<T> values(count);
+    take(values.data(), values.size() * sizeof(T));
+    auto const padding = (8 - values.size() * sizeof(T) % 8) % 8;
+    position += std::min(padding, remaining());
+    return values;
+  }
+
+  std::string chars() {
+    auto const values = array<char>();
+    return {std::begin(values), std::end(values)};
+  }
+
+  bool at_end() const { return position == end; }
+};
+
+/** rows + 1 ascending offsets from 0 to size */
+void check_offsets(std::vector<uint32_t> const &offsets, size_t const rows,
+                   size_t const size, char const *const what) {
+  if (offsets.size() != rows + 1 || offsets.front() != 0 ||
+      offsets.back() != size ||
+      !std::is_sorted(std::begin(offsets), std::end(offsets))) {
+    throw std::runtime_error(std::string("inconsistent offsets of ") + what);
+  }
+}
+
+/** checks the header and returns a reader for the payload behind it */
+Payload_reader payload_of(uint8_t const *const data, size_t const size) {
+  Header header{};
+  if (size < sizeof(header)) {
+    throw std::runtime_error("no host table snapshot");
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != snapshot_magic) {
+    throw std::runtime_error("no host table snapshot");
+  }
+  if (header.byte_order != byte_order_mark) {
+    throw std::runtime_error("written on a machine of another byte order");
+  }
+  if (header.version != snapshot_version) {
+    throw std::runtime_error("snapshot version " + to_string(header.version) +
+                             " instead of " + to_string(snapshot_version));
+  }
+  if (header.payload_size != size - sizeof(header)) {
+    throw std::runtime_error("payload of " + to_string(size - sizeof(header)) +
+                             " bytes instead of " +
+                             to_string(header.payload_size));
+  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto const *const payload = data + sizeof(header);
+  if (checksum(payload, header.payload_size) != header.checksum) {
+    throw std::runtime_error("checksum mismatch");
+  }
+  return {payload, header.payload_size};
+}
+
+/** a read only mapping of a whole file */
+struct Mapping {
+  size_t const size;
+  void *const addr;
+
+  Mapping(int const fd, size_t const sizee)
+      : size{sizee}, addr{mmap(nullptr, sizee, PROT_READ, MAP_PRIVATE, fd, 0)} {
+    if (addr == MAP_FAILED) {
+      throw errno_error("mmap()");
+    }
+  }
+
+  Mapping(Mapping const &) = delete;
+  Mapping(Mapping &&) = delete;
+
+  ~Mapping() { munmap(addr, size); }
+
+  Mapping &operator=(Mapping const &) = delete;
+  Mapping &operator=(Mapping &&) = delete;
+
+  uint8_t const *bytes() const { return static_cast<uint8_t const *>(addr); }
+};
+
+std::string read_config_file(std::string const &config_file) {
+  std::ifstream file{config_file};
+  std::ostringstream config;
+  config << file.rdbuf();
+  return config.str();
+}
+
+uint64_t checksum(std::string const &text) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return checksum(reinterpret_cast<uint8_t const *>(text.data()), text.size());
+}
+
+/**
+ * false if the header of the snapshot at path names another config text.
+ * Anything else wrong with it is left to read_snapshot() to report.
+ */
+bool compiled_from(std::string const &path, std::string const &config) {
+  Header header{};
+  std::ifstream file{path, std::ios::binary};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || header.magic != snapshot_magic ||
+      header.byte_order != byte_order_mark ||
+      header.version != snapshot_version) {
+    return true;
+  }
+  return header.config_size == config.size() &&
+         header.config_checksum == checksum(config);
+}
+} // namespace
+
+std::string snapshot_path(std::string const &config_file) {
+  return config_file + ".snapshot";
+}
+
+void write_snapshot(Host_table const &table, std::string const &path,
+                    std::string const &config) {
+  std::string interface_chars;
+  std::vector<uint32_t> interface_offsets{0};
+  for (auto const &name : table.interface_names) {
+    interface_chars += name;
+    interface_offsets.push_back(static_cast<uint32_t>(interface_chars.size()));
+  }
+  std::vector<Stored_address> addresses(table.addresses.size());
+  std::transform(std::begin(table.addresses), std::end(table.addresses),
+                 std::begin(addresses), store);
+  std::vector<uint8_t> wol_methods(table.wol_methods.size());
+  std::transform(std::begin(table.wol_methods), std::end(table.wol_methods),
+                 std::begin(wol_methods), [](Wol_method const method) {
+                   return static_cast<uint8_t>(method);
+                 });
+
+  std::vector<uint8_t> payload;
+  append_array(payload, interface_offsets);
+  append_array(payload, interface_chars);
+  append_array(payload, table.interface_ids);
+  append_array(payload, table.names);
+  append_array(payload, table.name_offsets);
+  append_array(payload, addresses);
+  append_array(payload, table.address_offsets);
+  append_array(payload, table.ports);
+  append_array(payload, table.port_offsets);
+  append_array(payload, table.macs);
+  append_array(payload, std::vector<uint32_t>(std::begin(table.ping_tries_),
+                                              std::end(table.ping_tries_)));
+  append_array(payload, wol_methods);
+  Header const header{snapshot_magic,
+                      snapshot_version,
+                      byte_order_mark,
+                      payload.size(),
+                      checksum(payload.data(), payload.size()),
+                      config.size(),
+                      checksum(config)};
+
+  // readers see either the old or the new snapshot, never a partial one
+  auto const temporary = path + ".tmp";
+  try {
+    auto const fd =
+        open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+      throw errno_error("open(" + temporary + ")");
+    }
+    File_descriptor file{fd};
+    write_all(file, &header, sizeof(header));
+    write_all(file, payload.data(), payload.size());
+    if (fsync(file) == -1) {
+      throw errno_error("fsync(" + temporary + ")");
+    }
+    file.close();
+    if (rename(temporary.c_str(), path.c_str()) == -1) {
+      throw errno_error("rename(" + temporary + ")");
+    }
+  } catch (...) {
+    unlink(temporary.c_str());
+    throw;
+  }
+}
+
+Host_table read_snapshot(std::string const &path) {
+  auto const fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    throw errno_error("open(" + path + ")");
+  }
+  File_descriptor const file{fd};
+  struct stat file_stat {};
+  if (fstat(file, &file_stat) == -1) {
+    throw errno_error("fstat(" + path + ")");
+  }
+  try {
+    if (file_stat.st_size == 0) {
+      throw std::runtime_error("no host table snapshot");
+    }
+    Mapping const mapping{file, static_cast<size_t>(file_stat.st_size)};
+    auto reader = payload_of(mapping.bytes(), mapping.size);
+
+    Host_table table;
+    auto const interface_offsets = reader.array<uint32_t>();
+    auto const interface_chars = reader.chars();
+    table.interface_ids = reader.array<uint16_t>();
+    table.names = reader.chars();
+    table.name_offsets = reader.array<uint32_t>();
+    auto const addresses = reader.array<Stored_address>();
+    table.address_offsets = reader.array<uint32_t>();
+    table.ports = reader.array<uint16_t>();
+    table.port_offsets = reader.array<uint32_t>();
+    table.macs = reader.array<ether_addr>();
+    auto const ping_tries = reader.array<uint32_t>();
+    auto const wol_methods = reader.array<uint8_t>();
+    if (!reader.at_end()) {
+      throw std::runtime_error("trailing data");
+    }
+
+    // the checksum only guards against damage, not against a buggy writer
+    auto const hosts = table.macs.size();
+    if (interface_offsets.empty() || table.interface_ids.size() != hosts ||
+        ping_tries.size() != hosts || wol_methods.size() != hosts) {
+      throw std::runtime_error("columns of different length");
+    }
+    check_offsets(interface_offsets, interface_offsets.size() - 1,
+                  interface_chars.size(), "interfaces");
+    check_offsets(table.name_offsets, hosts, table.names.size(), "names");
+    check_offsets(table.address_offsets, hosts, addresses.size(), "addresses");
+    check_offsets(table.port_offsets, hosts, table.ports.size(), "ports");
+    for (size_t i = 0; i + 1 < interface_offsets.size(); ++i) {
+      table.interface_names.emplace_back(
+          interface_chars, interface_offsets.at(i),
+          interface_offsets.at(i + 1) - interface_offsets.at(i));
+    }
+    if (std::any_of(std::begin(table.interface_ids),
+                    std::end(table.interface_ids), [&table](uint16_t id) {
+                      return id >= table.interface_names.size();
+                    })) {
+      throw std::runtime_error("unknown interface id");
+    }
+    table.addresses.reserve(addresses.size());
+    std::transform(std::begin(addresses), std::end(addresses),
+                   std::back_inserter(table.addresses), restore);
+    table.ping_tries_.assign(std::begin(ping_tries), std::end(ping_tries));
+    for (auto const method : wol_methods) {
+      if (method > static_cast<uint8_t>(Wol_method::udp)) {
+        throw std::runtime_error("invalid wol method " +
+                                 to_string(int{method}));
+      }
+      table.wol_methods.push_back(static_cast<Wol_method>(method));
+    }
+    return table;
+  } catch (std::exception const &e) {
+    throw std::runtime_error(path + ": " + e.what());
+  }
+}
+
+Host_table read_snapshot(std::string const &path, std::string const &config) {
+  if (!compiled_from(path, config)) {
+    throw std::runtime_error(path + ": compiled from another configuration");
+  }
+  return read_snapshot(path);
+}
+
+size_t compile_config(std::string const &config_file) {
+  if (!std::ifstream{config_file}) {
+    throw std::runtime_error("can't open " + config_file + ": " +
+                             strerror(errno));
+  }
+  auto const config = read_config_file(config_file);
+  auto const table = parse_host_table(config);
+  write_snapshot(table, snapshot_path(config_file), config);
+  return table.size();
+}
+
+Host_table load_host_table(std::string const &config_file) {
+  auto const config = read_config_file(config_file);
+  auto const snapshot = snapshot_path(config_file);
+  // not by mtime, restoring a backup may backdate an edited config
+  if (access(snapshot.c_str(), F_OK) == 0) {
+    if (compiled_from(snapshot, config)) {
+      try {
+        return read_snapshot(snapshot);
+      } catch (std::exception const &e) {
+        LOG(LOG_WARNING, "parsing %s instead of its snapshot: %s",
+            config_file.c_str(), e.what());
+      }
+    } else {
+      LOG(LOG_INFO, "ignoring %s, %s has been edited since compiling it",
+          snapshot.c_str(), config_file.c_str());
+    }
+  }
+  return parse_host_table(config);
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "config_watcher.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+std::string directory_of(std::string const &path) {
+  auto const slash = path.rfind('/');
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string name_of(std::string const &path) {
+  return path.substr(path.rfind('/') + 1);
+}
+} // namespace
+
+Config_watcher::Config_watcher(std::string const &path)
+    : name{name_of(path)},
+      inotify{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)} {
+  if (inotify_add_watch(inotify, directory_of(path).c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+    throw std::runtime_error("inotify_add_watch() failed for " + path + ": " +
+                             strerror(errno));
+  }
+}
+
+int Config_watcher::fd() const { return inotify; }
+
+bool Config_watcher::changed() {
+  bool concerned = false;
+  alignas(inotify_event) std::array<char, 4096> buffer{};
+  while (true) {
+    auto const bytes = read(inotify, buffer.data(), buffer.size());
+    if (bytes == -1) {
+      if (errno == EAGAIN) {
+        return concerned;
+      }
+      throw std::runtime_error(std::string("reading inotify events failed: ") +
+                               strerror(errno));
+    }
+    for (auto offset = size_t{0}; offset < static_cast<size_t>(bytes);) {
+      inotify_event event{};
+      std::memcpy(&event, &buffer.at(offset), sizeof(event));
+      // the name is padded with null bytes
+      if (event.len != 0 && name == &buffer.at(offset + sizeof(event))) {
+        concerned = true;
+      }
+      offset += sizeof(event) + event.len;
+    }
+  }
+}
@@ -15,51 +15,78 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "duplicate_address_watcher.h"
-#include "container_utils.h"
+#include "argv_arena.h"
 #include "log.h"
+#include "process_runner.h"
 #include "spawn_process.h"
-#include <cctype>
+#include "thread_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
 
 namespace {
-std::vector<std::string> get_cmd_ipv4() {
-  return std::vector<std::string>{"arping", "-q", "-D", "-c", "1", "-I"};
+Line_view as_view(std::string const &s) {
+  return Line_view{s.data(), s.size()};
 }
 
-std::vector<std::string> get_cmd_ipv6() {
-  return std::vector<std::string>{"ndisc6", "-q", "-n", "-m"};
+Line_view const &as_view(Line_view const &line) { return line; }
+
+template <typename Lines>
+bool contains_other_mac(std::string const &mac, Lines const &lines) {
+  return std::any_of(std::begin(lines), std::end(lines),
+                     [&mac](typename Lines::value_type const &line) {
+                       return !as_view(line).equals_ignore_case(mac);
+                     });
+}
+
+/** exits with 1 if another node answers for ip */
+Argv_arena arping_command(std::string const &iface, IP_address const &ip) {
+  Argv_arena cmd;
+  cmd << "arping"
+      << "-q"
+      << "-D"
+      << "-c"
+      << "1"
+      << "-I" << iface << ip.pure_text().c_str();
+  return cmd;
+}
+
+/** prints the MACs of all nodes using ip */
+Argv_arena ndisc6_command(std::string const &iface, IP_address const &ip) {
+  Argv_arena cmd;
+  cmd << "ndisc6"
+      << "-q"
+      << "-n"
+      << "-m" << ip.pure_text().c_str() << iface;
+  return cmd;
 }
 } // namespace
 
 bool contains_mac_different_from_given(std::string mac,
                                        std::vector<std::string> const &lines) {
-  auto const transform_to_upper = [](std::string tmp) {
-    std::transform(std::begin(tmp), std::end(tmp), std::begin(tmp), ::toupper);
-    return tmp;
-  };
-
-  auto const macs_are_not_equal = [&](std::string const &line) {
-    return transform_to_upper(line) != mac;
-  };
-
-  mac = transform_to_upper(mac);
+  return contains_other_mac(mac, lines);
+}
 
-  return std::any_of(std::begin(lines), std::end(lines), macs_are_not_equal);
+bool contains_mac_different_from_given(std::string const &mac,
+                                       std::vector<Line_view> const &lines) {
+  return contains_other_mac(mac, lines);
 }
 
 std::string get_mac(std::string const &iface) {
-  auto const cmd = std::vector<std::string>{"ip", "a", "show", "dev", iface};
-  auto const out_in = get_self_pipes(false);
-  auto const status = spawn(cmd, File_descriptor(), std::get<1>(out_in));
+  Argv_arena cmd;
+  cmd << "ip"
+      << "a"
+      << "show"
+      << "dev" << iface;
+  Stream_reader out;
+  auto const status = spawn(cmd, out);
   if (status != 0) {
     throw std::runtime_error(std::string("get_mac(): ip a show dev ") + iface +
                              " did not succeed");
   }
-  auto const lines = std::get<0>(out_in).read();
   static auto const mac_row = uint8_t{1};
-  auto const &line = lines.at(mac_row);
-  auto const splitted_line = split(line, ' ');
   static auto const mac_column = uint8_t{5};
-  return splitted_line.at(mac_column);
+  return out.lines().at(mac_row).field(mac_column).str();
 }
 
 Ip_neigh_checker::Ip_neigh_checker(std::string mac)
@@ -67,10 +94,8 @@ Ip_neigh_checker::Ip_neigh_checker(std::string mac)
 
 bool Ip_neigh_checker::is_ipv4_present(std::string const &iface,
                                        IP_address const &ip) {
-  auto cmd_ipv4_tmp = get_cmd_ipv4();
-  cmd_ipv4_tmp.push_back(iface);
-  cmd_ipv4_tmp.push_back(ip.pure());
-  auto const status = spawn(cmd_ipv4_tmp);
+  auto cmd = arping_command(iface, ip);
+  auto const status = spawn(cmd);
   // if arping detects duplicate address, it returns 1
   return status == 1;
 }
@@ -85,18 +110,13 @@ bool Ip_neigh_checker::is_ipv6_present(std::string const &iface,
   // openwrt handles this differently, and outputs only foreign MACs with an
   // error code. to be able to do tests, I have to check the output if there
   // are foreign macs in it
-  auto cmd_ipv6_tmp = get_cmd_ipv6();
-  cmd_ipv6_tmp.push_back(ip.pure());
-  cmd_ipv6_tmp.push_back(iface);
-
-  auto const out_in = get_self_pipes(false);
-
-  spawn(cmd_ipv6_tmp, File_descriptor(), std::get<1>(out_in));
+  auto cmd = ndisc6_command(iface, ip);
+  Stream_reader out;
+  spawn(cmd, out);
 
   // if there are more than one line, there must be another host
   // one line is this programm/node
-  return contains_mac_different_from_given(this_nodes_mac,
-                                           std::get<0>(out_in).read());
+  return contains_mac_different_from_given(this_nodes_mac, out.lines());
 }
 
 bool Ip_neigh_checker::operator()(std::string const &iface,
@@ -107,91 +127,216 @@ bool Ip_neigh_checker::operator()(std::string const &iface,
   return is_ipv6_present(iface, ip);
 }
 
-void daw_thread_main_non_root(const std::string &iface, const IP_address &ip,
-                              Is_ip_occupied const &is_ip_occupied,
-                              std::atomic<bool> &loop, Pcap_wrapper &pc) {
-  // 2. while(loop)
-  // 2.1 use 'ip neigh' to watch for neighbors with the same ip
-  // 2.2 if someone uses ip
-  // 2.2.1 loop = false
-  // 2.2.2 pc.break_loop
+void Ip_neigh_checker::start(std::string const &iface, IP_address const &ip,
+                             Ip_check_done done) const {
+  static auto const timeout = std::chrono::seconds{10};
+  auto const ipv4 = ip.family == AF_INET;
+  auto cmd = ipv4 ? arping_command(iface, ip) : ndisc6_command(iface, ip);
+  auto const mac = this_nodes_mac;
+  process_runner().run(
+      std::move(cmd), timeout,
+      [ipv4, mac, done](std::future<uint8_t> status, Stream_reader &out) {
+        // the same verdicts as is_ipv4_present() and is_ipv6_present()
+        std::promise<bool> occupied;
+        try {
+          auto const exit_status = status.get();
+          occupied.set_value(ipv4 ? exit_status == 1
+                                  : contains_mac_different_from_given(
+                                        mac, out.lines()));
+        } catch (std::exception const &) {
+          occupied.set_exception(std::current_exception());
+        }
+        done(occupied.get_future());
+      });
+}
+
+Pcap_wrapper::Loop_end_reason
+check_duplicate_address(std::string const &iface, IP_address const &ip,
+                        Is_ip_occupied const &is_ip_occupied) {
   try {
-    log(LOG_DEBUG, "daw_thread_main_non_root: iface = %s, ip = %s, loop = %d",
-        iface.c_str(), ip.with_subnet().c_str(), static_cast<int>(loop));
-
-    while (loop) {
-      if (is_ip_occupied(iface, ip)) {
-        loop = false;
-        pc.break_loop(Pcap_wrapper::Loop_end_reason::duplicate_address);
-      } else {
-        static auto const check_intervall = std::chrono::milliseconds(1000);
-        std::this_thread::sleep_for(check_intervall);
-      }
+    if (is_ip_occupied(iface, ip)) {
+      return Pcap_wrapper::Loop_end_reason::duplicate_address;
     }
   } catch (std::exception const &e) {
-    log(LOG_INFO, "daw_thread_main_non_root got exception: %s", e.what());
-    loop = false;
-    pc.break_loop(Pcap_wrapper::Loop_end_reason::signal);
+    LOG(LOG_INFO, "check_duplicate_address got exception: %s", e.what());
+    return Pcap_wrapper::Loop_end_reason::signal;
   }
+  return Pcap_wrapper::Loop_end_reason::unset;
 }
 
-void daw_thread_main_ipv6(const std::string &iface, const IP_address &ip,
-                          Is_ip_occupied const &is_ip_occupied,
-                          std::atomic<bool> &loop, Pcap_wrapper &pc) {
-  // 1. block incoming duplicate address detection for ip using firewall
+struct Duplicate_address_watcher::Watch {
+  std::string const iface;
+  IP_address const ip;
+  Start_ip_check const start_check;
+  Pcap_wrapper &pcap;
+  std::mutex mutex;
+  std::condition_variable idle;
+  /** cleared by stop_watcher() and once a check broke the capture */
+  bool watching;
+  /** a check has been started and not finished yet */
+  bool checking;
+  /** keeps the firewall from answering duplicate address detection */
+  std::unique_ptr<Scope_guard> block_solicitations;
+
+  Watch(std::string ifacee, IP_address const ipp, Start_ip_check start_checkk,
+        Pcap_wrapper &pc)
+      : iface{std::move(ifacee)}, ip{ipp}, start_check{std::move(start_checkk)},
+        pcap(pc), mutex{}, idle{}, watching{true}, checking{false},
+        block_solicitations{} {}
+};
+
+namespace {
+auto const check_interval = std::chrono::milliseconds(1000);
+
+using Watch_ptr = std::shared_ptr<Duplicate_address_watcher::Watch>;
+
+void run_check(Watch_ptr const &w);
+
+/** check_duplicate_address() for the result of a started check */
+Pcap_wrapper::Loop_end_reason reason_of(std::future<bool> &occupied) {
   try {
-    Scope_guard const bipv6ns{Block_ipv6_neighbor_solicitation{ip}};
-    daw_thread_main_non_root(iface, ip, is_ip_occupied, loop, pc);
+    if (occupied.get()) {
+      return Pcap_wrapper::Loop_end_reason::duplicate_address;
+    }
   } catch (std::exception const &e) {
-    log(LOG_INFO, "daw_thread_main_ipv6 got exception: %s", e.what());
-    loop = false;
-    pc.break_loop(Pcap_wrapper::Loop_end_reason::signal);
+    LOG(LOG_INFO, "check_duplicate_address got exception: %s", e.what());
+    return Pcap_wrapper::Loop_end_reason::signal;
+  }
+  return Pcap_wrapper::Loop_end_reason::unset;
+}
+
+/** the continuation of a check, queues the next one if needed */
+void finish_check(Watch_ptr const &w,
+                  Pcap_wrapper::Loop_end_reason const reason) {
+  std::lock_guard<std::mutex> const lock{w->mutex};
+  w->checking = false;
+  if (w->watching && reason != Pcap_wrapper::Loop_end_reason::unset) {
+    w->watching = false;
+    w->pcap.break_loop(reason);
+  }
+  if (w->watching) {
+    thread_pool().post_after(check_interval, [w]() { run_check(w); });
   }
+  w->idle.notify_all();
 }
 
+/**
+ * starts a single check from the thread pool. The worker returns right away,
+ * finish_check() runs once the check is done.
+ */
+void run_check(Watch_ptr const &w) {
+  {
+    std::lock_guard<std::mutex> const lock{w->mutex};
+    if (!w->watching) {
+      return;
+    }
+    w->checking = true;
+  }
+  try {
+    w->start_check(w->iface, w->ip, [w](std::future<bool> occupied) {
+      finish_check(w, reason_of(occupied));
+    });
+  } catch (std::exception const &e) {
+    LOG(LOG_INFO, "check_duplicate_address got exception: %s", e.what());
+    finish_check(w, Pcap_wrapper::Loop_end_reason::signal);
+  }
+}
+
+/** for checkers which return right away, like the ones of the tests */
+Start_ip_check run_inline(Is_ip_occupied is_ip_occupied) {
+  return [is_ip_occupied](std::string const &iface, IP_address const &ip,
+                          Ip_check_done const &done) {
+    std::promise<bool> occupied;
+    try {
+      occupied.set_value(is_ip_occupied(iface, ip));
+    } catch (std::exception const &) {
+      occupied.set_exception(std::current_exception());
+    }
+    done(occupied.get_future());
+  };
+}
+
+Start_ip_check run_on_process_runner(Ip_neigh_checker const &checker) {
+  return [checker](std::string const &iface, IP_address const &ip,
+                   Ip_check_done done) {
+    checker.start(iface, ip, std::move(done));
+  };
+}
+} // namespace
+
 Duplicate_address_watcher::Duplicate_address_watcher(std::string ifacee,
                                                      const IP_address ipp,
                                                      Pcap_wrapper &pc)
     : iface(std::move(ifacee)), ip(ipp),
       pcap(pc), is_ip_occupied{Ip_neigh_checker{get_mac(iface)}},
-      watcher(), loop{false} {}
+      start_check{run_on_process_runner(
+          *is_ip_occupied.target<Ip_neigh_checker>())},
+      watch{} {}
 
 Duplicate_address_watcher::Duplicate_address_watcher(
     std::string ifacee, const IP_address ipp, Pcap_wrapper &pc,
     Is_ip_occupied is_ip_occupiedd)
     : iface(std::move(ifacee)), ip(ipp),
       pcap(pc), is_ip_occupied{std::move(is_ip_occupiedd)},
-      watcher(), loop{false} {}
+      start_check{run_inline(is_ip_occupied)}, watch{} {}
 
-Duplicate_address_watcher::~Duplicate_address_watcher() { stop_watcher(); }
+Duplicate_address_watcher::Duplicate_address_watcher(
+    std::string ifacee, const IP_address ipp, Pcap_wrapper &pc,
+    Start_ip_check start_checkk)
+    : iface(std::move(ifacee)), ip(ipp), pcap(pc), is_ip_occupied{},
+      start_check{std::move(start_checkk)}, watch{} {}
 
-using Main_Function_Type = std::function<void(
-    const std::string &, const IP_address &, Is_ip_occupied const &,
-    std::atomic<bool> &, Pcap_wrapper &)>;
+Duplicate_address_watcher::~Duplicate_address_watcher() { stop_watcher(); }
 
 std::string Duplicate_address_watcher::operator()(const Action action) {
-  Main_Function_Type const main_function =
-      ip.family == AF_INET ? daw_thread_main_non_root : daw_thread_main_ipv6;
-
   if (Action::add == action) {
-    log(LOG_INFO, "starting Duplicate_address_watcher for IP %s",
-        ip.with_subnet().c_str());
-    loop = true;
-    watcher = std::thread(main_function, iface, ip, is_ip_occupied,
-                          std::ref(loop), std::ref(pcap));
+    LOG(LOG_INFO, "starting Duplicate_address_watcher for IP %s",
+        ip.with_subnet_text().c_str());
+    stop_watcher();
+    watch = std::make_shared<Watch>(iface, ip, start_check, pcap);
+    if (ip.family != AF_INET) {
+      // on our thread like the other firewall rules, no worker waits for it
+      try {
+        watch->block_solicitations = std::make_unique<Scope_guard>(
+            Block_ipv6_neighbor_solicitation{ip});
+      } catch (std::exception const &e) {
+        LOG(LOG_INFO, "can't block neighbor solicitations: %s", e.what());
+        watch->watching = false;
+        pcap.break_loop(Pcap_wrapper::Loop_end_reason::signal);
+        return "";
+      }
+    }
+    auto const w = watch;
+    thread_pool().post([w]() { run_check(w); });
   }
   if (Action::del == action) {
-    log(LOG_INFO, "stopping Duplicate_address_watcher for IP %s",
-        ip.with_subnet().c_str());
+    LOG(LOG_INFO, "stopping Duplicate_address_watcher for IP %s",
+        ip.with_subnet_text().c_str());
     stop_watcher();
   }
   return "";
 }
 
+bool Duplicate_address_watcher::watching() const {
+  if (watch == nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> const lock{watch->mutex};
+  return watch->watching;
+}
+
 void Duplicate_address_watcher::stop_watcher() {
-  loop = false;
-  if (watcher.joinable()) {
-    watcher.join();
+  if (watch == nullptr) {
+    return;
+  }
+  std::unique_ptr<Scope_guard> block_solicitations;
+  {
+    std::unique_lock<std::mutex> lock{watch->mutex};
+    watch->watching = false;
+    watch->idle.wait(lock, [this]() { return !watch->checking; });
+    block_solicitations = std::move(watch->block_solicitations);
   }
-  watcher = std::thread();
+  // a check still queued only finds watching cleared, the firewall rule is
+  // released when block_solicitations goes out of scope
+  watch.reset();
 }
@@ -29,6 +29,26 @@ std::ostream &operator<<(std::ostream &out, const Link_layer &ll) {
   return out;
 }
 
+Text_writer &operator<<(Text_writer &out, const Link_layer &ll) {
+  return out << ll.m_info;
+}
+
+Text_writer &operator<<(Text_writer &out, const ether_addr &mac) {
+  // like ether_ntoa_r(), without leading zeros
+  auto separator = "";
+  for (auto const octet : mac.ether_addr_octet) {
+    out << separator;
+    out.hex(octet, octet < 0x10 ? 1 : 2);
+    separator = ":";
+  }
+  return out;
+}
+
+std::ostream &operator<<(std::ostream &out, const ether_addr &mac) {
+  out << binary_to_mac(mac);
+  return out;
+}
+
 Link_layer::Link_layer(size_t const header_length, ether_addr const source,
                        uint16_t const payload_protocol, std::string info)
     : m_header_length(header_length), m_source(source),
@@ -66,11 +86,9 @@ ether_addr mac_to_binary(const std::string &mac) {
 }
 
 std::string binary_to_mac(const ether_addr &mac) {
-  static auto const characters = uint8_t{12};
-  static auto const double_colons = uint8_t{5};
-  static auto const nul_termination = uint8_t{1};
-  static auto const array_size = characters + double_colons + nul_termination;
-  auto canon_mac = std::array<char, array_size>{};
-  ether_ntoa_r(&mac, canon_mac.data());
-  return canon_mac.data();
+  // six octets of two hex digits, five colons and the nul termination
+  std::array<char, 18> text{};
+  Text_writer out{text};
+  out << mac;
+  return out.str();
 }
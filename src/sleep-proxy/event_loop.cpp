@@ -0,0 +1,556 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "event_loop.h"
+#include "log.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifdef SLEEP_PROXY_IO_URING
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+struct Epoll_backend final : public Event_backend {
+  File_descriptor epoll;
+  std::array<epoll_event, 64> events;
+
+  Epoll_backend() : epoll{epoll_create1(EPOLL_CLOEXEC)}, events{} {
+    if (epoll < 0) {
+      throw errno_error("epoll_create1");
+    }
+  }
+
+  void add(int const fd) override {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      throw errno_error("epoll_ctl(EPOLL_CTL_ADD)");
+    }
+  }
+
+  void remove(int const fd) override {
+    // the fd may already be closed, which removed it from the epoll set
+    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+  }
+
+  void wait(int const timeout_ms, std::vector<int> &ready) override {
+    auto const n = epoll_wait(epoll, events.data(),
+                              static_cast<int>(events.size()), timeout_ms);
+    if (n < 0) {
+      if (errno == EINTR) {
+        return;
+      }
+      throw errno_error("epoll_wait");
+    }
+    for (auto i = size_t{0}; i < static_cast<size_t>(n); ++i) {
+      ready.push_back(events[i].data.fd);
+    }
+  }
+};
+
+#ifdef SLEEP_PROXY_IO_URING
+int io_uring_setup(unsigned const entries, io_uring_params &params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int io_uring_enter(int const ring, unsigned const to_submit,
+                   unsigned const min_complete, unsigned const flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+/** the kernel expects poll32_events with swapped halves on big endian */
+uint32_t poll_events(uint32_t const events) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return (events << 16) | (events >> 16);
+#else
+  return events;
+#endif
+}
+
+struct Mapping {
+  void *addr;
+  size_t size;
+
+  Mapping(int const fd, size_t const sizee, off_t const offset)
+      : addr{mmap(nullptr, sizee, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, offset)},
+        size{sizee} {
+    if (addr == MAP_FAILED) {
+      throw errno_error("mmap(io_uring)");
+    }
+  }
+
+  Mapping(Mapping const &) = delete;
+  Mapping(Mapping &&) = delete;
+
+  ~Mapping() { munmap(addr, size); }
+
+  Mapping &operator=(Mapping const &) = delete;
+  Mapping &operator=(Mapping &&) = delete;
+
+  template <typename T> T *at(uint32_t const offset) const {
+    return reinterpret_cast<T *>(static_cast<uint8_t *>(addr) + offset);
+  }
+};
+
+/**
+ * One ring carries a one-shot POLL_ADD per file descriptor, re-armed after
+ * each completion, and a TIMEOUT for the next deadline. The user_data of a
+ * poll holds the fd and a generation, so completions of removed fds are
+ * recognised even if the fd number has been reused.
+ */
+struct Io_uring_backend final : public Event_backend {
+  static auto const ring_entries = unsigned{64};
+  /** user_data of timeouts, the low bits count them */
+  static auto const timeout_tag = uint64_t{1} << 63;
+  /** user_data of POLL_REMOVE and TIMEOUT_REMOVE */
+  static auto const ignore_tag = uint64_t{1} << 62;
+
+  io_uring_params params;
+  File_descriptor ring;
+  std::unique_ptr<Mapping> sq_ring;
+  std::unique_ptr<Mapping> cq_ring;
+  std::unique_ptr<Mapping> sqe_ring;
+  io_uring_sqe *sqes;
+  io_uring_cqe *cqes;
+  unsigned to_submit;
+  /** registered fds and the generation of their poll */
+  std::map<int, uint32_t> polls;
+  uint32_t next_generation;
+  /** tag of the timeout in flight, 0 if there is none */
+  uint64_t timeout;
+  uint64_t timeouts_submitted;
+  __kernel_timespec timeout_spec;
+  /** when the timeout in flight expires */
+  Event_loop::Clock::time_point timeout_deadline;
+
+  Io_uring_backend()
+      : params{}, ring{io_uring_setup(ring_entries, params)}, sq_ring{},
+        cq_ring{}, sqe_ring{}, sqes{nullptr}, cqes{nullptr}, to_submit{0},
+        polls{}, next_generation{1}, timeout{0}, timeouts_submitted{0},
+        timeout_spec{}, timeout_deadline{} {
+    if (ring < 0) {
+      throw errno_error("io_uring_setup");
+    }
+    auto const sq_size =
+        params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    auto const cq_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+      sq_ring.reset(new Mapping{ring, std::max(sq_size, cq_size),
+                                IORING_OFF_SQ_RING});
+    } else {
+      sq_ring.reset(new Mapping{ring, sq_size, IORING_OFF_SQ_RING});
+      cq_ring.reset(new Mapping{ring, cq_size, IORING_OFF_CQ_RING});
+    }
+    sqe_ring.reset(new Mapping{ring,
+                               params.sq_entries * sizeof(io_uring_sqe),
+                               IORING_OFF_SQES});
+    sqes = sqe_ring->at<io_uring_sqe>(0);
+    cqes = cq_mapping().at<io_uring_cqe>(params.cq_off.cqes);
+  }
+
+  Io_uring_backend(Io_uring_backend const &) = delete;
+  Io_uring_backend(Io_uring_backend &&) = delete;
+
+  ~Io_uring_backend() override = default;
+
+  Io_uring_backend &operator=(Io_uring_backend const &) = delete;
+  Io_uring_backend &operator=(Io_uring_backend &&) = delete;
+
+  Mapping const &cq_mapping() const { return cq_ring ? *cq_ring : *sq_ring; }
+
+  unsigned *sq(uint32_t const offset) const {
+    return sq_ring->at<unsigned>(offset);
+  }
+
+  unsigned *cq(uint32_t const offset) const {
+    return cq_mapping().at<unsigned>(offset);
+  }
+
+  /** returns false if a signal interrupted waiting */
+  bool submit(unsigned const min_complete) {
+    auto const flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0U;
+    auto const rc = io_uring_enter(ring, to_submit, min_complete, flags);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        return false;
+      }
+      if (errno == EBUSY || errno == EAGAIN) {
+        return true;
+      }
+      throw errno_error("io_uring_enter");
+    }
+    to_submit -= std::min(to_submit, static_cast<unsigned>(rc));
+    return true;
+  }
+
+  io_uring_sqe &get_sqe() {
+    auto const head = __atomic_load_n(sq(params.sq_off.head), __ATOMIC_ACQUIRE);
+    auto const tail = *sq(params.sq_off.tail);
+    if (tail - head == params.sq_entries) {
+      submit(0);
+      return get_sqe();
+    }
+    auto const index = tail & *sq(params.sq_off.ring_mask);
+    auto &sqe = sqes[index];
+    memset(&sqe, 0, sizeof(sqe));
+    sq(params.sq_off.array)[index] = index;
+    __atomic_store_n(sq(params.sq_off.tail), tail + 1, __ATOMIC_RELEASE);
+    ++to_submit;
+    return sqe;
+  }
+
+  static uint64_t poll_tag(int const fd, uint32_t const generation) {
+    return (uint64_t{generation} << 32) | static_cast<uint32_t>(fd);
+  }
+
+  void arm_poll(int const fd, uint32_t const generation) {
+    auto &sqe = get_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    sqe.poll32_events = poll_events(POLLIN);
+    sqe.user_data = poll_tag(fd, generation);
+  }
+
+  void add(int const fd) override {
+    auto const generation = next_generation++;
+    polls[fd] = generation;
+    arm_poll(fd, generation);
+  }
+
+  void remove(int const fd) override {
+    auto const it = polls.find(fd);
+    if (it == std::end(polls)) {
+      return;
+    }
+    auto &sqe = get_sqe();
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.fd = -1;
+    sqe.addr = poll_tag(fd, it->second);
+    sqe.user_data = ignore_tag;
+    polls.erase(it);
+  }
+
+  void arm_timeout(int const timeout_ms) {
+    auto const deadline =
+        Event_loop::Clock::now() + std::chrono::milliseconds{timeout_ms};
+    // the deadline is rounded to milliseconds, a timeout in flight which
+    // expires earlier only costs one more wakeup
+    if (timeout != 0 &&
+        timeout_deadline <= deadline + std::chrono::milliseconds{1}) {
+      return;
+    }
+    if (timeout != 0) {
+      auto &remove_sqe = get_sqe();
+      remove_sqe.opcode = IORING_OP_TIMEOUT_REMOVE;
+      remove_sqe.fd = -1;
+      remove_sqe.addr = timeout;
+      remove_sqe.user_data = ignore_tag;
+    }
+    // the kernel copies the timespec while submitting
+    timeout_spec.tv_sec = timeout_ms / 1000;
+    timeout_spec.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    timeout = timeout_tag | ++timeouts_submitted;
+    timeout_deadline = deadline;
+    auto &sqe = get_sqe();
+    sqe.opcode = IORING_OP_TIMEOUT;
+    sqe.fd = -1;
+    sqe.addr = reinterpret_cast<uint64_t>(&timeout_spec);
+    sqe.len = 1;
+    sqe.user_data = timeout;
+  }
+
+  /** returns false for completions of removed polls */
+  bool handle_poll(io_uring_cqe const &cqe, std::vector<int> &ready) {
+    auto const fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    auto const generation = static_cast<uint32_t>(cqe.user_data >> 32);
+    auto const it = polls.find(fd);
+    if (it == std::end(polls) || it->second != generation) {
+      return false;
+    }
+    if (cqe.res >= 0) {
+      ready.push_back(fd);
+      arm_poll(fd, generation);
+      return true;
+    }
+    if (cqe.res != -ECANCELED) {
+      LOG(LOG_ERR, "io_uring poll of fd %d failed: %s", fd,
+          strerror(-cqe.res));
+      // let the owner find out about the error when reading
+      ready.push_back(fd);
+      polls.erase(it);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * returns whether a poll completed or the timeout in flight expired, the
+   * completions of removals and replaced timeouts don't wake the loop up
+   */
+  bool reap(std::vector<int> &ready) {
+    auto woken = false;
+    auto *const head_ptr = cq(params.cq_off.head);
+    auto head = *head_ptr;
+    auto const tail = __atomic_load_n(cq(params.cq_off.tail), __ATOMIC_ACQUIRE);
+    auto const mask = *cq(params.cq_off.ring_mask);
+    for (; head != tail; ++head) {
+      auto const &cqe = cqes[head & mask];
+      if (cqe.user_data == ignore_tag) {
+        continue;
+      }
+      if ((cqe.user_data & timeout_tag) != 0) {
+        if (cqe.user_data == timeout) {
+          timeout = 0;
+          woken = true;
+        }
+        continue;
+      }
+      woken = handle_poll(cqe, ready) || woken;
+    }
+    __atomic_store_n(head_ptr, head, __ATOMIC_RELEASE);
+    return woken;
+  }
+
+  void wait(int const timeout_ms, std::vector<int> &ready) override {
+    if (timeout_ms == 0) {
+      if (to_submit > 0) {
+        submit(0);
+      }
+      reap(ready);
+      return;
+    }
+    if (timeout_ms > 0) {
+      arm_timeout(timeout_ms);
+    }
+    // submitting and waiting is a single syscall
+    while (submit(1) && !reap(ready)) {
+    }
+  }
+};
+#endif
+
+void drain_eventfd(int const fd) {
+  uint64_t count;
+  if (::read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    LOG(LOG_ERR, "reading the event loop wakeup failed: %s", strerror(errno));
+  }
+}
+
+std::unique_ptr<Event_backend> make_backend(Event_loop::Backend const type) {
+  switch (type) {
+  case Event_loop::Backend::epoll:
+    return std::unique_ptr<Event_backend>{new Epoll_backend{}};
+  case Event_loop::Backend::io_uring:
+#ifdef SLEEP_PROXY_IO_URING
+    return std::unique_ptr<Event_backend>{new Io_uring_backend{}};
+#else
+    throw std::runtime_error("io_uring support has not been compiled in");
+#endif
+  default:
+    throw std::runtime_error("unknown event loop backend");
+  }
+}
+} // namespace
+
+Event_loop::Backend Event_loop::default_backend() {
+#ifdef SLEEP_PROXY_IO_URING
+  // io_uring may be disabled by seccomp or kernel.io_uring_disabled
+  static auto const type = []() {
+    try {
+      Io_uring_backend probe{};
+      return Backend::io_uring;
+    } catch (std::runtime_error const &e) {
+      log_string(LOG_INFO, std::string{"falling back to epoll: "} + e.what());
+      return Backend::epoll;
+    }
+  }();
+  return type;
+#else
+  return Backend::epoll;
+#endif
+}
+
+Event_loop::Event_loop(Backend const backendd)
+    : backend{make_backend(backendd)}, backend_type{backendd}, fds{},
+      timers{}, timer_deadlines{}, next_timer_id{1},
+      wakeup{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}, posted_mutex{},
+      posted{}, stopped{false} {
+  if (wakeup < 0) {
+    throw errno_error("eventfd");
+  }
+  auto const wakeup_fd = wakeup.fd;
+  add_fd(wakeup_fd, [wakeup_fd]() { drain_eventfd(wakeup_fd); });
+}
+
+Event_loop::~Event_loop() = default;
+
+Event_loop::Backend Event_loop::get_backend() const { return backend_type; }
+
+void Event_loop::add_fd(int const fd, Callback on_readable) {
+  if (fds.find(fd) != std::end(fds)) {
+    throw std::runtime_error("fd " + std::to_string(fd) +
+                             " is already part of the event loop");
+  }
+  backend->add(fd);
+  fds.emplace(fd, std::move(on_readable));
+}
+
+void Event_loop::remove_fd(int const fd) {
+  if (fds.erase(fd) > 0) {
+    backend->remove(fd);
+  }
+}
+
+Event_loop::Timer_id
+Event_loop::add_timer(std::chrono::milliseconds const timeout, Callback cb) {
+  auto const id = next_timer_id++;
+  auto const deadline = Clock::now() + timeout;
+  timers.emplace(std::make_pair(deadline, id), std::move(cb));
+  timer_deadlines.emplace(id, deadline);
+  return id;
+}
+
+bool Event_loop::cancel_timer(Timer_id const id) {
+  auto const it = timer_deadlines.find(id);
+  if (it == std::end(timer_deadlines)) {
+    return false;
+  }
+  timers.erase(std::make_pair(it->second, id));
+  timer_deadlines.erase(it);
+  return true;
+}
+
+void Event_loop::post(Callback cb) {
+  {
+    std::lock_guard<std::mutex> const lock{posted_mutex};
+    posted.push_back(std::move(cb));
+  }
+  uint64_t const one = 1;
+  if (::write(wakeup, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    throw errno_error("write(eventfd)");
+  }
+}
+
+int Event_loop::next_timeout_ms(std::chrono::milliseconds const max_timeout) {
+  {
+    std::lock_guard<std::mutex> const lock{posted_mutex};
+    if (!posted.empty()) {
+      return 0;
+    }
+  }
+  auto const forever = max_timeout.count() < 0;
+  if (timers.empty()) {
+    return forever ? -1 : static_cast<int>(max_timeout.count());
+  }
+  auto const until_deadline = timers.begin()->first.first - Clock::now();
+  // round up, otherwise the loop spins until the deadline
+  auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+      until_deadline + std::chrono::milliseconds{1} -
+      std::chrono::nanoseconds{1});
+  if (!forever) {
+    timeout = std::min(timeout, max_timeout);
+  }
+  return timeout.count() < 0 ? 0 : static_cast<int>(timeout.count());
+}
+
+size_t Event_loop::run_timers() {
+  auto const now = Clock::now();
+  std::vector<Callback> expired;
+  while (!timers.empty() && timers.begin()->first.first <= now) {
+    auto const it = timers.begin();
+    expired.push_back(std::move(it->second));
+    timer_deadlines.erase(it->first.second);
+    timers.erase(it);
+  }
+  for (auto const &cb : expired) {
+    cb();
+  }
+  return expired.size();
+}
+
+size_t Event_loop::run_posted() {
+  std::vector<Callback> callbacks;
+  {
+    std::lock_guard<std::mutex> const lock{posted_mutex};
+    callbacks.swap(posted);
+  }
+  for (auto const &cb : callbacks) {
+    cb();
+  }
+  return callbacks.size();
+}
+
+size_t Event_loop::run_once(std::chrono::milliseconds const timeout) {
+  std::vector<int> ready;
+  backend->wait(next_timeout_ms(timeout), ready);
+  auto called = size_t{0};
+  for (auto const fd : ready) {
+    // earlier callbacks may have removed fd, copy as cb may remove itself
+    auto const it = fds.find(fd);
+    if (it == std::end(fds)) {
+      continue;
+    }
+    auto const cb = it->second;
+    cb();
+    if (fd != wakeup.fd) {
+      ++called;
+    }
+  }
+  called += run_timers();
+  called += run_posted();
+  return called;
+}
+
+void Event_loop::run() {
+  while (!stopped) {
+    run_once(std::chrono::milliseconds{-1});
+  }
+}
+
+void Event_loop::stop() {
+  stopped = true;
+  post([]() {});
+}
+
+bool Event_loop::is_stopped() const { return stopped; }
+
+std::ostream &operator<<(std::ostream &out,
+                         Event_loop::Backend const backend) {
+  switch (backend) {
+  case Event_loop::Backend::epoll:
+    return out << "epoll";
+  case Event_loop::Backend::io_uring:
+    return out << "io_uring";
+  default:
+    return out << "unknown";
+  }
+}
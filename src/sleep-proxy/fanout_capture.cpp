@@ -0,0 +1,487 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "fanout_capture.h"
+#include "log.h"
+#include "usdt.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <map>
+#include <net/if.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+/** how long workers and the consumer block before checking for a stop */
+auto const poll_timeout_ms = int{100};
+
+File_descriptor open_packet_socket(int const buffer_size) {
+  // protocol 0: receive nothing until the socket is bound, this way no
+  // unfiltered packet is queued before set_filter() has been called
+  int const sock = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    throw errno_error("socket(AF_PACKET)");
+  }
+  File_descriptor fd{sock};
+  // SO_RCVBUFFORCE ignores rmem_max but needs CAP_NET_ADMIN
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &buffer_size,
+                 sizeof(buffer_size)) != 0 &&
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size,
+                 sizeof(buffer_size)) != 0) {
+    throw errno_error("setsockopt(SO_RCVBUF)");
+  }
+  return fd;
+}
+
+int get_ifindex(std::string const &iface) {
+  if (iface == "any") {
+    return 0;
+  }
+  auto const index = if_nametoindex(iface.c_str());
+  if (index == 0) {
+    throw errno_error("if_nametoindex(" + iface + ")");
+  }
+  return static_cast<int>(index);
+}
+
+void pin_to_core(std::thread &t, size_t const index) {
+  auto const cores = std::max(1U, std::thread::hardware_concurrency());
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(index % cores, &cpus);
+  auto const rc =
+      pthread_setaffinity_np(t.native_handle(), sizeof(cpus), &cpus);
+  if (rc != 0) {
+    LOG(LOG_WARNING, "could not pin capture worker %zu to a core: %s", index,
+        strerror(rc));
+  }
+}
+
+void notify(int const eventfd) {
+  uint64_t const one = 1;
+  // a failed write means the counter is already non-zero, the consumer will
+  // wake up anyway
+  auto const ignored = write(eventfd, &one, sizeof(one));
+  static_cast<void>(ignored);
+}
+
+/** a handle to compile filters for raw IP packets */
+std::unique_ptr<pcap_t, void (*)(pcap_t *)> open_raw_dead(int const snaplen) {
+  std::unique_ptr<pcap_t, void (*)(pcap_t *)> dead{
+      pcap_open_dead(DLT_RAW, snaplen), pcap_close};
+  if (dead == nullptr) {
+    throw std::runtime_error("pcap_open_dead() failed");
+  }
+  return dead;
+}
+
+sock_fprog as_fprog(BPF &bpf) {
+  return sock_fprog{
+      static_cast<unsigned short>(bpf.bpf.bf_len),
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+      reinterpret_cast<sock_filter *>(bpf.bpf.bf_insns)};
+}
+
+void attach_filter(std::vector<File_descriptor> const &sockets,
+                   sock_fprog const &prog) {
+  for (auto const &sock : sockets) {
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) !=
+        0) {
+      throw errno_error("setsockopt(SO_ATTACH_FILTER)");
+    }
+  }
+}
+
+/** lets every packet through, fails harmlessly if no filter is attached */
+void detach_filter(std::vector<File_descriptor> const &sockets) {
+  // the option is ignored, but has to be at least an int
+  int const unused = 0;
+  for (auto const &sock : sockets) {
+    setsockopt(sock, SOL_SOCKET, SO_DETACH_FILTER, &unused, sizeof(unused));
+  }
+}
+} // namespace
+
+std::array<uint8_t, Link_layer::lcc_header_size>
+linux_cooked_header(sockaddr_ll const &sll) {
+  // see https://www.tcpdump.org/linktypes/LINKTYPE_LINUX_SLL.html
+  auto header = std::array<uint8_t, Link_layer::lcc_header_size>{};
+  auto const put_u16 = [&header](size_t const pos, uint16_t const value) {
+    uint16_t const net = htons(value);
+    std::memcpy(&header.at(pos), &net, sizeof(net));
+  };
+  put_u16(0, sll.sll_pkttype);
+  put_u16(2, sll.sll_hatype);
+  put_u16(4, sll.sll_halen);
+  std::copy(std::begin(sll.sll_addr), std::end(sll.sll_addr),
+            std::begin(header) + 6);
+  // already in network byte order
+  std::memcpy(&header.at(Link_layer::lcc_header_size - 2), &sll.sll_protocol,
+              sizeof(sll.sll_protocol));
+  return header;
+}
+
+std::shared_ptr<Fanout_group>
+Fanout_group::get(std::string const &iface, unsigned int const workers,
+                  int const snaplen, Counter &packets_seen,
+                  Counter &kernel_drops) {
+  static std::mutex groups_mutex;
+  static std::map<std::string, std::weak_ptr<Fanout_group>> groups;
+  std::lock_guard<std::mutex> const lock{groups_mutex};
+  auto group = groups[iface].lock();
+  if (group == nullptr || group->is_broken()) {
+    group = std::make_shared<Fanout_group>(iface, workers, snaplen,
+                                           packets_seen, kernel_drops);
+    groups[iface] = group;
+  } else if (workers != 0 && workers != group->worker_count()) {
+    LOG(LOG_INFO, "capture on %s shares the running %zu fanout workers",
+        iface.c_str(), group->worker_count());
+  }
+  return group;
+}
+
+Fanout_group::Fanout_group(std::string ifacee, unsigned int const workerss,
+                           int const snaplenn, Counter &packets_seenn,
+                           Counter &kernel_dropss)
+    : iface{std::move(ifacee)}, snaplen{snaplenn},
+      packets_seen(packets_seenn), kernel_drops(kernel_dropss), sockets{},
+      workers{}, stop_workers{false}, mutex{}, subscribers{}, broken{false},
+      drops_mutex{}, dropped{0} {
+  auto const count = workerss != 0
+                         ? workerss
+                         : std::max(1U, std::thread::hardware_concurrency());
+  sockets.reserve(count);
+  for (unsigned int i = 0; i < count; ++i) {
+    sockets.push_back(open_packet_socket(Fanout_capture::default_buffer_size));
+  }
+  update_kernel_filter();
+  join_fanout_group();
+  workers.reserve(sockets.size());
+  for (auto const &sock : sockets) {
+    workers.emplace_back(&Fanout_group::worker_main, this, sock.fd);
+    pin_to_core(workers.back(), workers.size() - 1);
+  }
+  LOG(LOG_INFO, "capturing on %s with %u fanout workers", iface.c_str(),
+      count);
+}
+
+Fanout_group::~Fanout_group() {
+  stop_workers = true;
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void Fanout_group::join_fanout_group() {
+  sockaddr_ll sll{};
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = htons(ETH_P_ALL);
+  sll.sll_ifindex = get_ifindex(iface);
+  // the kernel picks a group id unused in this network namespace for the
+  // first socket, the others join it
+  int fanout_id = 0;
+  for (auto const &sock : sockets) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (bind(sock, reinterpret_cast<sockaddr const *>(&sll), sizeof(sll)) !=
+        0) {
+      throw errno_error("bind(AF_PACKET) on " + iface);
+    }
+    int const flags = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG |
+                      (&sock == &sockets.front() ? PACKET_FANOUT_FLAG_UNIQUEID
+                                                 : 0);
+    int fanout_arg = fanout_id | (flags << 16);
+    if (setsockopt(sock, SOL_PACKET, PACKET_FANOUT, &fanout_arg,
+                   sizeof(fanout_arg)) != 0) {
+      throw errno_error("setsockopt(PACKET_FANOUT)");
+    }
+    if (&sock == &sockets.front()) {
+      socklen_t len = sizeof(fanout_arg);
+      if (getsockopt(sock, SOL_PACKET, PACKET_FANOUT, &fanout_arg, &len) !=
+          0) {
+        throw errno_error("getsockopt(PACKET_FANOUT)");
+      }
+      static auto const id_mask = int{0xffff};
+      fanout_id = fanout_arg & id_mask;
+    }
+  }
+}
+
+void Fanout_group::update_kernel_filter() {
+  // without subscribers nothing is received, a subscriber without a filter
+  // wants everything
+  std::string text;
+  auto accept_all = false;
+  auto separator = "";
+  for (auto const *const capture : subscribers) {
+    if (capture->filter == nullptr) {
+      accept_all = true;
+      break;
+    }
+    text.append(separator).append("(" + capture->filter_text + ")");
+    separator = " or ";
+  }
+  if (accept_all) {
+    detach_filter(sockets);
+    return;
+  }
+  if (subscribers.empty()) {
+    sock_filter drop_all{BPF_RET | BPF_K, 0, 0, 0};
+    attach_filter(sockets, sock_fprog{1, &drop_all});
+    return;
+  }
+  try {
+    auto dead = open_raw_dead(snaplen);
+    BPF bpf{dead, text};
+    attach_filter(sockets, as_fprog(bpf));
+  } catch (std::runtime_error const &e) {
+    // e.g. too many subscribers for the kernels instruction limit, the
+    // workers still filter for each capture
+    LOG(LOG_WARNING, "capturing on %s without kernel filter: %s",
+        iface.c_str(), e.what());
+    detach_filter(sockets);
+  }
+}
+
+void Fanout_group::worker_main(int const sock) {
+  try {
+    std::vector<uint8_t> buffer(static_cast<size_t>(snaplen));
+    pollfd pfd{sock, POLLIN, 0};
+    while (!stop_workers) {
+      int const ready = poll(&pfd, 1, poll_timeout_ms);
+      if (ready < 0 && errno != EINTR) {
+        throw errno_error("poll()");
+      }
+      while (ready > 0) {
+        sockaddr_ll sll{};
+        socklen_t sll_len = sizeof(sll);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto *const from = reinterpret_cast<sockaddr *>(&sll);
+        ssize_t const bytes =
+            recvfrom(sock, buffer.data(), buffer.size(),
+                     MSG_DONTWAIT | MSG_TRUNC, from, &sll_len);
+        if (bytes < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          if (errno == EAGAIN) {
+            break;
+          }
+          throw errno_error("recvfrom()");
+        }
+        auto const len = static_cast<size_t>(bytes);
+        auto const caplen = std::min(len, buffer.size());
+        // counted like libpcap counts packets on the "any" device
+        packets_seen.inc();
+        SLEEP_PROXY_PROBE2(packet, Link_layer::lcc_header_size + caplen,
+                           Link_layer::lcc_header_size + len);
+        std::lock_guard<std::mutex> const lock{mutex};
+        for (auto *const capture : subscribers) {
+          capture->offer(sll, buffer, caplen, len);
+        }
+      }
+    }
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "capture worker on %s stopped: %s", iface.c_str(), e.what());
+    std::lock_guard<std::mutex> const lock{mutex};
+    broken = true;
+    for (auto *const capture : subscribers) {
+      capture->fail();
+    }
+  }
+}
+
+void Fanout_group::subscribe(Fanout_capture &capture) {
+  std::lock_guard<std::mutex> const lock{mutex};
+  if (broken) {
+    capture.fail();
+    return;
+  }
+  subscribers.push_back(&capture);
+  update_kernel_filter();
+}
+
+void Fanout_group::unsubscribe(Fanout_capture &capture) {
+  std::lock_guard<std::mutex> const lock{mutex};
+  subscribers.erase(
+      std::remove(std::begin(subscribers), std::end(subscribers), &capture),
+      std::end(subscribers));
+  update_kernel_filter();
+}
+
+void Fanout_group::set_filter(Fanout_capture &capture,
+                              std::unique_ptr<BPF> filter,
+                              std::string const &text) {
+  std::lock_guard<std::mutex> const lock{mutex};
+  capture.filter = std::move(filter);
+  capture.filter_text = text;
+  if (std::find(std::begin(subscribers), std::end(subscribers), &capture) !=
+      std::end(subscribers)) {
+    update_kernel_filter();
+  }
+}
+
+bool Fanout_group::is_broken() {
+  std::lock_guard<std::mutex> const lock{mutex};
+  return broken;
+}
+
+size_t Fanout_group::worker_count() const { return sockets.size(); }
+
+uint64_t Fanout_group::collect_drops() {
+  std::lock_guard<std::mutex> const lock{drops_mutex};
+  // reading PACKET_STATISTICS resets the kernels counters
+  for (auto const &sock : sockets) {
+    tpacket_stats stats{};
+    socklen_t len = sizeof(stats);
+    if (getsockopt(sock, SOL_PACKET, PACKET_STATISTICS, &stats, &len) != 0) {
+      throw errno_error("getsockopt(PACKET_STATISTICS)");
+    }
+    dropped += stats.tp_drops;
+    kernel_drops.inc(stats.tp_drops);
+  }
+  return dropped;
+}
+
+Fanout_capture::Fanout_capture(std::string ifacee, unsigned int const workers,
+                               int const snaplenn)
+    : iface{std::move(ifacee)}, snaplen{snaplenn}, group{}, filter{},
+      filter_text{}, subscribed{false}, queue{}, wakeup{}, captured{0} {
+  int const efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (efd < 0) {
+    throw errno_error("eventfd()");
+  }
+  wakeup = File_descriptor{efd};
+  count_in_metrics_of(iface);
+  group = Fanout_group::get(iface, workers, snaplen, *packets_seen,
+                            *kernel_drops);
+}
+
+Fanout_capture::~Fanout_capture() {
+  if (subscribed) {
+    group->unsubscribe(*this);
+  }
+}
+
+int Fanout_capture::get_datalink() const { return DLT_LINUX_SLL; }
+
+void Fanout_capture::set_filter(const std::string &filter_string) {
+  // SOCK_DGRAM packet sockets run their filter on the network header
+  auto dead = open_raw_dead(snaplen);
+  auto bpf = std::make_unique<BPF>(dead, filter_string);
+  group->set_filter(*this, std::move(bpf), filter_string);
+  if (!subscribed) {
+    group->subscribe(*this);
+    subscribed = true;
+  }
+}
+
+void Fanout_capture::offer(sockaddr_ll const &sll,
+                           std::vector<uint8_t> const &raw,
+                           size_t const caplen, size_t const len) {
+  pcap_pkthdr raw_header{};
+  raw_header.caplen = static_cast<bpf_u_int32>(caplen);
+  raw_header.len = static_cast<bpf_u_int32>(len);
+  if (filter != nullptr &&
+      pcap_offline_filter(&filter->bpf, &raw_header, raw.data()) == 0) {
+    return;
+  }
+  auto const cooked = linux_cooked_header(sll);
+  Captured_packet packet{};
+  gettimeofday(&packet.header.ts, nullptr);
+  packet.header.caplen = static_cast<bpf_u_int32>(cooked.size() + caplen);
+  packet.header.len = static_cast<bpf_u_int32>(cooked.size() + len);
+  packet.data.reserve(packet.header.caplen);
+  packet.data.insert(std::end(packet.data), std::begin(cooked),
+                     std::end(cooked));
+  auto end_iter = std::begin(raw);
+  std::advance(end_iter, caplen);
+  packet.data.insert(std::end(packet.data), std::begin(raw), end_iter);
+  queue.push(std::move(packet));
+  notify(wakeup);
+}
+
+void Fanout_capture::fail() {
+  Pcap_wrapper::break_loop(Loop_end_reason::error);
+  notify(wakeup);
+}
+
+void Fanout_capture::wait_for_packets() const {
+  pollfd pfd{wakeup, POLLIN, 0};
+  if (poll(&pfd, 1, poll_timeout_ms) > 0) {
+    uint64_t counter = 0;
+    auto const ignored = read(wakeup, &counter, sizeof(counter));
+    static_cast<void>(ignored);
+  }
+}
+
+Pcap_wrapper::Loop_end_reason Fanout_capture::loop(int const count,
+                                                   Callback_t cb) {
+  if (!subscribed) {
+    group->subscribe(*this);
+    subscribed = true;
+  }
+
+  int delivered = 0;
+  while ((count <= 0 || delivered < count) &&
+         get_end_reason() == Loop_end_reason::unset) {
+    Captured_packet packet{};
+    if (queue.pop(packet)) {
+      cb(&packet.header, packet.data.data());
+      ++delivered;
+      ++captured;
+    } else {
+      wait_for_packets();
+    }
+  }
+  get_stats();
+
+  if (get_end_reason() == Loop_end_reason::error) {
+    throw std::runtime_error("error while capturing data on " + iface);
+  }
+  if (count > 0 && delivered >= count &&
+      get_end_reason() == Loop_end_reason::unset) {
+    Pcap_wrapper::break_loop(Loop_end_reason::packets_captured);
+  }
+  return get_end_reason();
+}
+
+void Fanout_capture::break_loop(const Loop_end_reason &ler) {
+  Pcap_wrapper::break_loop(ler);
+  notify(wakeup);
+}
+
+size_t Fanout_capture::worker_count() const { return group->worker_count(); }
+
+Fanout_capture::Stats Fanout_capture::get_stats() {
+  return Stats{captured, group->collect_drops()};
+}
+
+std::unique_ptr<Pcap_wrapper> open_capture(std::string const &iface,
+                                           unsigned int const workers) {
+  if (workers == 0) {
+    return std::make_unique<Pcap_wrapper>(iface);
+  }
+  return std::make_unique<Fanout_capture>(iface, workers);
+}
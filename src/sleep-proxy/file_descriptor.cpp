@@ -15,33 +15,22 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "file_descriptor.h"
-#include "container_utils.h"
+#include "stream_reader.h"
+#include <algorithm>
 #include <array>
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
-#include <iterator>
 #include <poll.h>
 #include <stdexcept>
 #include <string>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 namespace {
-auto const byte_vector_to_string = [](std::vector<uint8_t> const &v) {
-  return std::string(std::begin(v), std::end(v));
-};
-
-std::vector<std::string>
-byte_vector_to_strings(std::vector<uint8_t> const &data) {
-  std::vector<std::vector<uint8_t>> const splitted_data = split(data, '\n');
-  std::vector<std::string> lines(splitted_data.size());
-  std::transform(std::begin(splitted_data), std::end(splitted_data),
-                 std::begin(lines), byte_vector_to_string);
-  return lines;
-}
-
 bool is_data_ready_to_read(int const fd) {
   pollfd fds{fd, POLLIN, 0};
 
@@ -100,23 +89,17 @@ void File_descriptor::close() {
 }
 
 std::vector<std::string> File_descriptor::read() const {
-  std::vector<uint8_t> complete_data;
-
-  ssize_t read_bytes{-1};
-  while (is_data_ready_to_read(fd) && read_bytes != 0) {
-    static auto const buffer_size = uint8_t{100};
-    auto data = std::array<uint8_t, buffer_size>{};
-    read_bytes = ::read(fd, data.data(), data.size());
-    if (read_bytes == -1) {
-      throw std::runtime_error(std::string("File_descriptor::read() failed: ") +
-                               strerror(errno));
-    }
-    auto *end_iter = std::begin(data);
-    std::advance(end_iter, read_bytes);
-    complete_data.insert(std::end(complete_data), std::begin(data), end_iter);
+  Stream_reader reader;
+  while (is_data_ready_to_read(fd) && reader.read_some(fd)) {
   }
 
-  return byte_vector_to_strings(complete_data);
+  auto const views = reader.lines();
+  std::vector<std::string> lines;
+  lines.reserve(views.size());
+  for (auto const &line : views) {
+    lines.emplace_back(line.str());
+  }
+  return lines;
 }
 
 void flush_file(FILE *const stream) {
@@ -167,3 +150,29 @@ int get_fd_from_stream(FILE *const stream) {
   }
   return fd;
 }
+
+std::runtime_error errno_error(std::string const &what) {
+  return std::runtime_error(what + " failed: " + strerror(errno));
+}
+
+void write_all(int const fd, void const *const data, size_t const size) {
+  auto const *position = static_cast<uint8_t const *>(data);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto const *const end = position + size;
+  auto socket = true;
+  while (position != end) {
+    auto const left = static_cast<size_t>(end - position);
+    auto written = ssize_t{-1};
+    if (socket) {
+      written = send(fd, position, left, MSG_NOSIGNAL);
+      socket = written != -1 || errno != ENOTSOCK;
+    }
+    if (!socket) {
+      written = write(fd, position, left);
+    }
+    if (written == -1 && errno != EINTR) {
+      throw errno_error("write()");
+    }
+    position += std::max(written, ssize_t{0});
+  }
+}
@@ -0,0 +1,177 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "host_lifecycle.h"
+#include "metrics.h"
+#include "to_string.h"
+#include "usdt.h"
+#include <memory>
+
+std::ostream &operator<<(std::ostream &out, Host_state const state) {
+  switch (state) {
+  case Host_state::awake:
+    return out << "awake";
+  case Host_state::arming:
+    return out << "arming";
+  case Host_state::armed:
+    return out << "armed";
+  case Host_state::waking:
+    return out << "waking";
+  case Host_state::replaying:
+    return out << "replaying";
+  case Host_state::disarming:
+    return out << "disarming";
+  case Host_state::failed:
+    return out << "failed";
+  default:
+    return out << "unknown";
+  }
+}
+
+std::ostream &operator<<(std::ostream &out, Host_event const event) {
+  switch (event) {
+  case Host_event::silent:
+    return out << "silent";
+  case Host_event::armed:
+    return out << "armed";
+  case Host_event::syn:
+    return out << "syn";
+  case Host_event::duplicate_address:
+    return out << "duplicate_address";
+  case Host_event::answered:
+    return out << "answered";
+  case Host_event::timeout:
+    return out << "timeout";
+  case Host_event::replayed:
+    return out << "replayed";
+  case Host_event::disarmed:
+    return out << "disarmed";
+  case Host_event::stop:
+    return out << "stop";
+  case Host_event::error:
+    return out << "error";
+  default:
+    return out << "unknown";
+  }
+}
+
+Host_state next_state(Host_state const state, Host_event const event) {
+  if (event == Host_event::error) {
+    return Host_state::failed;
+  }
+  switch (state) {
+  case Host_state::awake:
+    return event == Host_event::silent ? Host_state::arming : state;
+  case Host_state::arming:
+    if (event == Host_event::armed) {
+      return Host_state::armed;
+    }
+    // the rules and IPs set up so far are removed
+    return event == Host_event::duplicate_address ||
+                   event == Host_event::stop
+               ? Host_state::disarming
+               : state;
+  case Host_state::armed:
+    if (event == Host_event::syn) {
+      return Host_state::waking;
+    }
+    return event == Host_event::duplicate_address ||
+                   event == Host_event::stop
+               ? Host_state::disarming
+               : state;
+  case Host_state::waking:
+    // a wake is finished even if the host is stopped meanwhile
+    if (event == Host_event::answered) {
+      return Host_state::replaying;
+    }
+    return event == Host_event::timeout ? Host_state::failed : state;
+  case Host_state::replaying:
+    return event == Host_event::replayed ? Host_state::awake : state;
+  case Host_state::disarming:
+    return event == Host_event::disarmed ? Host_state::awake : state;
+  case Host_state::failed:
+    // until the host shows up again
+    return event == Host_event::answered ? Host_state::awake : state;
+  default:
+    return state;
+  }
+}
+
+Host_lifecycle::Host_lifecycle(Observer observerr, Clock::time_point const now)
+    : current{Host_state::awake}, entered{now}, durations{},
+      observer{std::move(observerr)} {}
+
+bool Host_lifecycle::handle(Host_event const event,
+                            Clock::time_point const now) {
+  auto const next = next_state(current, event);
+  if (next == current) {
+    return false;
+  }
+  Transition const transition{current, next, event, now, now - entered};
+  durations.at(static_cast<size_t>(current)) += transition.duration;
+  current = next;
+  entered = now;
+  if (observer) {
+    observer(transition);
+  }
+  return true;
+}
+
+Host_state Host_lifecycle::state() const { return current; }
+
+Host_lifecycle::Clock::time_point Host_lifecycle::since() const {
+  return entered;
+}
+
+Host_lifecycle::Clock::duration
+Host_lifecycle::time_in(Host_state const state,
+                        Clock::time_point const now) const {
+  auto const past = durations.at(static_cast<size_t>(state));
+  return state == current ? past + (now - entered) : past;
+}
+
+Host_lifecycle::Observer host_state_metrics(std::string const &hostname) {
+  // looked up once, the metrics of a host are written on every transition
+  struct Host_metrics {
+    std::string hostname;
+    std::array<Gauge *, host_state_count> states;
+    std::array<Unsharded_counter *, host_state_count> seconds;
+  };
+  auto host = std::make_shared<Host_metrics>(
+      Host_metrics{hostname, {{nullptr}}, {{nullptr}}});
+  for (auto i = size_t{0}; i < host_state_count; ++i) {
+    auto const state = static_cast<Host_state>(i);
+    host->states.at(i) = &metrics().state(
+        "sleep_proxy_host_state", "what we think the host is doing",
+        {{"host", hostname}}, to_string(state));
+    host->states.at(i)->set(state == Host_state::awake ? 1 : 0);
+    host->seconds.at(i) = &metrics().unsharded_counter(
+        "sleep_proxy_host_state_seconds", "time the host spent in a state",
+        {{"host", hostname}, {"state", to_string(state)}}, Metrics::ns_per_s);
+  }
+  return [host](Host_lifecycle::Transition const &transition) {
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        transition.duration)
+                        .count();
+    SLEEP_PROXY_PROBE4(host_state, host->hostname.c_str(),
+                       static_cast<int>(transition.from),
+                       static_cast<int>(transition.to), ns);
+    auto const from = static_cast<size_t>(transition.from);
+    host->states.at(from)->set(0);
+    host->states.at(static_cast<size_t>(transition.to))->set(1);
+    host->seconds.at(from)->inc(static_cast<uint64_t>(ns));
+  };
+}
@@ -0,0 +1,282 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "host_table.h"
+
+#include "int_utils.h"
+#include "ip_utils.h"
+#include "log.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+enum class Key {
+  interface,
+  address,
+  port,
+  mac,
+  name,
+  ping_tries,
+  wol_method,
+  unknown
+};
+
+Key parse_key(char const *const begin, char const *const end) {
+  auto const is = [begin, end](char const *const key) {
+    return std::equal(begin, end, key, key + std::strlen(key));
+  };
+  // NOLINTNEXTLINE(readability-magic-numbers)
+  switch (end - begin) {
+  case 3:
+    return is("mac") ? Key::mac : Key::unknown;
+  case 4:
+    return is("port") ? Key::port : is("name") ? Key::name : Key::unknown;
+  case 7:
+    return is("address") ? Key::address : Key::unknown;
+  case 9:
+    return is("interface") ? Key::interface : Key::unknown;
+  case 10:
+    return is("ping_tries")   ? Key::ping_tries
+           : is("wol_method") ? Key::wol_method
+                              : Key::unknown;
+  default:
+    return Key::unknown;
+  }
+}
+
+/** like every line starting with host, even hostname */
+bool is_host_line(char const *const begin, char const *const end) {
+  static auto const length = 4;
+  return end - begin >= length && std::equal(begin, begin + length, "host");
+}
+
+void test_characters(char const *const begin, char const *const end,
+                     std::string const &valid_chars, char const *const what) {
+  if (std::any_of(begin, end, [&valid_chars](char const c) {
+        return valid_chars.find(c) == std::string::npos;
+      })) {
+    throw std::runtime_error(what + std::string(begin, end));
+  }
+}
+
+ether_addr parse_mac(char const *const begin, char const *const end) {
+  std::array<char, 32> text{{0}};
+  ether_addr mac{{0}};
+  if (static_cast<size_t>(end - begin) < text.size()) {
+    std::copy(begin, end, std::begin(text));
+    if (ether_aton_r(text.data(), &mac) != nullptr) {
+      return mac;
+    }
+  }
+  throw std::runtime_error("invalid mac: " + std::string(begin, end));
+}
+
+/** the values of the host being parsed, starting with the defaults */
+struct Host_values {
+  std::string interface{"lo"};
+  std::string hostname{};
+  ether_addr mac{{0x01, 0x12, 0x34, 0x45, 0x67, 0x89}};
+  unsigned int ping_tries{5};
+  Wol_method wol_method{Wol_method::ethernet};
+};
+
+void add_host(Host_table &table, Host_values const &host) {
+  if (!table.has_pending_addresses()) {
+    static auto const ipv4 = parse_ip(std::string{"10.0.0.1/16"});
+    static auto const ipv6 = parse_ip(std::string{"fe80::123/64"});
+    table.add_address(ipv4);
+    table.add_address(ipv6);
+  }
+  if (!table.has_pending_ports()) {
+    static auto const port0 = uint16_t{12345};
+    static auto const port1 = uint16_t{23456};
+    table.add_port(port0);
+    table.add_port(port1);
+  }
+  table.add_host(host.interface, host.hostname, host.mac, host.ping_tries,
+                 host.wol_method);
+}
+
+void parse_value(Host_table &table, Host_values &host, Key const key,
+                 char const *const begin, char const *const end) {
+  switch (key) {
+  case Key::interface:
+    test_characters(begin, end, iface_chars,
+                    "iface contains invalid characters: ");
+    host.interface.assign(begin, end);
+    break;
+  case Key::address:
+    table.add_address(parse_ip_range(begin, end));
+    break;
+  case Key::port:
+    table.add_port(str_to_integral<uint16_t>(std::string(begin, end)));
+    break;
+  case Key::mac:
+    host.mac = parse_mac(begin, end);
+    break;
+  case Key::name:
+    test_characters(begin, end, iface_chars + "-",
+                    "invalid token in hostname: ");
+    host.hostname.assign(begin, end);
+    break;
+  case Key::ping_tries:
+    host.ping_tries = str_to_integral<unsigned int>(std::string(begin, end));
+    break;
+  case Key::wol_method:
+    host.wol_method = parse_wol_method(std::string(begin, end));
+    break;
+  case Key::unknown:
+  default:
+    break;
+  }
+}
+
+/** a line is a name and a value separated by a single space */
+void parse_line(Host_table &table, Host_values &host, char const *const begin,
+                char const *const end) {
+  auto const space = std::find(begin, end, ' ');
+  auto value_end = end;
+  // a single trailing space is tolerated
+  if (space != end && space + 1 != end && *(end - 1) == ' ') {
+    --value_end;
+  }
+  if (space == end || space + 1 == end ||
+      std::find(space + 1, value_end, ' ') != value_end) {
+    LOG(LOG_INFO, "skipping line \"%s\"", std::string(begin, end).c_str());
+    LOG(LOG_INFO, "needs to be a pair of name and value separated by space");
+    return;
+  }
+  auto const key = parse_key(begin, space);
+  if (key == Key::unknown) {
+    LOG(LOG_INFO, "unknown name \"%s\": skipping",
+        std::string(begin, space).c_str());
+    return;
+  }
+  parse_value(table, host, key, space + 1, value_end);
+}
+} // namespace
+
+size_t Host_table::size() const { return macs.size(); }
+
+bool Host_table::empty() const { return macs.empty(); }
+
+std::vector<std::string> const &Host_table::interfaces() const {
+  return interface_names;
+}
+
+uint16_t Host_table::interface_id(size_t const host) const {
+  return interface_ids.at(host);
+}
+
+std::string const &Host_table::interface(size_t const host) const {
+  return interface_names.at(interface_ids.at(host));
+}
+
+std::string Host_table::hostname(size_t const host) const {
+  return names.substr(name_offsets.at(host),
+                      name_offsets.at(host + 1) - name_offsets.at(host));
+}
+
+Table_range<IP_address> Host_table::addresses_of(size_t const host) const {
+  auto const *const first = addresses.data();
+  return {first + address_offsets.at(host),
+          first + address_offsets.at(host + 1)};
+}
+
+Table_range<uint16_t> Host_table::ports_of(size_t const host) const {
+  auto const *const first = ports.data();
+  return {first + port_offsets.at(host), first + port_offsets.at(host + 1)};
+}
+
+ether_addr const &Host_table::mac(size_t const host) const {
+  return macs.at(host);
+}
+
+unsigned int Host_table::ping_tries(size_t const host) const {
+  return ping_tries_.at(host);
+}
+
+Wol_method Host_table::wol_method(size_t const host) const {
+  return wol_methods.at(host);
+}
+
+void Host_table::add_address(IP_address const &address) {
+  addresses.push_back(address);
+}
+
+void Host_table::add_port(uint16_t const port) { ports.push_back(port); }
+
+bool Host_table::has_pending_addresses() const {
+  return addresses.size() != address_offsets.back();
+}
+
+bool Host_table::has_pending_ports() const {
+  return ports.size() != port_offsets.back();
+}
+
+void Host_table::add_host(std::string const &interface,
+                          std::string const &hostname, ether_addr const &mac,
+                          unsigned int const ping_tries,
+                          Wol_method const wol_method) {
+  auto const interned = std::find(std::begin(interface_names),
+                                  std::end(interface_names), interface);
+  interface_ids.push_back(
+      static_cast<uint16_t>(interned - std::begin(interface_names)));
+  if (interned == std::end(interface_names)) {
+    interface_names.push_back(interface);
+  }
+  names += hostname;
+  name_offsets.push_back(static_cast<uint32_t>(names.size()));
+  address_offsets.push_back(static_cast<uint32_t>(addresses.size()));
+  port_offsets.push_back(static_cast<uint32_t>(ports.size()));
+  macs.push_back(mac);
+  ping_tries_.push_back(ping_tries);
+  wol_methods.push_back(wol_method);
+}
+
+Host_table parse_host_table(std::string const &config) {
+  Host_table table;
+  Host_values host;
+  bool in_host = false;
+  size_t line_number = 0;
+  auto const *line = config.data();
+  auto const *const end = config.data() + config.size();
+  while (line != end) {
+    auto const *const line_end = std::find(line, end, '\n');
+    ++line_number;
+    if (is_host_line(line, line_end)) {
+      if (in_host) {
+        add_host(table, host);
+      }
+      in_host = true;
+      host = Host_values{};
+    } else if (in_host && line != line_end) {
+      try {
+        parse_line(table, host, line, line_end);
+      } catch (std::exception const &e) {
+        throw std::runtime_error("line " + std::to_string(line_number) + ": " +
+                                 e.what());
+      }
+    }
+    line = line_end == end ? end : line_end + 1;
+  }
+  if (in_host) {
+    add_host(table, host);
+  }
+  return table;
+}
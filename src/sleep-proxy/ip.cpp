@@ -17,35 +17,40 @@
 #include "ip.h"
 #include "to_string.h"
 #include <arpa/inet.h>
+#include <array>
 
 uint8_t const ip::ipv4_header_size;
 uint8_t const ip::ipv6_header_size;
 uint8_t const ip::ipv6_address_size_byte;
 
-inline std::ostream &operator<<(std::ostream &out, const ip::Version &v) {
+namespace {
+Text_writer &operator<<(Text_writer &out, const ip::Version &v) {
   switch (v) {
   case ip::Version::ipv4:
-    // NOLINTNEXTLINE
-    out << 4;
-    break;
+    return out << '4';
   case ip::Version::ipv6:
-    // NOLINTNEXTLINE
-    out << 6;
-    break;
+    return out << '6';
   default:
-    out << "unknown";
-    break;
+    return out << "unknown";
   }
-  return out;
 }
+} // namespace
 
 std::ostream &operator<<(std::ostream &out, const ip &ip) {
-  out << "IPv" << ip.version() << ": ";
-  out << "dst = " << ip.destination().pure()
-      << ", src = " << ip.source().pure();
+  // two IPv6 addresses and the labels
+  std::array<char, 128> text{};
+  Text_writer writer{text};
+  writer << ip;
+  out << writer.c_str();
   return out;
 }
 
+Text_writer &operator<<(Text_writer &out, const ip &ip) {
+  return out << "IPv" << ip.version()
+             << ": dst = " << ip.destination().pure_text().c_str()
+             << ", src = " << ip.source().pure_text().c_str();
+}
+
 ip::ip(ip::Version const version, size_t const header_length,
        IP_address const source, IP_address const destination,
        uint8_t const payload_protocol)
@@ -19,67 +19,106 @@
 #include "int_utils.h"
 #include "log.h"
 #include "to_string.h"
+#include <algorithm>
 #include <array>
+#include <cstring>
 
 namespace {
-int get_af(const std::string &ip) {
-  in6_addr ipv6{};
-  if (inet_pton(AF_INET, ip.c_str(), &ipv6) == 1) {
-    return AF_INET;
-  }
-  if (inet_pton(AF_INET6, ip.c_str(), &ipv6) == 1) {
-    return AF_INET6;
-  }
-  throw std::runtime_error("ip " + ip +
-                           " is not as IPv4 or IPv6 recognizeable");
-}
-
-uint8_t get_std_subnet(const int version,
-                       const std::vector<std::string> &ip_subnet) {
+uint8_t get_std_subnet(const int version, char const *const text) {
   if (version == AF_INET6) {
     static auto const ipv6_subnet = uint8_t{64};
     static auto const ipv6_lo_subnet = uint8_t{128};
-    return ip_subnet.at(0) != "::1" ? ipv6_subnet : ipv6_lo_subnet;
+    return std::strcmp(text, "::1") != 0 ? ipv6_subnet : ipv6_lo_subnet;
   }
   static auto const ipv4_subnet = uint8_t{24};
   return ipv4_subnet;
 }
 
-uint8_t get_subnet(const int version,
-                   const std::vector<std::string> &ip_subnet) {
-  // if no subnet size is given, append standard values
-  uint8_t const subnet = ip_subnet.size() > 1
-                             ? str_to_integral<uint8_t>(ip_subnet.at(1))
-                             : get_std_subnet(version, ip_subnet);
+uint8_t get_subnet(const int version, char const *const subnet_begin,
+                   char const *const subnet_end) {
+  uint8_t const subnet =
+      str_to_integral<uint8_t>(std::string(subnet_begin, subnet_end));
 
   // check if the subnet size is in correct bounds
   const uint8_t maxsubnetlen = version == AF_INET ? 32 : 128;
   if (subnet > maxsubnetlen) {
-    std::string ss = "Subnet " + to_string(subnet) + " is not in range 0.." +
-                     to_string(maxsubnetlen);
+    std::string ss = "Subnet " + to_string(static_cast<int>(subnet)) +
+                     " is not in range 0.." +
+                     to_string(static_cast<int>(maxsubnetlen));
     throw std::invalid_argument(ss);
   }
   return subnet;
 }
+
+/** the bytes of the address in use, the rest of the union may be garbage */
+size_t address_size(int const family) {
+  switch (family) {
+  case AF_INET:
+    return sizeof(in_addr);
+  case AF_INET6:
+    return sizeof(in6_addr);
+  default:
+    return 0;
+  }
+}
 } // namespace
 
-std::string IP_address::pure() const {
-  std::array<char, INET6_ADDRSTRLEN> text{{0}};
+std::string IP_address::pure() const { return pure_text().c_str(); }
+
+std::string IP_address::with_subnet() const {
+  return with_subnet_text().c_str();
+}
+
+IP_text IP_address::pure_text() const {
+  IP_text result{{{0}}};
   // NOLINTNEXTLINE
-  inet_ntop(family, &address.ipv6, text.data(),
-            static_cast<socklen_t>(text.size()));
-  return text.data();
+  inet_ntop(family, &address.ipv6, result.text.data(),
+            static_cast<socklen_t>(result.text.size()));
+  return result;
 }
 
-std::string IP_address::with_subnet() const {
-  return pure() + "/" + to_string(static_cast<int>(subnet));
+IP_text IP_address::with_subnet_text() const {
+  auto result = pure_text();
+  auto const length = std::strlen(result.c_str());
+  Text_writer out{result.text.data() + length, result.text.size() - length};
+  out << '/' << int{subnet};
+  return result;
 }
 
 bool IP_address::operator==(const IP_address &rhs) const {
-  bool equal = family == rhs.family;
-  equal &= subnet == rhs.subnet;
-  equal &= pure() == rhs.pure();
-  return equal;
+  return family == rhs.family && subnet == rhs.subnet &&
+         std::memcmp(&address, &rhs.address, address_size(family)) == 0;
+}
+
+bool IP_address::operator!=(const IP_address &rhs) const {
+  return !(*this == rhs);
+}
+
+bool IP_address::operator<(const IP_address &rhs) const {
+  if (family != rhs.family) {
+    return family < rhs.family;
+  }
+  // network byte order compares like the numbers
+  auto const cmp = std::memcmp(&address, &rhs.address, address_size(family));
+  return cmp != 0 ? cmp < 0 : subnet < rhs.subnet;
+}
+
+size_t std::hash<IP_address>::operator()(const IP_address &ip) const
+    noexcept {
+  std::array<uint64_t, 2> words{{0, 0}};
+  // copies of a constant size are inlined
+  switch (ip.family) {
+  case AF_INET:
+    std::memcpy(words.data(), &ip.address.ipv4, sizeof(in_addr));
+    break;
+  case AF_INET6:
+    std::memcpy(words.data(), &ip.address.ipv6, sizeof(in6_addr));
+    break;
+  default:
+    break;
+  }
+  auto const tag = static_cast<uint64_t>(ip.family) << 8U | ip.subnet;
+  return hash_words(words[0], words[1] ^ tag);
 }
 
 static const std::string ip_chars{
@@ -89,27 +128,58 @@ IP_address parse_ip(const std::string &ip) {
   if (ip.empty()) {
     throw std::invalid_argument("given ip is empty");
   }
-  log_string(LOG_INFO, "parsing ip: " + ip);
-  test_characters(ip, ip_chars, "ip contains invalid characters: " + ip);
+  LOG(LOG_INFO, "parsing ip: %s", ip.c_str());
+  return parse_ip_range(ip.data(), ip.data() + ip.size());
+}
+
+IP_address parse_ip_range(char const *const begin,
+                          char const *const end) {
+  if (begin == end) {
+    throw std::invalid_argument("given ip is empty");
+  }
+  if (std::any_of(begin, end, [](char const c) {
+        return ip_chars.find(c) == std::string::npos;
+      })) {
+    throw std::runtime_error("ip contains invalid characters: " +
+                             std::string(begin, end));
+  }
   // one slash or no slash
-  if (ip.find('/') != ip.rfind('/')) {
+  auto const slash = std::find(begin, end, '/');
+  if (slash != end && std::find(slash + 1, end, '/') != end) {
     throw std::invalid_argument("Too many / in IP");
   }
-  // getAF() throws if inet_pton() can not understand the ip
-  // e.g. when the ip is ill formatted
-  const auto ip_subnet = split(split(ip, '%').at(0), '/');
-  const int version = get_af(ip_subnet.at(0));
+  // the zone index and everything after it is ignored
+  auto const zone = std::find(begin, end, '%');
+  auto const address_end = std::min(slash, zone);
+  std::array<char, INET6_ADDRSTRLEN> address{{0}};
   IP_address ipa{};
-  ipa.family = version;
-  ipa.subnet = get_subnet(version, ip_subnet);
-  // NOLINTNEXTLINE
-  inet_pton(version, ip_subnet.at(0).c_str(), &ipa.address.ipv6);
+  if (static_cast<size_t>(address_end - begin) < address.size()) {
+    std::copy(begin, address_end, std::begin(address));
+    // NOLINTNEXTLINE
+    if (inet_pton(AF_INET, address.data(), &ipa.address.ipv4) == 1) {
+      ipa.family = AF_INET;
+      // NOLINTNEXTLINE
+    } else if (inet_pton(AF_INET6, address.data(), &ipa.address.ipv6) == 1) {
+      ipa.family = AF_INET6;
+    }
+  }
+  if (ipa.family == 0) {
+    throw std::runtime_error("ip " + std::string(begin, address_end) +
+                             " is not as IPv4 or IPv6 recognizeable");
+  }
+  ipa.subnet = slash < zone && slash + 1 != zone
+                   ? get_subnet(ipa.family, slash + 1, zone)
+                   : get_std_subnet(ipa.family, address.data());
   return ipa;
 }
 
 std::string get_pure_ip(const IP_address &ip) { return ip.pure(); }
 
 std::ostream &operator<<(std::ostream &out, const IP_address &ipa) {
-  out << ipa.with_subnet();
+  out << ipa.with_subnet_text().c_str();
   return out;
 }
+
+Text_writer &operator<<(Text_writer &out, const IP_address &ipa) {
+  return out << ipa.with_subnet_text().c_str();
+}
@@ -18,18 +18,26 @@
 #include "args.h"
 #include "container_utils.h"
 #include "duplicate_address_watcher.h"
+#include "fanout_capture.h"
 #include "ip_utils.h"
 #include "log.h"
+#include "metrics.h"
 #include "packet_parser.h"
 #include "pcap_wrapper.h"
+#include "process_runner.h"
 #include "scope_guard.h"
-#include "spawn_process.h"
+#include "text_writer.h"
+#include "usdt.h"
+#include "wake_latency.h"
 #include "wol.h"
 #include "wol_watcher.h"
+#include <array>
 #include <atomic>
 #include <csignal>
 #include <cstring>
+#include <map>
 #include <mutex>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <tuple>
@@ -54,6 +62,12 @@ std::vector<Pcap_wrapper *> pcaps;
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 std::atomic_bool signaled{false};
+/** hosts which shall stop, guarded by pcaps_mutex */
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::set<Args const *> cancelled;
+/** the capture each host is listening with, guarded by pcaps_mutex */
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::map<Args const *, Pcap_wrapper *> listening;
 
 void signal_handler(int /*unused*/) {
   signaled = true;
@@ -70,6 +84,30 @@ void set_signal(const int signum, const struct sigaction &sa) {
   }
 }
 
+/** registers pc as the capture of args, breaks it if args is cancelled */
+struct Listening_guard {
+  Args const &args;
+  Pcap_wrapper &pc;
+
+  std::string operator()(const Action action) {
+    std::lock_guard<std::mutex> const lock(pcaps_mutex);
+    switch (action) {
+    case Action::add:
+      listening[&args] = &pc;
+      if (cancelled.count(&args) != 0) {
+        pc.break_loop(Pcap_wrapper::Loop_end_reason::signal);
+      }
+      break;
+    case Action::del:
+      listening.erase(&args);
+      break;
+    default:
+      break;
+    }
+    return "";
+  }
+};
+
 /**
  * Adds from args the IPs to the machine and setups the firewall
  */
@@ -92,18 +130,22 @@ std::vector<Scope_guard> setup_firewall_and_ips(const Args &args) {
 /**
  * Waits and blocks until a SYN packet to any of the given IPs in Args and to
  * any of the given ports in Args is received. Returns the data, the IP
- * source of the received packet and the destination IP
+ * source of the received packet, the destination IP and when the packet
+ * arrived
  */
 std::tuple<Pcap_wrapper::Loop_end_reason, std::vector<uint8_t>, IP_address,
-           IP_address>
+           IP_address, std::chrono::steady_clock::time_point>
 wait_and_listen(const Args &args) {
-  Pcap_wrapper pc("any");
+  std::unique_ptr<Pcap_wrapper> const capture =
+      open_capture("any", args.capture_workers);
+  Pcap_wrapper &pc = *capture;
 
   // guards to handle signals and address duplication
   std::vector<Scope_guard> guards;
   guards.emplace_back(
       make_copyable<Wol_watcher>(args.interface, args.mac, std::ref(pc)));
   guards.emplace_back(ptr_guard(pcaps, pcaps_mutex, pc));
+  guards.emplace_back(Listening_guard{args, pc});
   for (const auto &ip : args.address) {
     guards.emplace_back(make_copyable<Duplicate_address_watcher>(
         args.interface, ip, std::ref(pc)));
@@ -111,7 +153,7 @@ wait_and_listen(const Args &args) {
 
   const std::string bpf =
       rule_to_listen_on_ips_and_ports(args.address, args.ports);
-  log_string(LOG_INFO, "Listening with filter: " + bpf);
+  LOG(LOG_INFO, "Listening with filter: %s", bpf.c_str());
   pc.set_filter(bpf);
 
   Catch_incoming_connection catcher(pc.get_datalink());
@@ -120,12 +162,12 @@ wait_and_listen(const Args &args) {
   // check if address duplication got something
   switch (ler) {
   case Pcap_wrapper::Loop_end_reason::duplicate_address:
-    log_string(LOG_INFO, "Detected duplicated address: one of these ips is "
+    LOG_STRING(LOG_INFO, "Detected duplicated address: one of these ips is "
                          "owned by another machine: " +
                              to_string(args.address));
     break;
   case Pcap_wrapper::Loop_end_reason::signal:
-    log_string(LOG_INFO, "received signal while capturing with pcap");
+    LOG(LOG_INFO, "received signal while capturing with pcap");
     break;
   case Pcap_wrapper::Loop_end_reason::unset:
     log_string(LOG_ERR, "no reason given why pcap has been stopped");
@@ -140,20 +182,22 @@ wait_and_listen(const Args &args) {
     break;
   }
 
-  log_string(LOG_INFO, "catched headers: " + to_string(catcher.headers));
+  LOG_STRING(LOG_INFO, "catched headers: " + to_string(catcher.headers));
 
   if (std::get<1>(catcher.headers) == nullptr) {
-    log_string(LOG_INFO, "got nothing while catching with pcap");
+    LOG(LOG_INFO, "got nothing while catching with pcap");
     if (Pcap_wrapper::Loop_end_reason::packets_captured == ler) {
       throw std::runtime_error(
           "received some data but parsing headers did not succeed");
     }
-    return std::make_tuple(ler, catcher.data, IP_address(), IP_address());
+    return std::make_tuple(ler, catcher.data, IP_address(), IP_address(),
+                           catcher.received);
   }
 
   return std::make_tuple(ler, catcher.data,
                          std::get<1>(catcher.headers)->source(),
-                         std::get<1>(catcher.headers)->destination());
+                         std::get<1>(catcher.headers)->destination(),
+                         catcher.received);
 }
 
 std::string get_ping_cmd(const IP_address &ip) {
@@ -164,7 +208,7 @@ std::string get_ping_cmd(const IP_address &ip) {
 void replay_data(const std::string &iface, const int type,
                  const std::vector<uint8_t> &data,
                  const ether_addr &target_mac) {
-  log_string(LOG_INFO, "replaing SYN packet");
+  LOG(LOG_INFO, "replaing SYN packet");
   basic_headers headers = get_headers(type, data);
   const std::unique_ptr<Link_layer> &ll = std::get<0>(headers);
   if (ll == nullptr) {
@@ -176,8 +220,10 @@ void replay_data(const std::string &iface, const int type,
   const std::vector<uint8_t> payload =
       create_ethernet_header(target_mac, ll->source(), payload_type) +
       std::vector<uint8_t>(data_iter, std::end(data));
+  auto const start = std::chrono::steady_clock::now();
   Pcap_wrapper pc(iface);
-  pc.inject(payload);
+  auto const bytes = pc.inject(payload);
+  SLEEP_PROXY_PROBE3(replay, iface.c_str(), bytes, probe_ns_since(start));
 }
 
 } // namespace
@@ -198,45 +244,82 @@ void reset_signaled() { signaled = false; }
 std::string
 rule_to_listen_on_ips_and_ports(const std::vector<IP_address> &ips,
                                 const std::vector<uint16_t> &ports) {
-  std::string bpf = "tcp[tcpflags] == tcp-syn";
-  bpf += " and dst host (" + join(ips, get_pure_ip, " or ") + ")";
-  bpf += " and dst port (" + join(ports, identity<uint16_t>, " or ") + ")";
+  // addresses are shorter than an IP_text, ports have up to 5 digits
+  static auto const ip_length = sizeof(IP_text) + 4;
+  static auto const port_length = size_t{5 + 4};
+  std::string bpf = "tcp[tcpflags] == tcp-syn and dst host (";
+  bpf.reserve(bpf.size() + ips.size() * ip_length + ports.size() * port_length +
+               32);
+  auto separator = "";
+  for (auto const &ip : ips) {
+    bpf.append(separator).append(ip.pure_text().c_str());
+    separator = " or ";
+  }
+  bpf += ") and dst port (";
+  separator = "";
+  for (auto const port : ports) {
+    std::array<char, 8> digits{};
+    Text_writer out{digits};
+    out << port;
+    bpf.append(separator).append(out.c_str(), out.size());
+    separator = " or ";
+  }
+  bpf += ")";
   return bpf;
 }
 
 std::string get_bindable_ip(const std::string &iface, const std::string &ip) {
-  if (ip.find("fe80") == 0) {
+  // without an interface "fe80::1%" would not even parse
+  if (ip.find("fe80") == 0 && !iface.empty()) {
     return ip + '%' + iface;
   }
   return ip;
 }
 
-bool ping_and_wait(const std::string &iface, const IP_address &ip,
-                   const unsigned int tries) {
+std::future<uint8_t> ping_async(const std::string &iface,
+                                const IP_address &ip) {
+  // ping -c 1 gives up after 10 seconds without an answer
+  static auto const ping_timeout = std::chrono::seconds(15);
   const std::string ipcmd = get_ping_cmd(ip);
   const std::string cmd{ipcmd + " -c 1 " + get_bindable_ip(iface, ip.pure())};
-  uint8_t ret_val = 1;
-  for (unsigned int i = 0; i < tries && !is_signaled() && ret_val != 0; i++) {
-    ret_val = spawn(split(cmd, ' '));
-  }
-  if (ret_val != 0) {
-    log(LOG_ERR, "failed to ping ip %s after %d ping attempts",
-        ip.pure().c_str(), tries);
+  return process_runner().run(split(cmd, ' '), ping_timeout);
+}
+
+bool ping_succeeded(std::future<uint8_t> &ping) {
+  try {
+    return ping.get() == 0;
+  } catch (Process_timeout const &e) {
+    log_string(LOG_WARNING, e.what());
+    return false;
   }
-  return ret_val == 0;
 }
 
-/**
- * Puts everything together. Sets up firewall and IPs. Waits for an incoming
- * SYN packet and wakes the sleeping host via WOL
- */
-Emulate_host_status emulate_host(const Args &args) {
-  // setup firewall rules and add IPs to the interface
-  std::vector<Scope_guard> locks(setup_firewall_and_ips(args));
-  // wait until upon an incoming connection
-  const auto status_data_source_destination = wait_and_listen(args);
+bool ping_and_wait(const std::string &iface, const IP_address &ip,
+                   const unsigned int tries, Latency_histogram *attempts) {
+  bool answered = false;
+  for (unsigned int i = 0; i < tries && !is_signaled() && !answered; i++) {
+    auto const start = std::chrono::steady_clock::now();
+    auto ping = ping_async(iface, ip);
+    answered = ping_succeeded(ping);
+    auto const duration = std::chrono::steady_clock::now() - start;
+    if (attempts != nullptr) {
+      attempts->record(duration);
+    }
+    SLEEP_PROXY_PROBE5(
+        ping_attempt, iface.c_str(), ip.pure_text().c_str(), i,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+        answered);
+  }
+  if (!answered) {
+    LOG(LOG_ERR, "failed to ping ip %s after %d ping attempts",
+        ip.pure_text().c_str(), tries);
+  }
+  return answered;
+}
 
-  switch (std::get<0>(status_data_source_destination)) {
+namespace {
+Emulate_host_status status_of(Pcap_wrapper::Loop_end_reason const reason) {
+  switch (reason) {
   case Pcap_wrapper::Loop_end_reason::duplicate_address:
     return Emulate_host_status::duplicate_address;
   case Pcap_wrapper::Loop_end_reason::signal:
@@ -246,39 +329,157 @@ Emulate_host_status emulate_host(const Args &args) {
   case Pcap_wrapper::Loop_end_reason::error:
     return Emulate_host_status::undefined_error;
   case Pcap_wrapper::Loop_end_reason::packets_captured:
-    break;
+    return Emulate_host_status::success;
   default:
     log_string(LOG_ERR, "got unknown return status from Pcap_wrapper");
     return Emulate_host_status::undefined_error;
   }
+}
+
+/** the event ending an emulation without a SYN */
+Host_event end_of_emulation(Emulate_host_status const status) {
+  switch (status) {
+  case Emulate_host_status::duplicate_address:
+    return Host_event::duplicate_address;
+  case Emulate_host_status::signal_received:
+    return Host_event::stop;
+  case Emulate_host_status::success:
+  case Emulate_host_status::wake_failure:
+  case Emulate_host_status::undefined_error:
+  default:
+    return Host_event::error;
+  }
+}
 
-  log_string(LOG_INFO, "got something");
+/**
+ * Puts everything together. Sets up firewall and IPs. Waits for an incoming
+ * SYN packet and wakes the sleeping host via WOL
+ */
+Emulate_host_status emulate_and_wake(const Args &args,
+                                     Host_lifecycle &lifecycle) {
+  lifecycle.handle(Host_event::silent);
+  // setup firewall rules and add IPs to the interface
+  std::vector<Scope_guard> locks(setup_firewall_and_ips(args));
+  lifecycle.handle(Host_event::armed);
+  // wait until upon an incoming connection
+  const auto status_data_source_destination = wait_and_listen(args);
+
+  auto const reason = std::get<0>(status_data_source_destination);
+  if (reason != Pcap_wrapper::Loop_end_reason::packets_captured) {
+    auto const status = status_of(reason);
+    lifecycle.handle(end_of_emulation(status));
+    locks.clear();
+    lifecycle.handle(Host_event::disarmed);
+    return status;
+  }
+
+  LOG(LOG_INFO, "got something");
+  metrics()
+      .unsharded_counter("sleep_proxy_syns_caught",
+                         "connections which made us wake a host",
+                         {{"host", args.hostname}})
+      .inc();
+  lifecycle.handle(Host_event::syn);
+  auto &latency = wake_latency(args.hostname);
+  auto const syn_received = std::get<4>(status_data_source_destination);
+  auto stage_start = syn_received;
+  // records the time since the last stage ended
+  auto const stage_done = [&](Wake_stage const stage) {
+    SLEEP_PROXY_PROBE3(wake_stage, args.hostname.c_str(),
+                       static_cast<int>(stage), probe_ns_since(stage_start));
+    auto const now = std::chrono::steady_clock::now();
+    latency[stage].record(now - stage_start);
+    stage_start = now;
+  };
+  stage_done(Wake_stage::capture);
 
   // block icmp messages to the source IP, e.g. not tell him that his
   // destination IP is gone for a short while
   const Scope_guard block_icmp(
       Block_icmp{std::get<2>(status_data_source_destination)});
+  stage_done(Wake_stage::icmp_block);
   // release_locks()
   locks.clear();
+  stage_done(Wake_stage::firewall_teardown);
   // wake the sleeping server
   if (args.wol_method == Wol_method::udp) {
     wol_udp(args.mac);
   } else {
     wol_ethernet(args.interface, args.mac);
   }
+  stage_done(Wake_stage::wol);
 
   // wait until server responds and release ICMP rules
-  log_string(LOG_INFO,
-             "ping: " + std::get<3>(status_data_source_destination).pure());
+  LOG(LOG_INFO, "ping: %s",
+      std::get<3>(status_data_source_destination).pure_text().c_str());
   const bool wake_success =
       ping_and_wait(args.interface, std::get<3>(status_data_source_destination),
-                    args.ping_tries);
-  const std::string status = wake_success ? " succeeded" : " failed";
-  log_string(LOG_NOTICE, "waking " + args.hostname + " with mac " +
-                             binary_to_mac(args.mac) + status);
+                    args.ping_tries, &latency[Wake_stage::ping_attempt]);
+  stage_done(Wake_stage::ping);
+  lifecycle.handle(wake_success ? Host_event::answered : Host_event::timeout);
+  LOG(LOG_NOTICE, "waking %s with mac %s %s", args.hostname.c_str(),
+      binary_to_mac(args.mac).c_str(), wake_success ? "succeeded" : "failed");
   // replay SYN packet
   replay_data(args.interface, DLT_LINUX_SLL,
               std::get<1>(status_data_source_destination), args.mac);
+  stage_done(Wake_stage::replay);
+  lifecycle.handle(Host_event::replayed);
+  latency[Wake_stage::total].record(std::chrono::steady_clock::now() -
+                                    syn_received);
   return wake_success ? Emulate_host_status::success
                       : Emulate_host_status::wake_failure;
 }
+} // namespace
+
+std::ostream &operator<<(std::ostream &out, Emulate_host_status const status) {
+  switch (status) {
+  case Emulate_host_status::success:
+    return out << "success";
+  case Emulate_host_status::wake_failure:
+    return out << "wake_failure";
+  case Emulate_host_status::signal_received:
+    return out << "signal_received";
+  case Emulate_host_status::duplicate_address:
+    return out << "duplicate_address";
+  case Emulate_host_status::undefined_error:
+    return out << "undefined_error";
+  default:
+    return out << "unknown";
+  }
+}
+
+Emulate_host_status emulate_host(const Args &args,
+                                 Host_lifecycle &lifecycle) {
+  try {
+    auto const status = emulate_and_wake(args, lifecycle);
+    metrics()
+        .unsharded_counter(
+            "sleep_proxy_emulations",
+            "finished emulations of a host by their result",
+            {{"host", args.hostname}, {"result", to_string(status)}})
+        .inc();
+    return status;
+  } catch (...) {
+    lifecycle.handle(Host_event::error);
+    throw;
+  }
+}
+
+Emulate_host_status emulate_host(const Args &args) {
+  Host_lifecycle lifecycle{host_state_metrics(args.hostname)};
+  return emulate_host(args, lifecycle);
+}
+
+void cancel_emulation(const Args &args) {
+  std::lock_guard<std::mutex> const lock(pcaps_mutex);
+  cancelled.insert(&args);
+  auto const capture = listening.find(&args);
+  if (capture != std::end(listening)) {
+    capture->second->break_loop(Pcap_wrapper::Loop_end_reason::signal);
+  }
+}
+
+void resume_emulation(const Args &args) {
+  std::lock_guard<std::mutex> const lock(pcaps_mutex);
+  cancelled.erase(&args);
+}
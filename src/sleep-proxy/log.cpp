@@ -15,10 +15,23 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "log.h"
+#include "file_descriptor.h"
+#include "spsc_ring.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <cstdarg>
+#include <cstring>
 #include <memory>
 #include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
 #include <utility>
+#include <vector>
 
 namespace {
 struct Syslog {
@@ -37,13 +50,467 @@ struct Syslog {
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 std::unique_ptr<Syslog> logger{nullptr};
+
+/** every Log_rate_limit, so log_suppressed() finds their dropped messages */
+struct Rate_limits {
+  std::mutex mutex;
+  std::vector<Log_rate_limit *> limits;
+};
+
+Rate_limits &rate_limits() {
+  static Rate_limits instance{};
+  return instance;
+}
+
+void write_record(int const priority, char const *const text) {
+  if (logger == nullptr) {
+    std::printf("%s\n", text);
+  } else {
+    syslog(priority, "%s", text);
+  }
+}
+
+/**
+ * a message of one logging thread, either formatted already or the
+ * arguments of LOG() for formatter. Messages too long for the payload are
+ * kept in overflow, one record takes 256 bytes.
+ */
+struct Log_record {
+  int priority;
+  char const *format;
+  log_detail::Formatter formatter;
+  std::unique_ptr<char[]> overflow;
+  std::array<char, 224> payload;
+
+  Log_record()
+      : priority{0}, format{nullptr}, formatter{nullptr}, overflow{},
+        payload{} {}
+
+  Log_record(Log_record const &) = delete;
+  Log_record(Log_record &&) = default;
+  ~Log_record() = default;
+  Log_record &operator=(Log_record const &) = delete;
+  Log_record &operator=(Log_record &&) = default;
+};
+
+/** the ring of one logging thread */
+struct Thread_ring {
+  Spsc_ring<Log_record> records;
+  std::atomic<uint64_t> dropped;
+
+  explicit Thread_ring(size_t const slots) : records{slots}, dropped{0} {}
+};
+
+/**
+ * Drains the rings of all logging threads in its own thread. Threads only
+ * take a lock when they log for the first time, to register their ring.
+ */
+class Async_logger {
+  File_descriptor wakeup;
+  std::mutex rings_mutex;
+  std::vector<std::shared_ptr<Thread_ring>> rings;
+  std::thread writer;
+  std::atomic_bool running;
+  /** set by the writer before it sleeps, producers wake it if set */
+  std::atomic_bool writer_waiting;
+  std::atomic_bool held;
+  std::atomic<uint64_t> dropped_total;
+  size_t ring_slots;
+
+  /** where the writer formats the arguments of LOG() */
+  std::array<char, 1024> text;
+
+  /** writes everything queued, returns false if there was nothing */
+  bool drain() {
+    std::vector<std::shared_ptr<Thread_ring>> current;
+    {
+      std::lock_guard<std::mutex> const lock{rings_mutex};
+      // rings only referenced by us belong to threads which have exited
+      rings.erase(std::remove_if(std::begin(rings), std::end(rings),
+                                 [](std::shared_ptr<Thread_ring> const &r) {
+                                   return r.use_count() == 1 &&
+                                          r->records.empty();
+                                 }),
+                  std::end(rings));
+      current = rings;
+    }
+    auto wrote = false;
+    for (auto const &ring : current) {
+      Log_record *record = nullptr;
+      while ((record = ring->records.front()) != nullptr) {
+        if (record->overflow != nullptr) {
+          write_record(record->priority, record->overflow.get());
+          record->overflow.reset();
+        } else if (record->formatter == nullptr) {
+          write_record(record->priority, record->payload.data());
+        } else {
+          record->formatter(text.data(), text.size(), record->format,
+                            record->payload.data());
+          write_record(record->priority, text.data());
+        }
+        ring->records.pop();
+        wrote = true;
+      }
+      auto const dropped = ring->dropped.exchange(0);
+      if (dropped > 0) {
+        dropped_total += dropped;
+        auto const message = "dropped " + std::to_string(dropped) +
+                             " log messages, the log ring was full";
+        write_record(LOG_WARNING, message.c_str());
+        wrote = true;
+      }
+    }
+    if (wrote && logger == nullptr) {
+      std::fflush(stdout);
+    }
+    return wrote;
+  }
+
+  bool any_queued() {
+    std::lock_guard<std::mutex> const lock{rings_mutex};
+    return std::any_of(std::begin(rings), std::end(rings),
+                       [](std::shared_ptr<Thread_ring> const &r) {
+                         return !r->records.empty() || r->dropped > 0;
+                       });
+  }
+
+  void wait_for_records() {
+    writer_waiting = true;
+    // a producer may have logged before it could see writer_waiting
+    if ((!held && any_queued()) || !running) {
+      writer_waiting = false;
+      return;
+    }
+    static auto const max_sleep_ms = 1000;
+    pollfd pfd{wakeup, POLLIN, 0};
+    if (poll(&pfd, 1, max_sleep_ms) > 0) {
+      uint64_t count;
+      if (::read(wakeup, &count, sizeof(count)) < 0) {
+        count = 0;
+      }
+    }
+    writer_waiting = false;
+  }
+
+  void writer_main() {
+    auto next_suppressed = std::chrono::steady_clock::now();
+    while (running) {
+      if (held || !drain()) {
+        wait_for_records();
+      }
+      // messages rate limited at the end of a storm are reported here
+      auto const now = std::chrono::steady_clock::now();
+      if (!held && now >= next_suppressed) {
+        log_suppressed(true);
+        next_suppressed = now + std::chrono::seconds{1};
+      }
+    }
+    drain();
+  }
+
+public:
+  Async_logger()
+      : wakeup{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}, rings_mutex{}, rings{},
+        writer{}, running{false}, writer_waiting{false}, held{false},
+        dropped_total{0},
+        ring_slots{0}, text{} {}
+
+  Async_logger(Async_logger const &) = delete;
+  Async_logger(Async_logger &&) = delete;
+
+  ~Async_logger() { stop(); }
+
+  Async_logger &operator=(Async_logger const &) = delete;
+  Async_logger &operator=(Async_logger &&) = delete;
+
+  void start(size_t const slots) {
+    stop();
+    ring_slots = slots;
+    running = true;
+    writer = std::thread{[this]() { writer_main(); }};
+  }
+
+  void stop() {
+    if (writer.joinable()) {
+      running = false;
+      wake();
+      writer.join();
+    }
+  }
+
+  void wake() {
+    uint64_t const one = 1;
+    if (::write(wakeup, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      std::perror("waking the log writer failed");
+    }
+  }
+
+  /** the ring of the calling thread, created on first use */
+  Thread_ring &thread_ring() {
+    thread_local std::shared_ptr<Thread_ring> ring;
+    if (!ring || ring->records.capacity() < ring_slots) {
+      ring = std::make_shared<Thread_ring>(ring_slots);
+      std::lock_guard<std::mutex> const lock{rings_mutex};
+      rings.push_back(ring);
+    }
+    return *ring;
+  }
+
+  /** the payload of the next free record, nullptr if the ring is full */
+  Log_record *claim() {
+    auto &ring = thread_ring();
+    auto *const record = ring.records.claim();
+    if (record == nullptr) {
+      ++ring.dropped;
+    }
+    return record;
+  }
+
+  void publish(int const priority, char const *const format,
+               log_detail::Formatter const formatter,
+               std::unique_ptr<char[]> overflow = nullptr) {
+    auto &records = thread_ring().records;
+    auto *const record = records.claim();
+    if (record == nullptr) {
+      return;
+    }
+    record->priority = priority;
+    record->format = format;
+    record->formatter = formatter;
+    record->overflow = std::move(overflow);
+    records.publish();
+    if (writer_waiting.exchange(false)) {
+      wake();
+    }
+  }
+
+  void flush() {
+    while (running && any_queued()) {
+      wake();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  uint64_t dropped() const { return dropped_total; }
+
+  void hold(bool const on) {
+    held = on;
+    wake();
+  }
+};
+
+Async_logger &async_logger() {
+  static Async_logger instance;
+  return instance;
+}
+
+void vlog(int const priority, char const *const format, va_list args) {
+  if (priority > log_detail::level.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (log_detail::async_enabled) {
+    char *payload = nullptr;
+    char *end = nullptr;
+    if (!log_detail::claim_record(payload, end)) {
+      return;
+    }
+    auto const size = static_cast<size_t>(end - payload);
+    va_list again;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+    va_copy(again, args);
+    auto const length = std::vsnprintf(payload, size, format, args);
+    if (length >= 0 && static_cast<size_t>(length) >= size) {
+      std::unique_ptr<char[]> text{new char[static_cast<size_t>(length) + 1]};
+      std::vsnprintf(text.get(), static_cast<size_t>(length) + 1, format,
+                     again);
+      log_detail::publish_overflow(priority, std::move(text));
+    } else {
+      log_detail::publish_record(priority, format, nullptr);
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+    va_end(again);
+    return;
+  }
+  static std::mutex log_mutex;
+  std::lock_guard<std::mutex> const lg(log_mutex);
+  if (logger == nullptr) {
+    std::vprintf(format, args);
+    std::printf("\n");
+  } else {
+    vsyslog(priority, format, args);
+  }
+}
 } // namespace
 
+namespace log_detail {
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic<int> level{LOG_DEBUG};
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic_bool async_enabled{false};
+
+void log_unchecked(int const priority, char const *const format, ...) {
+  va_list args;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  va_start(args, format);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  vlog(priority, format, args);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  va_end(args);
+}
+
+int format_unchecked(char *const out, size_t const size,
+                     char const *const format, ...) {
+  va_list args;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  va_start(args, format);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  auto const length = std::vsnprintf(out, size, format, args);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  va_end(args);
+  return length;
+}
+
+bool claim_record(char *&payload, char *&end) {
+  auto *const record = async_logger().claim();
+  if (record == nullptr) {
+    return false;
+  }
+  payload = record->payload.data();
+  end = payload + record->payload.size();
+  return true;
+}
+
+void publish_record(int const priority, char const *const format,
+                    Formatter const formatter) {
+  async_logger().publish(priority, format, formatter);
+}
+
+void publish_overflow(int const priority, std::unique_ptr<char[]> text) {
+  async_logger().publish(priority, nullptr, nullptr, std::move(text));
+}
+
+void hold_writer(bool const held) { async_logger().hold(held); }
+} // namespace log_detail
+
 void setup_log(const std::string &ident, int option, int facility) {
   logger = nullptr;
   logger = std::make_unique<Syslog>(ident, option, facility);
 }
 
+void start_async_log(size_t const ring_slots) {
+  async_logger().start(ring_slots);
+  log_detail::async_enabled = true;
+}
+
+void stop_async_log() {
+  log_suppressed();
+  log_detail::async_enabled = false;
+  async_logger().stop();
+}
+
+void flush_log() {
+  if (log_detail::async_enabled) {
+    async_logger().flush();
+  }
+}
+
+uint64_t dropped_log_messages() { return async_logger().dropped(); }
+
+void set_log_level(int const level) { log_detail::level = level; }
+
+int get_log_level() { return log_detail::level; }
+
+int parse_log_level(std::string const &level) {
+  static std::array<char const *, 8> const names{
+      {"emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"}};
+  for (auto i = size_t{0}; i < names.size(); ++i) {
+    if (level == names.at(i) || level == std::to_string(i)) {
+      return static_cast<int>(i);
+    }
+  }
+  throw std::runtime_error("unknown log level: " + level);
+}
+
+Log_rate_limit::Log_rate_limit(unsigned int const burst,
+                               unsigned int const per_second,
+                               int const priority_, char const *const format_)
+    : priority{priority_}, format{format_},
+      interval_ns{std::chrono::nanoseconds{std::chrono::seconds{1}}.count() /
+                  std::max(per_second, 1U)},
+      burst_ns{interval_ns * std::max(burst, 1U)}, full_at{0}, dropped{0} {
+  auto &registry = rate_limits();
+  std::lock_guard<std::mutex> const lock{registry.mutex};
+  registry.limits.push_back(this);
+}
+
+Log_rate_limit::~Log_rate_limit() {
+  auto &registry = rate_limits();
+  std::lock_guard<std::mutex> const lock{registry.mutex};
+  registry.limits.erase(std::remove(std::begin(registry.limits),
+                                    std::end(registry.limits), this),
+                        std::end(registry.limits));
+}
+
+int64_t Log_rate_limit::to_ns(Clock::time_point const time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+bool Log_rate_limit::allow(uint64_t &suppressed,
+                           Clock::time_point const now) {
+  // generic cell rate algorithm: each message moves full_at by one interval,
+  // a message passes if the bucket is not more than burst intervals away
+  // from being full
+  auto const now_ns = to_ns(now);
+  auto expected = full_at.load(std::memory_order_relaxed);
+  auto next = int64_t{0};
+  do {
+    auto const start = std::max(expected, now_ns);
+    if (start - now_ns + interval_ns > burst_ns) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    next = start + interval_ns;
+  } while (!full_at.compare_exchange_weak(expected, next,
+                                          std::memory_order_relaxed));
+  suppressed = dropped.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t Log_rate_limit::take_suppressed(bool const only_idle,
+                                         Clock::time_point const now) {
+  auto const now_ns = to_ns(now);
+  auto const start = std::max(full_at.load(std::memory_order_relaxed), now_ns);
+  if (only_idle && start - now_ns + interval_ns > burst_ns) {
+    return 0;
+  }
+  return dropped.exchange(0, std::memory_order_relaxed);
+}
+
+void log_suppressed(bool const only_idle) {
+  struct Suppressed {
+    int priority;
+    char const *format;
+    uint64_t count;
+  };
+  std::vector<Suppressed> pending;
+  {
+    auto &registry = rate_limits();
+    std::lock_guard<std::mutex> const lock{registry.mutex};
+    for (auto const limit : registry.limits) {
+      auto const count = limit->take_suppressed(only_idle);
+      if (count > 0) {
+        pending.push_back({limit->priority, limit->format, count});
+      }
+    }
+  }
+  for (auto const &s : pending) {
+    LOG(s.priority, "suppressed %" PRIu64 " similar messages: %s", s.count,
+        s.format);
+  }
+}
+
 void log_string(int priority, char const *const t) { log(priority, "%s", t); }
 
 template <> void log_string<std::string>(const int priority, std::string &&t) {
@@ -51,19 +518,11 @@ template <> void log_string<std::string>(const int priority, std::string &&t) {
 }
 
 void log(const int priority, const char *format, ...) {
-  static std::mutex log_mutex;
-  std::lock_guard<std::mutex> const lg(log_mutex);
   va_list args;
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
   va_start(args, format);
-  if (logger == nullptr) {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
-    std::vprintf(format, args);
-    std::printf("\n");
-  } else {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
-    vsyslog(priority, format, args);
-  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  vlog(priority, format, args);
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
   va_end(args);
 }
@@ -0,0 +1,317 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "metrics.h"
+#include "log.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+/** escapes a label value as OpenMetrics requires */
+std::string escape(std::string const &value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (auto const c : value) {
+    switch (c) {
+    case '\\':
+      escaped += "\\\\";
+      break;
+    case '"':
+      escaped += "\\\"";
+      break;
+    case '\n':
+      escaped += "\\n";
+      break;
+    default:
+      escaped += c;
+      break;
+    }
+  }
+  return escaped;
+}
+
+/** {name="value",...} or an empty string for no labels */
+std::string render_labels(Metric_labels const &labels) {
+  if (labels.empty()) {
+    return "";
+  }
+  std::string rendered{"{"};
+  for (auto const &label : labels) {
+    if (rendered.size() > 1) {
+      rendered += ',';
+    }
+    rendered += label.first + "=\"" + escape(label.second) + '"';
+  }
+  return rendered + '}';
+}
+
+char const *type_name(Metrics::Type const type) {
+  switch (type) {
+  case Metrics::Type::counter:
+    return "counter";
+  case Metrics::Type::gauge:
+    return "gauge";
+  case Metrics::Type::stateset:
+    return "stateset";
+  default:
+    return "unknown";
+  }
+}
+
+void write_counter(std::ostream &out, std::string const &series,
+                   uint64_t const value, uint64_t const divisor) {
+  out << series << ' ';
+  if (divisor == 1) {
+    out << value << '\n';
+  } else {
+    out << static_cast<double>(value) / static_cast<double>(divisor) << '\n';
+  }
+}
+
+auto const client_timeout = std::chrono::milliseconds{1000};
+} // namespace
+
+Counter::Counter() : shards{} {}
+
+void *Counter::operator new(size_t const size) {
+  // aligned_alloc() wants a multiple of the alignment
+  auto const alignment = alignof(Counter);
+  auto *const counter =
+      aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+  if (counter == nullptr) {
+    throw std::bad_alloc{};
+  }
+  return counter;
+}
+
+void Counter::operator delete(void *const counter) {
+  // NOLINTNEXTLINE(cppcoreguidelines-no-malloc)
+  free(counter);
+}
+
+uint64_t Counter::value() const {
+  auto sum = uint64_t{0};
+  for (auto const &shard : shards) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+Unsharded_counter::Unsharded_counter() : total{0} {}
+
+Gauge::Gauge() : current{0} {}
+
+Metrics::Metrics() : mutex{}, families{} {}
+
+Metrics::Family &Metrics::family(std::string const &name, Type const type,
+                                 std::string const &help,
+                                 uint64_t const divisor) {
+  auto const it = families.find(name);
+  if (it == std::end(families)) {
+    return families
+        .emplace(name, Family{type, help, divisor, {}, {}, {}})
+        .first->second;
+  }
+  if (it->second.type != type) {
+    throw std::runtime_error("metric " + name + " has another type");
+  }
+  return it->second;
+}
+
+Counter &Metrics::counter(std::string const &name, std::string const &help,
+                          Metric_labels const &labels,
+                          uint64_t const divisor) {
+  std::lock_guard<std::mutex> const lock{mutex};
+  auto &counter = family(name, Type::counter, help, divisor)
+                      .counters[render_labels(labels)];
+  if (counter == nullptr) {
+    counter = std::make_unique<Counter>();
+  }
+  return *counter;
+}
+
+Unsharded_counter &Metrics::unsharded_counter(std::string const &name,
+                                              std::string const &help,
+                                              Metric_labels const &labels,
+                                              uint64_t const divisor) {
+  std::lock_guard<std::mutex> const lock{mutex};
+  auto &counter = family(name, Type::counter, help, divisor)
+                      .unsharded_counters[render_labels(labels)];
+  if (counter == nullptr) {
+    counter = std::make_unique<Unsharded_counter>();
+  }
+  return *counter;
+}
+
+Gauge &Metrics::gauge(std::string const &name, std::string const &help,
+                      Metric_labels const &labels) {
+  std::lock_guard<std::mutex> const lock{mutex};
+  auto &gauge =
+      family(name, Type::gauge, help, 1).gauges[render_labels(labels)];
+  if (gauge == nullptr) {
+    gauge = std::make_unique<Gauge>();
+  }
+  return *gauge;
+}
+
+Gauge &Metrics::state(std::string const &name, std::string const &help,
+                      Metric_labels const &labels, std::string const &state) {
+  auto state_labels = labels;
+  state_labels.emplace_back(name, state);
+  std::lock_guard<std::mutex> const lock{mutex};
+  auto &gauge = family(name, Type::stateset, help, 1)
+                    .gauges[render_labels(state_labels)];
+  if (gauge == nullptr) {
+    gauge = std::make_unique<Gauge>();
+  }
+  return *gauge;
+}
+
+void Metrics::write(std::ostream &out) const {
+  std::lock_guard<std::mutex> const lock{mutex};
+  for (auto const &entry : families) {
+    auto const &name = entry.first;
+    auto const &f = entry.second;
+    out << "# TYPE " << name << ' ' << type_name(f.type) << '\n';
+    out << "# HELP " << name << ' ' << f.help << '\n';
+    for (auto const &counter : f.counters) {
+      write_counter(out, name + "_total" + counter.first,
+                    counter.second->value(), f.divisor);
+    }
+    for (auto const &counter : f.unsharded_counters) {
+      write_counter(out, name + "_total" + counter.first,
+                    counter.second->value(), f.divisor);
+    }
+    for (auto const &gauge : f.gauges) {
+      out << name << gauge.first << ' ' << gauge.second->value() << '\n';
+    }
+  }
+  out << "# EOF\n";
+}
+
+Metrics &metrics() {
+  static Metrics instance;
+  return instance;
+}
+
+Metrics_server::Metrics_server(std::string socket_path)
+    : path{std::move(socket_path)},
+      listener{socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)},
+      loop{}, clients{}, thread{} {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error("metrics socket path too long: " + path);
+  }
+  std::copy(std::begin(path), std::end(path), std::begin(addr.sun_path));
+  unlink(path.c_str());
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (bind(listener, reinterpret_cast<sockaddr const *>(&addr),
+           sizeof(addr)) != 0) {
+    throw errno_error("bind(" + path + ")");
+  }
+  static auto const backlog = 16;
+  if (listen(listener, backlog) != 0) {
+    throw errno_error("listen(" + path + ")");
+  }
+  loop.add_fd(listener, [this]() { accept_clients(); });
+  thread = std::thread{[this]() { loop.run(); }};
+  LOG(LOG_INFO, "serving metrics on %s", path.c_str());
+}
+
+Metrics_server::~Metrics_server() {
+  loop.post([this]() {
+    for (auto const &client : clients) {
+      loop.remove_fd(client.first);
+    }
+    clients.clear();
+    loop.stop();
+  });
+  thread.join();
+  unlink(path.c_str());
+}
+
+void Metrics_server::accept_clients() {
+  while (true) {
+    int const fd =
+        accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EINTR) {
+        LOG(LOG_ERR, "accepting a metrics client failed: %s",
+            strerror(errno));
+      }
+      return;
+    }
+    File_descriptor client{fd};
+    auto const timeout =
+        loop.add_timer(client_timeout, [this, fd]() { respond(fd, false); });
+    clients.emplace(fd, Client{std::move(client), timeout});
+    loop.add_fd(fd, [this, fd]() { read_request(fd); });
+  }
+}
+
+void Metrics_server::read_request(int const fd) {
+  static auto const get_size = size_t{3};
+  std::array<char, 256> request{};
+  auto const n = recv(fd, request.data(), request.size(), 0);
+  if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+  auto const http = n >= static_cast<ssize_t>(get_size) &&
+                    std::string(request.data(), get_size) == "GET";
+  // the rest of a HTTP request does not matter, we only serve metrics
+  respond(fd, http);
+}
+
+void Metrics_server::respond(int const fd, bool const http) {
+  auto const it = clients.find(fd);
+  if (it == std::end(clients)) {
+    return;
+  }
+  auto const client = std::move(it->second);
+  clients.erase(it);
+  loop.remove_fd(fd);
+  loop.cancel_timer(client.timeout);
+  std::ostringstream body;
+  metrics().write(body);
+  std::string response;
+  if (http) {
+    response = "HTTP/1.0 200 OK\r\n"
+               "Content-Type: application/openmetrics-text; version=1.0.0; "
+               "charset=utf-8\r\n"
+               "Content-Length: " +
+               std::to_string(body.tellp()) + "\r\n\r\n";
+  }
+  response += body.str();
+  // a slow client may block this thread, never the capture threads
+  fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL) & ~O_NONBLOCK);
+  static timeval const send_timeout{1, 0};
+  setsockopt(client.fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout,
+             sizeof(send_timeout));
+  try {
+    write_all(client.fd, response.data(), response.size());
+  } catch (std::exception const &e) {
+    LOG(LOG_WARNING, "sending metrics failed: %s", e.what());
+  }
+}
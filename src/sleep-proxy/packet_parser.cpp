@@ -16,6 +16,7 @@
 
 #include "packet_parser.h"
 #include "log.h"
+#include "usdt.h"
 #include <iterator>
 
 template <typename T> void print_if_not_nullptr(std::ostream &out, T &&ptr) {
@@ -38,7 +39,8 @@ basic_headers get_headers(const int type, const std::vector<u_char> &packet) {
   // link layer header
   std::unique_ptr<Link_layer> ll = parse_link_layer(type, data, end);
   if (ll == nullptr) {
-    log(LOG_ERR, "unsupported link layer protocol: %i", type);
+    LOG_RATE_LIMITED(LOG_ERR, "unsupported link layer protocol: %i", type);
+    SLEEP_PROXY_PROBE3(headers, type, 0, 0);
     return std::make_tuple(std::unique_ptr<Link_layer>(nullptr),
                            std::unique_ptr<ip>(nullptr));
   }
@@ -55,8 +57,11 @@ basic_headers get_headers(const int type, const std::vector<u_char> &packet) {
 
   // IP header
   std::unique_ptr<ip> ipp = parse_ip(payload_type, data, end);
+  SLEEP_PROXY_PROBE3(headers, type, payload_type,
+                     ipp == nullptr ? 0 : ipp->version());
   if (ipp == nullptr) {
-    log(LOG_ERR, "unsupported link layer payload: %u", payload_type);
+    LOG_RATE_LIMITED(LOG_ERR, "unsupported link layer payload: %u",
+                     payload_type);
     return std::make_tuple(std::move(ll), std::unique_ptr<ip>(nullptr));
   }
   std::advance(data, ipp->header_length());
@@ -65,23 +70,25 @@ basic_headers get_headers(const int type, const std::vector<u_char> &packet) {
 }
 
 Catch_incoming_connection::Catch_incoming_connection(const int link_layer_typee)
-    : link_layer_type(link_layer_typee), headers{}, data{} {}
+    : link_layer_type(link_layer_typee), headers{}, data{}, received{} {}
 
 void Catch_incoming_connection::operator()(const pcap_pkthdr *header,
                                            const u_char *packet) {
   if (header == nullptr || packet == nullptr) {
-    log_string(LOG_ERR, "header or packet are nullptr");
+    LOG(LOG_ERR, "header or packet are nullptr");
     return;
   }
+  received = std::chrono::steady_clock::now();
   try {
     const auto *end_iter = packet;
-    std::advance(end_iter, header->len);
+    // len is the size on the wire, only caplen bytes have been captured
+    std::advance(end_iter, header->caplen);
     data = std::vector<uint8_t>(packet, end_iter);
     headers = get_headers(link_layer_type, data);
   } catch (std::exception const &e) {
-    log_string(LOG_ERR,
-               std::string("Catch_incoming_connection caught an exception: ") +
-                   e.what());
+    LOG_RATE_LIMITED(LOG_ERR,
+                     "Catch_incoming_connection caught an exception: %s",
+                     e.what());
     data = std::vector<uint8_t>();
     headers = basic_headers();
   }
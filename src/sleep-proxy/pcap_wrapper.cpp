@@ -18,6 +18,9 @@
 
 #include "log.h"
 #include "to_string.h"
+#include "usdt.h"
+#include <algorithm>
+#include <chrono>
 #include <mutex>
 #include <pthread.h>
 #include <stdexcept>
@@ -32,6 +35,7 @@ void callback_wrapper(u_char *args, const struct pcap_pkthdr *header,
                       const u_char *packet) {
   // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
   auto *const cb = reinterpret_cast<Pcap_wrapper::Callback_t *>(args);
+  SLEEP_PROXY_PROBE2(packet, header->caplen, header->len);
   (*cb)(header, packet);
 }
 
@@ -45,29 +49,38 @@ create_loop(int &ret_val) {
   };
   return loop_f;
 }
-} // namespace
 
-/** provides a bpf_programm instance in an exception safe way */
-struct BPF {
-  bpf_program bpf;
-  BPF(std::unique_ptr<pcap_t, void (*)(pcap_t *)> &pc,
-      const std::string &filter)
-      : bpf{0, nullptr} {
-    // pcap_compile is not thread safe
-    // see http://seclists.org/tcpdump/2012/q2/22
-    static std::mutex pcap_compile_mutex;
-    std::lock_guard<std::mutex> const lock(pcap_compile_mutex);
-    if (pcap_compile(pc.get(), &bpf, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) ==
-        -1) {
-      throw std::runtime_error("Can't compile bpf filter " + filter);
+/** delays each packet until as much time passed as between the recorded */
+Pcap_wrapper::Callback_t pace_like_recorded(Pcap_wrapper::Callback_t cb) {
+  using namespace std::chrono;
+  return [cb, start = steady_clock::time_point{}, first = microseconds{}](
+             const struct pcap_pkthdr *header, const u_char *packet) mutable {
+    auto const recorded =
+        seconds{header->ts.tv_sec} + microseconds{header->ts.tv_usec};
+    if (start == steady_clock::time_point{}) {
+      start = steady_clock::now();
+      first = recorded;
     }
+    std::this_thread::sleep_until(start + (recorded - first));
+    cb(header, packet);
+  };
+}
+} // namespace
+
+BPF::BPF(std::unique_ptr<pcap_t, void (*)(pcap_t *)> &pc,
+         const std::string &filter)
+    : bpf{0, nullptr} {
+  // pcap_compile is not thread safe
+  // see http://seclists.org/tcpdump/2012/q2/22
+  static std::mutex pcap_compile_mutex;
+  std::lock_guard<std::mutex> const lock(pcap_compile_mutex);
+  if (pcap_compile(pc.get(), &bpf, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) ==
+      -1) {
+    throw std::runtime_error("Can't compile bpf filter " + filter);
   }
-  BPF(BPF const &) = delete;
-  BPF(BPF &&) = delete;
-  ~BPF() { pcap_freecode(&bpf); }
-  BPF &operator=(BPF const &) = delete;
-  BPF &operator=(BPF &&) = delete;
-};
+}
+
+BPF::~BPF() { pcap_freecode(&bpf); }
 
 Pcap_wrapper::Pcap_wrapper()
     : pc(nullptr, pcap_close), loop_thread{},
@@ -79,7 +92,8 @@ Pcap_wrapper::Loop_end_reason Pcap_wrapper::get_end_reason() const {
 }
 
 Pcap_wrapper::Pcap_wrapper(const std::string &iface, const int snaplen,
-                           const bool promisc, const int timeout)
+                           const bool promisc, const int timeout,
+                           const int buffer_size)
     : pc(pcap_create(iface.c_str(), errbuf.data()), pcap_close), loop_thread{},
       loop_end_reson_mutex{std::make_unique<std::mutex>()} {
   if (pc == nullptr) {
@@ -98,11 +112,37 @@ Pcap_wrapper::Pcap_wrapper(const std::string &iface, const int snaplen,
     throw std::runtime_error("interface: " + iface +
                              " can't deactivate timeout");
   }
+  if (buffer_size != 0 && pcap_set_buffer_size(pc.get(), buffer_size) != 0) {
+    throw std::runtime_error("interface: " + iface +
+                             " can't set buffer size: " +
+                             to_string(buffer_size));
+  }
   if (pcap_activate(pc.get()) == -1) {
     throw std::runtime_error("interface: " + iface +
                              " can't activate selected interface: " + iface);
   }
-  log_string(LOG_INFO, "datalink " + get_verbose_datalink());
+  LOG(LOG_INFO, "datalink %s", get_verbose_datalink().c_str());
+  count_in_metrics_of(iface);
+}
+
+Pcap_wrapper::Pcap_wrapper(Offline const &file)
+    : pc(pcap_open_offline(file.path.c_str(), errbuf.data()), pcap_close),
+      loop_thread{}, loop_end_reson_mutex{std::make_unique<std::mutex>()},
+      realtime{file.realtime} {
+  if (pc == nullptr) {
+    throw std::runtime_error(errbuf.data());
+  }
+  LOG(LOG_INFO, "reading %s, datalink %s", file.path.c_str(),
+      get_verbose_datalink().c_str());
+}
+
+void Pcap_wrapper::count_in_metrics_of(std::string const &iface) {
+  Metric_labels const labels{{"iface", iface}};
+  packets_seen = &metrics().counter(
+      "sleep_proxy_captured_packets", "packets received by captures", labels);
+  kernel_drops = &metrics().counter(
+      "sleep_proxy_kernel_drops",
+      "packets dropped by the kernel because a capture was too slow", labels);
 }
 
 Pcap_wrapper::~Pcap_wrapper() = default;
@@ -140,9 +180,25 @@ Pcap_wrapper::Loop_end_reason Pcap_wrapper::loop(const int count,
   auto ret_val = int{1};
   auto loop_f = create_loop(ret_val);
 
+  if (packets_seen != nullptr) {
+    cb = [this, cb](const struct pcap_pkthdr *header, const u_char *packet) {
+      packets_seen->inc();
+      cb(header, packet);
+    };
+  }
+  if (realtime) {
+    cb = pace_like_recorded(std::move(cb));
+  }
   loop_thread = std::thread{loop_f, pc.get(), count, std::move(cb)};
   loop_thread.join();
 
+  pcap_stat stats{};
+  if (kernel_drops != nullptr && pcap_stats(pc.get(), &stats) == 0) {
+    // the statistics count since the handle has been opened
+    kernel_drops->inc(stats.ps_drop - reported_drops);
+    reported_drops = stats.ps_drop;
+  }
+
   std::lock_guard<std::mutex> const lock{*loop_end_reson_mutex};
   switch (ret_val) {
   case 0:
@@ -158,6 +214,29 @@ Pcap_wrapper::Loop_end_reason Pcap_wrapper::loop(const int count,
   return loop_end_reason;
 }
 
+int Pcap_wrapper::dispatch(int const count, Callback_t cb) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto *const args = reinterpret_cast<u_char *>(&cb);
+  auto const packets = pcap_dispatch(pc.get(), count, callback_wrapper, args);
+  if (packets == PCAP_ERROR) {
+    throw std::runtime_error(std::string("error while capturing data: ") +
+                             pcap_geterr(pc.get()));
+  }
+  if (packets_seen != nullptr && packets > 0) {
+    packets_seen->inc(static_cast<uint64_t>(packets));
+  }
+  return std::max(packets, 0);
+}
+
+pcap_stat Pcap_wrapper::stats() const {
+  pcap_stat stats{};
+  if (pcap_stats(pc.get(), &stats) != 0) {
+    throw std::runtime_error(std::string("pcap_stats() failed: ") +
+                             pcap_geterr(pc.get()));
+  }
+  return stats;
+}
+
 void Pcap_wrapper::break_loop(const Loop_end_reason &ler) {
   {
     std::lock_guard<std::mutex> const lock{*loop_end_reson_mutex};
@@ -0,0 +1,120 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pcapng_writer.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+auto const section_header_block = uint32_t{0x0a0d0d0a};
+auto const byte_order_magic = uint32_t{0x1a2b3c4d};
+auto const interface_description_block = uint32_t{1};
+auto const enhanced_packet_block = uint32_t{6};
+
+/** blocks are padded to 32 bits */
+uint32_t padded(uint32_t const size) { return (size + 3U) & ~3U; }
+} // namespace
+
+Pcapng_writer::Pcapng_writer(std::string pathh, int const link_typee,
+                             uint32_t const snaplenn,
+                             uint64_t const max_bytess,
+                             unsigned int const max_filess)
+    : path{std::move(pathh)}, link_type{link_typee}, snaplen{snaplenn},
+      max_bytes{max_bytess}, max_files{max_filess}, file{nullptr, fclose},
+      written{0}, file_number{0} {
+  open_next();
+}
+
+std::string Pcapng_writer::file_name(unsigned int const n) const {
+  if (max_bytes == 0) {
+    return path;
+  }
+  return path + '.' + std::to_string(max_files == 0 ? n : n % max_files);
+}
+
+void Pcapng_writer::write_bytes(void const *const data, size_t const size) {
+  if (fwrite(data, 1, size, file.get()) != size) {
+    throw std::runtime_error("can't write " + file_name(file_number) + ": " +
+                             strerror(errno));
+  }
+  written += size;
+}
+
+void Pcapng_writer::open_next() {
+  if (file != nullptr) {
+    ++file_number;
+  }
+  auto const name = file_name(file_number);
+  file.reset(fopen(name.c_str(), "wb"));
+  if (file == nullptr) {
+    throw std::runtime_error("can't open " + name + ": " + strerror(errno));
+  }
+  // large writes, the disk should not see every packet
+  static auto const buffer_size = size_t{1} << 20U;
+  setvbuf(file.get(), nullptr, _IOFBF, buffer_size);
+  written = 0;
+
+  auto const shb_length = uint32_t{28};
+  // section length unknown
+  auto const section_length = int64_t{-1};
+  std::array<uint32_t, 3> const shb_start{
+      {section_header_block, shb_length, byte_order_magic}};
+  std::array<uint16_t, 2> const version{{1, 0}};
+  write_bytes(shb_start.data(), sizeof(shb_start));
+  write_bytes(version.data(), sizeof(version));
+  write_bytes(&section_length, sizeof(section_length));
+  write_bytes(&shb_length, sizeof(shb_length));
+
+  auto const idb_length = uint32_t{20};
+  std::array<uint32_t, 2> const idb_start{
+      {interface_description_block, idb_length}};
+  std::array<uint16_t, 2> const link{{static_cast<uint16_t>(link_type), 0}};
+  write_bytes(idb_start.data(), sizeof(idb_start));
+  write_bytes(link.data(), sizeof(link));
+  write_bytes(&snaplen, sizeof(snaplen));
+  write_bytes(&idb_length, sizeof(idb_length));
+}
+
+void Pcapng_writer::write(pcap_pkthdr const &header, uint8_t const *data) {
+  auto const length = padded(32 + header.caplen);
+  if (max_bytes != 0 && written + length > max_bytes && written > 0) {
+    open_next();
+  }
+  // microseconds since the epoch, the default resolution
+  auto const timestamp =
+      static_cast<uint64_t>(header.ts.tv_sec) * 1000000U +
+      static_cast<uint64_t>(header.ts.tv_usec);
+  std::array<uint32_t, 7> const epb{{enhanced_packet_block, length, 0,
+                                     static_cast<uint32_t>(timestamp >> 32U),
+                                     static_cast<uint32_t>(timestamp),
+                                     header.caplen, header.len}};
+  write_bytes(epb.data(), sizeof(epb));
+  write_bytes(data, header.caplen);
+  static std::array<uint8_t, 3> const padding{{0, 0, 0}};
+  write_bytes(padding.data(), length - 32 - header.caplen);
+  write_bytes(&length, sizeof(length));
+}
+
+void Pcapng_writer::flush() {
+  if (fflush(file.get()) != 0) {
+    throw std::runtime_error("can't write " + file_name(file_number) + ": " +
+                             strerror(errno));
+  }
+}
@@ -0,0 +1,325 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "process_runner.h"
+#include "log.h"
+#include "metrics.h"
+#include "spawn_process.h"
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+constexpr Process_runner::Duration Process_runner::default_timeout;
+constexpr Process_runner::Duration Process_runner::kill_grace;
+
+namespace {
+/** how often children are polled without pidfd support */
+auto const waitpid_interval = std::chrono::milliseconds{10};
+
+int pidfd_open(pid_t const pid) {
+#ifdef __NR_pidfd_open
+  return static_cast<int>(syscall(__NR_pidfd_open, pid, 0));
+#else
+  (void)pid;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/** counts the finished command program, e.g. "iptables" */
+void count_in_metrics(std::string const &program,
+                      Event_loop::Clock::duration const duration,
+                      bool const timed_out) {
+  Metric_labels const labels{{"program", program}};
+  auto &m = metrics();
+  m.counter("sleep_proxy_processes", "commands run", labels).inc();
+  m.counter("sleep_proxy_process_seconds", "time commands took to finish",
+            labels, Metrics::ns_per_s)
+      .inc(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+              .count()));
+  if (timed_out) {
+    m.counter("sleep_proxy_process_timeouts", "commands which were killed",
+              labels)
+        .inc();
+  }
+}
+
+template <typename Exception>
+std::exception_ptr make_exception(std::string const &what) {
+  return std::make_exception_ptr(Exception{what});
+}
+
+/** a pipe for the stdout of a child, only the read end is non-blocking */
+std::array<File_descriptor, 2> output_pipe() {
+  auto fds = std::array<int, 2>{};
+  if (pipe2(fds.data(), O_CLOEXEC) != 0) {
+    throw std::runtime_error(std::string("pipe2() failed: ") +
+                             strerror(errno));
+  }
+  std::array<File_descriptor, 2> pipe{
+      {File_descriptor{fds.at(0)}, File_descriptor{fds.at(1)}}};
+  if (fcntl(pipe.at(0), F_SETFL, O_NONBLOCK) != 0) {
+    throw std::runtime_error(std::string("fcntl() failed: ") +
+                             strerror(errno));
+  }
+  return pipe;
+}
+
+/**
+ * reads what an exited child left in the pipe without waiting for EOF, which
+ * a grandchild holding the write end could delay forever
+ */
+void read_remaining(int const fd, Stream_reader &out) {
+  pollfd pfd{fd, POLLIN, 0};
+  while (poll(&pfd, 1, 0) > 0 && out.read_some(fd)) {
+  }
+}
+} // namespace
+
+void Process_runner::Job::set_value(uint8_t const status) {
+  result.set_value(status);
+  complete();
+}
+
+void Process_runner::Job::set_exception(std::exception_ptr const &e) {
+  result.set_exception(e);
+  complete();
+}
+
+void Process_runner::Job::complete() {
+  if (!done) {
+    return;
+  }
+  try {
+    done(result.get_future(), out);
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "completion of %s failed: %s", cmd.at(0), e.what());
+  }
+}
+
+Process_runner::Process_runner(size_t const max_childrenn)
+    : max_children{std::max(size_t{1}, max_childrenn)}, loop{}, children{},
+      pending{}, thread{} {
+  thread = std::thread{[this]() { loop.run(); }};
+}
+
+Process_runner::~Process_runner() {
+  loop.post([this]() {
+    shutdown();
+    loop.stop();
+  });
+  thread.join();
+}
+
+std::future<uint8_t> Process_runner::run(Argv_arena cmd,
+                                        Duration const timeout) {
+  auto const job = std::make_shared<Job>(std::move(cmd), timeout, nullptr);
+  auto result = job->result.get_future();
+  queue(job);
+  return result;
+}
+
+void Process_runner::run(Argv_arena cmd, Duration const timeout,
+                         Completion done) {
+  queue(std::make_shared<Job>(std::move(cmd), timeout, std::move(done)));
+}
+
+uint8_t Process_runner::run_and_wait(Argv_arena &cmd, Duration const timeout) {
+  auto const job = std::make_shared<Job>(std::move(cmd), timeout, nullptr);
+  auto result = job->result.get_future();
+  queue(job);
+  result.wait();
+  cmd = std::move(job->cmd);
+  return result.get();
+}
+
+void Process_runner::queue(std::shared_ptr<Job> const &job) {
+  loop.post([this, job]() {
+    if (children.size() < max_children) {
+      start(job);
+    } else {
+      pending.push_back(job);
+    }
+  });
+}
+
+void Process_runner::start(std::shared_ptr<Job> const &job) {
+  pid_t pid = 0;
+  File_descriptor output{};
+  try {
+    if (job->cmd.empty()) {
+      throw std::out_of_range{"no command given"};
+    }
+    if (job->done) {
+      auto pipe = output_pipe();
+      pid = spawn_child(job->cmd.argv(), File_descriptor{}, pipe.at(1));
+      output = std::move(pipe.at(0));
+    } else {
+      pid = spawn_child(job->cmd.argv(), File_descriptor{}, File_descriptor{});
+    }
+  } catch (std::exception const &) {
+    job->set_exception(std::current_exception());
+    return;
+  }
+
+  auto const deadline =
+      loop.add_timer(job->timeout, [this, pid]() { on_deadline(pid); });
+  auto const &child =
+      children
+          .emplace(pid, Child{job, File_descriptor{pidfd_open(pid)},
+                              std::move(output), deadline})
+          .first->second;
+  // read while the child runs, so it can't block on a full pipe
+  if (child.output >= 0) {
+    loop.add_fd(child.output, [this, pid]() { read_output(pid); });
+  }
+  if (child.pidfd >= 0) {
+    loop.add_fd(child.pidfd, [this, pid]() { reap(pid); });
+  } else {
+    loop.add_timer(waitpid_interval, [this, pid]() { poll_child(pid); });
+  }
+}
+
+void Process_runner::start_pending() {
+  while (!pending.empty() && children.size() < max_children) {
+    auto const job = pending.front();
+    pending.pop_front();
+    start(job);
+  }
+}
+
+void Process_runner::poll_child(pid_t const pid) {
+  reap(pid);
+  if (children.find(pid) != std::end(children)) {
+    loop.add_timer(waitpid_interval, [this, pid]() { poll_child(pid); });
+  }
+}
+
+void Process_runner::read_output(pid_t const pid) {
+  auto const it = children.find(pid);
+  if (it == std::end(children)) {
+    return;
+  }
+  auto &child = it->second;
+  try {
+    if (child.job->out.read_some(child.output)) {
+      return;
+    }
+  } catch (std::exception const &e) {
+    LOG(LOG_WARNING, "reading the output of %s failed: %s",
+        child.job->cmd.at(0), e.what());
+  }
+  loop.remove_fd(child.output);
+  child.output.close();
+}
+
+void Process_runner::reap(pid_t const pid) {
+  auto const it = children.find(pid);
+  if (it == std::end(children)) {
+    return;
+  }
+  int status = 0;
+  auto const rc = waitpid(pid, &status, WNOHANG);
+  if (rc == 0 || (rc < 0 && errno == EINTR)) {
+    return;
+  }
+  auto const wait_error = errno;
+
+  auto child = std::move(it->second);
+  children.erase(it);
+  loop.cancel_timer(child.deadline);
+  if (child.pidfd >= 0) {
+    loop.remove_fd(child.pidfd);
+  }
+  if (child.output >= 0) {
+    loop.remove_fd(child.output);
+    try {
+      read_remaining(child.output, child.job->out);
+    } catch (std::exception const &e) {
+      LOG(LOG_WARNING, "reading the output of %s failed: %s",
+          child.job->cmd.at(0), e.what());
+    }
+  }
+  count_in_metrics(child.job->cmd.at(0),
+                   Event_loop::Clock::now() - child.started, child.timed_out);
+  auto const command = child.job->cmd.to_string();
+  auto &job = *child.job;
+  if (rc < 0) {
+    job.set_exception(make_exception<std::runtime_error>(
+        std::string{"waitpid() failed: "} + strerror(wait_error)));
+  } else if (child.timed_out) {
+    job.set_exception(
+        make_exception<Process_timeout>("command timed out: " + command));
+  } else if (WIFSIGNALED(status)) {
+    // like wait_until_pid_exits() pass SIGINT etc. on to ourself
+    raise(WTERMSIG(status));
+    job.set_exception(make_exception<std::runtime_error>(
+        "command killed by signal " + std::to_string(WTERMSIG(status)) +
+        ": " + command));
+  } else if (WEXITSTATUS(status) == 127) {
+    job.set_exception(make_exception<std::runtime_error>(
+        "failed to spawn process: " + command));
+  } else {
+    job.set_value(static_cast<uint8_t>(WEXITSTATUS(status)));
+  }
+  start_pending();
+}
+
+void Process_runner::on_deadline(pid_t const pid) {
+  auto const it = children.find(pid);
+  if (it == std::end(children)) {
+    return;
+  }
+  auto &child = it->second;
+  // the child is not reaped yet, so pid cannot have been reused
+  if (!child.timed_out) {
+    LOG(LOG_WARNING, "command %s timed out, terminating it",
+        child.job->cmd.at(0));
+    child.timed_out = true;
+    kill(pid, SIGTERM);
+    child.deadline =
+        loop.add_timer(kill_grace, [this, pid]() { on_deadline(pid); });
+  } else {
+    kill(pid, SIGKILL);
+  }
+}
+
+void Process_runner::shutdown() {
+  for (auto &entry : children) {
+    kill(entry.first, SIGKILL);
+    waitpid(entry.first, nullptr, 0);
+    entry.second.job->set_exception(make_exception<std::runtime_error>(
+        "process runner stopped before the command finished"));
+  }
+  children.clear();
+  for (auto const &job : pending) {
+    job->set_exception(make_exception<std::runtime_error>(
+        "process runner stopped before the command started"));
+  }
+  pending.clear();
+}
+
+Process_runner &process_runner() {
+  static Process_runner runner{};
+  return runner;
+}
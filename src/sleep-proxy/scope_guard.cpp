@@ -15,13 +15,14 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "scope_guard.h"
-#include "container_utils.h"
-#include "int_utils.h"
 #include "ip_utils.h"
 #include "log.h"
-#include "spawn_process.h"
+#include "process_runner.h"
+#include "text_writer.h"
 #include "to_string.h"
+#include "usdt.h"
 #include <arpa/inet.h>
+#include <array>
 #include <cerrno>
 
 namespace {
@@ -29,24 +30,26 @@ namespace {
  * ipv4 and ipv6 have different iptables commands. return the one matching
  * the version of ip
  */
-std::string get_iptables_cmd(const IP_address &ip) {
-  std::string iptcmd{ip.family == AF_INET ? "iptables" : "ip6tables"};
-  return iptcmd;
+char const *get_iptables_cmd(const IP_address &ip) {
+  return ip.family == AF_INET ? "iptables" : "ip6tables";
 }
 
-std::string iptables_action(const Action &action) {
-  return action == Action::add ? std::string{"I"} : std::string{"D"};
+char const *iptables_action(const Action &action) {
+  return action == Action::add ? "-I" : "-D";
 }
 
 /**
  * in iptables the icmp parameter is differenct for IPv4 and IPv6. return
  * the correct one according to the ip version
  */
-std::string get_icmp_version(const IP_address &ip) {
+char const *get_icmp_version(const IP_address &ip) {
   return ip.family == AF_INET ? "icmp" : "icmpv6";
 }
 
-std::string ipv6_to_u32_rule(IP_address const &ip) {
+/** the rule has four times "48=0x" and eight hex digits, joined by "&&" */
+using U32_rule = std::array<char, 64>;
+
+U32_rule ipv6_to_u32_rule(IP_address const &ip) {
   if (ip.family != AF_INET6) {
     throw std::runtime_error(
         "cannot convert ipv4 address into u32 ip6tables rule");
@@ -54,23 +57,31 @@ std::string ipv6_to_u32_rule(IP_address const &ip) {
 
   // only up to 9 && are allored in a --u32 rule, do it as 32bit integers
   // from fe80::123
-  // to   -m u32 --u32 48=0xfe800000 && 52=0x0 && 56=0x0 && 60=0x123
+  // to   48=0xfe800000&&52=0x0&&56=0x0&&60=0x123
 
   uint32_t const base = 48;
   uint32_t const step = 4;
-  uint32_t pos = 0;
-  auto const address_int_to_rule = [&](uint32_t ipv6_int) {
-    return to_string(base + step * (pos++)) + "=0x" +
-           uint32_t_to_eight_hex_chars(ipv6_int);
-  };
-  std::vector<uint32_t> const ipv6_address{
-      // NOLINTNEXTLINE
-      std::begin(ip.address.ipv6.s6_addr32),
-      // NOLINTNEXTLINE
-      std::end(ip.address.ipv6.s6_addr32)};
-  std::string const rule = join(ipv6_address, address_int_to_rule, "&&");
-
-  return " -m u32 --u32 " + rule;
+  U32_rule text{};
+  Text_writer rule{text};
+  auto pos = base;
+  // NOLINTNEXTLINE
+  for (auto const ipv6_int : ip.address.ipv6.s6_addr32) {
+    if (pos != base) {
+      rule << "&&";
+    }
+    rule << pos << "=0x";
+    rule.hex(ntohl(ipv6_int), 8);
+    pos += step;
+  }
+  return text;
+}
+
+/** renders the command of functor into a temporary arena and joins it */
+template <typename Functor>
+std::string render(Functor const &functor, const Action action) {
+  Argv_arena argv;
+  functor(action, argv);
+  return argv.to_string();
 }
 } // namespace
 
@@ -96,59 +107,93 @@ void Scope_guard::free() {
 }
 
 void Scope_guard::take_action(const Action a) const {
-  std::string cmd = aquire_release(a);
-  if (!cmd.empty()) {
-    log_string(LOG_INFO, cmd);
-    auto const status = spawn(split(cmd, ' '));
+  // reused, so rendering a command does not allocate in the steady state
+  thread_local Argv_arena argv;
+  argv.clear();
+  aquire_release(a, argv);
+  if (!argv.empty()) {
+    LOG_STRING(LOG_INFO, argv.to_string());
+    // iptables -w can hang on the xtables lock, the runner kills it then
+    auto const start = std::chrono::steady_clock::now();
+    auto const status = process_runner().run_and_wait(argv);
+    SLEEP_PROXY_PROBE4(take_action, argv.argv()[0], a == Action::add,
+                       probe_ns_since(start), status);
     if (status != 0) {
-      throw std::runtime_error("command failed: " + cmd);
+      throw std::runtime_error("command failed: " + argv.to_string());
     }
   }
 }
 
+void Temp_ip::operator()(const Action action, Argv_arena &argv) const {
+  argv << "ip"
+       << "addr" << (action == Action::add ? "add" : "del")
+       << ip.with_subnet_text().c_str() << "dev" << iface;
+}
+
 std::string Temp_ip::operator()(const Action action) const {
-  auto const saction =
-      action == Action::add ? std::string{"add"} : std::string{"del"};
-  return std::string{"ip"} + " addr " + saction + " " + ip.with_subnet() +
-         " dev " + iface;
+  return render(*this, action);
+}
+
+void Drop_port::operator()(const Action action, Argv_arena &argv) const {
+  argv << get_iptables_cmd(ip) << "-w" << iptables_action(action) << "INPUT"
+       << "-d" << ip.pure_text().c_str() << "-p"
+       << "tcp"
+       << "--syn"
+       << "--dport" << port << "-j"
+       << "DROP";
 }
 
 std::string Drop_port::operator()(const Action action) const {
-  const std::string saction{iptables_action(action)};
-  const std::string iptcmd = get_iptables_cmd(ip);
-  const std::string pip = ip.pure();
-  return iptcmd + " -w -" + saction + " INPUT -d " + pip +
-         " -p tcp --syn --dport " + to_string(port) + " -j DROP";
+  return render(*this, action);
+}
+
+void Reject_tp::operator()(const Action action, Argv_arena &argv) const {
+  argv << get_iptables_cmd(ip) << "-w" << iptables_action(action) << "INPUT"
+       << "-d" << ip.pure_text().c_str() << "-p"
+       << (tcp_udp == TP::TCP ? "tcp" : "udp") << "-j"
+       << "REJECT";
 }
 
 std::string Reject_tp::operator()(const Action action) const {
-  const std::string saction{iptables_action(action)};
-  auto const stp = tcp_udp == TP::TCP ? std::string{"tcp"} : std::string{"udp"};
-  const std::string iptcmd = get_iptables_cmd(ip);
-  const std::string pip = ip.pure();
-  return iptcmd + " -w -" + saction + " INPUT -d " + pip + " -p " + stp +
-         " -j REJECT";
+  return render(*this, action);
 }
 
-std::string Block_icmp::operator()(const Action action) const {
-  const std::string saction{iptables_action(action)};
-  const std::string iptcmd = get_iptables_cmd(ip);
-  const std::string icmpv = get_icmp_version(ip);
-  return iptcmd + " -w -" + saction + " OUTPUT -d " + ip.pure() + " -p " +
-         icmpv + " --" + icmpv + "-type destination-unreachable -j DROP";
+void Block_icmp::operator()(const Action action, Argv_arena &argv) const {
+  auto const icmp_type =
+      ip.family == AF_INET ? "--icmp-type" : "--icmpv6-type";
+  argv << get_iptables_cmd(ip) << "-w" << iptables_action(action) << "OUTPUT"
+       << "-d" << ip.pure_text().c_str() << "-p" << get_icmp_version(ip)
+       << icmp_type
+       << "destination-unreachable"
+       << "-j"
+       << "DROP";
 }
 
-std::string
-Block_ipv6_neighbor_solicitation::operator()(const Action action) const {
-  const std::string saction{iptables_action(action)};
-  const std::string iptcmd{get_iptables_cmd(ip)};
-  const std::string ip_rule{ipv6_to_u32_rule(ip)};
+std::string Block_icmp::operator()(const Action action) const {
+  return render(*this, action);
+}
 
+void Block_ipv6_neighbor_solicitation::operator()(const Action action,
+                                                  Argv_arena &argv) const {
   // blocks neighbor solicitation for fe80::123
   // ip6tables -I INPUT -s :: -p icmpv6 --icmpv6-type neighbour-solicitation -m
   // u32 --u32 "48=0xfe800000 && 52=0x0 && 56=0x0 && 60=0x123" -j DROP
   // we also need to match the ipv6 address using u32 ip6tables modul
-  return iptcmd + " -w -" + saction +
-         " INPUT -s :: -p icmpv6 --icmpv6-type neighbour-solicitation" +
-         ip_rule + " -j DROP";
+  auto const ip_rule = ipv6_to_u32_rule(ip);
+  argv << get_iptables_cmd(ip) << "-w" << iptables_action(action) << "INPUT"
+       << "-s"
+       << "::"
+       << "-p"
+       << "icmpv6"
+       << "--icmpv6-type"
+       << "neighbour-solicitation"
+       << "-m"
+       << "u32"
+       << "--u32" << ip_rule.data() << "-j"
+       << "DROP";
+}
+
+std::string
+Block_ipv6_neighbor_solicitation::operator()(const Action action) const {
+  return render(*this, action);
 }
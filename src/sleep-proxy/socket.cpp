@@ -17,11 +17,13 @@
 #include "socket.h"
 #include "log.h"
 #include "to_string.h"
+#include <algorithm>
 #include <cstring>
 #include <iterator>
 #include <linux/if_ether.h>
 #include <stdexcept>
 #include <sys/ioctl.h>
+#include <thread>
 #include <unistd.h>
 
 namespace {
@@ -56,6 +58,19 @@ Socket::~Socket() {
 
 int Socket::fd() const { return sock; }
 
+unsigned int Socket::send_batch(std::vector<mmsghdr> &messages,
+                                unsigned int const count) {
+  auto const sent = sendmmsg(sock, messages.data(), count, 0);
+  if (sent < 0) {
+    if (errno == ENOBUFS || errno == EAGAIN) {
+      return 0;
+    }
+    throw std::runtime_error(std::string("sendmmsg() failed: ") +
+                             strerror(errno));
+  }
+  return static_cast<unsigned int>(sent);
+}
+
 void Socket::ioctl(const unsigned long req_number, ifreq &ifr) const {
   if (::ioctl(sock, req_number, &ifr) == -1) {
     throw std::runtime_error(std::string("ioctl() failed with request ") +
@@ -83,3 +98,58 @@ ether_addr Socket::get_hwaddr(const std::string &iface) const {
   std::copy(start, end_iter, start_dst);
   return addr;
 }
+
+Paced_sender::Paced_sender(unsigned int const batch, uint64_t const ratee)
+    : iovecs(std::max(1U, batch)), messages(std::max(1U, batch)), rate{ratee},
+      start{Clock::now()}, sent{0}, full_queue{0} {}
+
+void Paced_sender::restart() {
+  start = Clock::now();
+  sent = 0;
+}
+
+unsigned int Paced_sender::send(Socket &socket, Frames const &frames,
+                                size_t const first, size_t const count,
+                                sockaddr const *const destination,
+                                socklen_t const destination_size) {
+  auto batch =
+      static_cast<unsigned int>(std::min<size_t>(messages.size(), count));
+  if (batch == 0 || frames.empty()) {
+    return 0;
+  }
+  if (rate != 0) {
+    auto const due = static_cast<uint64_t>(
+        std::chrono::duration<double>(Clock::now() - start).count() *
+        static_cast<double>(rate));
+    if (due <= sent) {
+      // sleep until the next frame is due
+      std::this_thread::sleep_for(
+          std::chrono::duration<double>(1.0 / static_cast<double>(rate)));
+      return 0;
+    }
+    batch = static_cast<unsigned int>(std::min<uint64_t>(batch, due - sent));
+  }
+  for (unsigned int i = 0; i < batch; ++i) {
+    auto const &frame = frames.at((first + i) % frames.size());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    iovecs.at(i) = {const_cast<uint8_t *>(frame.data()), frame.size()};
+    messages.at(i) = mmsghdr{};
+    messages.at(i).msg_hdr.msg_iov = &iovecs.at(i);
+    messages.at(i).msg_hdr.msg_iovlen = 1;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    messages.at(i).msg_hdr.msg_name = const_cast<sockaddr *>(destination);
+    messages.at(i).msg_hdr.msg_namelen = destination_size;
+  }
+  auto const done = socket.send_batch(messages, batch);
+  if (done < batch) {
+    ++full_queue;
+  }
+  if (done == 0) {
+    // let the interface drain its queue
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  sent += done;
+  return done;
+}
+
+uint64_t Paced_sender::full_queues() const { return full_queue; }
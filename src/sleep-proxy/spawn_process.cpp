@@ -15,9 +15,13 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "spawn_process.h"
+#include "usdt.h"
+#include <array>
 #include <cerrno>
 #include <cstdlib>
+#include <csignal>
 #include <cstring>
+#include <fcntl.h>
 #include <spawn.h>
 #include <stdexcept>
 #include <sys/wait.h>
@@ -70,26 +74,117 @@ struct File_actions {
   }
 };
 
-uint8_t spawn_wrapper(std::vector<char *> params, File_descriptor const &in,
-                      File_descriptor const &out) {
+/**
+ * children start with no blocked signals and SIGHUP and SIGUSR1 at their
+ * default action, whatever the daemon's threads blocked for themselves
+ */
+struct Spawn_attributes {
+  posix_spawnattr_t attr{};
+
+  Spawn_attributes() {
+    auto rc = posix_spawnattr_init(&attr);
+    if (0 != rc) {
+      throw std::system_error{rc, std::system_category(),
+                              "posix_spawnattr_init()"};
+    }
+    sigset_t none{};
+    sigemptyset(&none);
+    sigset_t defaults{};
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGHUP);
+    sigaddset(&defaults, SIGUSR1);
+    auto const flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    if (0 != (rc = posix_spawnattr_setsigmask(&attr, &none)) ||
+        0 != (rc = posix_spawnattr_setsigdefault(&attr, &defaults)) ||
+        0 != (rc = posix_spawnattr_setflags(&attr, flags))) {
+      posix_spawnattr_destroy(&attr);
+      throw std::system_error{rc, std::system_category(),
+                              "posix_spawnattr_set*()"};
+    }
+  }
+
+  Spawn_attributes(Spawn_attributes const &) = delete;
+  Spawn_attributes(Spawn_attributes &&) = delete;
+
+  ~Spawn_attributes() { posix_spawnattr_destroy(&attr); }
+
+  Spawn_attributes &operator=(Spawn_attributes const &) = delete;
+  Spawn_attributes &operator=(Spawn_attributes &&) = delete;
+};
+
+pid_t spawn_child(char *const *const argv, File_descriptor const &in,
+                  File_descriptor const &out) {
   auto pid = pid_t{};
-  auto const command = std::string{params.at(0)};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto const command = std::string{argv[0]};
   File_actions file_actions{};
   file_actions.add_dup2(in, stdin);
   file_actions.add_dup2(out, stdout);
 
-  auto const rc = posix_spawnp(&pid, command.data(), &file_actions.fa, nullptr,
-                               params.data(), nullptr);
+  Spawn_attributes attributes{};
+
+  auto const rc = posix_spawnp(&pid, command.data(), &file_actions.fa,
+                               &attributes.attr, argv, nullptr);
   if (0 != rc) {
     throw std::system_error{rc, std::system_category(),
                             "posix_spawn(" + command + ")"};
   }
+  return pid;
+}
 
-  auto const exit_status = wait_until_pid_exits(pid);
+namespace {
+uint8_t check_exit_status(char *const *const argv, uint8_t const exit_status) {
   static auto const spawn_failure = uint8_t{127};
   if (spawn_failure == exit_status) {
-    throw std::runtime_error{"failed to spawn process: " + command};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    throw std::runtime_error{"failed to spawn process: " +
+                             std::string{argv[0]}};
   }
-
   return exit_status;
 }
+
+uint8_t spawn_and_wait(char *const *const argv, File_descriptor const &in,
+                       File_descriptor const &out) {
+  auto const start = std::chrono::steady_clock::now();
+  auto const pid = spawn_child(argv, in, out);
+  auto const exit_status = wait_until_pid_exits(pid);
+  SLEEP_PROXY_PROBE4(spawn, argv[0], pid, probe_ns_since(start), exit_status);
+  return check_exit_status(argv, exit_status);
+}
+} // namespace
+
+uint8_t spawn_wrapper(std::vector<char *> params, File_descriptor const &in,
+                      File_descriptor const &out) {
+  if (params.empty() || params.at(0) == nullptr) {
+    throw std::out_of_range{"spawn_wrapper(): no command given"};
+  }
+  return spawn_and_wait(params.data(), in, out);
+}
+
+uint8_t spawn(Argv_arena &cmd, File_descriptor const &in,
+              File_descriptor const &out) {
+  if (cmd.empty()) {
+    throw std::out_of_range{"spawn(): no command given"};
+  }
+  return spawn_and_wait(cmd.argv(), in, out);
+}
+
+uint8_t spawn(Argv_arena &cmd, Stream_reader &out) {
+  if (cmd.empty()) {
+    throw std::out_of_range{"spawn(): no command given"};
+  }
+  auto pipefds = std::array<int, 2>{};
+  // O_CLOEXEC: children spawned by other threads must not keep the write end
+  // open, or we would never see EOF
+  if (pipe2(pipefds.data(), O_CLOEXEC) != 0) {
+    throw std::runtime_error(std::string("pipe2() failed: ") +
+                             strerror(errno));
+  }
+  File_descriptor read_end{pipefds[0]};
+  File_descriptor write_end{pipefds[1]};
+  auto *const *const argv = cmd.argv();
+  auto const pid = spawn_child(argv, File_descriptor(), write_end);
+  write_end.close();
+  out.read_all(read_end);
+  return check_exit_status(argv, wait_until_pid_exits(pid));
+}
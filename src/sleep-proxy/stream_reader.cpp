@@ -0,0 +1,132 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "stream_reader.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+auto const min_read_size = size_t{4096};
+} // namespace
+
+std::string Line_view::str() const { return std::string(data, size); }
+
+Line_view Line_view::field(size_t index, char const delimiter) const {
+  auto const *iter = data;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto const *const end = data + size;
+  while (iter != end) {
+    auto const *const delim = std::find(iter, end, delimiter);
+    if (index == 0) {
+      return Line_view{iter, static_cast<size_t>(delim - iter)};
+    }
+    --index;
+    iter = delim == end ? end : delim + 1;
+  }
+  throw std::out_of_range("Line_view::field(): not enough fields");
+}
+
+bool Line_view::equals_ignore_case(std::string const &rhs) const {
+  return size == rhs.size() &&
+         std::equal(data, data + size, std::begin(rhs), [](char a, char b) {
+           return toupper(static_cast<unsigned char>(a)) ==
+                  toupper(static_cast<unsigned char>(b));
+         });
+}
+
+bool operator==(Line_view const &lhs, std::string const &rhs) {
+  return lhs.size == rhs.size() && std::equal(lhs.data, lhs.data + lhs.size,
+                                              std::begin(rhs));
+}
+
+std::ostream &operator<<(std::ostream &out, Line_view const &line) {
+  return out.write(line.data, static_cast<std::streamsize>(line.size));
+}
+
+Stream_reader::Stream_reader()
+    : buffer{}, filled{0}, consumed{0}, eof{false} {}
+
+bool Stream_reader::read_some(int const fd) {
+  if (eof) {
+    return false;
+  }
+  // grow geometrically, so large outputs need few reads and reallocations
+  if (buffer.size() - filled < min_read_size) {
+    buffer.resize(std::max(buffer.size() * 2, filled + min_read_size));
+  }
+  auto n = ssize_t{-1};
+  do {
+    n = ::read(fd, &buffer[filled], buffer.size() - filled);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    if (errno == EAGAIN) {
+      return true;
+    }
+    throw std::runtime_error(std::string("Stream_reader::read() failed: ") +
+                             strerror(errno));
+  }
+  if (n == 0) {
+    eof = true;
+    return false;
+  }
+  filled += static_cast<size_t>(n);
+  return true;
+}
+
+void Stream_reader::read_all(int const fd) {
+  while (read_some(fd)) {
+  }
+}
+
+bool Stream_reader::at_eof() const { return eof; }
+
+bool Stream_reader::next_line(Line_view &line) {
+  auto const begin = std::begin(buffer) + static_cast<ptrdiff_t>(consumed);
+  auto const end = std::begin(buffer) + static_cast<ptrdiff_t>(filled);
+  auto const newline = std::find(begin, end, '\n');
+  if (newline == end && (!eof || begin == end)) {
+    return false;
+  }
+  auto const length = static_cast<size_t>(std::distance(begin, newline));
+  line = Line_view{&buffer[consumed], length};
+  consumed += length + (newline == end ? 0 : 1);
+  return true;
+}
+
+std::vector<Line_view> Stream_reader::lines() const {
+  std::vector<Line_view> result;
+  auto const *iter = buffer.data();
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  auto const *const end = buffer.data() + filled;
+  while (iter != end) {
+    auto const *const newline = std::find(iter, end, '\n');
+    result.push_back(Line_view{iter, static_cast<size_t>(newline - iter)});
+    iter = newline == end ? end : newline + 1;
+  }
+  return result;
+}
+
+size_t Stream_reader::size() const { return filled; }
+
+void Stream_reader::clear() {
+  filled = 0;
+  consumed = 0;
+  eof = false;
+}
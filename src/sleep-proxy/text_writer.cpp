@@ -0,0 +1,114 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "text_writer.h"
+#include <algorithm>
+#include <cstring>
+
+Text_writer::Text_writer(char *const buffer, size_t const size)
+    : first{buffer}, last{buffer + size - 1}, position{buffer},
+      overflow{false} {
+  *position = '\0';
+}
+
+char const *Text_writer::c_str() const { return first; }
+
+size_t Text_writer::size() const {
+  return static_cast<size_t>(position - first);
+}
+
+bool Text_writer::truncated() const { return overflow; }
+
+std::string Text_writer::str() const { return {first, size()}; }
+
+void Text_writer::clear() {
+  position = first;
+  *position = '\0';
+  overflow = false;
+}
+
+Text_writer &Text_writer::write(char const *const text, size_t const length) {
+  auto const fitting =
+      std::min(length, static_cast<size_t>(last - position));
+  std::memcpy(position, text, fitting);
+  position += fitting;
+  *position = '\0';
+  overflow = overflow || fitting != length;
+  return *this;
+}
+
+Text_writer &Text_writer::operator<<(char const *const text) {
+  return write(text, std::strlen(text));
+}
+
+Text_writer &Text_writer::operator<<(std::string const &text) {
+  return write(text.data(), text.size());
+}
+
+Text_writer &Text_writer::operator<<(char const c) { return write(&c, 1); }
+
+Text_writer &Text_writer::write_unsigned(unsigned long long number,
+                                         bool const negative) {
+  // the digits of the largest 64 bit number and a sign
+  std::array<char, 21> digits{};
+  auto begin = std::end(digits);
+  do {
+    *--begin = static_cast<char>('0' + number % 10);
+    number /= 10;
+  } while (number != 0);
+  if (negative) {
+    *--begin = '-';
+  }
+  return write(begin, static_cast<size_t>(std::end(digits) - begin));
+}
+
+Text_writer &Text_writer::operator<<(int const number) {
+  return *this << static_cast<long long>(number);
+}
+
+Text_writer &Text_writer::operator<<(long const number) {
+  return *this << static_cast<long long>(number);
+}
+
+Text_writer &Text_writer::operator<<(long long const number) {
+  // negating the smallest number overflows, its magnitude does not
+  auto const magnitude =
+      number < 0 ? 0ULL - static_cast<unsigned long long>(number)
+                 : static_cast<unsigned long long>(number);
+  return write_unsigned(magnitude, number < 0);
+}
+
+Text_writer &Text_writer::operator<<(unsigned int const number) {
+  return write_unsigned(number, false);
+}
+
+Text_writer &Text_writer::operator<<(unsigned long const number) {
+  return write_unsigned(number, false);
+}
+
+Text_writer &Text_writer::operator<<(unsigned long long const number) {
+  return write_unsigned(number, false);
+}
+
+Text_writer &Text_writer::hex(uint64_t const number, size_t const width) {
+  std::array<char, 16> text{};
+  auto const length = std::min(width, text.size());
+  for (auto i = size_t{0}; i < length; ++i) {
+    auto const digit = static_cast<char>((number >> (4 * i)) & 0xfU);
+    text.at(length - 1 - i) = digit < 10 ? '0' + digit : 'a' + digit - 10;
+  }
+  return write(text.data(), length);
+}
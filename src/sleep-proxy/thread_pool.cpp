@@ -0,0 +1,132 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "thread_pool.h"
+#include "log.h"
+#include <algorithm>
+
+namespace {
+/** the pool and queue of the worker running on this thread */
+thread_local Thread_pool const *current_pool = nullptr;
+thread_local size_t current_queue = 0;
+} // namespace
+
+size_t Thread_pool::default_size() {
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+Thread_pool::Thread_pool(size_t const size)
+    : queues{}, queued{0}, next_queue{0}, stopping{false}, idle_mutex{},
+      idle{}, timers{}, timer_thread{}, workers{} {
+  for (size_t i = 0; i < std::max(size_t{1}, size); ++i) {
+    queues.emplace_back(std::make_unique<Worker_queue>());
+  }
+  timer_thread = std::thread{[this]() { timers.run(); }};
+  for (size_t i = 0; i < queues.size(); ++i) {
+    workers.emplace_back([this, i]() { work(i); });
+  }
+}
+
+Thread_pool::~Thread_pool() {
+  timers.stop();
+  timer_thread.join();
+  {
+    std::lock_guard<std::mutex> const lock{idle_mutex};
+    stopping = true;
+  }
+  idle.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+size_t Thread_pool::size() const { return queues.size(); }
+
+void Thread_pool::post(Task task) { push(std::move(task)); }
+
+void Thread_pool::post_after(std::chrono::milliseconds const delay,
+                             Task task) {
+  timers.post([this, delay, task]() {
+    timers.add_timer(delay, [this, task]() { push(task); });
+  });
+}
+
+void Thread_pool::push(Task task) {
+  auto const index = current_pool == this
+                         ? current_queue
+                         : next_queue.fetch_add(1) % queues.size();
+  {
+    // a worker checks queued under idle_mutex before it sleeps
+    std::lock_guard<std::mutex> const lock{idle_mutex};
+    ++queued;
+  }
+  {
+    auto &queue = *queues[index];
+    std::lock_guard<std::mutex> const lock{queue.mutex};
+    queue.tasks.push_back(std::move(task));
+  }
+  idle.notify_one();
+}
+
+bool Thread_pool::pop(size_t const index, Task &task) {
+  {
+    auto &own = *queues[index];
+    std::lock_guard<std::mutex> const lock{own.mutex};
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues.size(); ++i) {
+    auto &victim = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> const lock{victim.mutex};
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Thread_pool::work(size_t const index) {
+  current_pool = this;
+  current_queue = index;
+  while (true) {
+    Task task;
+    if (pop(index, task)) {
+      try {
+        task();
+      } catch (std::exception const &e) {
+        LOG(LOG_ERR, "task of thread pool failed: %s", e.what());
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock{idle_mutex};
+    idle.wait(lock, [this]() { return stopping || queued > 0; });
+    if (stopping && queued == 0) {
+      return;
+    }
+  }
+}
+
+Thread_pool &thread_pool() {
+  static Thread_pool pool{};
+  return pool;
+}
@@ -0,0 +1,197 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "wake_latency.h"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace {
+/** index of the highest set bit */
+unsigned int log2_floor(uint64_t const value) {
+  return 63U - static_cast<unsigned int>(__builtin_clzll(value));
+}
+
+struct Wake_latency_registry {
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<Wake_latency>> hosts;
+};
+
+Wake_latency_registry &registry() {
+  static Wake_latency_registry instance{{}, {}};
+  return instance;
+}
+
+double to_ms(Latency_histogram::Duration const d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+} // namespace
+
+Latency_histogram::Latency_histogram()
+    : buckets{}, total{0}, sum_ns{0}, max_ns{0} {}
+
+size_t Latency_histogram::bucket_index(uint64_t const ns) {
+  if (ns < sub_buckets) {
+    return ns;
+  }
+  auto const bits = log2_floor(ns);
+  if (bits > max_bits) {
+    return bucket_count - 1;
+  }
+  auto const shift = bits - sub_bucket_bits;
+  auto const sub = (ns >> shift) & (sub_buckets - 1);
+  return sub_buckets * (shift + 1) + sub;
+}
+
+uint64_t Latency_histogram::bucket_upper_bound(size_t const bucket) {
+  if (bucket < sub_buckets) {
+    return bucket;
+  }
+  auto const shift = bucket / sub_buckets - 1;
+  auto const sub = bucket % sub_buckets;
+  return ((sub_buckets + sub + 1) << shift) - 1;
+}
+
+void Latency_histogram::record(Duration const value) {
+  auto const ns =
+      static_cast<uint64_t>(std::max(value.count(), Duration::rep{0}));
+  buckets.at(bucket_index(ns)).fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(1, std::memory_order_relaxed);
+  sum_ns.fetch_add(ns, std::memory_order_relaxed);
+  auto current = max_ns.load(std::memory_order_relaxed);
+  while (ns > current && !max_ns.compare_exchange_weak(
+                              current, ns, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t Latency_histogram::count() const { return total; }
+
+Latency_histogram::Duration Latency_histogram::max() const {
+  return Duration{static_cast<Duration::rep>(max_ns.load())};
+}
+
+Latency_histogram::Duration Latency_histogram::mean() const {
+  auto const n = count();
+  return Duration{n == 0 ? 0 : static_cast<Duration::rep>(sum_ns / n)};
+}
+
+Latency_histogram::Duration
+Latency_histogram::percentile(double const percent) const {
+  auto const n = count();
+  if (n == 0) {
+    return Duration{0};
+  }
+  auto const share = std::min(percent, 100.0) / 100;
+  auto const wanted = std::max(
+      uint64_t{1},
+      static_cast<uint64_t>(std::ceil(static_cast<double>(n) * share)));
+  auto seen = uint64_t{0};
+  for (auto i = size_t{0}; i < buckets.size(); ++i) {
+    seen += buckets.at(i).load(std::memory_order_relaxed);
+    if (seen >= wanted) {
+      if (i == buckets.size() - 1) {
+        // the last bucket has no upper bound
+        return max();
+      }
+      auto const upper = static_cast<Duration::rep>(bucket_upper_bound(i));
+      return std::min(max(), Duration{upper});
+    }
+  }
+  // recorded concurrently, the buckets are behind total
+  return max();
+}
+
+std::ostream &operator<<(std::ostream &out, Wake_stage const stage) {
+  switch (stage) {
+  case Wake_stage::capture:
+    return out << "capture";
+  case Wake_stage::icmp_block:
+    return out << "icmp_block";
+  case Wake_stage::firewall_teardown:
+    return out << "firewall_teardown";
+  case Wake_stage::wol:
+    return out << "wol";
+  case Wake_stage::ping_attempt:
+    return out << "ping_attempt";
+  case Wake_stage::ping:
+    return out << "ping";
+  case Wake_stage::replay:
+    return out << "replay";
+  case Wake_stage::total:
+    return out << "total";
+  default:
+    return out << "unknown";
+  }
+}
+
+Wake_latency::Wake_latency() : stages{} {}
+
+Latency_histogram &Wake_latency::operator[](Wake_stage const stage) {
+  return stages.at(static_cast<size_t>(stage));
+}
+
+Latency_histogram const &
+Wake_latency::operator[](Wake_stage const stage) const {
+  return stages.at(static_cast<size_t>(stage));
+}
+
+Wake_latency &wake_latency(std::string const &hostname) {
+  auto &r = registry();
+  std::lock_guard<std::mutex> const lock{r.mutex};
+  auto &latency = r.hosts[hostname];
+  if (latency == nullptr) {
+    latency = std::make_unique<Wake_latency>();
+  }
+  return *latency;
+}
+
+void write_wake_latency(std::ostream &out) {
+  auto &r = registry();
+  std::lock_guard<std::mutex> const lock{r.mutex};
+  out << std::fixed << std::setprecision(3);
+  for (auto const &host : r.hosts) {
+    for (auto s = size_t{0}; s < Wake_latency::stage_count; ++s) {
+      auto const stage = static_cast<Wake_stage>(s);
+      auto const &h = (*host.second)[stage];
+      if (h.count() == 0) {
+        continue;
+      }
+      out << host.first << ' ' << stage << ": count " << h.count() << " p50 "
+          << to_ms(h.percentile(50)) << "ms p90 " << to_ms(h.percentile(90))
+          << "ms p99 " << to_ms(h.percentile(99)) << "ms max "
+          << to_ms(h.max()) << "ms\n";
+    }
+  }
+}
+
+void log_wake_latency() {
+  std::ostringstream out;
+  write_wake_latency(out);
+  if (out.tellp() == 0) {
+    log_string(LOG_NOTICE, "no host has been woken yet");
+    return;
+  }
+  std::istringstream lines{out.str()};
+  std::string line;
+  while (std::getline(lines, line)) {
+    log_string(LOG_NOTICE, "wake latency " + line);
+  }
+}
@@ -19,7 +19,9 @@
 #include "ethernet.h"
 #include "int_utils.h"
 #include "log.h"
+#include "metrics.h"
 #include "socket.h"
+#include "usdt.h"
 #include <arpa/inet.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
@@ -48,33 +50,44 @@ Wol_method parse_wol_method(const std::string &readable_wol_method) {
   throw std::invalid_argument("invalid wol method: " + readable_wol_method);
 }
 
-std::ostream &operator<<(std::ostream &out, const Wol_method &wol_method) {
+namespace {
+char const *wol_method_name(const Wol_method &wol_method) {
   switch (wol_method) {
   case Wol_method::ethernet:
-    out << "ethernet";
-    break;
+    return "ethernet";
   case Wol_method::udp:
-    out << "udp";
-    break;
+    return "udp";
   default:
     throw std::runtime_error("invalid wol method");
-    break;
   }
+}
+} // namespace
+
+std::ostream &operator<<(std::ostream &out, const Wol_method &wol_method) {
+  out << wol_method_name(wol_method);
   return out;
 }
 
+Text_writer &operator<<(Text_writer &out, const Wol_method &wol_method) {
+  return out << wol_method_name(wol_method);
+}
+
 void wol_udp(const ether_addr &mac) {
-  log_string(LOG_INFO, "waking (udp) " + binary_to_mac(mac));
+  LOG(LOG_INFO, "waking (udp) %s", binary_to_mac(mac).c_str());
   const std::vector<uint8_t> binary_data = create_wol_payload(mac);
   // Broadcast it to the LAN.
   Socket sock(AF_INET, SOCK_DGRAM);
   sock.set_sock_opt(SOL_SOCKET, SO_BROADCAST, 1);
   const sockaddr_in broadcast_port9{AF_INET, htons(9), {INADDR_BROADCAST}, {0}};
   sock.send_to(binary_data, 0, broadcast_port9);
+  SLEEP_PROXY_PROBE2(wol_udp, mac.ether_addr_octet, binary_data.size());
+  static auto &sent = metrics().counter(
+      "sleep_proxy_wol_packets", "WOL packets sent", {{"method", "udp"}});
+  sent.inc();
 }
 
 void wol_ethernet(const std::string &iface, const ether_addr &mac) {
-  log_string(LOG_INFO, "waking (ethernet) " + binary_to_mac(mac));
+  LOG(LOG_INFO, "waking (ethernet) %s", binary_to_mac(mac).c_str());
 
   // Broadcast it to the LAN.
   Socket sock(PF_PACKET, SOCK_RAW, 0);
@@ -92,4 +105,9 @@ void wol_ethernet(const std::string &iface, const ether_addr &mac) {
   const std::vector<uint8_t> binary_data =
       create_ethernet_header(mac, hw_addr, 0x0842) + create_wol_payload(mac);
   sock.send_to(binary_data, 0, broadcast_ll);
+  SLEEP_PROXY_PROBE3(wol_ethernet, iface.c_str(), mac.ether_addr_octet,
+                     binary_data.size());
+  static auto &sent = metrics().counter(
+      "sleep_proxy_wol_packets", "WOL packets sent", {{"method", "ethernet"}});
+  sent.inc();
 }
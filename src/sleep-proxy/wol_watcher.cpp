@@ -17,6 +17,7 @@
 #include "wol_watcher.h"
 #include "ethernet.h"
 #include "log.h"
+#include "usdt.h"
 #include "wol.h"
 #include <iterator>
 
@@ -27,19 +28,21 @@ bool is_magic_packet(std::vector<uint8_t> const &data, ether_addr const &mac) {
   // 2. convert data into a string
   std::string const data_string{std::begin(data), std::end(data)};
   // 3. search in data string for the magic pattern with string search
-  return std::string::npos != data_string.find(packet_string);
+  bool const found = std::string::npos != data_string.find(packet_string);
+  SLEEP_PROXY_PROBE3(magic_packet, mac.ether_addr_octet, data.size(), found);
+  return found;
 }
 
 void break_on_magic_packet(const struct pcap_pkthdr *header,
                            const u_char *packet, ether_addr const &mac,
                            Pcap_wrapper &waiting_for_wol) {
   if (header == nullptr || packet == nullptr) {
-    log_string(LOG_ERR, "header or packet are nullptr");
+    LOG(LOG_ERR, "header or packet are nullptr");
     return;
   }
 
   const auto *end_iter = packet;
-  std::advance(end_iter, header->len);
+  std::advance(end_iter, header->caplen);
   std::vector<uint8_t> const data{packet, end_iter};
   if (is_magic_packet(data, mac)) {
     waiting_for_wol.break_loop(
@@ -75,13 +78,13 @@ Wol_watcher::~Wol_watcher() { stop(); }
 
 std::string Wol_watcher::operator()(const Action action) {
   if (Action::add == action) {
-    log(LOG_INFO, "starting Wol_watcher");
+    LOG(LOG_INFO, "starting Wol_watcher");
     wol_listener =
         std::thread(wol_watcher_thread_main, std::cref(mac),
                     std::ref(waiting_for_wol), std::ref(waiting_for_syn));
   }
   if (Action::del == action) {
-    log(LOG_INFO, "stopping Wol_watcher");
+    LOG(LOG_INFO, "stopping Wol_watcher");
     stop();
   }
   return "";
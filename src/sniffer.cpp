@@ -14,11 +14,21 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include "address_index.h"
+#include "config_snapshot.h"
 #include "ethernet.h"
+#include "int_utils.h"
+#include "libsleep_proxy.h"
 #include "log.h"
 #include "packet_parser.h"
 #include "pcap_wrapper.h"
+#include "pcapng_writer.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cinttypes>
+#include <getopt.h>
 #include <iterator>
+#include <thread>
 
 /**
  * Writes time formatted into the stream
@@ -38,6 +48,27 @@ inline std::ostream &operator<<(std::ostream &out, const pcap_pkthdr &hdr) {
 }
 
 namespace {
+enum class Mode { print, summary, write };
+
+struct Options {
+  Mode mode{Mode::print};
+  std::string iface{};
+  std::string filter{};
+  std::string file{};
+  std::string hosts{};
+  uint64_t file_size{0};
+  unsigned int files{0};
+  int buffer_size{16 << 20};
+  int batch{256};
+  int snaplen{Pcap_wrapper::default_snaplen};
+};
+
+/** a packet copied out of the capture buffer */
+struct Frame {
+  pcap_pkthdr header{};
+  std::vector<uint8_t> data{};
+};
+
 /**
  * If used as pcap callback prints some info about the received data
  * */
@@ -51,25 +82,316 @@ struct Got_packet {
     }
     log_string(LOG_INFO, *header);
     const auto *end_iter = packet;
-    std::advance(end_iter, header->len);
+    std::advance(end_iter, header->caplen);
     basic_headers headers =
         get_headers(link_layer_type, std::vector<u_char>(packet, end_iter));
     log_string(LOG_INFO, headers);
   }
 };
 
-void print_help() { log_string(LOG_NOTICE, "usage: iface bpf_filter"); }
+/** written by the worker, read by the capture thread for its reports */
+struct Summary {
+  std::atomic<uint64_t> packets{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> ipv4{0};
+  std::atomic<uint64_t> ipv6{0};
+  std::atomic<uint64_t> tcp{0};
+  std::atomic<uint64_t> udp{0};
+  std::atomic<uint64_t> other{0};
+  /** the watched hosts packets are attributed to by their destination */
+  Address_index index{};
+  std::atomic<uint64_t> to_hosts{0};
+  std::vector<std::atomic<uint64_t>> per_host{};
+
+  void count(int const link_layer_type, Frame const &frame) {
+    packets.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(frame.header.len, std::memory_order_relaxed);
+    auto const headers = get_headers(link_layer_type, frame.data);
+    auto const &ip_header = std::get<1>(headers);
+    if (ip_header == nullptr) {
+      other.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    (ip_header->version() == ip::ipv4 ? ipv4 : ipv6)
+        .fetch_add(1, std::memory_order_relaxed);
+    auto const host = index.lookup(ip_header->destination());
+    if (host != Address_index::no_value) {
+      to_hosts.fetch_add(1, std::memory_order_relaxed);
+      per_host.at(host).fetch_add(1, std::memory_order_relaxed);
+    }
+    if (ip_header->payload_protocol() == ip::TCP) {
+      tcp.fetch_add(1, std::memory_order_relaxed);
+    } else if (ip_header->payload_protocol() == ip::UDP) {
+      udp.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+};
+
+/**
+ * Parsing, formatting and writing packets happens in a worker, the capture
+ * thread only copies them into a ring. When the ring is full packets are
+ * dropped and counted instead of stalling the capture.
+ */
+class Frame_worker {
+  Spsc_ring<Frame> ring;
+  std::atomic<bool> stopped;
+  uint64_t dropped;
+  std::thread worker;
+
+public:
+  template <typename Handler>
+  Frame_worker(size_t const slots, Handler handler)
+      : ring{slots}, stopped{false}, dropped{0}, worker{} {
+    worker = std::thread{[this, handler]() mutable {
+      while (true) {
+        auto *const frame = ring.front();
+        if (frame == nullptr) {
+          if (stopped) {
+            return;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds{1});
+          continue;
+        }
+        try {
+          handler(*frame);
+        } catch (std::exception const &e) {
+          LOG_RATE_LIMITED(LOG_ERR, "can't handle packet: %s", e.what());
+        }
+        ring.pop();
+      }
+    }};
+  }
+
+  Frame_worker(Frame_worker const &) = delete;
+  Frame_worker(Frame_worker &&) = delete;
+  ~Frame_worker() { stop(); }
+  Frame_worker &operator=(Frame_worker const &) = delete;
+  Frame_worker &operator=(Frame_worker &&) = delete;
+
+  /** capture thread only */
+  void push(pcap_pkthdr const *header, u_char const *packet) {
+    auto *const frame = ring.claim();
+    if (frame == nullptr) {
+      ++dropped;
+      return;
+    }
+    frame->header = *header;
+    // keeps the capacity of earlier packets, no allocation once warmed up
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    frame->data.assign(packet, packet + header->caplen);
+    ring.publish();
+  }
+
+  /** handles the remaining packets and joins the worker */
+  void stop() {
+    stopped = true;
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  uint64_t dropped_packets() const { return dropped; }
+};
+
+void report(Summary const &summary, Frame_worker const &worker,
+            pcap_stat const &stats) {
+  LOG(LOG_NOTICE,
+      "%" PRIu64 " packets, %" PRIu64 " bytes, IPv4 %" PRIu64 ", IPv6 %" PRIu64
+      ", TCP %" PRIu64 ", UDP %" PRIu64 ", other %" PRIu64 ", dropped %" PRIu64
+      " by sniffer, %u by kernel",
+      summary.packets.load(), summary.bytes.load(), summary.ipv4.load(),
+      summary.ipv6.load(), summary.tcp.load(), summary.udp.load(),
+      summary.other.load(), worker.dropped_packets(), stats.ps_drop);
+  if (!summary.index.empty()) {
+    LOG(LOG_NOTICE, "%" PRIu64 " packets to watched hosts",
+        summary.to_hosts.load());
+  }
+}
+
+/** the packets of every watched host which got any */
+void report_hosts(Summary const &summary, Host_table const &hosts) {
+  for (size_t host = 0; host < summary.per_host.size(); ++host) {
+    auto const packets = summary.per_host.at(host).load();
+    if (packets != 0) {
+      LOG(LOG_NOTICE, "%s: %" PRIu64 " packets",
+          hosts.hostname(host).c_str(), packets);
+    }
+  }
+}
+
+void sniff(Options const &options) {
+  // a short timeout, so signals are noticed between batches
+  static auto const timeout_ms = 100;
+  Pcap_wrapper pcap(options.iface, options.snaplen, false, timeout_ms,
+                    options.buffer_size);
+  if (!options.filter.empty()) {
+    pcap.set_filter(options.filter);
+  }
+  auto const link_layer_type = pcap.get_datalink();
+  Summary summary;
+  Host_table hosts;
+  if (!options.hosts.empty()) {
+    hosts = load_host_table(options.hosts);
+    summary.index = index_host_addresses(hosts);
+    summary.per_host = std::vector<std::atomic<uint64_t>>(hosts.size());
+  }
+  std::unique_ptr<Pcapng_writer> writer;
+  static auto const ring_slots = size_t{8192};
+
+  std::function<void(Frame const &)> handle;
+  switch (options.mode) {
+  case Mode::print:
+    handle = [link_layer_type](Frame const &frame) {
+      Got_packet{link_layer_type}(&frame.header, frame.data.data());
+    };
+    break;
+  case Mode::summary:
+    handle = [&summary, link_layer_type](Frame const &frame) {
+      summary.count(link_layer_type, frame);
+    };
+    break;
+  case Mode::write:
+    writer = std::make_unique<Pcapng_writer>(
+        options.file, link_layer_type, static_cast<uint32_t>(options.snaplen),
+        options.file_size, options.files);
+    handle = [&writer](Frame const &frame) {
+      writer->write(frame.header, frame.data.data());
+    };
+    break;
+  default:
+    throw std::runtime_error("unknown mode");
+  }
+
+  Frame_worker worker{ring_slots, handle};
+  auto const push = [&worker](pcap_pkthdr const *header,
+                              u_char const *packet) {
+    worker.push(header, packet);
+  };
+  auto last_report = std::chrono::steady_clock::now();
+  while (!is_signaled()) {
+    pcap.dispatch(options.batch, push);
+    auto const now = std::chrono::steady_clock::now();
+    if (options.mode == Mode::summary &&
+        now - last_report >= std::chrono::seconds{1}) {
+      report(summary, worker, pcap.stats());
+      last_report = now;
+    }
+  }
+  worker.stop();
+  if (writer != nullptr) {
+    writer->flush();
+  }
+  report(summary, worker, pcap.stats());
+  report_hosts(summary, hosts);
+}
+
+void print_help() {
+  log_string(LOG_NOTICE,
+             "usage: sniffer [options] iface [bpf_filter]\n"
+             "  -m, --mode MODE       print (default), summary or write\n"
+             "  -w, --write FILE      write pcapng into FILE, implies -m "
+             "write\n"
+             "  -C, --file-size MB    start a new file after MB megabytes\n"
+             "  -W, --files N         keep N files, overwrite the oldest\n"
+             "  -B, --buffer MB       kernel capture buffer (16)\n"
+             "  -b, --batch N         packets per pcap_dispatch() (256)\n"
+             "  -s, --snaplen BYTES   captured bytes per packet\n"
+             "  -H, --hosts CONFIG    count the packets to each host of the "
+             "watchHost\n"
+             "                        configuration CONFIG in summary mode");
+}
+
+Mode parse_mode(std::string const &mode) {
+  if (mode == "print") {
+    return Mode::print;
+  }
+  if (mode == "summary") {
+    return Mode::summary;
+  }
+  if (mode == "write") {
+    return Mode::write;
+  }
+  throw std::runtime_error("unknown mode: " + mode);
+}
+
+Options read_options(int const argc, char *const argv[]) {
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+  static const option long_options[] = {
+      {"help", no_argument, nullptr, 'h'},
+      {"mode", required_argument, nullptr, 'm'},
+      {"write", required_argument, nullptr, 'w'},
+      {"file-size", required_argument, nullptr, 'C'},
+      {"files", required_argument, nullptr, 'W'},
+      {"buffer", required_argument, nullptr, 'B'},
+      {"batch", required_argument, nullptr, 'b'},
+      {"snaplen", required_argument, nullptr, 's'},
+      {"hosts", required_argument, nullptr, 'H'},
+      {nullptr, 0, nullptr, 0}};
+  static auto const megabyte = 1U << 20U;
+  Options options;
+  int c = -1;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  while ((c = getopt_long(argc, argv, "hm:w:C:W:B:b:s:H:", long_options,
+                          nullptr)) != -1) {
+    switch (c) {
+    case 'm':
+      options.mode = parse_mode(optarg);
+      break;
+    case 'w':
+      options.mode = Mode::write;
+      options.file = optarg;
+      break;
+    case 'C':
+      options.file_size = str_to_integral<uint64_t>(optarg) * megabyte;
+      break;
+    case 'W':
+      options.files = str_to_integral<unsigned int>(optarg);
+      break;
+    case 'B':
+      options.buffer_size =
+          static_cast<int>(str_to_integral<uint16_t>(optarg) * megabyte);
+      break;
+    case 'b':
+      options.batch = str_to_integral<int>(optarg);
+      break;
+    case 's':
+      options.snaplen = str_to_integral<int>(optarg);
+      break;
+    case 'H':
+      options.hosts = optarg;
+      break;
+    case 'h':
+      print_help();
+      exit(0);
+    default:
+      print_help();
+      exit(1);
+    }
+  }
+  auto const positional = argc - optind;
+  if (positional < 1 || positional > 2 ||
+      (options.mode == Mode::write && options.file.empty())) {
+    print_help();
+    exit(1);
+  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  options.iface = argv[optind];
+  if (positional == 2) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    options.filter = argv[optind + 1];
+  }
+  return options;
+}
 } // namespace
 
 int main(int argc, char *argv[]) {
-  if (argc != 3) {
-    print_help();
+  try {
+    auto const options = read_options(argc, argv);
+    setup_signals();
+    sniff(options);
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "sniffer: %s", e.what());
     return 1;
   }
-  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  Pcap_wrapper pcap(argv[1]);
-  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  pcap.set_filter(argv[2]);
-  pcap.loop(0, Got_packet{pcap.get_datalink()});
   return 0;
 }
@@ -0,0 +1,553 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "container_utils.h"
+#include "ethernet.h"
+#include "int_utils.h"
+#include "ip_address.h"
+#include "ip_utils.h"
+#include "libsleep_proxy.h"
+#include "log.h"
+#include "socket.h"
+#include "wol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <getopt.h>
+#include <linux/if_packet.h>
+#include <netinet/if_ether.h>
+#include <random>
+
+/**
+ * Load generator for the proxy: sends TCP SYNs, magic packets, ARP requests,
+ * neighbor solicitations and junk frames at a given rate with sendmmsg().
+ * The frames are built once into a pool, sending only cycles through it.
+ */
+
+namespace {
+enum class Frame_kind { syn, wol, arp, ns, junk };
+
+struct Options {
+  std::string iface{};
+  std::vector<IP_address> targets{};
+  std::vector<uint16_t> ports{80};
+  /** frames per second, 0 sends as fast as possible */
+  uint64_t rate{1000};
+  std::chrono::seconds duration{10};
+  /** kinds with their share of the frames */
+  std::vector<std::pair<Frame_kind, unsigned int>> mix{{Frame_kind::syn, 1}};
+  unsigned int batch{64};
+  ether_addr destination{{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+  /** magic packets for random macs if empty */
+  std::vector<ether_addr> wol_macs{};
+};
+
+Frame_kind parse_kind(std::string const &name) {
+  if (name == "syn") {
+    return Frame_kind::syn;
+  }
+  if (name == "wol") {
+    return Frame_kind::wol;
+  }
+  if (name == "arp") {
+    return Frame_kind::arp;
+  }
+  if (name == "ns") {
+    return Frame_kind::ns;
+  }
+  if (name == "junk") {
+    return Frame_kind::junk;
+  }
+  throw std::runtime_error("unknown frame kind: " + name);
+}
+
+/** syn:90,junk:10 */
+std::vector<std::pair<Frame_kind, unsigned int>>
+parse_mix(std::string const &mix) {
+  std::vector<std::pair<Frame_kind, unsigned int>> result;
+  for (auto const &item : split(mix, ',')) {
+    auto const kind_weight = split(item, ':');
+    auto const weight = kind_weight.size() > 1
+                            ? str_to_integral<unsigned int>(kind_weight.at(1))
+                            : 1U;
+    result.emplace_back(parse_kind(kind_weight.at(0)), weight);
+  }
+  return result;
+}
+
+void add_uint16(std::vector<uint8_t> &frame, uint16_t const value) {
+  frame.push_back(static_cast<uint8_t>(value >> 8U));
+  frame.push_back(static_cast<uint8_t>(value & 0xffU));
+}
+
+void add_bytes(std::vector<uint8_t> &frame, void const *data,
+               size_t const size) {
+  auto const *const bytes = static_cast<uint8_t const *>(data);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  frame.insert(std::end(frame), bytes, bytes + size);
+}
+
+uint32_t sum_words(uint32_t sum, uint8_t const *const data,
+                   size_t const size) {
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    sum += static_cast<uint32_t>(data[i] << 8U | data[i + 1]);
+  }
+  if (size % 2 != 0) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    sum += static_cast<uint32_t>(data[size - 1] << 8U);
+  }
+  return sum;
+}
+
+/** stores the internet checksum of frame[from, end) at frame[at] */
+void set_checksum(std::vector<uint8_t> &frame, size_t const from,
+                  size_t const at, uint32_t sum = 0) {
+  sum = sum_words(sum, &frame.at(from), frame.size() - from);
+  while (sum > 0xffffU) {
+    sum = (sum & 0xffffU) + (sum >> 16U);
+  }
+  auto const checksum = static_cast<uint16_t>(~sum);
+  frame.at(at) = static_cast<uint8_t>(checksum >> 8U);
+  frame.at(at + 1) = static_cast<uint8_t>(checksum & 0xffU);
+}
+
+/** pseudo header sum of the addresses, protocol and length */
+uint32_t pseudo_header_sum(IP_address const &source,
+                           IP_address const &destination,
+                           uint8_t const protocol, size_t const length) {
+  auto const *const src = reinterpret_cast<uint8_t const *>(&source.address);
+  auto const *const dst =
+      reinterpret_cast<uint8_t const *>(&destination.address);
+  auto const size = source.family == AF_INET ? 4U : 16U;
+  auto sum = sum_words(0, src, size);
+  sum = sum_words(sum, dst, size);
+  return sum + protocol + static_cast<uint32_t>(length);
+}
+
+void add_ip_header(std::vector<uint8_t> &frame, IP_address const &source,
+                   IP_address const &destination, uint8_t const protocol,
+                   uint16_t const payload_length, uint8_t const hop_limit) {
+  auto const start = frame.size();
+  if (source.family == AF_INET) {
+    frame.push_back(0x45);
+    frame.push_back(0);
+    add_uint16(frame, static_cast<uint16_t>(20 + payload_length));
+    add_uint16(frame, 0);
+    // don't fragment
+    add_uint16(frame, 0x4000);
+    frame.push_back(hop_limit);
+    frame.push_back(protocol);
+    add_uint16(frame, 0);
+    add_bytes(frame, &source.address.ipv4, 4);
+    add_bytes(frame, &destination.address.ipv4, 4);
+    set_checksum(frame, start, start + 10);
+  } else {
+    add_uint16(frame, 0x6000);
+    add_uint16(frame, 0);
+    add_uint16(frame, payload_length);
+    frame.push_back(protocol);
+    frame.push_back(hop_limit);
+    add_bytes(frame, &source.address.ipv6, 16);
+    add_bytes(frame, &destination.address.ipv6, 16);
+  }
+}
+
+class Frame_factory {
+  Options const &options;
+  ether_addr const source_mac;
+  std::mt19937 random;
+  size_t next_target{0};
+
+  std::vector<IP_address> targets_of(int const family) const {
+    std::vector<IP_address> result;
+    std::copy_if(std::begin(options.targets), std::end(options.targets),
+                 std::back_inserter(result),
+                 [family](IP_address const &ip) {
+                   return ip.family == family;
+                 });
+    if (result.empty()) {
+      throw std::runtime_error(std::string("no ") +
+                               (family == AF_INET ? "IPv4" : "IPv6") +
+                               " target given");
+    }
+    return result;
+  }
+
+  uint8_t random_byte() { return static_cast<uint8_t>(random() & 0xffU); }
+
+  /** 198.18.0.0/15 or 2001:db8::/32, reserved for benchmarks and examples */
+  IP_address random_source(int const family) {
+    IP_address ip{};
+    ip.family = family;
+    if (family == AF_INET) {
+      auto const host = static_cast<uint32_t>(random() & 0x1ffffU);
+      ip.address.ipv4.s_addr = htonl(0xc6120000U | host);
+      ip.subnet = 32;
+    } else {
+      ip.address.ipv6.s6_addr[0] = 0x20;
+      ip.address.ipv6.s6_addr[1] = 0x01;
+      ip.address.ipv6.s6_addr[2] = 0x0d;
+      ip.address.ipv6.s6_addr[3] = 0xb8;
+      for (size_t i = 4; i < 16; ++i) {
+        ip.address.ipv6.s6_addr[i] = random_byte();
+      }
+      ip.subnet = 128;
+    }
+    return ip;
+  }
+
+  ether_addr random_mac() {
+    ether_addr mac{};
+    for (auto &octet : mac.ether_addr_octet) {
+      octet = random_byte();
+    }
+    // locally administered unicast
+    mac.ether_addr_octet[0] =
+        static_cast<uint8_t>((mac.ether_addr_octet[0] & 0xfcU) | 0x02U);
+    return mac;
+  }
+
+  std::vector<uint8_t> syn() {
+    auto const &destination =
+        options.targets.at(next_target++ % options.targets.size());
+    auto const port = options.ports.at(random() % options.ports.size());
+    auto const source = random_source(destination.family);
+    auto const ethertype =
+        destination.family == AF_INET ? ETHERTYPE_IP : ETHERTYPE_IPV6;
+    auto frame = create_ethernet_header(options.destination, source_mac,
+                                        static_cast<uint16_t>(ethertype));
+    static auto const tcp_length = uint16_t{20};
+    add_ip_header(frame, source, destination, IPPROTO_TCP, tcp_length, 64);
+    auto const tcp_start = frame.size();
+    add_uint16(frame, static_cast<uint16_t>(1024 + random() % 60000));
+    add_uint16(frame, port);
+    add_uint16(frame, static_cast<uint16_t>(random()));
+    add_uint16(frame, static_cast<uint16_t>(random()));
+    add_uint16(frame, 0);
+    add_uint16(frame, 0);
+    // data offset 5 words, SYN
+    add_uint16(frame, 0x5002);
+    add_uint16(frame, 64240);
+    add_uint16(frame, 0);
+    add_uint16(frame, 0);
+    set_checksum(frame, tcp_start, tcp_start + 16,
+                 pseudo_header_sum(source, destination, IPPROTO_TCP,
+                                   tcp_length));
+    return frame;
+  }
+
+  std::vector<uint8_t> wol() {
+    auto const mac =
+        options.wol_macs.empty()
+            ? random_mac()
+            : options.wol_macs.at(random() % options.wol_macs.size());
+    static ether_addr const broadcast{{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+    return create_ethernet_header(broadcast, source_mac, 0x0842) +
+           create_wol_payload(mac);
+  }
+
+  std::vector<uint8_t> arp() {
+    auto const targets = targets_of(AF_INET);
+    auto const &target = targets.at(random() % targets.size());
+    auto const source = random_source(AF_INET);
+    static ether_addr const broadcast{{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+    auto frame = create_ethernet_header(broadcast, source_mac, ETHERTYPE_ARP);
+    add_uint16(frame, ARPHRD_ETHER);
+    add_uint16(frame, ETHERTYPE_IP);
+    frame.push_back(ETH_ALEN);
+    frame.push_back(4);
+    add_uint16(frame, ARPOP_REQUEST);
+    add_bytes(frame, &source_mac, ETH_ALEN);
+    add_bytes(frame, &source.address.ipv4, 4);
+    frame.insert(std::end(frame), ETH_ALEN, 0);
+    add_bytes(frame, &target.address.ipv4, 4);
+    return frame;
+  }
+
+  std::vector<uint8_t> ns() {
+    auto const targets = targets_of(AF_INET6);
+    auto const &target = targets.at(random() % targets.size());
+    auto const &t = target.address.ipv6.s6_addr;
+    // solicited node multicast address ff02::1:ffXX:XXXX
+    IP_address destination{};
+    destination.family = AF_INET6;
+    auto &d = destination.address.ipv6.s6_addr;
+    d[0] = 0xff;
+    d[1] = 0x02;
+    d[11] = 0x01;
+    d[12] = 0xff;
+    std::copy(&t[13], &t[16], &d[13]);
+    ether_addr const multicast{{0x33, 0x33, 0xff, t[13], t[14], t[15]}};
+    IP_address source = random_source(AF_INET6);
+    // link local
+    std::fill(&source.address.ipv6.s6_addr[0], &source.address.ipv6.s6_addr[8],
+              0);
+    source.address.ipv6.s6_addr[0] = 0xfe;
+    source.address.ipv6.s6_addr[1] = 0x80;
+
+    auto frame = create_ethernet_header(multicast, source_mac, ETHERTYPE_IPV6);
+    static auto const icmp_length = uint16_t{32};
+    add_ip_header(frame, source, destination, IPPROTO_ICMPV6, icmp_length, 255);
+    auto const icmp_start = frame.size();
+    // neighbor solicitation, code 0, checksum, reserved
+    frame.push_back(135);
+    frame.insert(std::end(frame), 7, 0);
+    add_bytes(frame, &t, 16);
+    // source link-layer address option of 8 bytes
+    frame.push_back(1);
+    frame.push_back(1);
+    add_bytes(frame, &source_mac, ETH_ALEN);
+    set_checksum(frame, icmp_start, icmp_start + 2,
+                 pseudo_header_sum(source, destination, IPPROTO_ICMPV6,
+                                   icmp_length));
+    return frame;
+  }
+
+  /** random bytes behind a known or random ethertype */
+  std::vector<uint8_t> junk() {
+    static std::array<uint16_t, 4> const ethertypes{
+        {ETHERTYPE_IP, ETHERTYPE_IPV6, ETHERTYPE_VLAN, 0}};
+    auto ethertype = ethertypes.at(random() % ethertypes.size());
+    if (ethertype == 0) {
+      ethertype = static_cast<uint16_t>(random());
+    }
+    auto frame =
+        create_ethernet_header(options.destination, source_mac, ethertype);
+    auto const length = 46 + random() % (1500 - 46);
+    std::generate_n(std::back_inserter(frame), length,
+                    [this]() { return random_byte(); });
+    return frame;
+  }
+
+public:
+  Frame_factory(Options const &optionss, ether_addr const &source_macc)
+      : options(optionss), source_mac(source_macc), random{} {}
+
+  std::vector<uint8_t> operator()(Frame_kind const kind) {
+    switch (kind) {
+    case Frame_kind::syn:
+      return syn();
+    case Frame_kind::wol:
+      return wol();
+    case Frame_kind::arp:
+      return arp();
+    case Frame_kind::ns:
+      return ns();
+    case Frame_kind::junk:
+      return junk();
+    default:
+      throw std::runtime_error("unknown frame kind");
+    }
+  }
+};
+
+/** interleaves the kinds by their weight */
+std::vector<std::vector<uint8_t>> build_pool(Options const &options,
+                                             ether_addr const &source_mac) {
+  static auto const pool_size = size_t{4096};
+  Frame_factory factory{options, source_mac};
+  unsigned int total_weight = 0;
+  for (auto const &kind_weight : options.mix) {
+    total_weight += kind_weight.second;
+  }
+  if (total_weight == 0) {
+    throw std::runtime_error("the frame mix is empty");
+  }
+  std::vector<std::vector<uint8_t>> pool;
+  pool.reserve(pool_size);
+  while (pool.size() < pool_size) {
+    for (auto const &kind_weight : options.mix) {
+      for (unsigned int i = 0; i < kind_weight.second; ++i) {
+        pool.emplace_back(factory(kind_weight.first));
+      }
+    }
+  }
+  return pool;
+}
+
+/** AF_PACKET socket bound to one interface */
+class Packet_socket : public Socket {
+public:
+  explicit Packet_socket(std::string const &iface)
+      : Socket(AF_PACKET, SOCK_RAW, 0) {
+    sockaddr_ll address{};
+    address.sll_family = AF_PACKET;
+    address.sll_ifindex = get_ifindex(iface);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (bind(fd(), reinterpret_cast<sockaddr const *>(&address),
+             sizeof(address)) != 0) {
+      throw std::runtime_error(std::string("bind() failed: ") +
+                               strerror(errno));
+    }
+  }
+};
+
+struct Totals {
+  uint64_t frames{0};
+  uint64_t bytes{0};
+  uint64_t full_queue{0};
+};
+
+void report(char const *what, Totals const &totals,
+            std::chrono::steady_clock::duration const elapsed) {
+  auto const seconds = std::chrono::duration<double>(elapsed).count();
+  LOG(LOG_NOTICE,
+      "%s: %" PRIu64 " frames, %.0f frames/s, %.1f Mbit/s, %" PRIu64
+      " full send queues",
+      what, totals.frames, totals.frames / seconds,
+      totals.bytes * 8 / seconds / 1e6, totals.full_queue);
+}
+
+void flood(Options const &options) {
+  Packet_socket sock{options.iface};
+  auto const pool = build_pool(options, sock.get_hwaddr(options.iface));
+  Paced_sender paced{options.batch, options.rate};
+
+  Totals totals;
+  Totals second;
+  size_t next_frame = 0;
+  auto const start = std::chrono::steady_clock::now();
+  auto second_start = start;
+  while (!is_signaled()) {
+    auto const now = std::chrono::steady_clock::now();
+    if (options.duration.count() != 0 && now - start >= options.duration) {
+      break;
+    }
+    if (now - second_start >= std::chrono::seconds{1}) {
+      report("last second", second, now - second_start);
+      second = Totals{};
+      second_start = now;
+    }
+    auto const full_queues = paced.full_queues();
+    auto const sent = paced.send(sock, pool, next_frame, options.batch);
+    if (paced.full_queues() != full_queues) {
+      ++totals.full_queue;
+      ++second.full_queue;
+    }
+    for (unsigned int i = 0; i < sent; ++i) {
+      auto const size = pool.at((next_frame + i) % pool.size()).size();
+      totals.bytes += size;
+      second.bytes += size;
+    }
+    totals.frames += sent;
+    second.frames += sent;
+    next_frame += sent;
+  }
+  report("total", totals, std::chrono::steady_clock::now() - start);
+}
+
+void print_help() {
+  log_string(LOG_NOTICE,
+             "usage: synflood -i iface -t ip[,ip...] [options]\n"
+             "  -i, --interface IFACE  where to send the frames\n"
+             "  -t, --targets IPS      emulated addresses to send to\n"
+             "  -p, --ports PORTS      destination ports of the SYNs (80)\n"
+             "  -r, --rate FPS         frames per second, 0 for no limit "
+             "(1000)\n"
+             "  -d, --duration S       seconds to send, 0 until SIGINT (10)\n"
+             "  -x, --mix KINDS        syn, wol, arp, ns and junk with "
+             "optional weights, e.g. syn:90,junk:10 (syn)\n"
+             "  -b, --batch N          frames per sendmmsg() (64)\n"
+             "  -D, --destination MAC  ethernet destination of SYNs and junk "
+             "(broadcast)\n"
+             "  -w, --wol-macs MACS    macs of the magic packets (random)");
+}
+
+Options read_options(int const argc, char *const argv[]) {
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+  static const option long_options[] = {
+      {"help", no_argument, nullptr, 'h'},
+      {"interface", required_argument, nullptr, 'i'},
+      {"targets", required_argument, nullptr, 't'},
+      {"ports", required_argument, nullptr, 'p'},
+      {"rate", required_argument, nullptr, 'r'},
+      {"duration", required_argument, nullptr, 'd'},
+      {"mix", required_argument, nullptr, 'x'},
+      {"batch", required_argument, nullptr, 'b'},
+      {"destination", required_argument, nullptr, 'D'},
+      {"wol-macs", required_argument, nullptr, 'w'},
+      {nullptr, 0, nullptr, 0}};
+  Options options;
+  int c = -1;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  while ((c = getopt_long(argc, argv, "hi:t:p:r:d:x:b:D:w:", long_options,
+                          nullptr)) != -1) {
+    switch (c) {
+    case 'i':
+      options.iface = validate_iface(optarg);
+      break;
+    case 't':
+      options.targets = parse_items(split(std::string{optarg}, ','),
+                                    [](std::string const &ip) {
+                                      return parse_ip(ip);
+                                    });
+      break;
+    case 'p':
+      options.ports = parse_items(
+          split(std::string{optarg}, ','),
+          [](std::string const &p) { return str_to_integral<uint16_t>(p); });
+      break;
+    case 'r':
+      options.rate = str_to_integral<uint64_t>(optarg);
+      break;
+    case 'd':
+      options.duration =
+          std::chrono::seconds{str_to_integral<unsigned int>(optarg)};
+      break;
+    case 'x':
+      options.mix = parse_mix(optarg);
+      break;
+    case 'b':
+      options.batch = std::max(1U, str_to_integral<unsigned int>(optarg));
+      break;
+    case 'D':
+      options.destination = mac_to_binary(optarg);
+      break;
+    case 'w':
+      options.wol_macs = parse_items(split(std::string{optarg}, ','),
+                                     [](std::string const &mac) {
+                                       return mac_to_binary(mac);
+                                     });
+      break;
+    case 'h':
+      print_help();
+      exit(0);
+    default:
+      print_help();
+      exit(1);
+    }
+  }
+  if (options.iface.empty() || options.targets.empty()) {
+    print_help();
+    exit(1);
+  }
+  return options;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  try {
+    auto const options = read_options(argc, argv);
+    setup_signals();
+    flood(options);
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "synflood: %s", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -14,49 +14,388 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include "container_utils.h"
 #include "ethernet.h"
+#include "int_utils.h"
+#include "ip_address.h"
 #include "ip_utils.h"
+#include "libsleep_proxy.h"
 #include "log.h"
+#include "socket.h"
 #include "wol.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <getopt.h>
+#include <iostream>
+#include <linux/if_packet.h>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
 
 namespace {
-void print_help() { log_string(LOG_NOTICE, "usage: [-i iface] mac"); }
+/** a host to wake, with the interface and ip given in the host list */
+struct Host {
+  ether_addr mac{};
+  /** UDP broadcasts if empty */
+  std::string iface{};
+  /** the host is not pinged if empty */
+  std::string ip{};
+};
 
-void check_arguments(const int argc, const int count) {
-  if (argc < count) {
+struct Options {
+  std::vector<Host> hosts{};
+  /** the interface of hosts which do not name their own */
+  std::string iface{};
+  /** magic packets per second, 0 sends as fast as possible */
+  uint64_t rate{0};
+  /** how often every magic packet is sent */
+  unsigned int repeat{1};
+  std::chrono::milliseconds gap{100};
+  unsigned int batch{64};
+  bool confirm{false};
+  /** concurrent pings while confirming */
+  unsigned int jobs{16};
+  std::chrono::seconds timeout{120};
+};
+
+std::string checked_iface(std::string const &iface) {
+  static auto const max_ethernet_name_size = size_t{13};
+  if (validate_iface(iface).size() > max_ethernet_name_size) {
+    throw std::invalid_argument(
+        "maximum of 13 characters allowed for ethernet name: " + iface);
+  }
+  return iface;
+}
+
+bool is_ip(std::string const &word) {
+  auto const pure = word.substr(0, word.find('/'));
+  std::array<uint8_t, sizeof(in6_addr)> binary{};
+  return inet_pton(AF_INET, pure.c_str(), binary.data()) == 1 ||
+         inet_pton(AF_INET6, pure.c_str(), binary.data()) == 1;
+}
+
+/** reads lines of MAC [IFACE] [IP], # starts a comment */
+std::vector<Host> read_hosts(std::istream &in) {
+  std::vector<Host> hosts;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream words{line.substr(0, line.find('#'))};
+    std::string word;
+    if (!(words >> word)) {
+      continue;
+    }
+    Host host;
+    host.mac = mac_to_binary(word);
+    while (words >> word) {
+      if (is_ip(word)) {
+        host.ip = get_pure_ip(parse_ip(word));
+      } else {
+        host.iface = checked_iface(word);
+      }
+    }
+    hosts.push_back(std::move(host));
+  }
+  return hosts;
+}
+
+std::vector<Host> read_hosts(std::string const &path) {
+  if (path == "-") {
+    return read_hosts(std::cin);
+  }
+  std::ifstream file{path};
+  if (!file) {
+    throw std::runtime_error("can't open " + path + ": " + strerror(errno));
+  }
+  return read_hosts(file);
+}
+
+/**
+ * The magic packets of all hosts reached through one interface, built up
+ * front and sent with sendmmsg(). Without an interface they are UDP
+ * broadcasts to port 9.
+ */
+class Sender : public Socket {
+  bool const udp;
+  sockaddr_in broadcast_port9{AF_INET, htons(9), {INADDR_BROADCAST}, {0}};
+  ether_addr source{};
+
+public:
+  std::vector<std::vector<uint8_t>> frames{};
+
+  explicit Sender(std::string const &iface)
+      : Socket(iface.empty() ? AF_INET : AF_PACKET,
+               iface.empty() ? SOCK_DGRAM : SOCK_RAW),
+        udp{iface.empty()} {
+    if (udp) {
+      set_sock_opt(SOL_SOCKET, SO_BROADCAST, 1);
+      return;
+    }
+    sockaddr_ll address{};
+    address.sll_family = AF_PACKET;
+    address.sll_ifindex = get_ifindex(iface);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (bind(fd(), reinterpret_cast<sockaddr const *>(&address),
+             sizeof(address)) != 0) {
+      throw std::runtime_error(std::string("bind() failed: ") +
+                               strerror(errno));
+    }
+    source = get_hwaddr(iface);
+  }
+
+  void add(ether_addr const &mac) {
+    if (udp) {
+      frames.push_back(create_wol_payload(mac));
+    } else {
+      frames.push_back(create_ethernet_header(mac, source, 0x0842) +
+                       create_wol_payload(mac));
+    }
+  }
+
+  /** where the frames go, nullptr for a bound packet socket */
+  sockaddr const *destination() const {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return udp ? reinterpret_cast<sockaddr const *>(&broadcast_port9)
+               : nullptr;
+  }
+
+  socklen_t destination_size() const {
+    return udp ? socklen_t{sizeof(broadcast_port9)} : 0;
+  }
+};
+
+std::vector<std::unique_ptr<Sender>> build_senders(Options const &options) {
+  std::map<std::string, std::unique_ptr<Sender>> by_iface;
+  for (auto const &host : options.hosts) {
+    auto &sender = by_iface[host.iface];
+    if (sender == nullptr) {
+      sender = std::make_unique<Sender>(host.iface);
+    }
+    sender->add(host.mac);
+  }
+  std::vector<std::unique_ptr<Sender>> senders;
+  for (auto &iface_sender : by_iface) {
+    senders.push_back(std::move(iface_sender.second));
+  }
+  return senders;
+}
+
+/** sends every frame repeat times, at most rate frames per second */
+void send_all(std::vector<std::unique_ptr<Sender>> &senders,
+              Options const &options) {
+  using namespace std::chrono;
+  Paced_sender paced{options.batch, options.rate};
+  auto const start = steady_clock::now();
+  uint64_t total = 0;
+  for (unsigned int r = 0; r < options.repeat && !is_signaled(); ++r) {
+    if (r != 0) {
+      std::this_thread::sleep_for(options.gap);
+    }
+    paced.restart();
+    for (auto &sender : senders) {
+      auto const &frames = sender->frames;
+      size_t next = 0;
+      while (next < frames.size() && !is_signaled()) {
+        auto const sent =
+            paced.send(*sender, frames, next, frames.size() - next,
+                       sender->destination(), sender->destination_size());
+        next += sent;
+        total += sent;
+      }
+    }
+  }
+  LOG(LOG_NOTICE,
+      "sent %" PRIu64 " magic packets for %zu hosts in %.0f ms, %" PRIu64
+      " full send queues",
+      total, options.hosts.size(),
+      duration<double, std::milli>(steady_clock::now() - start).count(),
+      paced.full_queues());
+}
+
+/**
+ * pings every host with an ip until it answers or the timeout passed, at most
+ * jobs pings at a time. Returns whether all of them answered.
+ */
+bool confirm(Options const &options,
+             std::chrono::steady_clock::time_point const woken) {
+  using namespace std::chrono;
+  struct Ping {
+    Host const *host;
+    IP_address ip;
+    std::future<uint8_t> answer;
+  };
+  // a host gets pinged again one second after its last attempt at the earliest
+  std::deque<std::pair<Host const *, steady_clock::time_point>> waiting;
+  for (auto const &host : options.hosts) {
+    if (!host.ip.empty()) {
+      waiting.emplace_back(&host, woken);
+    }
+  }
+  auto const pinged = waiting.size();
+  size_t awake = 0;
+  std::vector<Ping> running;
+  while ((!waiting.empty() || !running.empty()) && !is_signaled()) {
+    auto const now = steady_clock::now();
+    while (running.size() < options.jobs && !waiting.empty() &&
+           waiting.front().second <= now) {
+      auto const *host = waiting.front().first;
+      auto const ip = parse_ip(host->ip);
+      running.push_back(Ping{host, ip, ping_async(host->iface, ip)});
+      waiting.pop_front();
+    }
+    for (auto ping = std::begin(running); ping != std::end(running);) {
+      if (ping->answer.wait_for(seconds{0}) != std::future_status::ready) {
+        ++ping;
+        continue;
+      }
+      auto const mac = binary_to_mac(ping->host->mac);
+      auto const after = duration<double>(steady_clock::now() - woken);
+      if (ping_succeeded(ping->answer)) {
+        LOG(LOG_NOTICE, "%s (%s) woke after %.1f s", mac.c_str(),
+            ping->host->ip.c_str(), after.count());
+        ++awake;
+      } else if (after >= options.timeout) {
+        LOG(LOG_WARNING, "%s (%s) did not answer within %.0f s", mac.c_str(),
+            ping->host->ip.c_str(), after.count());
+      } else {
+        waiting.emplace_back(ping->host, steady_clock::now() + seconds{1});
+      }
+      ping = running.erase(ping);
+    }
+    std::this_thread::sleep_for(milliseconds{10});
+  }
+  LOG(LOG_NOTICE, "%zu of %zu hosts are awake", awake, pinged);
+  return awake == pinged;
+}
+
+void print_help() {
+  log_string(LOG_NOTICE,
+             "usage: waker [options] [mac...]\n"
+             "  -i, --interface IFACE  send ethernet frames on IFACE instead "
+             "of UDP broadcasts\n"
+             "  -f, --file FILE        wake the hosts in FILE, - for stdin, "
+             "with one\n"
+             "                         MAC [IFACE] [IP] per line\n"
+             "  -r, --rate PPS         magic packets per second, 0 for no "
+             "limit (0)\n"
+             "  -n, --repeat N         send every magic packet N times (1)\n"
+             "  -g, --gap MS           milliseconds between repetitions "
+             "(100)\n"
+             "  -b, --batch N          packets per sendmmsg() (64)\n"
+             "  -c, --confirm          ping the hosts with an IP until they "
+             "answer,\n"
+             "                         link-local IPv6 needs an interface\n"
+             "  -j, --jobs N           concurrent pings (16)\n"
+             "  -t, --timeout S        seconds to wait for answers (120)");
+}
+
+Options read_options(int const argc, char *const argv[]) {
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays)
+  static const option long_options[] = {
+      {"help", no_argument, nullptr, 'h'},
+      {"interface", required_argument, nullptr, 'i'},
+      {"file", required_argument, nullptr, 'f'},
+      {"rate", required_argument, nullptr, 'r'},
+      {"repeat", required_argument, nullptr, 'n'},
+      {"gap", required_argument, nullptr, 'g'},
+      {"batch", required_argument, nullptr, 'b'},
+      {"confirm", no_argument, nullptr, 'c'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"timeout", required_argument, nullptr, 't'},
+      {nullptr, 0, nullptr, 0}};
+  Options options;
+  std::vector<std::string> files;
+  int c = -1;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+  while ((c = getopt_long(argc, argv, "hi:f:r:n:g:b:cj:t:", long_options,
+                          nullptr)) != -1) {
+    switch (c) {
+    case 'i':
+      options.iface = checked_iface(optarg);
+      break;
+    case 'f':
+      files.emplace_back(optarg);
+      break;
+    case 'r':
+      options.rate = str_to_integral<uint64_t>(optarg);
+      break;
+    case 'n':
+      options.repeat = std::max(1U, str_to_integral<unsigned int>(optarg));
+      break;
+    case 'g':
+      options.gap =
+          std::chrono::milliseconds{str_to_integral<unsigned int>(optarg)};
+      break;
+    case 'b':
+      options.batch = std::max(1U, str_to_integral<unsigned int>(optarg));
+      break;
+    case 'c':
+      options.confirm = true;
+      break;
+    case 'j':
+      options.jobs = std::max(1U, str_to_integral<unsigned int>(optarg));
+      break;
+    case 't':
+      options.timeout =
+          std::chrono::seconds{str_to_integral<unsigned int>(optarg)};
+      break;
+    case 'h':
+      print_help();
+      exit(0);
+    default:
+      print_help();
+      exit(1);
+    }
+  }
+  for (auto const &file : files) {
+    auto const hosts = read_hosts(file);
+    options.hosts.insert(std::end(options.hosts), std::begin(hosts),
+                         std::end(hosts));
+  }
+  for (int i = optind; i < argc; ++i) {
+    Host host;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    host.mac = mac_to_binary(argv[i]);
+    options.hosts.push_back(host);
+  }
+  if (options.hosts.empty()) {
     print_help();
     exit(1);
   }
+  for (auto &host : options.hosts) {
+    if (host.iface.empty()) {
+      host.iface = options.iface;
+    }
+    // a link-local address is only reachable with the interface as scope
+    if (options.confirm && host.iface.empty() && host.ip.find("fe80") == 0) {
+      throw std::invalid_argument("pinging " + host.ip +
+                                  " needs an interface, give one with -i or "
+                                  "in the host list");
+    }
+  }
+  return options;
 }
 } // namespace
 
 int main(int argc, char *argv[]) {
-  int count = 2;
-  unsigned int mac_pos = 1;
-  check_arguments(argc, count);
-  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  if (std::string("-i") == argv[1]) {
-    count += 2;
-    mac_pos += 2;
-  }
-  check_arguments(argc, count);
-  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  ether_addr mac = mac_to_binary(argv[mac_pos]);
-  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  if (std::string("-i") != argv[1]) {
-    wol_udp(mac);
-  } else {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-    std::string iface = validate_iface(argv[2]);
-    static auto const max_ethernet_name_size = uint8_t{13};
-    if (iface.size() > max_ethernet_name_size) {
-      log_string(LOG_NOTICE,
-                 "maximum of 13 characters allowed for ethernet name");
+  try {
+    auto const options = read_options(argc, argv);
+    setup_signals();
+    auto senders = build_senders(options);
+    auto const woken = std::chrono::steady_clock::now();
+    send_all(senders, options);
+    if (options.confirm && !confirm(options, woken)) {
       return 1;
     }
-
-    wol_ethernet(iface, mac);
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "waker: %s", e.what());
+    return 1;
   }
   return 0;
 }
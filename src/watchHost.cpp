@@ -15,43 +15,91 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "args.h"
+#include "config_snapshot.h"
+#include "config_watcher.h"
+#include "event_loop.h"
+#include "file_descriptor.h"
 #include "libsleep_proxy.h"
 #include "log.h"
+#include "metrics.h"
+#include "wake_latency.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <csignal>
+#include <cstring>
+#include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/signalfd.h>
 #include <thread>
 #include <type_traits>
+#include <unistd.h>
 
 namespace {
 template <typename Container>
 bool ping_ips(const std::string &iface, const Container &ips) {
-  std::vector<std::future<bool>> futures;
-  futures.reserve(ips.size());
+  std::vector<std::future<uint8_t>> pings;
+  pings.reserve(ips.size());
   for (const auto &ip : ips) {
-    futures.emplace_back(std::async(ping_and_wait, iface, ip, 1));
+    pings.emplace_back(ping_async(iface, ip));
   }
-  return std::any_of(std::begin(futures), std::end(futures),
-                     [](std::future<bool> &f) { return f.get(); });
+  // wait for all of them, so pings of one round do not pile up
+  bool answered = false;
+  for (auto &ping : pings) {
+    answered = ping_succeeded(ping) || answered;
+  }
+  return answered;
 }
 
-void thread_main(const Args &args) {
+/** tells a host thread to stop, even while it sleeps */
+class Stop_flag {
+  std::mutex mutex{};
+  std::condition_variable stopped_cv{};
+  bool stopped{false};
+
+public:
+  void set() {
+    {
+      std::lock_guard<std::mutex> const lock{mutex};
+      stopped = true;
+    }
+    stopped_cv.notify_all();
+  }
+
+  bool is_set() {
+    std::lock_guard<std::mutex> const lock{mutex};
+    return stopped;
+  }
+
+  /** sleeps for duration or until set(), returns whether it is set */
+  bool wait_for(std::chrono::milliseconds const duration) {
+    std::unique_lock<std::mutex> lock{mutex};
+    return stopped_cv.wait_for(lock, duration, [this]() { return stopped; });
+  }
+};
+
+void thread_main(const Args &args, Stop_flag &stop) {
+  Host_lifecycle lifecycle{host_state_metrics(args.hostname)};
   bool loop = true;
-  while (!is_signaled() && loop) {
-    log_string(LOG_INFO, "ping " + args.hostname);
-    while (ping_ips(args.interface, args.address) && !is_signaled()) {
-      static auto const sleep_time = std::chrono::milliseconds(500);
-      std::this_thread::sleep_for(sleep_time);
+  while (!is_signaled() && !stop.is_set() && loop) {
+    LOG(LOG_INFO, "ping %s", args.hostname.c_str());
+    static auto const sleep_time = std::chrono::milliseconds(500);
+    while (ping_ips(args.interface, args.address) && !is_signaled() &&
+           !stop.wait_for(sleep_time)) {
     }
-    if (is_signaled()) {
-      return;
+    if (is_signaled() || stop.is_set()) {
+      break;
     }
     try {
-      Emulate_host_status const status = emulate_host(args);
+      Emulate_host_status const status = emulate_host(args, lifecycle);
       loop = Emulate_host_status::duplicate_address == status ||
              Emulate_host_status::success == status;
     } catch (const std::exception &e) {
-      log(LOG_ERR, "caught exception what(): %s", e.what());
+      LOG(LOG_ERR, "caught exception what(): %s", e.what());
       raise(SIGTERM);
     } catch (...) {
       log_string(LOG_ERR,
@@ -59,34 +107,215 @@ void thread_main(const Args &args) {
       raise(SIGTERM);
     }
   }
-  log_string(LOG_INFO, "finished watching " + args.hostname);
+  LOG(LOG_INFO, "finished watching %s", args.hostname.c_str());
+}
+
+/** watches a host in its own thread until destroyed */
+class Host_watcher {
+  Args const args;
+  Stop_flag stop;
+  std::atomic_bool finished;
+  std::thread thread;
+
+public:
+  explicit Host_watcher(Args const &argss)
+      : args{argss}, stop{}, finished{false}, thread{[this]() {
+          thread_main(args, stop);
+          finished = true;
+        }} {}
+
+  Host_watcher(Host_watcher const &) = delete;
+  Host_watcher(Host_watcher &&) = delete;
+
+  ~Host_watcher() {
+    request_stop();
+    thread.join();
+    resume_emulation(args);
+  }
+
+  Host_watcher &operator=(Host_watcher const &) = delete;
+  Host_watcher &operator=(Host_watcher &&) = delete;
+
+  /** lets the thread stop without waiting for it */
+  void request_stop() {
+    stop.set();
+    cancel_emulation(args);
+  }
+
+  bool is_finished() const { return finished; }
+};
+
+/**
+ * Rereads the configuration and starts, stops or restarts only the hosts
+ * which changed. Keeps the running configuration if the new one is invalid.
+ */
+void reload(std::string const &config_file, std::vector<Args> &config,
+            std::vector<std::unique_ptr<Host_watcher>> &watchers) {
+  auto const start = std::chrono::steady_clock::now();
+  std::vector<Args> new_config;
+  try {
+    new_config = read_config(config_file);
+  } catch (std::exception const &e) {
+    LOG(LOG_ERR, "keeping the running configuration: %s", e.what());
+    return;
+  }
+  if (new_config.empty()) {
+    LOG(LOG_ERR, "keeping the running configuration: no host in %s",
+        config_file.c_str());
+    return;
+  }
+  auto const diff = diff_config(config, new_config);
+  if (diff.stopped.empty() && diff.started.empty()) {
+    LOG(LOG_INFO, "%s did not change", config_file.c_str());
+    return;
+  }
+  // all of them unwind their firewall rules and IPs at the same time
+  for (auto const i : diff.stopped) {
+    LOG(LOG_INFO, "stopping %s", host_identity(config.at(i)).c_str());
+    watchers.at(i)->request_stop();
+  }
+  std::vector<std::unique_ptr<Host_watcher>> new_watchers(new_config.size());
+  for (auto const &old_new : diff.kept) {
+    new_watchers.at(old_new.second) = std::move(watchers.at(old_new.first));
+  }
+  watchers.clear();
+  for (auto const i : diff.started) {
+    LOG(LOG_INFO, "starting %s", host_identity(new_config.at(i)).c_str());
+    new_watchers.at(i) = std::make_unique<Host_watcher>(new_config.at(i));
+  }
+  watchers = std::move(new_watchers);
+  config = std::move(new_config);
+  LOG(LOG_NOTICE,
+      "reloaded %s in %.1f ms: %zu hosts stopped, %zu started, %zu kept",
+      config_file.c_str(),
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start)
+          .count(),
+      diff.stopped.size(), diff.started.size(), diff.kept.size());
+}
+
+/**
+ * Logs the wake latencies whenever SIGUSR1 arrives. The signal has to be
+ * blocked in all threads before, so only this thread receives it.
+ */
+class Latency_dump_thread {
+  std::atomic_bool stopped;
+  std::thread thread;
+
+  void main(sigset_t const signals) {
+    int signal = 0;
+    while (sigwait(&signals, &signal) == 0 && !stopped) {
+      log_wake_latency();
+    }
+  }
+
+public:
+  explicit Latency_dump_thread(sigset_t const &signals)
+      : stopped{false}, thread{[this, signals]() { main(signals); }} {}
+
+  Latency_dump_thread(Latency_dump_thread const &) = delete;
+  Latency_dump_thread(Latency_dump_thread &&) = delete;
+
+  ~Latency_dump_thread() {
+    stopped = true;
+    pthread_kill(thread.native_handle(), SIGUSR1);
+    thread.join();
+  }
+
+  Latency_dump_thread &operator=(Latency_dump_thread const &) = delete;
+  Latency_dump_thread &operator=(Latency_dump_thread &&) = delete;
+};
+
+sigset_t block_signal(int const signum) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, signum);
+  auto const error = pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  if (error != 0) {
+    throw std::runtime_error(std::string("pthread_sigmask() failed: ") +
+                             strerror(error));
+  }
+  return signals;
 }
 } // namespace
 
 int main(int argc, char *argv[]) {
   try {
+    // before any thread is started, they inherit the signal mask
+    auto const usr1 = block_signal(SIGUSR1);
+    auto const hup = block_signal(SIGHUP);
     setup_signals();
     auto argss = read_commandline(argc, argv);
     if (argss.empty()) {
       log_string(LOG_ERR, "no configuration given");
       return 1;
     }
+    if (argss.at(0).compile_config) {
+      auto const &config_file = argss.at(0).config_file;
+      try {
+        auto const hosts = compile_config(config_file);
+        LOG(LOG_NOTICE, "wrote %zu hosts to %s", hosts,
+            snapshot_path(config_file).c_str());
+        return 0;
+      } catch (std::exception const &e) {
+        LOG(LOG_ERR, "can't compile %s: %s", config_file.c_str(), e.what());
+        return 1;
+      }
+    }
     if (argss.at(0).syslog) {
       // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
       setup_log(argv[0], 0, LOG_DAEMON);
     }
-    std::vector<std::thread> threads;
-    threads.reserve(argss.size());
-    for (auto &args : argss) {
-      threads.emplace_back(thread_main, std::move(args));
+    // packet handling threads must not wait for syslog
+    start_async_log();
+    Latency_dump_thread const latency_dump{usr1};
+    std::unique_ptr<Metrics_server> metrics_server;
+    if (!argss.at(0).metrics_socket.empty()) {
+      metrics_server =
+          std::make_unique<Metrics_server>(argss.at(0).metrics_socket);
     }
-    std::for_each(std::begin(threads), std::end(threads), [](std::thread &t) {
-      if (t.joinable()) {
-        t.join();
+    std::string const config_file = argss.at(0).config_file;
+    std::vector<std::unique_ptr<Host_watcher>> watchers;
+    watchers.reserve(argss.size());
+    for (auto const &args : argss) {
+      watchers.emplace_back(std::make_unique<Host_watcher>(args));
+    }
+
+    Event_loop loop;
+    auto const reload_config = [&]() { reload(config_file, argss, watchers); };
+    Config_watcher config_watcher{config_file};
+    loop.add_fd(config_watcher.fd(), [&]() {
+      if (config_watcher.changed()) {
+        reload_config();
       }
     });
+    File_descriptor const sighup{
+        signalfd(-1, &hup, SFD_NONBLOCK | SFD_CLOEXEC)};
+    loop.add_fd(sighup, [&]() {
+      signalfd_siginfo info{};
+      while (read(sighup, &info, sizeof(info)) == sizeof(info)) {
+      }
+      reload_config();
+    });
+    // signals only set a flag, as do hosts which gave up
+    std::function<void()> check_finished;
+    check_finished = [&]() {
+      auto const all_finished = std::all_of(
+          std::begin(watchers), std::end(watchers),
+          [](std::unique_ptr<Host_watcher> const &watcher) {
+            return watcher->is_finished();
+          });
+      if (is_signaled() || all_finished) {
+        loop.stop();
+      } else {
+        loop.add_timer(std::chrono::milliseconds{500}, check_finished);
+      }
+    };
+    loop.add_timer(std::chrono::milliseconds{500}, check_finished);
+    loop.run();
   } catch (std::exception const &e) {
-    log(LOG_ERR, "something wrong: %s\n", e.what());
+    LOG(LOG_ERR, "something wrong: %s\n", e.what());
   }
+  stop_async_log();
   return 0;
 }
@@ -0,0 +1,158 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "address_index.h"
+
+#include "host_table.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <string>
+
+namespace {
+uint32_t lookup(Address_index const &index, std::string const &address) {
+  return index.lookup(parse_ip(address));
+}
+} // namespace
+
+class Address_index_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Address_index_test);
+  CPPUNIT_TEST(test_empty);
+  CPPUNIT_TEST(test_exact_addresses);
+  CPPUNIT_TEST(test_longest_prefix);
+  CPPUNIT_TEST(test_insertion_order);
+  CPPUNIT_TEST(test_families);
+  CPPUNIT_TEST(test_duplicates);
+  CPPUNIT_TEST(test_invalid_prefixes);
+  CPPUNIT_TEST(test_host_addresses);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp() override {}
+
+  void tearDown() override {}
+
+  static void test_empty() {
+    Address_index const index;
+    CPPUNIT_ASSERT(index.empty());
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "10.0.0.1"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, index.lookup(IP_address{}));
+  }
+
+  static void test_exact_addresses() {
+    Address_index index;
+    CPPUNIT_ASSERT(index.add(parse_ip("10.0.0.1"), 32, 1));
+    CPPUNIT_ASSERT(index.add(parse_ip("10.0.0.2"), 32, 2));
+    CPPUNIT_ASSERT(index.add(parse_ip("10.0.0.3"), 32, 3));
+    CPPUNIT_ASSERT(index.add(parse_ip("192.168.1.1"), 32, 4));
+    CPPUNIT_ASSERT_EQUAL(size_t{4}, index.size());
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "10.0.0.1"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{2}, lookup(index, "10.0.0.2"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{3}, lookup(index, "10.0.0.3/16"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{4}, lookup(index, "192.168.1.1"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "10.0.0.4"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "10.0.0.0"));
+  }
+
+  static void test_longest_prefix() {
+    Address_index index;
+    index.add(parse_ip("10.0.0.0"), 8, 1);
+    index.add(parse_ip("10.1.0.0"), 16, 2);
+    index.add(parse_ip("10.1.2.3"), 32, 3);
+    index.add(parse_ip("2001:db8::"), 32, 4);
+    index.add(parse_ip("2001:db8::1"), 128, 5);
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "10.200.0.1"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{2}, lookup(index, "10.1.2.4"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{3}, lookup(index, "10.1.2.3"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "11.0.0.1"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{4}, lookup(index, "2001:db8::2"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{5}, lookup(index, "2001:db8::1"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value,
+                         lookup(index, "2001:db9::1"));
+  }
+
+  static void test_insertion_order() {
+    // shorter prefixes added after longer ones split the existing nodes
+    Address_index index;
+    index.add(parse_ip("10.1.2.3"), 32, 3);
+    index.add(parse_ip("10.1.2.4"), 32, 4);
+    index.add(parse_ip("10.1.0.0"), 16, 2);
+    index.add(parse_ip("10.0.0.0"), 8, 1);
+    index.add(parse_ip("0.0.0.0"), 0, 0);
+    CPPUNIT_ASSERT_EQUAL(uint32_t{3}, lookup(index, "10.1.2.3"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{4}, lookup(index, "10.1.2.4"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{2}, lookup(index, "10.1.2.5"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "10.2.0.0"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{0}, lookup(index, "1.2.3.4"));
+    CPPUNIT_ASSERT_EQUAL(size_t{5}, index.size());
+  }
+
+  static void test_families() {
+    // the default route of IPv4 does not cover IPv6
+    Address_index index;
+    index.add(parse_ip("0.0.0.0"), 0, 1);
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "203.0.113.1"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "::1"));
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "fe80::1"));
+    index.add(parse_ip("::"), 0, 2);
+    CPPUNIT_ASSERT_EQUAL(uint32_t{2}, lookup(index, "fe80::1"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "203.0.113.1"));
+  }
+
+  static void test_duplicates() {
+    Address_index index;
+    CPPUNIT_ASSERT(index.add(parse_ip("10.0.0.1"), 32, 1));
+    CPPUNIT_ASSERT(!index.add(parse_ip("10.0.0.1"), 32, 2));
+    // the host bits do not count
+    CPPUNIT_ASSERT(index.add(parse_ip("10.0.0.1"), 24, 3));
+    CPPUNIT_ASSERT(!index.add(parse_ip("10.0.0.7"), 24, 4));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "10.0.0.1"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{3}, lookup(index, "10.0.0.2"));
+    CPPUNIT_ASSERT_EQUAL(size_t{2}, index.size());
+  }
+
+  static void test_invalid_prefixes() {
+    Address_index index;
+    CPPUNIT_ASSERT_THROW(index.add(parse_ip("10.0.0.1"), 33, 1),
+                         std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(index.add(parse_ip("::1"), 129, 1),
+                         std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(index.add(IP_address{}, 0, 1), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(
+        index.add(parse_ip("::1"), 128, Address_index::no_value),
+        std::invalid_argument);
+    CPPUNIT_ASSERT(index.empty());
+  }
+
+  static void test_host_addresses() {
+    auto const table = parse_host_table("host\n"
+                                        "name nas\n"
+                                        "address 10.0.0.2/16\n"
+                                        "address fe80::2\n"
+                                        "host\n"
+                                        "name tv\n"
+                                        "address 10.0.0.3/16\n"
+                                        "address 10.0.0.2/24\n");
+    auto const index = index_host_addresses(table);
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, index.size());
+    CPPUNIT_ASSERT_EQUAL(uint32_t{0}, lookup(index, "10.0.0.2"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{0}, lookup(index, "fe80::2"));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, lookup(index, "10.0.0.3"));
+    // the subnets are not part of the index
+    CPPUNIT_ASSERT_EQUAL(Address_index::no_value, lookup(index, "10.0.0.4"));
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Address_index_test);
@@ -18,6 +18,7 @@
 
 #include "ethernet.h"
 #include "ip_utils.h"
+#include "log.h"
 #include "packet_test_utils.h"
 #include "to_string.h"
 
@@ -37,11 +38,18 @@ class Args_test : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_ping_tries);
   CPPUNIT_TEST(test_wol_method);
   CPPUNIT_TEST(test_syslog);
+  CPPUNIT_TEST(test_global_options);
   CPPUNIT_TEST(test_read_file);
   CPPUNIT_TEST(test_print_help);
   CPPUNIT_TEST(test_ostream_operator_with_default_initialized_args);
   CPPUNIT_TEST(test_ostream_operator_with_value_initialized_args);
   CPPUNIT_TEST(test_read_command_line_weird_option);
+  CPPUNIT_TEST(test_config_file);
+  CPPUNIT_TEST(test_read_config);
+  CPPUNIT_TEST(test_equality);
+  CPPUNIT_TEST(test_host_identity);
+  CPPUNIT_TEST(test_diff_config);
+  CPPUNIT_TEST(test_diff_config_with_shared_identity);
   CPPUNIT_TEST_SUITE_END();
   std::string interface = "lo";
   std::vector<std::string> addresses{"fe80::123/64"};
@@ -214,6 +222,18 @@ public:
     CPPUNIT_ASSERT(!Args().syslog);
   }
 
+  static void test_global_options() {
+    std::vector<std::string> params{"args_test", "--metrics-socket",
+                                    "/run/sleep-proxy.sock", "-l", "notice"};
+    CPPUNIT_ASSERT(get_args(params).empty());
+    CPPUNIT_ASSERT_EQUAL(std::string{"/run/sleep-proxy.sock"},
+                         Args().metrics_socket);
+    CPPUNIT_ASSERT_EQUAL(LOG_NOTICE, get_log_level());
+    reset();
+    CPPUNIT_ASSERT(Args().metrics_socket.empty());
+    CPPUNIT_ASSERT_EQUAL(LOG_DEBUG, get_log_level());
+  }
+
   void test_read_file() {
     auto args = get_args("watchhosts");
     CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long>(3), args.size());
@@ -271,7 +291,7 @@ public:
     CPPUNIT_ASSERT_EQUAL(
         std::string("Args(interface = , address = , ports = , mac = "
                     "0:0:0:0:0:0, hostname = , print_tries = 0, wol_method = "
-                    "ethernet, syslog = 0)"),
+                    "ethernet, syslog = 0, capture_workers = 0)"),
         ss.str());
   }
 
@@ -282,7 +302,7 @@ public:
         std::string(
             "Args(interface = lo, address = fe80::123/64, ports = 12345, mac = "
             "1:12:34:45:67:89, hostname = , print_tries = 5, wol_method = "
-            "ethernet, syslog = 0)"),
+            "ethernet, syslog = 0, capture_workers = 0)"),
         ss.str());
   }
 
@@ -312,6 +332,92 @@ public:
     CPPUNIT_ASSERT_EQUAL(std::string("got unknown option: f"), messages.at(0));
     CPPUNIT_ASSERT_EQUAL(std::string("got unknown option: c"), messages.at(1));
   }
+
+  static void test_config_file() {
+    CPPUNIT_ASSERT(Args().config_file.empty());
+    auto const args = get_args("watchhosts");
+    CPPUNIT_ASSERT_EQUAL(get_executable_directory() + "/watchhosts",
+                         args.at(0).config_file);
+    reset();
+    CPPUNIT_ASSERT(Args().config_file.empty());
+  }
+
+  static void test_read_config() {
+    auto const args = read_config(get_executable_directory() + "/watchhosts");
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), args.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"test2"}, args.at(1).hostname);
+    CPPUNIT_ASSERT(
+        read_config(get_executable_directory() + "/watchhosts-empty").empty());
+    CPPUNIT_ASSERT_THROW(read_config(get_executable_directory() + "/missing"),
+                         std::runtime_error);
+  }
+
+  void test_equality() {
+    Args const args = get_args();
+    CPPUNIT_ASSERT(args == get_args());
+    ports = std::vector<std::string>{"22"};
+    CPPUNIT_ASSERT(args != get_args());
+    ports = std::vector<std::string>{"12345"};
+    mac = "1:12:34:45:67:8a";
+    CPPUNIT_ASSERT(args != get_args());
+    mac = "1:12:34:45:67:89";
+    wol_method = "udp";
+    CPPUNIT_ASSERT(args != get_args());
+  }
+
+  void test_host_identity() {
+    CPPUNIT_ASSERT_EQUAL(std::string{"1:12:34:45:67:89"},
+                         host_identity(get_args()));
+    hostname = "nas";
+    CPPUNIT_ASSERT_EQUAL(std::string{"nas"}, host_identity(get_args()));
+  }
+
+  Args host(std::string const &name, std::string const &port) {
+    hostname = name;
+    ports = std::vector<std::string>{port};
+    return get_args();
+  }
+
+  void test_diff_config() {
+    std::vector<Args> old_config;
+    old_config.push_back(host("a", "22"));
+    old_config.push_back(host("b", "22"));
+    old_config.push_back(host("c", "22"));
+    std::vector<Args> new_config;
+    new_config.push_back(host("d", "22"));
+    new_config.push_back(host("c", "22"));
+    new_config.push_back(host("a", "80"));
+
+    auto const diff = diff_config(old_config, new_config);
+    CPPUNIT_ASSERT((std::vector<size_t>{0, 1}) == diff.stopped);
+    CPPUNIT_ASSERT((std::vector<size_t>{0, 2}) == diff.started);
+    CPPUNIT_ASSERT((std::vector<std::pair<size_t, size_t>>{{2, 1}}) ==
+                   diff.kept);
+
+    auto const same = diff_config(old_config, old_config);
+    CPPUNIT_ASSERT(same.stopped.empty());
+    CPPUNIT_ASSERT(same.started.empty());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), same.kept.size());
+
+    auto const emptied = diff_config(old_config, {});
+    CPPUNIT_ASSERT((std::vector<size_t>{0, 1, 2}) == emptied.stopped);
+  }
+
+  void test_diff_config_with_shared_identity() {
+    std::vector<Args> old_config;
+    old_config.push_back(host("", "22"));
+    old_config.push_back(host("", "80"));
+    std::vector<Args> new_config;
+    new_config.push_back(host("", "22"));
+    new_config.push_back(host("", "80"));
+    new_config.push_back(host("", "443"));
+
+    auto const diff = diff_config(old_config, new_config);
+    CPPUNIT_ASSERT(diff.stopped.empty());
+    CPPUNIT_ASSERT((std::vector<size_t>{2}) == diff.started);
+    CPPUNIT_ASSERT((std::vector<std::pair<size_t, size_t>>{{0, 0}, {1, 1}}) ==
+                   diff.kept);
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Args_test);
@@ -0,0 +1,98 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "argv_arena.h"
+#include "container_utils.h"
+#include "spawn_process.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class Argv_arena_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Argv_arena_test);
+  CPPUNIT_TEST(test_append);
+  CPPUNIT_TEST(test_split_like_split);
+  CPPUNIT_TEST(test_argv);
+  CPPUNIT_TEST(test_clear_keeps_arguments_apart);
+  CPPUNIT_TEST(test_spawn);
+  CPPUNIT_TEST_SUITE_END();
+
+  static std::vector<std::string> args(Argv_arena const &argv) {
+    std::vector<std::string> result;
+    for (auto i = size_t{0}; i < argv.size(); ++i) {
+      result.emplace_back(argv.at(i));
+    }
+    return result;
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_append() {
+    Argv_arena argv;
+    CPPUNIT_ASSERT(argv.empty());
+    argv << "iptables" << std::string{"-w"} << 22UL << "";
+    CPPUNIT_ASSERT_EQUAL(size_t{4}, argv.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"iptables"}, std::string{argv.at(0)});
+    CPPUNIT_ASSERT_EQUAL(std::string{"-w"}, std::string{argv.at(1)});
+    CPPUNIT_ASSERT_EQUAL(std::string{"22"}, std::string{argv.at(2)});
+    CPPUNIT_ASSERT_EQUAL(std::string{}, std::string{argv.at(3)});
+    CPPUNIT_ASSERT_EQUAL(std::string{"iptables -w 22 "}, argv.to_string());
+    CPPUNIT_ASSERT_THROW(argv.at(4), std::out_of_range);
+  }
+
+  static void test_split_like_split() {
+    for (auto const &cmd :
+         {std::string{"ip addr add 10.0.0.1/24 dev lo"}, std::string{""},
+          std::string{"a  b"}, std::string{" a"}, std::string{"a "}}) {
+      Argv_arena argv;
+      argv.split(cmd, ' ');
+      CPPUNIT_ASSERT_EQUAL(split(cmd, ' '), args(argv));
+    }
+  }
+
+  static void test_argv() {
+    Argv_arena argv;
+    argv << "echo"
+         << "a";
+    auto const *const p = argv.argv();
+    CPPUNIT_ASSERT_EQUAL(std::string{"echo"}, std::string{p[0]});
+    CPPUNIT_ASSERT_EQUAL(std::string{"a"}, std::string{p[1]});
+    CPPUNIT_ASSERT(p[2] == nullptr);
+  }
+
+  static void test_clear_keeps_arguments_apart() {
+    Argv_arena argv;
+    argv << "a long argument which makes the buffer grow";
+    argv.clear();
+    CPPUNIT_ASSERT(argv.empty());
+    argv.split("x y", ' ');
+    CPPUNIT_ASSERT_EQUAL(std::string{"x y"}, argv.to_string());
+  }
+
+  static void test_spawn() {
+    Argv_arena argv;
+    argv << "true";
+    CPPUNIT_ASSERT_EQUAL(uint8_t{0}, spawn(argv));
+    argv.clear();
+    argv << "false";
+    CPPUNIT_ASSERT_EQUAL(uint8_t{1}, spawn(argv));
+    argv.clear();
+    CPPUNIT_ASSERT_THROW(spawn(argv), std::out_of_range);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Argv_arena_test);
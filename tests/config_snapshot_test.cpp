@@ -0,0 +1,196 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "config_snapshot.h"
+
+#include "args.h"
+
+#include <array>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+void write_file(std::string const &path, std::string const &content) {
+  std::ofstream out{path};
+  out << content;
+}
+
+/** overwrites the byte at offset with its complement */
+void flip_byte(std::string const &path, long const offset) {
+  std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+  file.seekg(offset);
+  auto const byte = static_cast<char>(file.get());
+  file.seekp(offset);
+  file.put(static_cast<char>(~byte));
+}
+
+/** sets the modification time of path to seconds after the epoch */
+void set_mtime(std::string const &path, time_t const seconds) {
+  std::array<timespec, 2> const times{{{seconds, 0}, {seconds, 0}}};
+  CPPUNIT_ASSERT_EQUAL(0, utimensat(AT_FDCWD, path.c_str(), times.data(), 0));
+}
+
+std::string hostname_of_first(Host_table const &table) {
+  return table.empty() ? "" : table.hostname(0);
+}
+} // namespace
+
+class Config_snapshot_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Config_snapshot_test);
+  CPPUNIT_TEST(test_round_trip);
+  CPPUNIT_TEST(test_empty_table);
+  CPPUNIT_TEST(test_damaged);
+  CPPUNIT_TEST(test_truncated);
+  CPPUNIT_TEST(test_other_version);
+  CPPUNIT_TEST(test_no_snapshot);
+  CPPUNIT_TEST(test_compile_config);
+  CPPUNIT_TEST(test_load_matching_snapshot);
+  CPPUNIT_TEST(test_load_backdated_edit);
+  CPPUNIT_TEST(test_load_damaged_snapshot);
+  CPPUNIT_TEST_SUITE_END();
+
+  std::string const config{"host\n"
+                           "name nas\n"
+                           "address 10.0.0.2/16\n"
+                           "address fe80::2\n"
+                           "port 22\n"
+                           "port 445\n"
+                           "mac 11:22:33:44:55:66\n"
+                           "interface br-lan\n"
+                           "ping_tries 3\n"
+                           "wol_method udp\n"
+                           "host\n"
+                           "name tv\n"
+                           "address 10.0.0.3\n"
+                           "interface eth0\n"
+                           "host\n"
+                           "address 10.0.0.4\n"
+                           "port 631\n"
+                           "interface br-lan\n"};
+  std::string dir;
+  std::string config_file;
+  std::string snapshot;
+
+public:
+  Config_snapshot_test() : dir{}, config_file{}, snapshot{} {}
+
+  void setUp() override {
+    std::array<char, 32> path{{"/tmp/snapshot_testXXXXXX"}};
+    CPPUNIT_ASSERT(mkdtemp(path.data()) != nullptr);
+    dir = path.data();
+    config_file = dir + "/watchHost.conf";
+    snapshot = snapshot_path(config_file);
+    write_file(config_file, config);
+  }
+
+  void tearDown() override {
+    unlink(config_file.c_str());
+    unlink(snapshot.c_str());
+    rmdir(dir.c_str());
+  }
+
+  void test_round_trip() {
+    auto const table = parse_host_table(config);
+    write_snapshot(table, snapshot);
+    auto const read = read_snapshot(snapshot);
+    CPPUNIT_ASSERT_EQUAL(table.size(), read.size());
+    CPPUNIT_ASSERT(table.interfaces() == read.interfaces());
+    for (size_t host = 0; host < table.size(); ++host) {
+      CPPUNIT_ASSERT(Args(table, host) == Args(read, host));
+      CPPUNIT_ASSERT_EQUAL(table.interface_id(host), read.interface_id(host));
+    }
+    // the temporary file is gone
+    CPPUNIT_ASSERT_EQUAL(-1, access((snapshot + ".tmp").c_str(), F_OK));
+  }
+
+  void test_empty_table() {
+    write_snapshot(Host_table{}, snapshot);
+    CPPUNIT_ASSERT(read_snapshot(snapshot).empty());
+  }
+
+  void test_damaged() {
+    write_snapshot(parse_host_table(config), snapshot);
+    flip_byte(snapshot, 100);
+    CPPUNIT_ASSERT_THROW(read_snapshot(snapshot), std::runtime_error);
+  }
+
+  void test_truncated() {
+    write_snapshot(parse_host_table(config), snapshot);
+    CPPUNIT_ASSERT_EQUAL(0, truncate(snapshot.c_str(), 100));
+    CPPUNIT_ASSERT_THROW(read_snapshot(snapshot), std::runtime_error);
+    CPPUNIT_ASSERT_EQUAL(0, truncate(snapshot.c_str(), 0));
+    CPPUNIT_ASSERT_THROW(read_snapshot(snapshot), std::runtime_error);
+  }
+
+  void test_other_version() {
+    write_snapshot(parse_host_table(config), snapshot);
+    // the version follows the 8 byte magic
+    flip_byte(snapshot, 8);
+    CPPUNIT_ASSERT_THROW(read_snapshot(snapshot), std::runtime_error);
+  }
+
+  void test_no_snapshot() {
+    CPPUNIT_ASSERT_THROW(read_snapshot(config_file), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(read_snapshot(dir + "/missing"), std::runtime_error);
+  }
+
+  void test_compile_config() {
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, compile_config(config_file));
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, read_snapshot(snapshot).size());
+    CPPUNIT_ASSERT_THROW(compile_config(dir + "/missing"), std::runtime_error);
+  }
+
+  void test_load_matching_snapshot() {
+    // a table the text doesn't describe tells whether the snapshot was used
+    auto const compiled = parse_host_table("host\nname snap\naddress 1.2.3.4");
+    write_snapshot(compiled, snapshot, config);
+    CPPUNIT_ASSERT_EQUAL(std::string{"snap"},
+                         hostname_of_first(load_host_table(config_file)));
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, read_snapshot(snapshot, config).size());
+    CPPUNIT_ASSERT_THROW(read_snapshot(snapshot, config + "\n"),
+                         std::runtime_error);
+    write_snapshot(compiled, snapshot);
+    CPPUNIT_ASSERT_EQUAL(std::string{"nas"},
+                         hostname_of_first(load_host_table(config_file)));
+  }
+
+  void test_load_backdated_edit() {
+    static auto const now = time(nullptr);
+    compile_config(config_file);
+    set_mtime(snapshot, now);
+    // like restoring a backup with cp -p: edited but older than the snapshot
+    write_file(config_file, "host\nname changed\naddress 10.0.0.5\n");
+    set_mtime(config_file, now - 10);
+    CPPUNIT_ASSERT_EQUAL(std::string{"changed"},
+                         hostname_of_first(load_host_table(config_file)));
+  }
+
+  void test_load_damaged_snapshot() {
+    static auto const now = time(nullptr);
+    compile_config(config_file);
+    flip_byte(snapshot, 100);
+    set_mtime(config_file, now - 10);
+    set_mtime(snapshot, now);
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, load_host_table(config_file).size());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Config_snapshot_test);
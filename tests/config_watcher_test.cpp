@@ -0,0 +1,98 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "config_watcher.h"
+
+#include <array>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+void write_file(std::string const &path, std::string const &content) {
+  std::ofstream out{path};
+  out << content;
+}
+
+bool readable(int const fd) {
+  pollfd pfd{fd, POLLIN, 0};
+  return poll(&pfd, 1, 0) == 1;
+}
+} // namespace
+
+class Config_watcher_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Config_watcher_test);
+  CPPUNIT_TEST(test_write);
+  CPPUNIT_TEST(test_rename);
+  CPPUNIT_TEST(test_other_files);
+  CPPUNIT_TEST(test_missing_directory);
+  CPPUNIT_TEST_SUITE_END();
+
+  std::string dir;
+
+public:
+  Config_watcher_test() : dir{} {}
+
+  void setUp() override {
+    std::array<char, 32> path{{"/tmp/config_testXXXXXX"}};
+    CPPUNIT_ASSERT(mkdtemp(path.data()) != nullptr);
+    dir = path.data();
+    write_file(dir + "/watchHost.conf", "host\n");
+  }
+
+  void tearDown() override {
+    for (auto const &name : {"watchHost.conf", "watchHost.conf~", "other"}) {
+      unlink((dir + '/' + name).c_str());
+    }
+    rmdir(dir.c_str());
+  }
+
+  void test_write() {
+    Config_watcher watcher{dir + "/watchHost.conf"};
+    CPPUNIT_ASSERT(!readable(watcher.fd()));
+    CPPUNIT_ASSERT(!watcher.changed());
+    write_file(dir + "/watchHost.conf", "host\nname a\n");
+    CPPUNIT_ASSERT(readable(watcher.fd()));
+    CPPUNIT_ASSERT(watcher.changed());
+    CPPUNIT_ASSERT(!readable(watcher.fd()));
+  }
+
+  void test_rename() {
+    Config_watcher watcher{dir + "/watchHost.conf"};
+    write_file(dir + "/watchHost.conf~", "host\nname b\n");
+    // writing the temporary file is no change yet
+    CPPUNIT_ASSERT(!watcher.changed());
+    CPPUNIT_ASSERT_EQUAL(0, rename((dir + "/watchHost.conf~").c_str(),
+                                   (dir + "/watchHost.conf").c_str()));
+    CPPUNIT_ASSERT(watcher.changed());
+  }
+
+  void test_other_files() {
+    Config_watcher watcher{dir + "/watchHost.conf"};
+    write_file(dir + "/other", "something");
+    CPPUNIT_ASSERT(readable(watcher.fd()));
+    CPPUNIT_ASSERT(!watcher.changed());
+  }
+
+  void test_missing_directory() {
+    CPPUNIT_ASSERT_THROW(Config_watcher{dir + "/missing/watchHost.conf"},
+                         std::runtime_error);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Config_watcher_test);
@@ -19,13 +19,14 @@
 #include "container_utils.h"
 #include "file_descriptor.h"
 #include "packet_test_utils.h"
+#include "process_runner.h"
 #include "spawn_process.h"
+#include "thread_pool.h"
 #include "to_string.h"
 
 #include <algorithm>
-#include <atomic>
 #include <cppunit/extensions/HelperMacros.h>
-#include <future>
+#include <thread>
 
 struct Is_ip_occupied_dummy {
   std::vector<std::tuple<std::string, IP_address>> const occupied;
@@ -51,7 +52,6 @@ struct Throwing_ip_occupied_dummy {
 
 static auto const sleep_10 = std::chrono::milliseconds(10);
 static auto const sleep_100 = std::chrono::milliseconds(100);
-static auto const second = 1000;
 
 class Duplicate_address_watcher_test : public CppUnit::TestFixture {
 
@@ -60,7 +60,6 @@ class Duplicate_address_watcher_test : public CppUnit::TestFixture {
           std::make_tuple("wlp3s0", parse_ip("192.168.1.1/24")),
           std::make_tuple("wlp3s0", parse_ip("2001:470:1f15:df3::1/64"))}};
   Pcap_dummy pcap{};
-  std::atomic_bool loop{true};
 
   CPPUNIT_TEST_SUITE(Duplicate_address_watcher_test);
   //  CPPUNIT_TEST(test_duplicate_address_watcher_constructor);
@@ -70,7 +69,8 @@ class Duplicate_address_watcher_test : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_duplicate_address_watcher_ipv6_ip_not_taken);
   CPPUNIT_TEST(test_duplicate_address_watcher_ipv6_ip_taken);
   CPPUNIT_TEST(test_duplicate_address_watcher_receives_exception_in_thread);
-  CPPUNIT_TEST(test_daw_thread_main_ipv6);
+  CPPUNIT_TEST(test_duplicate_address_watcher_ipv6);
+  CPPUNIT_TEST(test_checks_do_not_hold_workers);
   //  CPPUNIT_TEST(test_ip_neigh_checker);
   CPPUNIT_TEST(test_contains_mac_different_from_given);
   CPPUNIT_TEST(test_get_mac);
@@ -79,7 +79,6 @@ class Duplicate_address_watcher_test : public CppUnit::TestFixture {
 public:
   void setUp() override {
     pcap = Pcap_dummy();
-    loop = true;
   }
 
   void test_duplicate_address_watcher_constructor() {
@@ -89,7 +88,7 @@ public:
     CPPUNIT_ASSERT_EQUAL(std::string("enp0s25"), daw.iface);
     CPPUNIT_ASSERT_EQUAL(static_cast<Pcap_wrapper *>(&pcap), &daw.pcap);
     CPPUNIT_ASSERT_EQUAL(parse_ip("10.0.0.1/16"), daw.ip);
-    CPPUNIT_ASSERT_EQUAL(std::atomic_bool(false), daw.loop);
+    CPPUNIT_ASSERT(!daw.watching());
     const auto *ip_neigh_ptr = daw.is_ip_occupied.target<Ip_neigh_checker>();
     CPPUNIT_ASSERT(ip_neigh_ptr != nullptr);
     CPPUNIT_ASSERT_EQUAL(get_mac("enp0s25"), ip_neigh_ptr->this_nodes_mac);
@@ -108,14 +107,11 @@ public:
     {
       Duplicate_address_watcher daw{"enp0s25", parse_ip("10.0.0.1/16"), pcap,
                                     ip_checker};
-      CPPUNIT_ASSERT(!daw.loop);
-      CPPUNIT_ASSERT(!daw.watcher.joinable());
+      CPPUNIT_ASSERT(!daw.watching());
       CPPUNIT_ASSERT_EQUAL(std::string(""), daw(Action::add));
-      CPPUNIT_ASSERT(daw.loop);
-      CPPUNIT_ASSERT(daw.watcher.joinable());
+      CPPUNIT_ASSERT(daw.watching());
       CPPUNIT_ASSERT_EQUAL(std::string(""), daw(Action::del));
-      CPPUNIT_ASSERT(!daw.loop);
-      CPPUNIT_ASSERT(!daw.watcher.joinable());
+      CPPUNIT_ASSERT(!daw.watching());
     }
   }
 
@@ -141,36 +137,25 @@ public:
     auto const end_reason = pcap.get_end_reason();
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::duplicate_address ==
                    end_reason);
+    CPPUNIT_ASSERT(!daw2.watching());
     CPPUNIT_ASSERT_EQUAL(std::string(""), daw2(Action::del));
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::duplicate_address ==
                    pcap.get_end_reason());
   }
 
-  static void timeout(std::atomic_bool &loop, size_t const milliseconds) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
-    loop = false;
-  }
-
   void test_duplicate_address_watcher_ipv6_ip_taken() {
     // detect ip which is occupied by router
-    auto f = std::async(std::launch::async, timeout, std::ref(loop), second);
-    daw_thread_main_non_root("wlp3s0", parse_ip("2001:470:1f15:df3::1/64"),
-                             ip_checker, loop, pcap);
-
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::duplicate_address ==
-                   pcap.get_end_reason());
-    CPPUNIT_ASSERT(!loop);
+                   check_duplicate_address(
+                       "wlp3s0", parse_ip("2001:470:1f15:df3::1/64"),
+                       ip_checker));
   }
 
   void test_duplicate_address_watcher_ipv6_ip_not_taken() {
-    // just timeout
-    auto f = std::async(std::launch::async, timeout, std::ref(loop), second);
-    daw_thread_main_non_root("wlp3s0", parse_ip("2001:470:1f15:df3::DEAD/64"),
-                             ip_checker, loop, pcap);
-
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::unset ==
-                   pcap.get_end_reason());
-    CPPUNIT_ASSERT(!loop);
+                   check_duplicate_address(
+                       "wlp3s0", parse_ip("2001:470:1f15:df3::DEAD/64"),
+                       ip_checker));
   }
 
   void test_duplicate_address_watcher_receives_exception_in_thread() {
@@ -178,24 +163,58 @@ public:
                                   Throwing_ip_occupied_dummy()};
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::unset ==
                    pcap.get_end_reason());
-    CPPUNIT_ASSERT(!daw.loop);
+    CPPUNIT_ASSERT(!daw.watching());
     { daw(Action::add); }
     std::this_thread::sleep_for(sleep_100);
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::signal ==
                    pcap.get_end_reason());
-    CPPUNIT_ASSERT(!daw.loop);
+    CPPUNIT_ASSERT(!daw.watching());
   }
 
-  void test_daw_thread_main_ipv6() {
-    // is only executable as root
-    daw_thread_main_ipv6("enp0s25", parse_ip("2001:470:1f15:df3::1/64"),
-                         ip_checker, loop, pcap);
-
-    CPPUNIT_ASSERT(!loop);
+  void test_duplicate_address_watcher_ipv6() {
+    // blocking neighbor solicitations is only possible as root
+    Duplicate_address_watcher daw{"enp0s25",
+                                  parse_ip("2001:470:1f15:df3::1/64"), pcap,
+                                  ip_checker};
+    // the rule is added on our thread, so its failure is known right away
+    daw(Action::add);
+    CPPUNIT_ASSERT(!daw.watching());
     CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::signal ==
                    pcap.get_end_reason());
   }
 
+  void test_checks_do_not_hold_workers() {
+    // a check takes a second like arping, but runs on process_runner()
+    auto const slow_check = [](std::string const & /*iface*/,
+                               IP_address const & /*ip*/, Ip_check_done done) {
+      Argv_arena cmd;
+      cmd << "sleep"
+          << "1";
+      process_runner().run(std::move(cmd), Process_runner::default_timeout,
+                           [done](std::future<uint8_t> /*status*/,
+                                  Stream_reader & /*out*/) {
+                             std::promise<bool> occupied;
+                             occupied.set_value(false);
+                             done(occupied.get_future());
+                           });
+    };
+    std::vector<std::unique_ptr<Duplicate_address_watcher>> watchers;
+    for (size_t i = 0; i <= thread_pool().size(); ++i) {
+      watchers.push_back(std::make_unique<Duplicate_address_watcher>(
+          "lo", parse_ip("10.0.0." + to_string(i + 1)), pcap,
+          Start_ip_check{slow_check}));
+      (*watchers.back())(Action::add);
+    }
+    std::this_thread::sleep_for(sleep_100);
+    // more checks are running than the pool has workers
+    auto const start = std::chrono::steady_clock::now();
+    CPPUNIT_ASSERT_EQUAL(42, thread_pool().submit([]() { return 42; }).get());
+    CPPUNIT_ASSERT(std::chrono::steady_clock::now() - start < sleep_100);
+    for (auto const &watcher : watchers) {
+      CPPUNIT_ASSERT(watcher->watching());
+    }
+  }
+
   static void test_ip_neigh_checker() {
     std::vector<std::string> const ip_neigh_content = get_ip_neigh_output();
     Iface_Ips const iface_ips = get_iface_ips(ip_neigh_content);
@@ -0,0 +1,181 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "event_loop.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+class Event_loop_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Event_loop_test);
+  CPPUNIT_TEST(test_fd_readable);
+  CPPUNIT_TEST(test_remove_fd);
+  CPPUNIT_TEST(test_timers);
+  CPPUNIT_TEST(test_cancel_timer);
+  CPPUNIT_TEST(test_no_spinning_with_pending_timer);
+  CPPUNIT_TEST(test_post_and_stop);
+  CPPUNIT_TEST(test_backend_name);
+  CPPUNIT_TEST_SUITE_END();
+
+  /** epoll and, if usable, io_uring */
+  static std::vector<Event_loop::Backend> backends() {
+    std::vector<Event_loop::Backend> result{Event_loop::Backend::epoll};
+    try {
+      Event_loop const probe{Event_loop::Backend::io_uring};
+      result.push_back(Event_loop::Backend::io_uring);
+    } catch (std::runtime_error const &) {
+    }
+    return result;
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_fd_readable() {
+    for (auto const backend : backends()) {
+      Event_loop loop{backend};
+      File_descriptor read_end;
+      File_descriptor write_end;
+      std::tie(read_end, write_end) = get_self_pipes();
+      auto calls = 0;
+      loop.add_fd(read_end, [&read_end, &calls]() {
+        char c;
+        CPPUNIT_ASSERT_EQUAL(ssize_t{1}, ::read(read_end, &c, 1));
+        ++calls;
+      });
+      CPPUNIT_ASSERT_EQUAL(size_t{0},
+                           loop.run_once(std::chrono::milliseconds{0}));
+      CPPUNIT_ASSERT_EQUAL(ssize_t{1}, ::write(write_end, "a", 1));
+      CPPUNIT_ASSERT_EQUAL(size_t{1},
+                           loop.run_once(std::chrono::milliseconds{1000}));
+      // the fd stays registered
+      CPPUNIT_ASSERT_EQUAL(ssize_t{1}, ::write(write_end, "b", 1));
+      CPPUNIT_ASSERT_EQUAL(size_t{1},
+                           loop.run_once(std::chrono::milliseconds{1000}));
+      CPPUNIT_ASSERT_EQUAL(2, calls);
+      CPPUNIT_ASSERT_THROW(loop.add_fd(read_end, []() {}),
+                           std::runtime_error);
+    }
+  }
+
+  static void test_remove_fd() {
+    for (auto const backend : backends()) {
+      Event_loop loop{backend};
+      File_descriptor read_end;
+      File_descriptor write_end;
+      std::tie(read_end, write_end) = get_self_pipes();
+      auto calls = 0;
+      loop.add_fd(read_end, [&loop, &read_end, &calls]() {
+        ++calls;
+        loop.remove_fd(read_end);
+      });
+      CPPUNIT_ASSERT_EQUAL(ssize_t{1}, ::write(write_end, "a", 1));
+      loop.run_once(std::chrono::milliseconds{1000});
+      loop.run_once(std::chrono::milliseconds{10});
+      CPPUNIT_ASSERT_EQUAL(1, calls);
+      // the fd can be added again
+      loop.add_fd(read_end, [&calls]() { ++calls; });
+      loop.run_once(std::chrono::milliseconds{1000});
+      CPPUNIT_ASSERT_EQUAL(2, calls);
+    }
+  }
+
+  static void test_timers() {
+    for (auto const backend : backends()) {
+      Event_loop loop{backend};
+      std::vector<int> order;
+      loop.add_timer(std::chrono::milliseconds{30},
+                     [&order]() { order.push_back(2); });
+      loop.add_timer(std::chrono::milliseconds{10},
+                     [&order]() { order.push_back(1); });
+      auto const start = Event_loop::Clock::now();
+      while (order.size() < 2) {
+        loop.run_once(std::chrono::milliseconds{1000});
+      }
+      auto const elapsed = Event_loop::Clock::now() - start;
+      CPPUNIT_ASSERT(elapsed >= std::chrono::milliseconds{30});
+      CPPUNIT_ASSERT(elapsed < std::chrono::milliseconds{1000});
+      CPPUNIT_ASSERT_EQUAL(1, order.at(0));
+      CPPUNIT_ASSERT_EQUAL(2, order.at(1));
+    }
+  }
+
+  static void test_cancel_timer() {
+    for (auto const backend : backends()) {
+      Event_loop loop{backend};
+      auto fired = false;
+      auto const id = loop.add_timer(std::chrono::milliseconds{10},
+                                     [&fired]() { fired = true; });
+      CPPUNIT_ASSERT(loop.cancel_timer(id));
+      CPPUNIT_ASSERT(!loop.cancel_timer(id));
+      CPPUNIT_ASSERT_EQUAL(size_t{0},
+                           loop.run_once(std::chrono::milliseconds{30}));
+      CPPUNIT_ASSERT(!fired);
+    }
+  }
+
+  static void test_no_spinning_with_pending_timer() {
+    for (auto const backend : backends()) {
+      Event_loop loop{backend};
+      File_descriptor read_end;
+      File_descriptor write_end;
+      std::tie(read_end, write_end) = get_self_pipes();
+      loop.add_fd(read_end, [&read_end]() {
+        char c;
+        CPPUNIT_ASSERT_EQUAL(ssize_t{1}, ::read(read_end, &c, 1));
+      });
+      CPPUNIT_ASSERT_EQUAL(ssize_t{1}, ::write(write_end, "x", 1));
+      loop.add_timer(std::chrono::seconds{1}, []() {});
+      auto done = false;
+      loop.add_timer(std::chrono::milliseconds{300},
+                     [&done]() { done = true; });
+      // one iteration for the fd and one for the short timer, some more if
+      // signals interrupt waiting, but not one per pending timer check
+      auto iterations = 0;
+      while (!done) {
+        loop.run_once(std::chrono::milliseconds{-1});
+        ++iterations;
+      }
+      CPPUNIT_ASSERT(iterations < 20);
+    }
+  }
+
+  static void test_post_and_stop() {
+    for (auto const backend : backends()) {
+      Event_loop loop{backend};
+      auto posted = false;
+      std::thread runner{[&loop]() { loop.run(); }};
+      loop.post([&posted]() { posted = true; });
+      loop.post([&loop]() { loop.stop(); });
+      runner.join();
+      CPPUNIT_ASSERT(posted);
+      CPPUNIT_ASSERT(loop.is_stopped());
+    }
+  }
+
+  static void test_backend_name() {
+    std::ostringstream out;
+    out << Event_loop::Backend::epoll << ' ' << Event_loop::Backend::io_uring;
+    CPPUNIT_ASSERT_EQUAL(std::string{"epoll io_uring"}, out.str());
+    Event_loop const loop{};
+    CPPUNIT_ASSERT(loop.get_backend() == Event_loop::default_backend());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Event_loop_test);
@@ -0,0 +1,148 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "fanout_capture.h"
+
+#include "metrics.h"
+#include "packet_parser.h"
+#include "packet_test_utils.h"
+
+#include <arpa/inet.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <linux/if_ether.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+class Fanout_capture_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Fanout_capture_test);
+  CPPUNIT_TEST(test_linux_cooked_header);
+  CPPUNIT_TEST(test_worker_count);
+  CPPUNIT_TEST(test_capture_on_loopback);
+  CPPUNIT_TEST(test_break_loop);
+  CPPUNIT_TEST(test_shared_group);
+  CPPUNIT_TEST_SUITE_END();
+
+  /** sends a few UDP packets over lo until stop is set */
+  static void send_udp_to_lo(std::atomic_bool const &stop) {
+    int const sock = socket(AF_INET, SOCK_DGRAM, 0);
+    CPPUNIT_ASSERT(sock >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(9);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto const payload = std::string{"fanout"};
+    while (!stop) {
+      sendto(sock, payload.data(), payload.size(), 0,
+             reinterpret_cast<sockaddr const *>(&addr), sizeof(addr));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    close(sock);
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_linux_cooked_header() {
+    sockaddr_ll sll{};
+    sll.sll_pkttype = PACKET_HOST;
+    sll.sll_hatype = ARPHRD_ETHER;
+    sll.sll_halen = ETH_ALEN;
+    sll.sll_protocol = htons(ETH_P_IP);
+    auto const mac = mac_to_binary("11:22:33:44:55:66");
+    std::copy(std::begin(mac.ether_addr_octet), std::end(mac.ether_addr_octet),
+              std::begin(sll.sll_addr));
+
+    auto const header = linux_cooked_header(sll);
+    std::vector<uint8_t> const data(std::begin(header), std::end(header));
+    auto const ll = parse_link_layer(DLT_LINUX_SLL, std::begin(data),
+                                     std::end(data));
+    CPPUNIT_ASSERT(ll != nullptr);
+    CPPUNIT_ASSERT_EQUAL(size_t{Link_layer::lcc_header_size},
+                         ll->header_length());
+    CPPUNIT_ASSERT_EQUAL(uint16_t{ETH_P_IP}, ll->payload_protocol());
+    CPPUNIT_ASSERT_EQUAL(mac, ll->source());
+  }
+
+  static void test_worker_count() {
+    Fanout_capture const capture{"lo", 3};
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, capture.worker_count());
+    CPPUNIT_ASSERT_EQUAL(DLT_LINUX_SLL, capture.get_datalink());
+  }
+
+  static void test_capture_on_loopback() {
+    Fanout_capture capture{"lo", 2};
+    std::atomic_bool stop{false};
+    std::thread sender{send_udp_to_lo, std::cref(stop)};
+
+    Catch_incoming_connection catcher{capture.get_datalink()};
+    auto const ler = capture.loop(1, std::ref(catcher));
+    stop = true;
+    sender.join();
+
+    CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::packets_captured == ler);
+    CPPUNIT_ASSERT(std::get<0>(catcher.headers) != nullptr);
+    CPPUNIT_ASSERT(std::get<1>(catcher.headers) != nullptr);
+    CPPUNIT_ASSERT_EQUAL(parse_ip("127.0.0.1/32"),
+                         std::get<1>(catcher.headers)->destination());
+    CPPUNIT_ASSERT_EQUAL(uint64_t{1}, capture.get_stats().captured);
+  }
+
+  static void test_break_loop() {
+    Fanout_capture capture{"lo", 2};
+    capture.set_filter("udp port 1");
+    std::thread breaker{[&capture] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      capture.break_loop(Pcap_wrapper::Loop_end_reason::signal);
+    }};
+    auto const ler =
+        capture.loop(0, [](const pcap_pkthdr *, const u_char *) {});
+    breaker.join();
+    CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::signal == ler);
+  }
+
+  static void test_shared_group() {
+    auto const &seen = metrics().counter(
+        "sleep_proxy_captured_packets", "packets received by captures",
+        Metric_labels{{"iface", "lo"}});
+    auto const seen_before = seen.value();
+    Fanout_capture first{"lo", 2};
+    Fanout_capture second{"lo", 3};
+    // the second capture joins the workers of the first one
+    CPPUNIT_ASSERT_EQUAL(size_t{2}, second.worker_count());
+
+    std::atomic_bool stop{false};
+    std::thread sender{send_udp_to_lo, std::cref(stop)};
+    Catch_incoming_connection first_catcher{first.get_datalink()};
+    std::thread first_loop{
+        [&first, &first_catcher]() { first.loop(1, std::ref(first_catcher)); }};
+    Catch_incoming_connection second_catcher{second.get_datalink()};
+    auto const ler = second.loop(1, std::ref(second_catcher));
+    first_loop.join();
+    stop = true;
+    sender.join();
+
+    CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::packets_captured == ler);
+    CPPUNIT_ASSERT_EQUAL(uint64_t{1}, first.get_stats().captured);
+    CPPUNIT_ASSERT_EQUAL(uint64_t{1}, second.get_stats().captured);
+    CPPUNIT_ASSERT(seen.value() > seen_before);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Fanout_capture_test);
@@ -21,11 +21,13 @@
 #include "to_string.h"
 #include <container_utils.h>
 
+#include <array>
 #include <cppunit/extensions/HelperMacros.h>
 #include <cstdio>
 #include <cstring>
 #include <fcntl.h>
 #include <string>
+#include <sys/socket.h>
 #include <unistd.h>
 
 static auto const invalid_fd = int{-1};
@@ -45,6 +47,7 @@ class File_descriptor_test : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_get_self_pipes);
   CPPUNIT_TEST(test_fd_read);
   CPPUNIT_TEST(test_fd_read_from_self_pipe);
+  CPPUNIT_TEST(test_write_all);
   CPPUNIT_TEST(test_fd_self_pipe_without_close_on_exec);
   CPPUNIT_TEST(test_get_fd_from_stream);
   CPPUNIT_TEST(test_duplicate_file_descriptors);
@@ -205,6 +208,23 @@ public:
     CPPUNIT_ASSERT_EQUAL(std::string("testdata2"), data.at(1));
   }
 
+  static void test_write_all() {
+    auto const self_pipes = get_self_pipes();
+    std::string const text{"testdata\ntestdata2\n"};
+    write_all(std::get<1>(self_pipes), text.data(), text.size());
+    auto const lines = std::get<0>(self_pipes).read();
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), lines.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("testdata2"), lines.at(1));
+
+    // a socket without peer throws instead of killing us with SIGPIPE
+    std::array<int, 2> fds{{-1, -1}};
+    CPPUNIT_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()));
+    File_descriptor const local{fds.at(0)};
+    File_descriptor{fds.at(1)}.close();
+    CPPUNIT_ASSERT_THROW(write_all(local, text.data(), text.size()),
+                         std::runtime_error);
+  }
+
   static void test_fd_self_pipe_without_close_on_exec() {
     {
       auto const out_in = get_self_pipes();
@@ -0,0 +1,167 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "host_lifecycle.h"
+#include "metrics.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <vector>
+
+class Host_lifecycle_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Host_lifecycle_test);
+  CPPUNIT_TEST(test_wake);
+  CPPUNIT_TEST(test_disarm);
+  CPPUNIT_TEST(test_failure);
+  CPPUNIT_TEST(test_ignored_events);
+  CPPUNIT_TEST(test_durations);
+  CPPUNIT_TEST(test_observer);
+  CPPUNIT_TEST(test_metrics);
+  CPPUNIT_TEST_SUITE_END();
+
+  using Clock = Host_lifecycle::Clock;
+  using ms = std::chrono::milliseconds;
+
+  /** the states visited by handling events one after the other */
+  static std::vector<Host_state> walk(std::vector<Host_event> const &events) {
+    Host_lifecycle lifecycle;
+    std::vector<Host_state> states;
+    for (auto const event : events) {
+      lifecycle.handle(event);
+      states.push_back(lifecycle.state());
+    }
+    return states;
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_wake() {
+    auto const states =
+        walk({Host_event::silent, Host_event::armed, Host_event::syn,
+              Host_event::answered, Host_event::replayed});
+    std::vector<Host_state> const expected{
+        Host_state::arming, Host_state::armed, Host_state::waking,
+        Host_state::replaying, Host_state::awake};
+    CPPUNIT_ASSERT(expected == states);
+  }
+
+  static void test_disarm() {
+    for (auto const event : {Host_event::duplicate_address, Host_event::stop}) {
+      auto const states = walk(
+          {Host_event::silent, Host_event::armed, event, Host_event::disarmed});
+      std::vector<Host_state> const expected{
+          Host_state::arming, Host_state::armed, Host_state::disarming,
+          Host_state::awake};
+      CPPUNIT_ASSERT(expected == states);
+    }
+    // stopped before the rules are all in place
+    CPPUNIT_ASSERT_EQUAL(Host_state::disarming,
+                         next_state(Host_state::arming, Host_event::stop));
+  }
+
+  static void test_failure() {
+    auto const states =
+        walk({Host_event::silent, Host_event::armed, Host_event::syn,
+              Host_event::timeout, Host_event::replayed, Host_event::answered});
+    std::vector<Host_state> const expected{
+        Host_state::arming, Host_state::armed,  Host_state::waking,
+        Host_state::failed, Host_state::failed, Host_state::awake};
+    CPPUNIT_ASSERT(expected == states);
+    for (auto i = size_t{0}; i < host_state_count; ++i) {
+      CPPUNIT_ASSERT_EQUAL(
+          Host_state::failed,
+          next_state(static_cast<Host_state>(i), Host_event::error));
+    }
+  }
+
+  static void test_ignored_events() {
+    Host_lifecycle lifecycle;
+    CPPUNIT_ASSERT(!lifecycle.handle(Host_event::syn));
+    CPPUNIT_ASSERT(!lifecycle.handle(Host_event::disarmed));
+    CPPUNIT_ASSERT_EQUAL(Host_state::awake, lifecycle.state());
+    CPPUNIT_ASSERT(lifecycle.handle(Host_event::silent));
+    CPPUNIT_ASSERT(lifecycle.handle(Host_event::armed));
+    CPPUNIT_ASSERT(lifecycle.handle(Host_event::syn));
+    // a wake is not interrupted
+    CPPUNIT_ASSERT(!lifecycle.handle(Host_event::stop));
+    CPPUNIT_ASSERT(!lifecycle.handle(Host_event::duplicate_address));
+    CPPUNIT_ASSERT_EQUAL(Host_state::waking, lifecycle.state());
+  }
+
+  static void test_durations() {
+    auto const start = Clock::now();
+    Host_lifecycle lifecycle{{}, start};
+    lifecycle.handle(Host_event::silent, start + ms{10});
+    lifecycle.handle(Host_event::armed, start + ms{30});
+    lifecycle.handle(Host_event::stop, start + ms{100});
+    lifecycle.handle(Host_event::disarmed, start + ms{110});
+    CPPUNIT_ASSERT(start + ms{110} == lifecycle.since());
+
+    auto const now = start + ms{150};
+    auto const in = [&](Host_state const state) {
+      return std::chrono::duration_cast<ms>(lifecycle.time_in(state, now))
+          .count();
+    };
+    CPPUNIT_ASSERT_EQUAL(ms::rep{50}, in(Host_state::awake));
+    CPPUNIT_ASSERT_EQUAL(ms::rep{20}, in(Host_state::arming));
+    CPPUNIT_ASSERT_EQUAL(ms::rep{70}, in(Host_state::armed));
+    CPPUNIT_ASSERT_EQUAL(ms::rep{10}, in(Host_state::disarming));
+    CPPUNIT_ASSERT_EQUAL(ms::rep{0}, in(Host_state::waking));
+  }
+
+  static void test_observer() {
+    std::vector<Host_lifecycle::Transition> transitions;
+    auto const start = Clock::now();
+    Host_lifecycle lifecycle{
+        [&](Host_lifecycle::Transition const &t) { transitions.push_back(t); },
+        start};
+    lifecycle.handle(Host_event::silent, start + ms{5});
+    lifecycle.handle(Host_event::replayed, start + ms{6});
+    lifecycle.handle(Host_event::error, start + ms{8});
+    CPPUNIT_ASSERT_EQUAL(size_t{2}, transitions.size());
+    auto const &last = transitions.back();
+    CPPUNIT_ASSERT_EQUAL(Host_state::arming, last.from);
+    CPPUNIT_ASSERT_EQUAL(Host_state::failed, last.to);
+    CPPUNIT_ASSERT_EQUAL(Host_event::error, last.event);
+    CPPUNIT_ASSERT(start + ms{8} == last.at);
+    CPPUNIT_ASSERT(ms{3} == last.duration);
+  }
+
+  static void test_metrics() {
+    auto const start = Clock::now();
+    Host_lifecycle lifecycle{host_state_metrics("lifecycle_test"), start};
+    lifecycle.handle(Host_event::silent, start + ms{1500});
+    lifecycle.handle(Host_event::armed, start + ms{1750});
+    std::ostringstream out;
+    metrics().write(out);
+    auto const text = out.str();
+    auto const has = [&text](std::string const &line) {
+      return text.find(line + "\n") != std::string::npos;
+    };
+    CPPUNIT_ASSERT(has("sleep_proxy_host_state{host=\"lifecycle_test\","
+                       "sleep_proxy_host_state=\"armed\"} 1"));
+    CPPUNIT_ASSERT(has("sleep_proxy_host_state{host=\"lifecycle_test\","
+                       "sleep_proxy_host_state=\"awake\"} 0"));
+    CPPUNIT_ASSERT(has("sleep_proxy_host_state_seconds_total{host="
+                       "\"lifecycle_test\",state=\"awake\"} 1.5"));
+    CPPUNIT_ASSERT(has("sleep_proxy_host_state_seconds_total{host="
+                       "\"lifecycle_test\",state=\"arming\"} 0.25"));
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Host_lifecycle_test);
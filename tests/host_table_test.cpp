@@ -0,0 +1,163 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "host_table.h"
+
+#include "args.h"
+#include "ethernet.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <string>
+#include <vector>
+
+class Host_table_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Host_table_test);
+  CPPUNIT_TEST(test_parse);
+  CPPUNIT_TEST(test_defaults);
+  CPPUNIT_TEST(test_interned_interfaces);
+  CPPUNIT_TEST(test_skipped_lines);
+  CPPUNIT_TEST(test_invalid_values);
+  CPPUNIT_TEST(test_args_of_row);
+  CPPUNIT_TEST_SUITE_END();
+
+  std::string const config{"# lines before the first host are ignored\n"
+                           "address 1.1.1.1\n"
+                           "host\n"
+                           "name nas\n"
+                           "address 10.0.0.2/16\n"
+                           "address fe80::2\n"
+                           "port 22\n"
+                           "port 445\n"
+                           "mac 11:22:33:44:55:66\n"
+                           "interface br-lan\n"
+                           "ping_tries 3\n"
+                           "wol_method udp\n"
+                           "\n"
+                           "host\n"
+                           "name tv\n"
+                           "address 10.0.0.3\n"
+                           "port 8080\n"
+                           "interface eth0\n"
+                           "host\n"
+                           "name printer\n"
+                           "address 10.0.0.4\n"
+                           "port 631\n"
+                           "interface br-lan"};
+
+public:
+  Host_table_test() = default;
+
+  void setUp() override {}
+
+  void tearDown() override {}
+
+  void test_parse() {
+    auto const table = parse_host_table(config);
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, table.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"nas"}, table.hostname(0));
+    CPPUNIT_ASSERT_EQUAL(std::string{"br-lan"}, table.interface(0));
+    auto const addresses = table.addresses_of(0);
+    CPPUNIT_ASSERT_EQUAL(size_t{2}, addresses.size());
+    CPPUNIT_ASSERT(parse_ip("10.0.0.2/16") == *addresses.begin());
+    CPPUNIT_ASSERT(parse_ip("fe80::2/64") == *(addresses.begin() + 1));
+    auto const ports = table.ports_of(0);
+    CPPUNIT_ASSERT((std::vector<uint16_t>{22, 445}) ==
+                   std::vector<uint16_t>(ports.begin(), ports.end()));
+    CPPUNIT_ASSERT_EQUAL(std::string{"11:22:33:44:55:66"},
+                         binary_to_mac(table.mac(0)));
+    CPPUNIT_ASSERT_EQUAL(3U, table.ping_tries(0));
+    CPPUNIT_ASSERT(Wol_method::udp == table.wol_method(0));
+
+    CPPUNIT_ASSERT_EQUAL(std::string{"tv"}, table.hostname(1));
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, table.addresses_of(1).size());
+    CPPUNIT_ASSERT_EQUAL(uint16_t{8080}, *table.ports_of(1).begin());
+    // the last line has no newline
+    CPPUNIT_ASSERT_EQUAL(std::string{"br-lan"}, table.interface(2));
+  }
+
+  static void test_defaults() {
+    auto const table = parse_host_table("host\n");
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, table.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"lo"}, table.interface(0));
+    CPPUNIT_ASSERT(table.hostname(0).empty());
+    CPPUNIT_ASSERT_EQUAL(size_t{2}, table.addresses_of(0).size());
+    CPPUNIT_ASSERT(parse_ip("10.0.0.1/16") == *table.addresses_of(0).begin());
+    CPPUNIT_ASSERT_EQUAL(size_t{2}, table.ports_of(0).size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"1:12:34:45:67:89"},
+                         binary_to_mac(table.mac(0)));
+    CPPUNIT_ASSERT_EQUAL(5U, table.ping_tries(0));
+    CPPUNIT_ASSERT(Wol_method::ethernet == table.wol_method(0));
+
+    CPPUNIT_ASSERT(parse_host_table("").empty());
+    CPPUNIT_ASSERT(parse_host_table("name a\nport 1\n").empty());
+  }
+
+  void test_interned_interfaces() {
+    auto const table = parse_host_table(config);
+    CPPUNIT_ASSERT((std::vector<std::string>{"br-lan", "eth0"}) ==
+                   table.interfaces());
+    CPPUNIT_ASSERT_EQUAL(uint16_t{0}, table.interface_id(0));
+    CPPUNIT_ASSERT_EQUAL(uint16_t{1}, table.interface_id(1));
+    CPPUNIT_ASSERT_EQUAL(uint16_t{0}, table.interface_id(2));
+  }
+
+  static void test_skipped_lines() {
+    auto const table = parse_host_table("host\n"
+                                        "port 80 443\n"
+                                        "port\n"
+                                        "color blue\n"
+                                        "name a \n"
+                                        "port 81\n");
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, table.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"a"}, table.hostname(0));
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, table.ports_of(0).size());
+    CPPUNIT_ASSERT_EQUAL(uint16_t{81}, *table.ports_of(0).begin());
+  }
+
+  static std::string error_of(std::string const &config) {
+    try {
+      parse_host_table(config);
+    } catch (std::runtime_error const &e) {
+      return e.what();
+    }
+    return "";
+  }
+
+  static void test_invalid_values() {
+    for (auto const &line :
+         {"interface eth0;", "address 10.0.0.1/40", "address nonsense",
+          "port 70000", "mac 11:22", "name a,b", "ping_tries -",
+          "wol_method magic"}) {
+      auto const error = error_of(std::string{"host\nname a\n"} + line);
+      CPPUNIT_ASSERT_EQUAL(std::string{"line 3: "}, error.substr(0, 8));
+    }
+  }
+
+  void test_args_of_row() {
+    auto const table = parse_host_table(config);
+    Args const args{table, 0};
+    Args const expected{"br-lan",
+                        {"10.0.0.2/16", "fe80::2"},
+                        {"22", "445"},
+                        "11:22:33:44:55:66",
+                        "nas",
+                        "3",
+                        "udp"};
+    CPPUNIT_ASSERT(expected == args);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Host_table_test);
@@ -27,6 +27,7 @@ class Str_to_integral_test : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_stoll);
   CPPUNIT_TEST(test_stoull);
   CPPUNIT_TEST(test_uint32_t_to_eight_hex_chars);
+  CPPUNIT_TEST(test_hash_words);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -74,6 +75,14 @@ public:
                          stoull_with_checks("F", 16));
   }
 
+  static void test_hash_words() {
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, mix64(0));
+    CPPUNIT_ASSERT(mix64(1) != mix64(2));
+    // the words are not interchangeable
+    CPPUNIT_ASSERT(hash_words(1, 2) != hash_words(2, 1));
+    CPPUNIT_ASSERT_EQUAL(hash_words(1, 2), hash_words(1, 2));
+  }
+
   static void test_uint32_t_to_eight_hex_chars() {
     CPPUNIT_ASSERT_EQUAL(std::string("00000000"),
                          uint32_t_to_eight_hex_chars(0));
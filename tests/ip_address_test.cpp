@@ -18,12 +18,20 @@
 
 #include "to_string.h"
 
+#include <algorithm>
 #include <cppunit/extensions/HelperMacros.h>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
 
 class Ip_address_test : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(Ip_address_test);
   CPPUNIT_TEST(test_parse_ip);
   CPPUNIT_TEST(test_stream_operator);
+  CPPUNIT_TEST(test_parse_ip_range);
+  CPPUNIT_TEST(test_equality);
+  CPPUNIT_TEST(test_ordering);
+  CPPUNIT_TEST(test_hash);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -74,6 +82,72 @@ public:
     ss << ipa;
     CPPUNIT_ASSERT_EQUAL(std::string("192.168.1.2/23"), ss.str());
   }
+
+  static void test_parse_ip_range() {
+    // the range is a part of a line without a null byte after it
+    std::string const line{"address 10.1.2.3/16 fe80::1 ::1"};
+    auto const *const data = line.data();
+    auto const ipv4 = parse_ip_range(data + 8, data + 19);
+    CPPUNIT_ASSERT(parse_ip("10.1.2.3/16") == ipv4);
+    auto const ipv6 = parse_ip_range(data + 20, data + 27);
+    CPPUNIT_ASSERT(parse_ip("fe80::1/64") == ipv6);
+    auto const lo = parse_ip_range(data + 28, data + 31);
+    CPPUNIT_ASSERT(parse_ip("::1/128") == lo);
+    CPPUNIT_ASSERT_THROW(parse_ip_range(data, data + 19), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(parse_ip_range(data + 8, data + 8),
+                         std::invalid_argument);
+    std::string const too_long(100, '1');
+    CPPUNIT_ASSERT_THROW(
+        parse_ip_range(too_long.data(), too_long.data() + too_long.size()),
+        std::runtime_error);
+  }
+
+  static void test_equality() {
+    CPPUNIT_ASSERT(parse_ip("10.0.0.1/24") == parse_ip("10.0.0.1"));
+    CPPUNIT_ASSERT(parse_ip("10.0.0.1/16") != parse_ip("10.0.0.1/24"));
+    CPPUNIT_ASSERT(parse_ip("10.0.0.1") != parse_ip("10.0.0.2"));
+    CPPUNIT_ASSERT(parse_ip("::1/128") != parse_ip("::2/128"));
+    CPPUNIT_ASSERT(parse_ip("fe80::1") == parse_ip("fe80::1%lo"));
+    // the unused bytes of the union do not count for IPv4
+    auto ipv4 = parse_ip("10.0.0.1");
+    std::memset(&ipv4.address.ipv6.s6_addr[4], 0xff, 12);
+    CPPUNIT_ASSERT(parse_ip("10.0.0.1") == ipv4);
+    // ::a00:1 has the same first bytes as 10.0.0.1
+    IP_address ipv6{};
+    ipv6.family = AF_INET6;
+    ipv6.subnet = 24;
+    std::memcpy(&ipv6.address, &ipv4.address, sizeof(in_addr));
+    CPPUNIT_ASSERT(ipv4 != ipv6);
+  }
+
+  static void test_ordering() {
+    std::vector<IP_address> ips{parse_ip("fe80::1"), parse_ip("10.0.0.10/24"),
+                                parse_ip("::1"), parse_ip("10.0.0.9/24"),
+                                parse_ip("10.0.0.9/16"), parse_ip("9.0.0.1")};
+    std::sort(std::begin(ips), std::end(ips));
+    std::vector<IP_address> const sorted{
+        parse_ip("9.0.0.1"),     parse_ip("10.0.0.9/16"),
+        parse_ip("10.0.0.9/24"), parse_ip("10.0.0.10/24"),
+        parse_ip("::1"),         parse_ip("fe80::1")};
+    CPPUNIT_ASSERT(sorted == ips);
+    auto const ip = parse_ip("10.0.0.9");
+    CPPUNIT_ASSERT(!(ip < ip));
+  }
+
+  static void test_hash() {
+    std::hash<IP_address> const hash{};
+    auto ipv4 = parse_ip("10.0.0.1");
+    std::memset(&ipv4.address.ipv6.s6_addr[4], 0xff, 12);
+    CPPUNIT_ASSERT_EQUAL(hash(parse_ip("10.0.0.1")), hash(ipv4));
+    CPPUNIT_ASSERT(hash(parse_ip("10.0.0.1")) != hash(parse_ip("10.0.0.2")));
+    CPPUNIT_ASSERT(hash(parse_ip("10.0.0.1/24")) !=
+                   hash(parse_ip("10.0.0.1/16")));
+    std::unordered_set<IP_address> const ips{
+        parse_ip("10.0.0.1"), parse_ip("fe80::1"), parse_ip("10.0.0.1/24"),
+        parse_ip("fe80::1%lo"), parse_ip("fe80::2")};
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, ips.size());
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, ips.count(parse_ip("fe80::2")));
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Ip_address_test);
@@ -75,6 +75,7 @@ public:
     CPPUNIT_ASSERT_EQUAL(ipv6 + "%lo", get_bindable_ip("lo", ipv6));
     CPPUNIT_ASSERT_EQUAL(ipv4, get_bindable_ip("bla", ipv4));
     CPPUNIT_ASSERT_EQUAL(ipv6 + "%bla", get_bindable_ip("bla", ipv6));
+    CPPUNIT_ASSERT_EQUAL(ipv6, get_bindable_ip("", ipv6));
   }
 
   static std::vector<IP_address> parse_ips(const std::string &ips) {
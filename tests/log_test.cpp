@@ -16,17 +16,32 @@
 
 #include "log.h"
 
+#include <array>
+#include <thread>
+#include <vector>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 class Log_test : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(Log_test);
   CPPUNIT_TEST(test_log_string);
   CPPUNIT_TEST(test_log_fmt);
+  CPPUNIT_TEST(test_async_log);
+  CPPUNIT_TEST(test_async_log_drops);
+  CPPUNIT_TEST(test_async_log_overflow);
+  CPPUNIT_TEST(test_level);
+  CPPUNIT_TEST(test_parse_level);
+  CPPUNIT_TEST(test_deferred_format);
+  CPPUNIT_TEST(test_deferred_truncate);
+  CPPUNIT_TEST(test_rate_limit);
+  CPPUNIT_TEST(test_rate_limited_macro);
+  CPPUNIT_TEST(test_take_suppressed);
+  CPPUNIT_TEST(test_suppressed_at_stop);
   CPPUNIT_TEST_SUITE_END();
 
 public:
   void setUp() override { setup_log("Log_test", 0, LOG_USER); }
-  void tearDown() override {}
+  void tearDown() override { set_log_level(LOG_DEBUG); }
   static void test_log_string() {
     log_string(LOG_DEBUG, "test_log_string()");
     log_string(LOG_NOTICE, "test_log_string()");
@@ -42,6 +57,161 @@ public:
     log(LOG_ERR, "bla %d, %f", i, f);
     log(LOG_ALERT, "bla %d, %f", i, f);
   }
+  static void test_async_log() {
+    // tiny rings, so messages get dropped
+    start_async_log(2);
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 4; ++t) {
+      threads.emplace_back([t]() {
+        for (auto i = 0; i < 1000; ++i) {
+          log(LOG_DEBUG, "test_async_log() thread %d message %d", t, i);
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    flush_log();
+    stop_async_log();
+    // back to synchronous logging
+    log(LOG_DEBUG, "bla %d", 42);
+    start_async_log();
+    log(LOG_DEBUG, "bla %d", 42);
+    stop_async_log();
+  }
+  static void test_async_log_drops() {
+    auto const dropped_before = dropped_log_messages();
+    start_async_log(2);
+    log_detail::hold_writer(true);
+    // a new thread gets a new ring, which only takes two messages
+    std::thread{[]() {
+      for (auto i = 0; i < 10; ++i) {
+        LOG(LOG_DEBUG, "test_async_log_drops() message %d", i);
+      }
+    }}.join();
+    log_detail::hold_writer(false);
+    flush_log();
+    stop_async_log();
+    CPPUNIT_ASSERT_EQUAL(uint64_t{8}, dropped_log_messages() - dropped_before);
+  }
+  static void test_async_log_overflow() {
+    auto const dropped_before = dropped_log_messages();
+    std::string const long_text(2000, 'x');
+    start_async_log();
+    // longer than a record, both take the heap instead of being cut
+    LOG(LOG_DEBUG, "test_async_log_overflow() %s %d", long_text.c_str(), 42);
+    log(LOG_DEBUG, "test_async_log_overflow() %s", long_text.c_str());
+    flush_log();
+    stop_async_log();
+    CPPUNIT_ASSERT_EQUAL(dropped_before, dropped_log_messages());
+  }
+  static void test_level() {
+    auto evaluated = 0;
+    set_log_level(LOG_WARNING);
+    CPPUNIT_ASSERT_EQUAL(LOG_WARNING, get_log_level());
+    LOG(LOG_INFO, "not evaluated %d", ++evaluated);
+    LOG_STRING(LOG_NOTICE, std::to_string(++evaluated));
+    CPPUNIT_ASSERT_EQUAL(0, evaluated);
+    LOG(LOG_ERR, "evaluated %d", ++evaluated);
+    LOG_STRING(LOG_WARNING, std::to_string(++evaluated));
+    CPPUNIT_ASSERT_EQUAL(2, evaluated);
+    CPPUNIT_ASSERT(!log_enabled(LOG_DEBUG));
+    CPPUNIT_ASSERT(log_enabled(LOG_EMERG));
+  }
+  static void test_parse_level() {
+    CPPUNIT_ASSERT_EQUAL(LOG_ERR, parse_log_level("err"));
+    CPPUNIT_ASSERT_EQUAL(LOG_NOTICE, parse_log_level("notice"));
+    CPPUNIT_ASSERT_EQUAL(LOG_DEBUG, parse_log_level("7"));
+    CPPUNIT_ASSERT_THROW(parse_log_level("loud"), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(parse_log_level("8"), std::runtime_error);
+  }
+  static void test_deferred_format() {
+    std::array<char, 64> payload{};
+    auto *out = payload.data();
+    std::string const s{"abc"};
+    CPPUNIT_ASSERT(log_detail::encode_all(out, payload.data() + payload.size(),
+                                          uint8_t{42}, s.c_str(), 2.5,
+                                          static_cast<char const *>(nullptr)));
+    // the string lives in the payload, not in s
+    CPPUNIT_ASSERT_EQUAL(
+        size_t{1 + 4 + sizeof(double) + sizeof("(null)")},
+        static_cast<size_t>(out - payload.data()));
+    std::array<char, 64> text{};
+    log_detail::format_payload<uint8_t, char const *, double, char const *>(
+        text.data(), text.size(), "%u %s %.1f %s", payload.data());
+    CPPUNIT_ASSERT_EQUAL(std::string{"42 abc 2.5 (null)"},
+                         std::string{text.data()});
+  }
+  static void test_deferred_truncate() {
+    std::array<char, 8> payload{};
+    auto *out = payload.data();
+    auto *const end = payload.data() + payload.size();
+    CPPUNIT_ASSERT(log_detail::encode_all(out, end, "a long string"));
+    CPPUNIT_ASSERT_EQUAL(std::string{"a long "}, std::string{payload.data()});
+    // no room left for a number
+    out = payload.data();
+    CPPUNIT_ASSERT(!log_detail::encode_all(out, end, "abc", 1.0));
+  }
+  static void test_rate_limit() {
+    Log_rate_limit limit{3, 2};
+    auto const start = Log_rate_limit::Clock::now();
+    auto suppressed = uint64_t{42};
+    for (auto i = 0; i < 3; ++i) {
+      CPPUNIT_ASSERT(limit.allow(suppressed, start));
+      CPPUNIT_ASSERT_EQUAL(uint64_t{0}, suppressed);
+    }
+    CPPUNIT_ASSERT(!limit.allow(suppressed, start));
+    CPPUNIT_ASSERT(!limit.allow(suppressed, start));
+    // two per second refill one message after half a second
+    auto const later = start + std::chrono::milliseconds{500};
+    CPPUNIT_ASSERT(limit.allow(suppressed, later));
+    CPPUNIT_ASSERT_EQUAL(uint64_t{2}, suppressed);
+    CPPUNIT_ASSERT(!limit.allow(suppressed, later));
+    // a long pause refills only the burst
+    auto const much_later = start + std::chrono::seconds{60};
+    CPPUNIT_ASSERT(limit.allow(suppressed, much_later));
+    CPPUNIT_ASSERT_EQUAL(uint64_t{1}, suppressed);
+    CPPUNIT_ASSERT(limit.allow(suppressed, much_later));
+    CPPUNIT_ASSERT(limit.allow(suppressed, much_later));
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, suppressed);
+    CPPUNIT_ASSERT(!limit.allow(suppressed, much_later));
+  }
+  static void test_rate_limited_macro() {
+    auto evaluated = 0;
+    for (auto i = 0; i < 1000; ++i) {
+      LOG_RATE_LIMITED(LOG_ERR, "test_rate_limited_macro() %d", ++evaluated);
+    }
+    CPPUNIT_ASSERT_EQUAL(10, evaluated);
+  }
+  static void test_take_suppressed() {
+    Log_rate_limit limit{1, 1};
+    auto const start = Log_rate_limit::Clock::now();
+    auto suppressed = uint64_t{0};
+    CPPUNIT_ASSERT(limit.allow(suppressed, start));
+    CPPUNIT_ASSERT(!limit.allow(suppressed, start));
+    CPPUNIT_ASSERT(!limit.allow(suppressed, start));
+    // the storm still goes on, its next message reports the count
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, limit.take_suppressed(true, start));
+    auto const later = start + std::chrono::seconds{1};
+    CPPUNIT_ASSERT_EQUAL(uint64_t{2}, limit.take_suppressed(true, later));
+    CPPUNIT_ASSERT(limit.allow(suppressed, later));
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, suppressed);
+    CPPUNIT_ASSERT(!limit.allow(suppressed, later));
+    CPPUNIT_ASSERT_EQUAL(uint64_t{1}, limit.take_suppressed(false, later));
+  }
+  static void test_suppressed_at_stop() {
+    Log_rate_limit limit{1, 1, LOG_ERR, "test_suppressed_at_stop()"};
+    auto const far = Log_rate_limit::Clock::now() + std::chrono::hours{1};
+    auto suppressed = uint64_t{0};
+    start_async_log();
+    CPPUNIT_ASSERT(limit.allow(suppressed, far));
+    CPPUNIT_ASSERT(!limit.allow(suppressed, far));
+    CPPUNIT_ASSERT(!limit.allow(suppressed, far));
+    // the bucket is empty for an hour, so the writer leaves the count alone
+    flush_log();
+    stop_async_log();
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, limit.take_suppressed(false, far));
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Log_test);
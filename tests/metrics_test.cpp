@@ -0,0 +1,147 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "metrics.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+class Metrics_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Metrics_test);
+  CPPUNIT_TEST(test_counter_threads);
+  CPPUNIT_TEST(test_same_metric);
+  CPPUNIT_TEST(test_write);
+  CPPUNIT_TEST(test_type_mismatch);
+  CPPUNIT_TEST(test_server);
+  CPPUNIT_TEST_SUITE_END();
+
+  static std::string socket_path() {
+    return "/tmp/metrics_test." + std::to_string(getpid()) + ".sock";
+  }
+
+  /** connects to the server, sends request and reads until EOF */
+  static std::string scrape(std::string const &request) {
+    File_descriptor sock{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    auto const path = socket_path();
+    std::copy(std::begin(path), std::end(path), std::begin(addr.sun_path));
+    CPPUNIT_ASSERT_EQUAL(
+        0, connect(sock, reinterpret_cast<sockaddr const *>(&addr),
+                   sizeof(addr)));
+    if (!request.empty()) {
+      CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(request.size()),
+                           write(sock, request.data(), request.size()));
+    }
+    std::string response;
+    std::array<char, 4096> buffer{};
+    ssize_t n = 0;
+    while ((n = read(sock, buffer.data(), buffer.size())) > 0) {
+      response.append(buffer.data(), static_cast<size_t>(n));
+    }
+    return response;
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_counter_threads() {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 8; ++t) {
+      threads.emplace_back([&counter]() {
+        for (auto i = 0; i < 10000; ++i) {
+          counter.inc();
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t{80000}, counter.value());
+  }
+
+  static void test_same_metric() {
+    Metrics m;
+    auto &a = m.counter("requests", "help", {{"host", "a"}});
+    CPPUNIT_ASSERT(&a == &m.counter("requests", "help", {{"host", "a"}}));
+    CPPUNIT_ASSERT(&a != &m.counter("requests", "help", {{"host", "b"}}));
+    // the shards of heap allocated counters start on a cache line
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    CPPUNIT_ASSERT_EQUAL(uintptr_t{0}, reinterpret_cast<uintptr_t>(&a) % 64);
+    auto &host = m.unsharded_counter("host_seconds", "help", {{"host", "a"}});
+    CPPUNIT_ASSERT(&host == &m.unsharded_counter("host_seconds", "help",
+                                                 {{"host", "a"}}));
+    CPPUNIT_ASSERT(sizeof(host) < sizeof(a));
+  }
+
+  static void test_write() {
+    Metrics m;
+    m.counter("wol_packets", "sent", {{"method", "udp"}}).inc(3);
+    m.counter("seconds", "time", {}, Metrics::ns_per_s).inc(1500000000);
+    m.unsharded_counter("wol_packets", "sent", {{"method", "ethernet"}}).inc();
+    m.gauge("queue", "length").set(-2);
+    m.state("host_state", "state", {{"host", "a\"b"}}, "awake").set(1);
+    std::ostringstream out;
+    m.write(out);
+    CPPUNIT_ASSERT_EQUAL(std::string{"# TYPE host_state stateset\n"
+                                     "# HELP host_state state\n"
+                                     "host_state{host=\"a\\\"b\","
+                                     "host_state=\"awake\"} 1\n"
+                                     "# TYPE queue gauge\n"
+                                     "# HELP queue length\n"
+                                     "queue -2\n"
+                                     "# TYPE seconds counter\n"
+                                     "# HELP seconds time\n"
+                                     "seconds_total 1.5\n"
+                                     "# TYPE wol_packets counter\n"
+                                     "# HELP wol_packets sent\n"
+                                     "wol_packets_total{method=\"udp\"} 3\n"
+                                     "wol_packets_total{method=\"ethernet\"} "
+                                     "1\n"
+                                     "# EOF\n"},
+                         out.str());
+  }
+
+  static void test_type_mismatch() {
+    Metrics m;
+    m.counter("x", "help");
+    CPPUNIT_ASSERT_THROW(m.gauge("x", "help"), std::runtime_error);
+  }
+
+  static void test_server() {
+    metrics().counter("metrics_test_scrapes", "test").inc();
+    Metrics_server const server{socket_path()};
+    auto const http = scrape("GET /metrics HTTP/1.0\r\n\r\n");
+    CPPUNIT_ASSERT_EQUAL(std::string{"HTTP/1.0 200 OK\r\n"},
+                         http.substr(0, 17));
+    CPPUNIT_ASSERT(http.find("metrics_test_scrapes_total 1\n") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(http.find("# EOF\n") == http.size() - 6);
+
+    // no request at all gets plain text after the timeout
+    auto const plain = scrape("");
+    CPPUNIT_ASSERT_EQUAL(std::string{"# TYPE"}, plain.substr(0, 6));
+    CPPUNIT_ASSERT(plain.find("# EOF\n") == plain.size() - 6);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Metrics_test);
@@ -0,0 +1,99 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "mpsc_queue.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Mpsc_queue_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Mpsc_queue_test);
+  CPPUNIT_TEST(test_empty);
+  CPPUNIT_TEST(test_fifo);
+  CPPUNIT_TEST(test_destructor_frees_remaining_elements);
+  CPPUNIT_TEST(test_many_producers);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_empty() {
+    Mpsc_queue<int> queue;
+    CPPUNIT_ASSERT(queue.empty());
+    int value = 0;
+    CPPUNIT_ASSERT(!queue.pop(value));
+  }
+
+  static void test_fifo() {
+    Mpsc_queue<std::string> queue;
+    queue.push("a");
+    queue.push("b");
+    CPPUNIT_ASSERT(!queue.empty());
+    std::string value;
+    CPPUNIT_ASSERT(queue.pop(value));
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), value);
+    queue.push("c");
+    CPPUNIT_ASSERT(queue.pop(value));
+    CPPUNIT_ASSERT_EQUAL(std::string("b"), value);
+    CPPUNIT_ASSERT(queue.pop(value));
+    CPPUNIT_ASSERT_EQUAL(std::string("c"), value);
+    CPPUNIT_ASSERT(!queue.pop(value));
+    CPPUNIT_ASSERT(queue.empty());
+  }
+
+  static void test_destructor_frees_remaining_elements() {
+    Mpsc_queue<std::vector<int>> queue;
+    queue.push(std::vector<int>(100));
+    queue.push(std::vector<int>(200));
+  }
+
+  static void test_many_producers() {
+    static auto const producers = size_t{4};
+    static auto const per_producer = size_t{10000};
+    Mpsc_queue<std::pair<size_t, size_t>> queue;
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+      threads.emplace_back([&queue, p] {
+        for (size_t i = 0; i < per_producer; ++i) {
+          queue.push(std::make_pair(p, i));
+        }
+      });
+    }
+
+    // elements of one producer keep their order, none gets lost
+    std::vector<size_t> next(producers, 0);
+    size_t received = 0;
+    while (received < producers * per_producer) {
+      std::pair<size_t, size_t> value;
+      if (queue.pop(value)) {
+        CPPUNIT_ASSERT_EQUAL(next.at(value.first), value.second);
+        ++next.at(value.first);
+        ++received;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    CPPUNIT_ASSERT(queue.empty());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Mpsc_queue_test);
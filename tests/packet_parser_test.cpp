@@ -198,6 +198,7 @@ public:
     Catch_incoming_connection cic(DLT_EN10MB);
     pcap_pkthdr hdr{};
     hdr.len = static_cast<bpf_u_int32>(ethernet_ipv4_tcp.size());
+    hdr.caplen = hdr.len;
     cic(&hdr, ethernet_ipv4_tcp.data());
     CPPUNIT_ASSERT(ethernet_ipv4_tcp == cic.data);
     CPPUNIT_ASSERT_EQUAL(*std::get<0>(headers), *std::get<0>(cic.headers));
@@ -208,6 +209,7 @@ public:
     Catch_incoming_connection cic(DLT_LINUX_SLL);
     pcap_pkthdr hdr{};
     hdr.len = static_cast<bpf_u_int32>(lcc_unknown_udp.size());
+    hdr.caplen = hdr.len;
     cic(&hdr, lcc_unknown_udp.data());
     CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), cic.data.size());
     CPPUNIT_ASSERT_EQUAL(basic_headers(), cic.headers);
@@ -217,6 +219,7 @@ public:
     Catch_incoming_connection cic(DLT_LINUX_SLL);
     pcap_pkthdr hdr{};
     hdr.len = static_cast<bpf_u_int32>(lcc_unknown_udp.size());
+    hdr.caplen = hdr.len;
     cic(nullptr, nullptr);
     CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), cic.data.size());
     CPPUNIT_ASSERT_EQUAL(basic_headers(), cic.headers);
@@ -42,8 +42,6 @@ bool operator==(const Link_layer &lhs, const Link_layer &rhs);
 
 bool operator==(const ip &lhs, const ip &rhs);
 
-bool operator<(IP_address const &lhs, IP_address const &rhs);
-
 std::vector<std::string> get_ip_neigh_output();
 
 using Iface_Ips = std::vector<std::tuple<std::string, IP_address>>;
@@ -107,8 +105,6 @@ struct Tmp_fd_remap {
 
 bool operator==(ether_addr const &lhs, ether_addr const &rhs);
 
-std::ostream &operator<<(std::ostream &out, ether_addr const &ether_addr);
-
 struct Pcap_dummy : public Pcap_wrapper {
   Pcap_wrapper::Loop_end_reason loop_return;
 
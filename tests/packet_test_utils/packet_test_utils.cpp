@@ -91,10 +91,6 @@ bool operator==(const ip &lhs, const ip &rhs) {
          lhs.source() == rhs.source();
 }
 
-bool operator<(IP_address const &lhs, IP_address const &rhs) {
-  return lhs.with_subnet() < rhs.with_subnet();
-}
-
 std::vector<std::string> get_ip_neigh_output() {
   auto const out_in = get_self_pipes(false);
   std::vector<std::string> const cmd{"ip", "neigh"};
@@ -173,14 +169,6 @@ bool operator==(ether_addr const &lhs, ether_addr const &rhs) {
                     std::begin(rhs.ether_addr_octet));
 }
 
-std::ostream &operator<<(std::ostream &out, ether_addr const &ether_addr) {
-  out << "ether_addr("
-      << std::vector<uint8_t>(std::begin(ether_addr.ether_addr_octet),
-                              std::end(ether_addr.ether_addr_octet))
-      << ")";
-  return out;
-}
-
 Pcap_dummy::Pcap_dummy() : loop_return{Pcap_wrapper::Loop_end_reason::unset} {}
 
 void Pcap_dummy::set_loop_return(Pcap_wrapper::Loop_end_reason const &ler) {
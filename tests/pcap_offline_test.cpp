@@ -0,0 +1,151 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pcap_wrapper.h"
+#include "ethernet.h"
+#include "packet_parser.h"
+#include "packet_test_utils.h"
+#include "wol.h"
+#include "wol_watcher.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+namespace {
+struct Record {
+  uint32_t usec;
+  std::vector<uint8_t> data;
+  /** captured bytes, the whole frame if 0 */
+  uint32_t caplen;
+};
+
+void put_u32(std::ofstream &out, uint32_t const value) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  out.write(reinterpret_cast<char const *>(&value), sizeof(value));
+}
+
+/** writes a classic ethernet pcap file in host byte order */
+std::string write_capture(std::vector<Record> const &records) {
+  std::array<char, 32> path{{"/tmp/pcap_offline_testXXXXXX"}};
+  auto const fd = mkstemp(path.data());
+  CPPUNIT_ASSERT(fd >= 0);
+  close(fd);
+  std::ofstream out{path.data(), std::ios::binary};
+  static auto const magic = uint32_t{0xa1b2c3d4};
+  put_u32(out, magic);
+  // version 2.4, zone, sigfigs, snaplen, ethernet
+  put_u32(out, 4U << 16U | 2U);
+  put_u32(out, 0);
+  put_u32(out, 0);
+  put_u32(out, 65535);
+  put_u32(out, DLT_EN10MB);
+  for (auto const &record : records) {
+    auto const caplen = record.caplen == 0
+                            ? static_cast<uint32_t>(record.data.size())
+                            : record.caplen;
+    put_u32(out, record.usec / 1000000);
+    put_u32(out, record.usec % 1000000);
+    put_u32(out, caplen);
+    put_u32(out, static_cast<uint32_t>(record.data.size()));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    out.write(reinterpret_cast<char const *>(record.data.data()), caplen);
+  }
+  return path.data();
+}
+
+} // namespace
+
+class Pcap_offline_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Pcap_offline_test);
+  CPPUNIT_TEST(test_pipeline);
+  CPPUNIT_TEST(test_truncated);
+  CPPUNIT_TEST(test_realtime);
+  CPPUNIT_TEST(test_missing_file);
+  CPPUNIT_TEST_SUITE_END();
+
+  // initialized at construction, to_binary() needs other statics
+  std::vector<uint8_t> const syn = to_binary(
+      "00000000000000000000000008004500003c88d040004006b3e97f0000017f000001");
+  ether_addr const mac = mac_to_binary("01:12:34:45:67:89");
+  std::vector<uint8_t> const magic =
+      create_ethernet_header(mac, mac, 0x0842) + create_wol_payload(mac);
+  std::vector<std::string> files;
+
+public:
+  Pcap_offline_test() : files{} {}
+
+  void setUp() override {}
+
+  void tearDown() override {
+    for (auto const &file : files) {
+      std::remove(file.c_str());
+    }
+    files.clear();
+  }
+
+  void test_pipeline() {
+    files.push_back(write_capture({{0, magic, 0}, {1, syn, 0}, {2, syn, 0}}));
+    Pcap_wrapper pc{Pcap_wrapper::Offline{files.back(), false}};
+    CPPUNIT_ASSERT_EQUAL(DLT_EN10MB, pc.get_datalink());
+    Catch_incoming_connection cic{pc.get_datalink()};
+    auto packets = 0;
+    auto magic_packets = 0;
+    auto const ler =
+        pc.loop(0, [&](pcap_pkthdr const *header, u_char const *packet) {
+          ++packets;
+          cic(header, packet);
+          magic_packets += is_magic_packet(cic.data, mac) ? 1 : 0;
+        });
+    CPPUNIT_ASSERT(Pcap_wrapper::Loop_end_reason::packets_captured == ler);
+    CPPUNIT_ASSERT_EQUAL(3, packets);
+    CPPUNIT_ASSERT_EQUAL(1, magic_packets);
+    CPPUNIT_ASSERT(syn == cic.data);
+    CPPUNIT_ASSERT(std::get<1>(cic.headers) != nullptr);
+  }
+
+  void test_truncated() {
+    // only the captured bytes may be read
+    files.push_back(write_capture({{0, std::vector<uint8_t>(syn) + syn, 40}}));
+    Pcap_wrapper pc{Pcap_wrapper::Offline{files.back(), false}};
+    Catch_incoming_connection cic{pc.get_datalink()};
+    pc.loop(0, std::ref(cic));
+    CPPUNIT_ASSERT_EQUAL(size_t{40}, cic.data.size());
+    CPPUNIT_ASSERT(std::get<1>(cic.headers) != nullptr);
+  }
+
+  void test_realtime() {
+    static auto const gap = std::chrono::milliseconds{200};
+    files.push_back(write_capture(
+        {{0, syn, 0}, {static_cast<uint32_t>(gap.count() * 1000), syn, 0}}));
+    for (auto const realtime : {false, true}) {
+      Pcap_wrapper pc{Pcap_wrapper::Offline{files.back(), realtime}};
+      auto const start = std::chrono::steady_clock::now();
+      pc.loop(0, [](pcap_pkthdr const *, u_char const *) {});
+      auto const took = std::chrono::steady_clock::now() - start;
+      CPPUNIT_ASSERT_EQUAL(realtime, took >= gap);
+    }
+  }
+
+  static void test_missing_file() {
+    CPPUNIT_ASSERT_THROW(
+        Pcap_wrapper(Pcap_wrapper::Offline{"/nonexistent.pcap", false}),
+        std::runtime_error);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Pcap_offline_test);
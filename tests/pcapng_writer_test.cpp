@@ -0,0 +1,124 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pcapng_writer.h"
+
+#include <array>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+std::vector<uint8_t> read_file(std::string const &path) {
+  std::ifstream in{path, std::ios::binary};
+  return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+uint32_t u32_at(std::vector<uint8_t> const &data, size_t const offset) {
+  uint32_t value = 0;
+  std::memcpy(&value, &data.at(offset), sizeof(value));
+  return value;
+}
+
+bool exists(std::string const &path) { return access(path.c_str(), F_OK) == 0; }
+
+pcap_pkthdr header_of(size_t const size) {
+  pcap_pkthdr header{};
+  header.ts.tv_sec = 5000;
+  header.ts.tv_usec = 7;
+  header.caplen = static_cast<bpf_u_int32>(size);
+  header.len = static_cast<bpf_u_int32>(size + 100);
+  return header;
+}
+} // namespace
+
+class Pcapng_writer_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Pcapng_writer_test);
+  CPPUNIT_TEST(test_blocks);
+  CPPUNIT_TEST(test_rotation);
+  CPPUNIT_TEST_SUITE_END();
+
+  std::string dir;
+
+public:
+  Pcapng_writer_test() : dir{} {}
+
+  void setUp() override {
+    std::array<char, 32> path{{"/tmp/pcapng_testXXXXXX"}};
+    CPPUNIT_ASSERT(mkdtemp(path.data()) != nullptr);
+    dir = path.data();
+  }
+
+  void tearDown() override {
+    for (auto const &name : {"single", "ring.0", "ring.1", "ring.2"}) {
+      unlink((dir + '/' + name).c_str());
+    }
+    rmdir(dir.c_str());
+  }
+
+  void test_blocks() {
+    std::vector<uint8_t> const packet{1, 2, 3, 4, 5};
+    {
+      Pcapng_writer writer{dir + "/single", DLT_EN10MB, 1500};
+      writer.write(header_of(packet.size()), packet.data());
+      writer.flush();
+    }
+    auto const data = read_file(dir + "/single");
+    // section header, interface description and one packet of 5 + 3 bytes
+    CPPUNIT_ASSERT_EQUAL(size_t{28 + 20 + 40}, data.size());
+    CPPUNIT_ASSERT_EQUAL(uint32_t{0x0a0d0d0a}, u32_at(data, 0));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{28}, u32_at(data, 4));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{0x1a2b3c4d}, u32_at(data, 8));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{28}, u32_at(data, 24));
+
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1}, u32_at(data, 28));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{DLT_EN10MB}, u32_at(data, 36) & 0xffffU);
+    CPPUNIT_ASSERT_EQUAL(uint32_t{1500}, u32_at(data, 40));
+
+    auto const epb = size_t{48};
+    CPPUNIT_ASSERT_EQUAL(uint32_t{6}, u32_at(data, epb));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{40}, u32_at(data, epb + 4));
+    auto const timestamp = uint64_t{u32_at(data, epb + 12)} << 32U |
+                           u32_at(data, epb + 16);
+    CPPUNIT_ASSERT_EQUAL(uint64_t{5000000007}, timestamp);
+    CPPUNIT_ASSERT_EQUAL(uint32_t{5}, u32_at(data, epb + 20));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{105}, u32_at(data, epb + 24));
+    CPPUNIT_ASSERT(std::equal(std::begin(packet), std::end(packet),
+                              &data.at(epb + 28)));
+    CPPUNIT_ASSERT_EQUAL(uint32_t{40}, u32_at(data, epb + 36));
+  }
+
+  void test_rotation() {
+    std::vector<uint8_t> const packet(100, 0xaa);
+    {
+      // two packets fit into one file
+      Pcapng_writer writer{dir + "/ring", DLT_EN10MB, 1500, 48 + 2 * 132, 2};
+      for (auto i = 0; i < 5; ++i) {
+        writer.write(header_of(packet.size()), packet.data());
+      }
+    }
+    CPPUNIT_ASSERT(!exists(dir + "/ring.2"));
+    // the third file overwrote the first one
+    CPPUNIT_ASSERT_EQUAL(size_t{48 + 132}, read_file(dir + "/ring.0").size());
+    CPPUNIT_ASSERT_EQUAL(size_t{48 + 2 * 132},
+                         read_file(dir + "/ring.1").size());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Pcapng_writer_test);
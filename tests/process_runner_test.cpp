@@ -0,0 +1,161 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "process_runner.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class Process_runner_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Process_runner_test);
+  CPPUNIT_TEST(test_exit_status);
+  CPPUNIT_TEST(test_run_and_wait);
+  CPPUNIT_TEST(test_non_existing_command);
+  CPPUNIT_TEST(test_timeout);
+  CPPUNIT_TEST(test_kill_escalation);
+  CPPUNIT_TEST(test_max_children);
+  CPPUNIT_TEST(test_destructor_kills_children);
+  CPPUNIT_TEST(test_completion);
+  CPPUNIT_TEST_SUITE_END();
+
+  using Clock = std::chrono::steady_clock;
+  using Cmd = std::vector<std::string>;
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_exit_status() {
+    Process_runner runner{};
+    auto t = runner.run(Cmd{"true"});
+    auto f = runner.run(Cmd{"false"});
+    auto sh = runner.run(Cmd{"sh", "-c", "exit 3"});
+    CPPUNIT_ASSERT_EQUAL(uint8_t{0}, t.get());
+    CPPUNIT_ASSERT_EQUAL(uint8_t{1}, f.get());
+    CPPUNIT_ASSERT_EQUAL(uint8_t{3}, sh.get());
+    CPPUNIT_ASSERT_EQUAL(uint8_t{0}, process_runner().run(Cmd{"true"}).get());
+  }
+
+  static void test_run_and_wait() {
+    Process_runner runner{};
+    Argv_arena argv;
+    argv << "sh"
+         << "-c"
+         << "exit 3";
+    CPPUNIT_ASSERT_EQUAL(uint8_t{3}, runner.run_and_wait(argv));
+    // the arena is handed back, also if the command failed
+    CPPUNIT_ASSERT_EQUAL(std::string{"sh -c exit 3"}, argv.to_string());
+    argv.clear();
+    argv << "/bin/whereAmI";
+    CPPUNIT_ASSERT_THROW(runner.run_and_wait(argv), std::runtime_error);
+    CPPUNIT_ASSERT_EQUAL(std::string{"/bin/whereAmI"}, argv.to_string());
+  }
+
+  static void test_non_existing_command() {
+    Process_runner runner{};
+    auto f = runner.run(Cmd{"/bin/whereAmI"});
+    CPPUNIT_ASSERT_THROW(f.get(), std::runtime_error);
+  }
+
+  static void test_timeout() {
+    Process_runner runner{};
+    auto const start = Clock::now();
+    auto f = runner.run(Cmd{"sleep", "10"}, std::chrono::milliseconds{100});
+    CPPUNIT_ASSERT_THROW(f.get(), Process_timeout);
+    CPPUNIT_ASSERT(Clock::now() - start < std::chrono::seconds{2});
+  }
+
+  static void test_kill_escalation() {
+    Process_runner runner{};
+    auto const start = Clock::now();
+    auto f = runner.run(Cmd{"sh", "-c", "trap '' TERM; sleep 10"},
+                        std::chrono::milliseconds{100});
+    CPPUNIT_ASSERT_THROW(f.get(), Process_timeout);
+    auto const elapsed = Clock::now() - start;
+    CPPUNIT_ASSERT(elapsed >= Process_runner::kill_grace);
+    CPPUNIT_ASSERT(elapsed < std::chrono::seconds{5});
+  }
+
+  static void test_max_children() {
+    Process_runner runner{1};
+    auto const start = Clock::now();
+    std::vector<std::future<uint8_t>> results;
+    for (auto i = 0; i < 3; ++i) {
+      results.emplace_back(runner.run(Cmd{"sleep", "0.2"}));
+    }
+    for (auto &r : results) {
+      CPPUNIT_ASSERT_EQUAL(uint8_t{0}, r.get());
+    }
+    CPPUNIT_ASSERT(Clock::now() - start >= std::chrono::milliseconds{600});
+  }
+
+  static void test_destructor_kills_children() {
+    std::future<uint8_t> running;
+    std::future<uint8_t> queued;
+    auto const start = Clock::now();
+    {
+      Process_runner runner{1};
+      running = runner.run(Cmd{"sleep", "10"});
+      queued = runner.run(Cmd{"sleep", "10"});
+      std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    }
+    CPPUNIT_ASSERT_THROW(running.get(), std::runtime_error);
+    CPPUNIT_ASSERT_THROW(queued.get(), std::runtime_error);
+    CPPUNIT_ASSERT(Clock::now() - start < std::chrono::seconds{2});
+  }
+
+  static Argv_arena argv(Cmd const &cmd) {
+    Argv_arena arena;
+    for (auto const &arg : cmd) {
+      arena << arg;
+    }
+    return arena;
+  }
+
+  static void test_completion() {
+    std::promise<std::thread::id> called_on;
+    std::future<uint8_t> exit_status;
+    std::promise<Cmd> lines;
+    Process_runner runner{};
+    runner.run(argv(Cmd{"sh", "-c", "echo first; echo second; exit 2"}),
+               Process_runner::default_timeout,
+               [&](std::future<uint8_t> status, Stream_reader &out) {
+                 exit_status = std::move(status);
+                 Cmd read;
+                 for (auto const &line : out.lines()) {
+                   read.push_back(line.str());
+                 }
+                 lines.set_value(read);
+                 called_on.set_value(std::this_thread::get_id());
+               });
+    CPPUNIT_ASSERT(called_on.get_future().get() != std::this_thread::get_id());
+    CPPUNIT_ASSERT_EQUAL(uint8_t{2}, exit_status.get());
+    CPPUNIT_ASSERT((Cmd{"first", "second"}) == lines.get_future().get());
+
+    std::promise<bool> timed_out;
+    runner.run(argv(Cmd{"sleep", "10"}), std::chrono::milliseconds{100},
+               [&](std::future<uint8_t> status, Stream_reader & /*out*/) {
+                 try {
+                   status.get();
+                   timed_out.set_value(false);
+                 } catch (Process_timeout const &) {
+                   timed_out.set_value(true);
+                 }
+               });
+    CPPUNIT_ASSERT(timed_out.get_future().get());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Process_runner_test);
@@ -73,6 +73,7 @@ class Socket_test : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_constructor_throws);
   CPPUNIT_TEST(test_ioctl_throws);
   CPPUNIT_TEST(test_send_to);
+  CPPUNIT_TEST(test_paced_sender);
   //  CPPUNIT_TEST(test_get_ifindex);
   CPPUNIT_TEST(test_set_sock_opt);
   CPPUNIT_TEST(test_destructor);
@@ -138,6 +139,40 @@ public:
     CPPUNIT_ASSERT_THROW(s1.send_to(data, 0, broken_addr), std::runtime_error);
   }
 
+  static void test_paced_sender() {
+    sockaddr_in addr{0, 0, {0}, {0}};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(31338);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Socket_listen s0(AF_INET, SOCK_DGRAM);
+    s0.bind(addr);
+    Socket s1(AF_INET, SOCK_DGRAM);
+    Paced_sender::Frames const frames{{1}, {2, 2}, {3, 3, 3}};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto const *const destination = reinterpret_cast<sockaddr *>(&addr);
+
+    // batches of two, wrapping around at the end of frames
+    Paced_sender unlimited{2, 0};
+    CPPUNIT_ASSERT_EQUAL(
+        2U, unlimited.send(s1, frames, 2, 5, destination, sizeof(addr)));
+    CPPUNIT_ASSERT(frames.at(2) == s0.recv());
+    CPPUNIT_ASSERT(frames.at(0) == s0.recv());
+
+    // 100 frames per second send the fifth frame 40 ms after the first
+    Paced_sender paced{64, 100};
+    auto const start = std::chrono::steady_clock::now();
+    auto sent = size_t{0};
+    while (sent < 5) {
+      sent += paced.send(s1, frames, sent, 5 - sent, destination, sizeof(addr));
+    }
+    CPPUNIT_ASSERT(std::chrono::steady_clock::now() - start >=
+                   std::chrono::milliseconds{40});
+    for (auto i = size_t{0}; i < sent; ++i) {
+      CPPUNIT_ASSERT(frames.at(i % frames.size()) == s0.recv());
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, paced.full_queues());
+  }
+
   static void test_get_ifindex() {
     // Socket(int domain, int type, int protocol = 0)
     Socket s0(AF_INET, SOCK_DGRAM);
@@ -19,6 +19,7 @@
 #include "packet_test_utils.h"
 
 #include <cppunit/extensions/HelperMacros.h>
+#include <csignal>
 #include <cstring>
 #include <string>
 #include <thread>
@@ -29,6 +30,7 @@ class Spawn_process_test : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_wait_until_pid_exits);
   CPPUNIT_TEST(test_fork_exec);
   CPPUNIT_TEST(test_direct_output_to_self_pipes);
+  CPPUNIT_TEST(test_child_signal_mask);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -81,6 +83,23 @@ public:
     CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), content.size());
     CPPUNIT_ASSERT_EQUAL(std::string{"blablabla12"}, content.at(0));
   }
+
+  static void test_child_signal_mask() {
+    sigset_t usr1{};
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    sigset_t old{};
+    CPPUNIT_ASSERT_EQUAL(0, pthread_sigmask(SIG_BLOCK, &usr1, &old));
+    auto const self_pipes = get_self_pipes(false);
+    std::vector<std::string> const cmd{"grep", "SigBlk", "/proc/self/status"};
+    auto const status = spawn(cmd, File_descriptor(), std::get<1>(self_pipes));
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(0), status);
+    auto const content = std::get<0>(self_pipes).read();
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), content.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{"SigBlk:\t0000000000000000"},
+                         content.at(0));
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Spawn_process_test);
@@ -0,0 +1,96 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "spsc_ring.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <thread>
+
+class Spsc_ring_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Spsc_ring_test);
+  CPPUNIT_TEST(test_capacity);
+  CPPUNIT_TEST(test_full_and_empty);
+  CPPUNIT_TEST(test_threads);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_capacity() {
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, Spsc_ring<int>{1}.capacity());
+    CPPUNIT_ASSERT_EQUAL(size_t{8}, Spsc_ring<int>{5}.capacity());
+    CPPUNIT_ASSERT_EQUAL(size_t{8}, Spsc_ring<int>{8}.capacity());
+  }
+
+  static void test_full_and_empty() {
+    Spsc_ring<int> ring{2};
+    CPPUNIT_ASSERT(ring.empty());
+    CPPUNIT_ASSERT(ring.front() == nullptr);
+    for (auto i = 0; i < 2; ++i) {
+      auto *const slot = ring.claim();
+      CPPUNIT_ASSERT(slot != nullptr);
+      *slot = i;
+      ring.publish();
+    }
+    CPPUNIT_ASSERT(ring.claim() == nullptr);
+    auto const *const first = ring.front();
+    CPPUNIT_ASSERT(first != nullptr);
+    CPPUNIT_ASSERT_EQUAL(0, *first);
+    ring.pop();
+    // the freed slot is reused
+    auto *const reused = ring.claim();
+    CPPUNIT_ASSERT(reused != nullptr);
+    *reused = 2;
+    ring.publish();
+    for (auto i = 1; i <= 2; ++i) {
+      auto const *const front = ring.front();
+      CPPUNIT_ASSERT(front != nullptr);
+      CPPUNIT_ASSERT_EQUAL(i, *front);
+      ring.pop();
+    }
+    CPPUNIT_ASSERT(ring.empty());
+  }
+
+  static void test_threads() {
+    static auto const count = 100000;
+    Spsc_ring<int> ring{16};
+    std::thread producer{[&ring]() {
+      for (auto i = 0; i < count; ++i) {
+        int *slot = nullptr;
+        while ((slot = ring.claim()) == nullptr) {
+          std::this_thread::yield();
+        }
+        *slot = i;
+        ring.publish();
+      }
+    }};
+    for (auto expected = 0; expected < count;) {
+      auto const *const value = ring.front();
+      if (value == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      CPPUNIT_ASSERT_EQUAL(expected, *value);
+      ring.pop();
+      ++expected;
+    }
+    producer.join();
+    CPPUNIT_ASSERT(ring.empty());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Spsc_ring_test);
@@ -0,0 +1,145 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "stream_reader.h"
+#include "container_utils.h"
+#include "event_loop.h"
+#include "spawn_process.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class Stream_reader_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Stream_reader_test);
+  CPPUNIT_TEST(test_lines_like_split);
+  CPPUNIT_TEST(test_next_line);
+  CPPUNIT_TEST(test_field);
+  CPPUNIT_TEST(test_spawn_large_output);
+  CPPUNIT_TEST(test_event_loop);
+  CPPUNIT_TEST_SUITE_END();
+
+  static Stream_reader read_string(std::string const &data) {
+    File_descriptor read_end;
+    File_descriptor write_end;
+    std::tie(read_end, write_end) = get_self_pipes();
+    CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(data.size()),
+                         ::write(write_end, data.data(), data.size()));
+    write_end.close();
+    Stream_reader reader;
+    reader.read_all(read_end);
+    return reader;
+  }
+
+  static std::vector<std::string> strings(std::vector<Line_view> const &v) {
+    std::vector<std::string> result;
+    for (auto const &line : v) {
+      result.emplace_back(line.str());
+    }
+    return result;
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_lines_like_split() {
+    for (auto const &data :
+         {std::string{"a\nbb\nccc\n"}, std::string{""}, std::string{"\n\na"},
+          std::string{"no newline"}}) {
+      auto const reader = read_string(data);
+      CPPUNIT_ASSERT(reader.at_eof());
+      CPPUNIT_ASSERT_EQUAL(data.size(), reader.size());
+      CPPUNIT_ASSERT_EQUAL(split(data, '\n'), strings(reader.lines()));
+    }
+  }
+
+  static void test_next_line() {
+    File_descriptor read_end;
+    File_descriptor write_end;
+    std::tie(read_end, write_end) = get_self_pipes();
+    Stream_reader reader;
+    Line_view line{nullptr, 0};
+
+    CPPUNIT_ASSERT_EQUAL(ssize_t{6}, ::write(write_end, "one\ntw", 6));
+    CPPUNIT_ASSERT(reader.read_some(read_end));
+    CPPUNIT_ASSERT(reader.next_line(line));
+    CPPUNIT_ASSERT(line == std::string{"one"});
+    // incomplete lines are kept until the rest arrives
+    CPPUNIT_ASSERT(!reader.next_line(line));
+
+    CPPUNIT_ASSERT_EQUAL(ssize_t{3}, ::write(write_end, "o\nx", 3));
+    write_end.close();
+    reader.read_all(read_end);
+    CPPUNIT_ASSERT(reader.next_line(line));
+    CPPUNIT_ASSERT(line == std::string{"two"});
+    CPPUNIT_ASSERT(reader.next_line(line));
+    CPPUNIT_ASSERT(line == std::string{"x"});
+    CPPUNIT_ASSERT(!reader.next_line(line));
+  }
+
+  static void test_field() {
+    std::string const s{"    link/ether 11:22:33:44:55:66 brd ff:ff"};
+    Line_view const line{s.data(), s.size()};
+    CPPUNIT_ASSERT_EQUAL(split(s, ' ').at(5), line.field(5).str());
+    CPPUNIT_ASSERT_EQUAL(std::string{}, line.field(0).str());
+    CPPUNIT_ASSERT_THROW(line.field(42), std::out_of_range);
+    CPPUNIT_ASSERT(line.field(4).equals_ignore_case("LINK/ETHER"));
+    CPPUNIT_ASSERT(!line.field(4).equals_ignore_case("link/ethe"));
+  }
+
+  static void test_spawn_large_output() {
+    // more than a pipe can buffer, the child would block if we waited first
+    Argv_arena cmd;
+    cmd << "seq"
+        << "1"
+        << "100000";
+    Stream_reader out;
+    CPPUNIT_ASSERT_EQUAL(uint8_t{0}, spawn(cmd, out));
+    auto const lines = out.lines();
+    CPPUNIT_ASSERT_EQUAL(size_t{100000}, lines.size());
+    CPPUNIT_ASSERT(lines.front() == std::string{"1"});
+    CPPUNIT_ASSERT(lines.back() == std::string{"100000"});
+  }
+
+  static void test_event_loop() {
+    File_descriptor read_end;
+    File_descriptor write_end;
+    std::tie(read_end, write_end) = get_self_pipes();
+    fcntl(read_end, F_SETFL, fcntl(read_end, F_GETFL) | O_NONBLOCK);
+    Event_loop loop{};
+    Stream_reader reader;
+    std::vector<std::string> received;
+    loop.add_fd(read_end, [&]() {
+      if (!reader.read_some(read_end)) {
+        loop.remove_fd(read_end);
+      }
+      Line_view line{nullptr, 0};
+      while (reader.next_line(line)) {
+        received.emplace_back(line.str());
+      }
+    });
+    CPPUNIT_ASSERT_EQUAL(ssize_t{5}, ::write(write_end, "a\nb\nc", 5));
+    loop.run_once(std::chrono::milliseconds{1000});
+    CPPUNIT_ASSERT_EQUAL((std::vector<std::string>{"a", "b"}), received);
+    write_end.close();
+    loop.run_once(std::chrono::milliseconds{1000});
+    CPPUNIT_ASSERT(reader.at_eof());
+    CPPUNIT_ASSERT_EQUAL((std::vector<std::string>{"a", "b", "c"}), received);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Stream_reader_test);
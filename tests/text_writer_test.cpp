@@ -0,0 +1,176 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "text_writer.h"
+
+#include "args.h"
+#include "ethernet.h"
+#include "ip.h"
+#include "ip_address.h"
+#include "to_string.h"
+#include "wol.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <limits>
+#include <sstream>
+
+class Text_writer_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Text_writer_test);
+  CPPUNIT_TEST(test_write);
+  CPPUNIT_TEST(test_integers);
+  CPPUNIT_TEST(test_hex);
+  CPPUNIT_TEST(test_truncation);
+  CPPUNIT_TEST(test_ip_text);
+  CPPUNIT_TEST(test_like_streams);
+  CPPUNIT_TEST(test_to_string);
+  CPPUNIT_TEST_SUITE_END();
+
+  /** what the std::ostream overload of t writes */
+  template <typename T> static std::string streamed(T const &t) {
+    std::stringstream ss;
+    ss << t;
+    return ss.str();
+  }
+
+  template <typename T> static std::string written(T const &t) {
+    std::array<char, 512> text{};
+    Text_writer out{text};
+    out << t;
+    CPPUNIT_ASSERT(!out.truncated());
+    return out.str();
+  }
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_write() {
+    std::array<char, 32> text{};
+    Text_writer out{text};
+    CPPUNIT_ASSERT_EQUAL(size_t{0}, out.size());
+    CPPUNIT_ASSERT_EQUAL(std::string{}, std::string{out.c_str()});
+    out << "ip" << ' ' << std::string{"addr"};
+    CPPUNIT_ASSERT_EQUAL(std::string{"ip addr"}, out.str());
+    CPPUNIT_ASSERT_EQUAL(std::string{"ip addr"}, std::string{out.c_str()});
+    CPPUNIT_ASSERT_EQUAL(size_t{7}, out.size());
+    out.clear();
+    out << "del";
+    CPPUNIT_ASSERT_EQUAL(std::string{"del"}, out.str());
+  }
+
+  static void test_integers() {
+    CPPUNIT_ASSERT_EQUAL(std::string{"0"}, written(0));
+    CPPUNIT_ASSERT_EQUAL(std::string{"-42"}, written(-42L));
+    CPPUNIT_ASSERT_EQUAL(std::string{"8080"}, written(uint16_t{8080}));
+    CPPUNIT_ASSERT_EQUAL(std::string{"255"}, written(uint8_t{255}));
+    CPPUNIT_ASSERT_EQUAL(
+        std::to_string(std::numeric_limits<long long>::min()),
+        written(std::numeric_limits<long long>::min()));
+    CPPUNIT_ASSERT_EQUAL(
+        std::to_string(std::numeric_limits<unsigned long long>::max()),
+        written(std::numeric_limits<unsigned long long>::max()));
+  }
+
+  static void test_hex() {
+    std::array<char, 32> text{};
+    Text_writer out{text};
+    out.hex(0xfe80, 8);
+    out << ' ';
+    out.hex(0xab, 1);
+    CPPUNIT_ASSERT_EQUAL(std::string{"0000fe80 b"}, out.str());
+  }
+
+  static void test_truncation() {
+    std::array<char, 8> text{};
+    Text_writer out{text};
+    out << "1234567";
+    CPPUNIT_ASSERT(!out.truncated());
+    out << 8;
+    CPPUNIT_ASSERT(out.truncated());
+    CPPUNIT_ASSERT_EQUAL(std::string{"1234567"}, std::string{out.c_str()});
+    out.clear();
+    CPPUNIT_ASSERT(!out.truncated());
+
+    std::array<char, 1> nothing{{'x'}};
+    Text_writer empty{nothing};
+    empty << "a";
+    CPPUNIT_ASSERT(empty.truncated());
+    CPPUNIT_ASSERT_EQUAL('\0', nothing.at(0));
+  }
+
+  static void test_ip_text() {
+    auto const longest = parse_ip("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
+    auto const with_subnet = std::string{longest.with_subnet_text().c_str()};
+    CPPUNIT_ASSERT_EQUAL(
+        std::string{"ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff/64"},
+        with_subnet);
+    auto const mapped = parse_ip("::ffff:255.255.255.255/128");
+    CPPUNIT_ASSERT_EQUAL(std::string{"::ffff:255.255.255.255/128"},
+                         std::string{mapped.with_subnet_text().c_str()});
+    auto const ipv4 = parse_ip("10.0.0.1/16");
+    CPPUNIT_ASSERT_EQUAL(std::string{"10.0.0.1"},
+                         std::string{ipv4.pure_text().c_str()});
+    CPPUNIT_ASSERT_EQUAL(ipv4.pure(), std::string{ipv4.pure_text().c_str()});
+    CPPUNIT_ASSERT_EQUAL(std::string{"10.0.0.1/16"}, ipv4.with_subnet());
+  }
+
+  static void test_like_streams() {
+    auto const ipv6 = parse_ip("fe80::123/64");
+    CPPUNIT_ASSERT_EQUAL(streamed(ipv6), written(ipv6));
+
+    ether_addr const mac{{0, 17, 170, 205, 101, 67}};
+    CPPUNIT_ASSERT_EQUAL(std::string{"0:11:aa:cd:65:43"}, written(mac));
+    CPPUNIT_ASSERT_EQUAL(streamed(mac), written(mac));
+
+    ip const packet{ip::ipv6, ip::ipv6_header_size, parse_ip("fe80::1"),
+                    ipv6, IPPROTO_TCP};
+    CPPUNIT_ASSERT_EQUAL(std::string{"IPv6: dst = fe80::123, src = fe80::1"},
+                         written(packet));
+    CPPUNIT_ASSERT_EQUAL(streamed(packet), written(packet));
+
+    Link_layer const ll{Link_layer::ethernet_header_size, mac, ETHERTYPE_IP,
+                        "Ethernet: dst = 0:0:0:0:0:0, src = 0:11:aa:cd:65:43"};
+    CPPUNIT_ASSERT_EQUAL(streamed(ll), written(ll));
+
+    CPPUNIT_ASSERT_EQUAL(streamed(Wol_method::udp), written(Wol_method::udp));
+
+    Args const args{"eth0",          {"10.0.0.1/16", "fe80::123"},
+                    {"22", "80"},    "00:11:aa:cd:65:43",
+                    "host",          "5",
+                    "ethernet"};
+    CPPUNIT_ASSERT_EQUAL(streamed(args), written(args));
+  }
+
+  static void test_to_string() {
+    CPPUNIT_ASSERT_EQUAL(std::string{"-7"}, to_string(-7));
+    CPPUNIT_ASSERT_EQUAL(std::string{"65535"}, to_string(uint16_t{65535}));
+    // characters stay characters, like with streams
+    CPPUNIT_ASSERT_EQUAL(std::string{"a"}, to_string('a'));
+    CPPUNIT_ASSERT_EQUAL(std::string{"1"}, to_string(true));
+    auto const ip = parse_ip("2001:db8::1/64");
+    CPPUNIT_ASSERT_EQUAL(std::string{"2001:db8::1/64"}, to_string(ip));
+
+    // too long for the buffer on the stack, streamed instead
+    std::vector<std::string> addresses(40, "2001:db8::1/64");
+    Args const args{"eth0", addresses, {"22"}, "00:11:aa:cd:65:43", "host",
+                    "5",    "ethernet"};
+    auto const text = to_string(args);
+    CPPUNIT_ASSERT(text.size() > 256);
+    CPPUNIT_ASSERT_EQUAL(streamed(args), text);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Text_writer_test);
@@ -0,0 +1,119 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "thread_pool.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <stdexcept>
+
+class Thread_pool_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Thread_pool_test);
+  CPPUNIT_TEST(test_size);
+  CPPUNIT_TEST(test_submit);
+  CPPUNIT_TEST(test_failing_task);
+  CPPUNIT_TEST(test_parallel);
+  CPPUNIT_TEST(test_stealing);
+  CPPUNIT_TEST(test_post_after);
+  CPPUNIT_TEST(test_destructor_runs_queued);
+  CPPUNIT_TEST_SUITE_END();
+
+  using Clock = std::chrono::steady_clock;
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_size() {
+    CPPUNIT_ASSERT(Thread_pool::default_size() >= 1);
+    CPPUNIT_ASSERT_EQUAL(size_t{3}, Thread_pool{3}.size());
+    CPPUNIT_ASSERT_EQUAL(size_t{1}, Thread_pool{0}.size());
+    CPPUNIT_ASSERT_EQUAL(Thread_pool::default_size(), thread_pool().size());
+  }
+
+  static void test_submit() {
+    Thread_pool pool{2};
+    auto answer = pool.submit([]() { return 42; });
+    auto text = pool.submit([]() { return std::string{"pool"}; });
+    CPPUNIT_ASSERT_EQUAL(42, answer.get());
+    CPPUNIT_ASSERT_EQUAL(std::string{"pool"}, text.get());
+    CPPUNIT_ASSERT_EQUAL(7, thread_pool().submit([]() { return 7; }).get());
+  }
+
+  static void test_failing_task() {
+    Thread_pool pool{1};
+    auto failed = pool.submit(
+        []() -> int { throw std::runtime_error{"task failed"}; });
+    CPPUNIT_ASSERT_THROW(failed.get(), std::runtime_error);
+    // the worker survives tasks throwing without a future
+    pool.post([]() { throw std::runtime_error{"task failed"}; });
+    CPPUNIT_ASSERT_EQUAL(1, pool.submit([]() { return 1; }).get());
+  }
+
+  static void test_parallel() {
+    // every task waits until all of them run
+    auto const count = size_t{4};
+    Thread_pool pool{count};
+    std::atomic<size_t> running{0};
+    std::vector<std::future<bool>> results;
+    for (size_t i = 0; i < count; ++i) {
+      results.emplace_back(pool.submit([&running, count]() {
+        ++running;
+        auto const deadline = Clock::now() + std::chrono::seconds{5};
+        while (running < count && Clock::now() < deadline) {
+          std::this_thread::yield();
+        }
+        return running == count;
+      }));
+    }
+    for (auto &result : results) {
+      CPPUNIT_ASSERT(result.get());
+    }
+  }
+
+  static void test_stealing() {
+    // the subtask lands in the deque of the blocked worker
+    Thread_pool pool{2};
+    auto ids = pool.submit([&pool]() {
+      auto sub = pool.submit([]() { return std::this_thread::get_id(); });
+      return std::make_pair(std::this_thread::get_id(), sub.get());
+    });
+    auto const result = ids.get();
+    CPPUNIT_ASSERT(result.first != result.second);
+  }
+
+  static void test_post_after() {
+    Thread_pool pool{1};
+    auto const delay = std::chrono::milliseconds{50};
+    std::promise<Clock::time_point> ran;
+    auto const start = Clock::now();
+    pool.post_after(delay, [&ran]() { ran.set_value(Clock::now()); });
+    CPPUNIT_ASSERT(ran.get_future().get() - start >= delay);
+  }
+
+  static void test_destructor_runs_queued() {
+    std::atomic<int> counter{0};
+    {
+      Thread_pool pool{1};
+      for (auto i = 0; i < 100; ++i) {
+        pool.post([&counter]() { ++counter; });
+      }
+      pool.post_after(std::chrono::seconds{10}, [&counter]() { ++counter; });
+    }
+    CPPUNIT_ASSERT_EQUAL(100, counter.load());
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Thread_pool_test);
@@ -0,0 +1,127 @@
+// Copyright (C) 2026  Lutz Reinhardt
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "wake_latency.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+class Wake_latency_test : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(Wake_latency_test);
+  CPPUNIT_TEST(test_buckets);
+  CPPUNIT_TEST(test_percentiles);
+  CPPUNIT_TEST(test_beyond_max_bits);
+  CPPUNIT_TEST(test_empty);
+  CPPUNIT_TEST(test_threads);
+  CPPUNIT_TEST(test_report);
+  CPPUNIT_TEST_SUITE_END();
+
+  using ms = std::chrono::milliseconds;
+  using us = std::chrono::microseconds;
+
+public:
+  void setUp() override {}
+  void tearDown() override {}
+
+  static void test_buckets() {
+    // every value lies in its bucket and the buckets cover all values
+    auto previous_upper = uint64_t{0};
+    for (auto i = size_t{1}; i < Latency_histogram::bucket_count; ++i) {
+      auto const upper = Latency_histogram::bucket_upper_bound(i);
+      auto const lower = previous_upper + 1;
+      CPPUNIT_ASSERT_EQUAL(i, Latency_histogram::bucket_index(upper));
+      CPPUNIT_ASSERT_EQUAL(i, Latency_histogram::bucket_index(lower));
+      // relative error of a bucket is below 1/sub_buckets
+      CPPUNIT_ASSERT((upper - lower) * Latency_histogram::sub_buckets <= upper);
+      previous_upper = upper;
+    }
+    CPPUNIT_ASSERT_EQUAL(Latency_histogram::bucket_count - 1,
+                         Latency_histogram::bucket_index(~uint64_t{0}));
+  }
+
+  static void test_percentiles() {
+    Latency_histogram h;
+    for (auto i = 1; i <= 1000; ++i) {
+      h.record(us{i});
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t{1000}, h.count());
+    CPPUNIT_ASSERT(std::chrono::nanoseconds{us{1000}} == h.max());
+    CPPUNIT_ASSERT(std::chrono::nanoseconds{us{500}} +
+                       std::chrono::nanoseconds{500} ==
+                   h.mean());
+    for (auto const p : {50.0, 90.0, 99.0}) {
+      auto const exact = us{static_cast<int>(p * 10)};
+      auto const value = h.percentile(p);
+      CPPUNIT_ASSERT(value >= exact);
+      CPPUNIT_ASSERT(value <= exact + exact / Latency_histogram::sub_buckets);
+    }
+    CPPUNIT_ASSERT(h.percentile(100) == h.max());
+  }
+
+  static void test_beyond_max_bits() {
+    Latency_histogram h;
+    auto const long_wake = std::chrono::minutes{10};
+    h.record(long_wake);
+    CPPUNIT_ASSERT(h.percentile(50) == long_wake);
+  }
+
+  static void test_empty() {
+    Latency_histogram h;
+    CPPUNIT_ASSERT_EQUAL(uint64_t{0}, h.count());
+    CPPUNIT_ASSERT(h.percentile(50).count() == 0);
+    CPPUNIT_ASSERT(h.mean().count() == 0);
+    // negative durations of an unsynchronised clock count as 0
+    h.record(ms{-1});
+    CPPUNIT_ASSERT(h.max().count() == 0);
+  }
+
+  static void test_threads() {
+    Latency_histogram h;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 4; ++t) {
+      threads.emplace_back([&h, t]() {
+        for (auto i = 0; i < 10000; ++i) {
+          h.record(ms{t});
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t{40000}, h.count());
+    CPPUNIT_ASSERT(std::chrono::nanoseconds{ms{3}} == h.max());
+  }
+
+  static void test_report() {
+    auto &latency = wake_latency("report-test");
+    CPPUNIT_ASSERT(&latency == &wake_latency("report-test"));
+    latency[Wake_stage::wol].record(ms{2});
+    latency[Wake_stage::total].record(ms{1500});
+    std::ostringstream out;
+    write_wake_latency(out);
+    auto const report = out.str();
+    CPPUNIT_ASSERT(report.find("report-test wol: count 1 p50 2.000ms") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(report.find("report-test total: count 1") !=
+                   std::string::npos);
+    // stages without values are left out
+    CPPUNIT_ASSERT(report.find("report-test replay") == std::string::npos);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Wake_latency_test);
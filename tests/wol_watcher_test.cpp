@@ -38,7 +38,8 @@ std::vector<uint8_t> gen_random_data(size_t const size) {
 
 pcap_pkthdr create_header(size_t packet_length) {
   const struct pcap_pkthdr header {
-    {0, 0}, 0, static_cast<uint32_t>(packet_length)
+    {0, 0}, static_cast<uint32_t>(packet_length),
+        static_cast<uint32_t>(packet_length)
   };
   return header;
 }